@@ -1,3 +1,6 @@
+# glslc ships with the Vulkan SDK, it is optional and callers check GLSLC_EXECUTABLE before adding shaders
+find_program(GLSLC_EXECUTABLE glslc HINTS $ENV{VULKAN_SDK}/bin $ENV{VULKAN_SDK}/Bin)
+
 # add_target_shader: this function add a shader dependency in given target
 # this function add a shader dependency in given target and genearte a bin2c header file
 # <target> the target name
@@ -19,7 +22,7 @@ function(add_target_shader target resource_name)
     file(MAKE_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR}/${target}_spvs)
 
     add_custom_command(OUTPUT ${CMAKE_CURRENT_BINARY_DIR}/${target}_spvs/${FILENAME}.spv
-      COMMAND glslc ${shader} -o ${CMAKE_CURRENT_BINARY_DIR}/${target}_spvs/${FILENAME}.spv
+      COMMAND ${GLSLC_EXECUTABLE} ${shader} -o ${CMAKE_CURRENT_BINARY_DIR}/${target}_spvs/${FILENAME}.spv
       DEPENDS ${shader}
       COMMENT "Compiling ${FILENAME}"
     )
@@ -36,5 +39,8 @@ function(add_target_shader target resource_name)
 
   target_include_directories(${target}_${resource_name} INTERFACE $<BUILD_INTERFACE:${CMAKE_CURRENT_BINARY_DIR}/${target}_spvs>)
 
-  target_link_libraries(${target} ${target}_${resource_name})
+  # the generated header has to be a source of target, otherwise nothing triggers the custom commands
+  target_sources(${target} PRIVATE ${CMAKE_CURRENT_BINARY_DIR}/${target}_spvs/${resource_name}.hpp)
+
+  target_link_libraries(${target} PRIVATE ${target}_${resource_name})
 endfunction()
@@ -0,0 +1,301 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#ifndef ENGINE_INCLUDE_HEXGON_CORE_AABB_TREE_HPP_
+#define ENGINE_INCLUDE_HEXGON_CORE_AABB_TREE_HPP_
+
+#include <Hexgon/Core/Bounds.hpp>
+#include <Hexgon/Macro.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace hexgon {
+
+// Dynamic bounding volume hierarchy. Leaves store AABBs enlarged by a margin, so objects moving a little stay in
+// their leaf and only leave the tree when they escape it. Inserting picks the sibling with the surface area
+// heuristic and rotations keep the tree balanced, so queries visit O(log n) nodes.
+// Not thread safe for modification, concurrent queries are fine.
+class HEX_API AabbTree final {
+ public:
+  static constexpr int32_t kNullNode = -1;
+
+  explicit AabbTree(float margin = 0.1f);
+  ~AabbTree() = default;
+
+  // returns the proxy id handed to the query callbacks
+  int32_t Insert(Aabb const& aabb, void* user_data);
+
+  void Remove(int32_t proxy);
+
+  // `displacement` predicts the motion of the next frames and stretches the fat AABB along it.
+  // Returns true when the proxy had to be reinserted.
+  bool Move(int32_t proxy, Aabb const& aabb, glm::vec3 const& displacement = glm::vec3(0.f));
+
+  void* GetUserData(int32_t proxy) const { return m_nodes[proxy].user_data; }
+
+  Aabb const& GetFatAabb(int32_t proxy) const { return m_nodes[proxy].aabb; }
+
+  uint32_t GetProxyCount() const { return m_proxy_count; }
+
+  int32_t GetHeight() const { return m_root == kNullNode ? 0 : m_nodes[m_root].height; }
+
+  // sum of all node surface areas over the root's, a measure of tree quality
+  float GetAreaRatio() const;
+
+  void Clear();
+
+  // The callbacks are `bool(int32_t proxy)`, return false to stop. They receive every proxy whose fat AABB passes,
+  // testing the object itself is up to the caller.
+
+  template <typename Func>
+  void Query(Aabb const& aabb, Func&& func) const {
+    Traverse([&aabb](Aabb const& node) { return node.Overlaps(aabb); }, func);
+  }
+
+  template <typename Func>
+  void Query(BoundingSphere const& sphere, Func&& func) const {
+    Traverse(
+        [&sphere](Aabb const& node) {
+          glm::vec3 offset = glm::max(node.min - sphere.center, glm::max(sphere.center - node.max, glm::vec3(0.f)));
+          return glm::dot(offset, offset) <= sphere.radius * sphere.radius;
+        },
+        func);
+  }
+
+  // subtrees entirely inside the frustum are reported without testing their nodes
+  template <typename Func>
+  void Query(Frustum const& frustum, Func&& func) const;
+
+  // `func` is `float(int32_t proxy, float max_distance)` and returns the distance to clip the ray to, the hit
+  // distance when it hit the object, `max_distance` to go on unchanged and 0 to stop
+  template <typename Func>
+  void RayCast(glm::vec3 const& origin, glm::vec3 const& direction, float max_distance, Func&& func) const;
+
+ private:
+  struct Node {
+    Aabb aabb = {};
+    void* user_data = nullptr;
+    // next free node while on the free list
+    int32_t parent = kNullNode;
+    int32_t child1 = kNullNode;
+    int32_t child2 = kNullNode;
+    // leaf 0, free -1
+    int32_t height = -1;
+
+    bool IsLeaf() const { return child1 == kNullNode; }
+  };
+
+  // traversal stack, balanced trees never get deep enough to spill into the vector
+  template <typename T>
+  class Stack {
+   public:
+    void Push(T value) {
+      if (m_size < m_inline.size()) {
+        m_inline[m_size] = value;
+      } else {
+        m_spill.push_back(value);
+      }
+      m_size++;
+    }
+
+    T Pop() {
+      m_size--;
+      if (m_size < m_inline.size()) {
+        return m_inline[m_size];
+      }
+      T value = m_spill.back();
+      m_spill.pop_back();
+      return value;
+    }
+
+    bool IsEmpty() const { return m_size == 0; }
+
+   private:
+    std::array<T, 128> m_inline;
+    std::vector<T> m_spill;
+    size_t m_size = 0;
+  };
+
+  template <typename Test, typename Func>
+  void Traverse(Test&& test, Func&& func) const;
+
+  int32_t AllocateNode();
+
+  void FreeNode(int32_t node);
+
+  void InsertLeaf(int32_t leaf);
+
+  void RemoveLeaf(int32_t leaf);
+
+  // rotate so the subtree at `a` is balanced, returns its new root
+  int32_t Balance(int32_t a);
+
+  // refit and rebalance from `node` up to the root
+  void FixUpwards(int32_t node);
+
+ private:
+  std::vector<Node> m_nodes = {};
+  int32_t m_root = kNullNode;
+  int32_t m_free_list = kNullNode;
+  uint32_t m_proxy_count = 0;
+  float m_margin;
+};
+
+template <typename Test, typename Func>
+void AabbTree::Traverse(Test&& test, Func&& func) const {
+  if (m_root == kNullNode) {
+    return;
+  }
+
+  Stack<int32_t> stack{};
+  stack.Push(m_root);
+
+  while (!stack.IsEmpty()) {
+    Node const& node = m_nodes[stack.Pop()];
+
+    if (!test(node.aabb)) {
+      continue;
+    }
+
+    if (node.IsLeaf()) {
+      if (!func(static_cast<int32_t>(&node - m_nodes.data()))) {
+        return;
+      }
+    } else {
+      stack.Push(node.child1);
+      stack.Push(node.child2);
+    }
+  }
+}
+
+template <typename Func>
+void AabbTree::Query(Frustum const& frustum, Func&& func) const {
+  if (m_root == kNullNode) {
+    return;
+  }
+
+  constexpr uint32_t kAllPlanes = (1u << Frustum::kPlaneCount) - 1;
+
+  // node and the planes it still crosses, a node inside a plane passes the test for its whole subtree
+  Stack<std::pair<int32_t, uint32_t>> stack{};
+  stack.Push({m_root, kAllPlanes});
+
+  while (!stack.IsEmpty()) {
+    auto entry = stack.Pop();
+    Node const& node = m_nodes[entry.first];
+    uint32_t planes = entry.second;
+
+    glm::vec3 center = node.aabb.GetCenter();
+    glm::vec3 extent = node.aabb.GetExtent();
+    bool outside = false;
+
+    for (uint32_t p = 0; p < Frustum::kPlaneCount && !outside; p++) {
+      if (!(planes & (1u << p))) {
+        continue;
+      }
+
+      auto const& plane = frustum.planes[p];
+      glm::vec3 normal(plane);
+
+      float distance = glm::dot(normal, center) + plane.w;
+      float radius = glm::dot(glm::abs(normal), extent);
+
+      if (distance + radius < 0.f) {
+        outside = true;
+      } else if (distance - radius >= 0.f) {
+        planes &= ~(1u << p);
+      }
+    }
+
+    if (outside) {
+      continue;
+    }
+
+    if (node.IsLeaf()) {
+      if (!func(entry.first)) {
+        return;
+      }
+    } else {
+      stack.Push({node.child1, planes});
+      stack.Push({node.child2, planes});
+    }
+  }
+}
+
+template <typename Func>
+void AabbTree::RayCast(glm::vec3 const& origin, glm::vec3 const& direction, float max_distance, Func&& func) const {
+  if (m_root == kNullNode) {
+    return;
+  }
+
+  // division by zero gives infinities, which the slab test handles
+  glm::vec3 inverse(1.f / direction.x, 1.f / direction.y, 1.f / direction.z);
+
+  Stack<int32_t> stack{};
+  stack.Push(m_root);
+
+  while (!stack.IsEmpty()) {
+    int32_t index = stack.Pop();
+    Node const& node = m_nodes[index];
+
+    float enter = 0.f;
+    float exit = max_distance;
+
+    for (int axis = 0; axis < 3; axis++) {
+      float t0 = (node.aabb.min[axis] - origin[axis]) * inverse[axis];
+      float t1 = (node.aabb.max[axis] - origin[axis]) * inverse[axis];
+
+      // NaN from 0 * inf means the ray runs inside the slab
+      if (t0 != t0 || t1 != t1) {
+        continue;
+      }
+
+      enter = std::max(enter, std::min(t0, t1));
+      exit = std::min(exit, std::max(t0, t1));
+    }
+
+    if (enter > exit) {
+      continue;
+    }
+
+    if (node.IsLeaf()) {
+      float distance = func(index, max_distance);
+
+      if (distance == 0.f) {
+        return;
+      }
+
+      max_distance = std::min(max_distance, distance);
+    } else {
+      stack.Push(node.child1);
+      stack.Push(node.child2);
+    }
+  }
+}
+
+}  // namespace hexgon
+
+#endif  // ENGINE_INCLUDE_HEXGON_CORE_AABB_TREE_HPP_
@@ -29,10 +29,22 @@
 #include <Hexgon/Macro.hpp>
 #include <Hexgon/Render/RenderSystem.hpp>
 #include <Hexgon/Render/SwapChain.hpp>
+#include <chrono>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 namespace hexgon {
 
+struct StartupStage {
+  std::string name = {};
+  // milliseconds since Application::Create was entered
+  double begin = 0.0;
+  double end = 0.0;
+};
+
 class HEX_API Application final : public WindowDelegate {
  public:
   ~Application() = default;
@@ -45,6 +57,9 @@ class HEX_API Application final : public WindowDelegate {
 
   void Run();
 
+  // stages may overlap, the list is complete once the layers received their first update
+  std::vector<StartupStage> GetStartupStages() const;
+
   void PushLayer(std::shared_ptr<Layer> const& layer);
   void PopLayer(std::shared_ptr<Layer> const& layer);
 
@@ -56,14 +71,29 @@ class HEX_API Application final : public WindowDelegate {
   void OnCharEvent(CharEvent* event) override;
 
  private:
+  using Clock = std::chrono::steady_clock;
+
   Application() = default;
   static Application* g_instance;
 
+  // thread safe
+  void RecordStage(std::string name, Clock::time_point begin);
+
+  // true once every layer finished its prefetch
+  bool CollectPrefetch(bool wait);
+
+  void LogStartup();
+
  private:
   std::unique_ptr<Window> m_window = {};
   std::unique_ptr<RenderSystem> m_render_system = {};
   std::unique_ptr<SwapChain> m_swap_chain = {};
   LayerStack m_layer_stack = {};
+  std::vector<std::future<void>> m_prefetch = {};
+  Clock::time_point m_startup_begin = {};
+  mutable std::mutex m_startup_mutex = {};
+  std::vector<StartupStage> m_startup_stages = {};
+  bool m_startup_logged = false;
 };
 
 }  // namespace hexgon
@@ -0,0 +1,86 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#ifndef ENGINE_INCLUDE_HEXGON_CORE_BOUNDS_HPP_
+#define ENGINE_INCLUDE_HEXGON_CORE_BOUNDS_HPP_
+
+#include <Hexgon/Macro.hpp>
+#include <array>
+#include <glm/glm.hpp>
+
+namespace hexgon {
+
+struct HEX_API Aabb {
+  glm::vec3 min = glm::vec3(0.f);
+  glm::vec3 max = glm::vec3(0.f);
+
+  glm::vec3 GetCenter() const { return (min + max) * 0.5f; }
+
+  glm::vec3 GetExtent() const { return (max - min) * 0.5f; }
+
+  float GetSurfaceArea() const {
+    glm::vec3 size = max - min;
+    return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+  }
+
+  Aabb Merge(Aabb const& other) const { return Aabb{glm::min(min, other.min), glm::max(max, other.max)}; }
+
+  bool Contains(Aabb const& other) const {
+    return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z && other.max.x <= max.x &&
+           other.max.y <= max.y && other.max.z <= max.z;
+  }
+
+  bool Overlaps(Aabb const& other) const {
+    return min.x <= other.max.x && min.y <= other.max.y && min.z <= other.max.z && other.min.x <= max.x &&
+           other.min.y <= max.y && other.min.z <= max.z;
+  }
+
+  // bounds of the 8 transformed corners
+  Aabb Transform(glm::mat4 const& matrix) const;
+};
+
+struct HEX_API BoundingSphere {
+  glm::vec3 center = glm::vec3(0.f);
+  float radius = 0.f;
+
+  // a non uniform scale grows the radius by the largest axis
+  BoundingSphere Transform(glm::mat4 const& matrix) const;
+};
+
+// Normalized planes facing inwards, a point p is inside a plane when dot(plane.xyz, p) + plane.w >= 0.
+struct HEX_API Frustum {
+  enum Plane { kLeft, kRight, kBottom, kTop, kNear, kFar, kPlaneCount };
+
+  std::array<glm::vec4, kPlaneCount> planes = {};
+
+  // Gribb/Hartmann extraction from a projection * view matrix
+  static Frustum FromMatrix(glm::mat4 const& view_projection);
+
+  bool Intersects(Aabb const& aabb) const;
+
+  bool Intersects(BoundingSphere const& sphere) const;
+};
+
+}  // namespace hexgon
+
+#endif  // ENGINE_INCLUDE_HEXGON_CORE_BOUNDS_HPP_
@@ -24,6 +24,7 @@
 #ifndef ENGINE_INCLUDE_HEXGON_CORE_GEOMETRY_HPP_
 #define ENGINE_INCLUDE_HEXGON_CORE_GEOMETRY_HPP_
 
+#include <Hexgon/Core/Bounds.hpp>
 #include <Hexgon/Macro.hpp>
 #include <memory>
 #include <vector>
@@ -34,12 +35,44 @@ class GraphicsContext;
 
 class HEX_API Geometry {
  public:
+  // floats per vertex: position, normal, uv
+  static constexpr size_t kVertexStride = 8;
+
+  // a range of GetIndices(), every level draws from the same vertices
+  struct Lod {
+    uint32_t first_index = 0;
+    uint32_t index_count = 0;
+    // how far the simplified surface strays from the full detail one, in object space
+    float error = 0.f;
+  };
+
   Geometry() = default;
   virtual ~Geometry() = default;
 
   void Build();
 
-  size_t GetIndexCount() const { return m_index.size(); }
+  // Simplifies the full detail level with quadric error metrics into at most `max_lod_count` levels in total, each
+  // with about `reduction` times the triangles of the previous one. The chain ends early once the error would exceed
+  // `max_error` times the bounding sphere radius or a level barely removes anything.
+  void GenerateLods(uint32_t max_lod_count = 4, float reduction = 0.5f, float max_error = 0.1f);
+
+  // index count of the full detail level
+  size_t GetIndexCount() const { return m_lods.empty() ? m_index.size() : m_lods[0].index_count; }
+
+  std::vector<float> const& GetVertices() const { return m_vertex; }
+
+  // every level of detail back to back, the full detail one first
+  std::vector<uint32_t> const& GetIndices() const { return m_index; }
+
+  // at least one level after Build, errors grow with the level
+  size_t GetLodCount() const { return m_lods.size(); }
+
+  Lod const& GetLod(size_t level) const { return m_lods[level]; }
+
+  // object space bounds of the vertices, computed by Build
+  Aabb const& GetAabb() const { return m_aabb; }
+
+  BoundingSphere const& GetBoundingSphere() const { return m_sphere; }
 
   static std::unique_ptr<Geometry> MakeBox(float width = 1.f, float height = 1.f, float depth = 1.f,
                                            uint32_t width_segments = 1, uint32_t height_segments = 1,
@@ -60,6 +93,9 @@ class HEX_API Geometry {
  private:
   std::vector<float> m_vertex;
   std::vector<uint32_t> m_index;
+  std::vector<Lod> m_lods = {};
+  Aabb m_aabb = {};
+  BoundingSphere m_sphere = {};
 };
 
 }  // namespace hexgon
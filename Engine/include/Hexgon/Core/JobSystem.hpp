@@ -0,0 +1,81 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#ifndef ENGINE_INCLUDE_HEXGON_CORE_JOB_SYSTEM_HPP_
+#define ENGINE_INCLUDE_HEXGON_CORE_JOB_SYSTEM_HPP_
+
+#include <Hexgon/Macro.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hexgon {
+
+// Fixed pool of worker threads for data parallel work.
+// The calling thread always takes part in its own ParallelFor, so nested calls from inside a job do not deadlock.
+class HEX_API JobSystem final {
+ public:
+  // begin, end, thread_index
+  using ChunkFunc = std::function<void(uint32_t, uint32_t, uint32_t)>;
+
+  // stops and joins the workers, ParallelFor must not be running
+  ~JobSystem();
+
+  // created on first use, safe to call from several threads at once
+  static JobSystem* Get();
+
+  // worker threads plus the calling thread. `thread_index` passed to a job is in [0, GetThreadCount()), index 0 is
+  // shared by all threads outside the pool, so per thread resources indexed by it must only be used by one of them
+  uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_workers.size()) + 1; }
+
+  // split [0, count) into chunks of `chunk_size` and run them on all threads, returns after every chunk finished
+  void ParallelFor(uint32_t count, uint32_t chunk_size, ChunkFunc const& func);
+
+  static uint32_t GetCurrentThreadIndex();
+
+ private:
+  struct Batch;
+
+  explicit JobSystem(uint32_t worker_count);
+
+  void WorkerLoop(uint32_t thread_index);
+
+  void RunBatch(std::shared_ptr<Batch> const& batch, uint32_t thread_index);
+
+ private:
+  std::vector<std::thread> m_workers = {};
+  std::deque<std::shared_ptr<Batch>> m_batches = {};
+  std::mutex m_mutex = {};
+  std::condition_variable m_cv = {};
+  std::condition_variable m_done_cv = {};
+  bool m_stop = false;
+};
+
+}  // namespace hexgon
+
+#endif  // ENGINE_INCLUDE_HEXGON_CORE_JOB_SYSTEM_HPP_
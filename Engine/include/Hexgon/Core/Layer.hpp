@@ -45,6 +45,14 @@ class HEX_API Layer {
   virtual void OnUpdate(float tm) = 0;
   virtual void OnEvent(const Event* event) = 0;
 
+  // called after every layer's OnUpdate once world matrices are recomposed, record draws here
+  virtual void OnRender() {}
+
+  // runs on a background thread right after the layer is pushed, load and decode assets here. It may overlap
+  // OnAttach, OnUpdate is not called before it returned. Objects own transforms and must be created on the main
+  // thread, build their geometry and materials here and the objects in OnAttach or OnUpdate.
+  virtual void OnPrefetch() {}
+
   std::string const& GetLayerName() const { return m_name; }
 
  protected:
@@ -25,14 +25,31 @@
 #define ENGINE_INCLUDE_HEXGON_CORE_MATERIAL_HPP_
 
 #include <Hexgon/Macro.hpp>
+#include <cstdint>
 
 namespace hexgon {
 
 class HEX_API Material {
  public:
-  Material() {}
+  Material();
 
   ~Material() = default;
+
+  // a copy would share the id and look like the same material to bind checks
+  Material(Material const&) = delete;
+  Material& operator=(Material const&) = delete;
+
+  // unique among all materials, for sorting and redundant bind checks
+  uint32_t GetId() const { return m_id; }
+
+  // backend pipeline this material draws with, materials sharing it can be drawn without a pipeline switch
+  void SetPipeline(uint32_t pipeline) { m_pipeline = pipeline; }
+
+  uint32_t GetPipeline() const { return m_pipeline; }
+
+ private:
+  uint32_t m_id;
+  uint32_t m_pipeline = 0;
 };
 
 }  // namespace hexgon
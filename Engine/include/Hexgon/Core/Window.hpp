@@ -63,6 +63,10 @@ class HEX_API Window {
 
   static std::unique_ptr<Window> Create(std::string title, uint32_t width, uint32_t height);
 
+  // initialize the windowing platform, must run on the main thread. Create calls it too, calling it earlier lets
+  // the render instance be created on another thread while the window is being created
+  static bool InitPlatform();
+
   virtual void SetVSync(bool enabled) = 0;
 
   virtual void* GetNativeWindow() const = 0;
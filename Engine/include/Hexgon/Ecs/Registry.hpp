@@ -0,0 +1,367 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#ifndef ENGINE_INCLUDE_HEXGON_ECS_REGISTRY_HPP_
+#define ENGINE_INCLUDE_HEXGON_ECS_REGISTRY_HPP_
+
+#include <Hexgon/Core/JobSystem.hpp>
+#include <Hexgon/Macro.hpp>
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace hexgon {
+
+struct Entity {
+  uint32_t index = ~0u;
+  uint32_t generation = 0;
+
+  bool IsValid() const { return index != ~0u; }
+
+  bool operator==(Entity const& other) const { return index == other.index && generation == other.generation; }
+  bool operator!=(Entity const& other) const { return !(*this == other); }
+};
+
+using ComponentId = uint32_t;
+
+constexpr ComponentId kMaxComponents = 128;
+
+struct ComponentInfo {
+  const char* name = nullptr;
+  size_t size = 0;
+  size_t align = 0;
+  // move construct into `dst` and destroy `src`
+  void (*relocate)(void* dst, void* src) = nullptr;
+  void (*destroy)(void* ptr) = nullptr;
+};
+
+// ids are process wide and assigned on first use of a type, types are matched by name across modules
+HEX_API ComponentId RegisterComponent(ComponentInfo const& info);
+
+HEX_API ComponentInfo const& GetComponentInfo(ComponentId id);
+
+template <typename T>
+ComponentId ComponentIdOf() {
+  using Type = std::remove_cv_t<T>;
+
+  static_assert(alignof(Type) <= 64, "components are stored in 64 byte aligned chunks");
+
+  static const ComponentId id = RegisterComponent(ComponentInfo{
+      typeid(Type).name(),
+      sizeof(Type),
+      alignof(Type),
+      [](void* dst, void* src) {
+        new (dst) Type(std::move(*static_cast<Type*>(src)));
+        static_cast<Type*>(src)->~Type();
+      },
+      [](void* ptr) { static_cast<Type*>(ptr)->~Type(); },
+  });
+
+  return id;
+}
+
+template <typename... Ts>
+class Query;
+
+// Entities grouped by archetype, the exact set of components they have. Each archetype stores its entities in
+// 16 KB chunks holding one tightly packed array per component, and every chunk remembers the registry version of the
+// last write to each of its arrays so systems can skip chunks that did not change.
+// Structural changes (create, destroy, add, remove) are not thread safe and must not happen during a query.
+class HEX_API Registry final {
+  template <typename... Ts>
+  friend class Query;
+
+ public:
+  static constexpr size_t kChunkSize = 16 * 1024;
+
+  Registry();
+  ~Registry();
+
+  Registry(Registry const&) = delete;
+  Registry& operator=(Registry const&) = delete;
+
+  Entity Create();
+
+  template <typename... Ts>
+  Entity Create(Ts&&... components) {
+    Entity entity = Create();
+    (Add<std::decay_t<Ts>>(entity, std::forward<Ts>(components)), ...);
+    return entity;
+  }
+
+  void Destroy(Entity entity);
+
+  bool IsAlive(Entity entity) const;
+
+  // replaces the value if the entity already has a T, nullptr if the archetype does not fit into a chunk
+  template <typename T, typename... Args>
+  T* Add(Entity entity, Args&&... args) {
+    if (T* existing = Get<T>(entity)) {
+      *existing = T(std::forward<Args>(args)...);
+      return existing;
+    }
+
+    void* storage = AddComponent(entity, ComponentIdOf<T>());
+
+    return storage ? new (storage) T(std::forward<Args>(args)...) : nullptr;
+  }
+
+  template <typename T>
+  void Remove(Entity entity) {
+    RemoveComponent(entity, ComponentIdOf<T>());
+  }
+
+  // counts as a write of the entity's whole chunk
+  template <typename T>
+  T* Get(Entity entity) {
+    return static_cast<T*>(GetComponent(entity, ComponentIdOf<T>(), true));
+  }
+
+  template <typename T>
+  const T* Get(Entity entity) const {
+    return static_cast<const T*>(const_cast<Registry*>(this)->GetComponent(entity, ComponentIdOf<T>(), false));
+  }
+
+  template <typename T>
+  bool Has(Entity entity) const {
+    return Get<T>(entity) != nullptr;
+  }
+
+  // advanced by every write, remember it after a system ran and pass it to Query::Changed next time
+  uint64_t GetVersion() const { return m_version; }
+
+  uint32_t GetEntityCount() const { return m_entity_count; }
+
+  uint32_t GetArchetypeCount() const { return static_cast<uint32_t>(m_archetypes.size()); }
+
+  uint32_t GetChunkCount() const;
+
+ private:
+  using Mask = std::bitset<kMaxComponents>;
+
+  struct Chunk {
+    uint8_t* data = nullptr;
+    uint32_t count = 0;
+    // per component slot
+    std::vector<uint64_t> versions = {};
+  };
+
+  struct Archetype {
+    Mask mask = {};
+    // sorted, the slot of a component is its position here
+    std::vector<ComponentId> components = {};
+    // byte offset of each component array inside a chunk, the entity array is at 0
+    std::vector<uint32_t> offsets = {};
+    // copied from the component table, per slot
+    std::vector<ComponentInfo> infos = {};
+    std::array<int16_t, kMaxComponents> slots = {};
+    uint32_t capacity = 0;
+    std::vector<Chunk> chunks = {};
+    std::unordered_map<ComponentId, Archetype*> add_edges = {};
+    std::unordered_map<ComponentId, Archetype*> remove_edges = {};
+  };
+
+  struct Record {
+    Archetype* archetype = nullptr;
+    uint32_t chunk = 0;
+    uint32_t row = 0;
+    uint32_t generation = 0;
+  };
+
+  void* AddComponent(Entity entity, ComponentId id);
+
+  void RemoveComponent(Entity entity, ComponentId id);
+
+  void* GetComponent(Entity entity, ComponentId id, bool write);
+
+  Archetype* FindArchetype(std::vector<ComponentId> components);
+
+  // free row at the end of the archetype, the components are not constructed
+  std::pair<uint32_t, uint32_t> AllocateRow(Archetype* archetype);
+
+  // move the last row of the archetype into a row whose components are already destroyed or moved out
+  void FillHole(Archetype* archetype, uint32_t chunk, uint32_t row);
+
+  void MoveEntity(Record& record, Archetype* target);
+
+  static uint8_t* Column(Archetype const& archetype, Chunk const& chunk, int16_t slot) {
+    return chunk.data + archetype.offsets[slot];
+  }
+
+ private:
+  std::vector<std::unique_ptr<Archetype>> m_archetypes = {};
+  std::unordered_map<Mask, Archetype*> m_archetype_lookup = {};
+  Archetype* m_empty_archetype = nullptr;
+  std::vector<Record> m_records = {};
+  std::vector<uint32_t> m_free_entities = {};
+  uint32_t m_entity_count = 0;
+  uint64_t m_version = 1;
+};
+
+// Iterates every chunk whose archetype has all of Ts. Components named as `const T` are read only, every other one
+// counts as written and stamps the chunks it visits with a new version.
+//
+//   Query<Velocity, const Position> query(registry);
+//   query.Changed<Position>(last_version).ParallelEach([](Entity e, Velocity& v, const Position& p) { ... });
+template <typename... Ts>
+class Query {
+ public:
+  explicit Query(Registry& registry) : m_registry(&registry) { (m_required.set(ComponentIdOf<Ts>()), ...); }
+
+  // required, but not accessed
+  template <typename T>
+  Query& With() {
+    m_required.set(ComponentIdOf<T>());
+    return *this;
+  }
+
+  template <typename T>
+  Query& Without() {
+    m_excluded.set(ComponentIdOf<T>());
+    return *this;
+  }
+
+  // only chunks in which T was written after `version`, several Changed match chunks with any of them written
+  template <typename T>
+  Query& Changed(uint64_t version) {
+    m_changed.emplace_back(ComponentIdOf<T>(), version);
+    return *this;
+  }
+
+  // func(uint32_t count, const Entity* entities, Ts*... columns)
+  template <typename Func>
+  void EachChunk(Func&& func) {
+    for (auto const& it : Collect()) {
+      RunChunk(it.first, it.second, func);
+    }
+  }
+
+  // func(Entity entity, Ts&... components)
+  template <typename Func>
+  void Each(Func&& func) {
+    EachChunk([&func](uint32_t count, const Entity* entities, Ts*... columns) {
+      for (uint32_t i = 0; i < count; i++) {
+        func(entities[i], columns[i]...);
+      }
+    });
+  }
+
+  // chunks are spread over the JobSystem, `func` is called concurrently for entities of different chunks
+  template <typename Func>
+  void ParallelEach(Func&& func) {
+    auto chunks = Collect();
+
+    JobSystem::Get()->ParallelFor(static_cast<uint32_t>(chunks.size()), 1,
+                                  [&chunks, &func](uint32_t begin, uint32_t end, uint32_t) {
+                                    for (uint32_t c = begin; c < end; c++) {
+                                      RunChunk(chunks[c].first, chunks[c].second,
+                                               [&func](uint32_t count, const Entity* entities, Ts*... columns) {
+                                                 for (uint32_t i = 0; i < count; i++) {
+                                                   func(entities[i], columns[i]...);
+                                                 }
+                                               });
+                                    }
+                                  });
+  }
+
+ private:
+  using Archetype = Registry::Archetype;
+
+  std::vector<std::pair<Archetype*, uint32_t>> Collect() {
+    std::vector<std::pair<Archetype*, uint32_t>> result{};
+
+    constexpr bool kWrites = (!std::is_const<Ts>::value || ...);
+    uint64_t version = kWrites ? ++m_registry->m_version : 0;
+
+    for (auto const& archetype : m_registry->m_archetypes) {
+      if ((archetype->mask & m_required) != m_required || (archetype->mask & m_excluded).any()) {
+        continue;
+      }
+
+      for (uint32_t c = 0; c < archetype->chunks.size(); c++) {
+        auto& chunk = archetype->chunks[c];
+
+        if (chunk.count == 0 || !IsChanged(*archetype, chunk)) {
+          continue;
+        }
+
+        if (kWrites) {
+          (Stamp<Ts>(*archetype, chunk, version), ...);
+        }
+
+        result.emplace_back(archetype.get(), c);
+      }
+    }
+
+    return result;
+  }
+
+  bool IsChanged(Archetype const& archetype, Registry::Chunk const& chunk) const {
+    if (m_changed.empty()) {
+      return true;
+    }
+
+    for (auto const& it : m_changed) {
+      int16_t slot = archetype.slots[it.first];
+
+      if (slot >= 0 && chunk.versions[slot] > it.second) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  template <typename T>
+  static void Stamp(Archetype const& archetype, Registry::Chunk& chunk, uint64_t version) {
+    if (!std::is_const<T>::value) {
+      chunk.versions[archetype.slots[ComponentIdOf<T>()]] = version;
+    }
+  }
+
+  template <typename Func>
+  static void RunChunk(Archetype* archetype, uint32_t index, Func&& func) {
+    auto const& chunk = archetype->chunks[index];
+
+    func(chunk.count, reinterpret_cast<const Entity*>(chunk.data),
+         reinterpret_cast<Ts*>(Registry::Column(*archetype, chunk, archetype->slots[ComponentIdOf<Ts>()]))...);
+  }
+
+ private:
+  Registry* m_registry;
+  Registry::Mask m_required = {};
+  Registry::Mask m_excluded = {};
+  std::vector<std::pair<ComponentId, uint64_t>> m_changed = {};
+};
+
+}  // namespace hexgon
+
+#endif  // ENGINE_INCLUDE_HEXGON_ECS_REGISTRY_HPP_
@@ -0,0 +1,62 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#ifndef ENGINE_INCLUDE_HEXGON_ECS_SCENE_COMPONENTS_HPP_
+#define ENGINE_INCLUDE_HEXGON_ECS_SCENE_COMPONENTS_HPP_
+
+#include <Hexgon/Ecs/Registry.hpp>
+#include <Hexgon/Macro.hpp>
+#include <Hexgon/Object/TransformSystem.hpp>
+
+namespace hexgon {
+
+class Camera;
+class Geometry;
+class Material;
+class Mesh;
+
+// Components referring to the existing scene objects, the objects keep owning their data and their transform and
+// have to outlive the entities.
+
+struct TransformComponent {
+  TransformHandle handle = TransformSystem::kInvalidHandle;
+};
+
+struct MeshComponent {
+  Mesh* mesh = nullptr;
+  Geometry* geometry = nullptr;
+  Material* material = nullptr;
+};
+
+struct CameraComponent {
+  Camera* camera = nullptr;
+};
+
+// one entity per mesh, children included, their hierarchy stays in the TransformSystem
+HEX_API Entity AddMesh(Registry& registry, Mesh* mesh, bool with_children = true);
+
+HEX_API Entity AddCamera(Registry& registry, Camera* camera);
+
+}  // namespace hexgon
+
+#endif  // ENGINE_INCLUDE_HEXGON_ECS_SCENE_COMPONENTS_HPP_
@@ -28,9 +28,12 @@
 // Event
 #include <Hexgon/Core/Event.hpp>
 // Geometry
+#include <Hexgon/Core/Bounds.hpp>
 #include <Hexgon/Core/Geometry.hpp>
 // Window
 #include <Hexgon/Core/Window.hpp>
+// JobSystem
+#include <Hexgon/Core/JobSystem.hpp>
 // Layer
 #include <Hexgon/Core/Layer.hpp>
 #include <Hexgon/Core/LayerStack.hpp>
@@ -43,5 +46,16 @@
 // object
 #include <Hexgon/Object/Mesh.hpp>
 #include <Hexgon/Object/Object3D.hpp>
+#include <Hexgon/Object/TransformSystem.hpp>
 // camera
 #include <Hexgon/Object/Camera.hpp>
+// culling and spatial queries
+#include <Hexgon/Core/AabbTree.hpp>
+#include <Hexgon/Render/FrustumCuller.hpp>
+#include <Hexgon/Render/OcclusionCuller.hpp>
+// batching and draw ordering
+#include <Hexgon/Render/InstanceBatcher.hpp>
+#include <Hexgon/Render/RenderQueue.hpp>
+// entity component system
+#include <Hexgon/Ecs/Registry.hpp>
+#include <Hexgon/Ecs/SceneComponents.hpp>
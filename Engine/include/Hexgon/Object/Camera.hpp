@@ -24,6 +24,7 @@
 #ifndef ENGINE_INCLUDE_HEXGON_OBJECT_CAMERA_HPP_
 #define ENGINE_INCLUDE_HEXGON_OBJECT_CAMERA_HPP_
 
+#include <Hexgon/Core/Bounds.hpp>
 #include <Hexgon/Macro.hpp>
 #include <Hexgon/Object/Object3D.hpp>
 #include <memory>
@@ -44,6 +45,11 @@ class HEX_API Camera : public Object3D {
 
   glm::vec3 GetForward() const;
 
+  Frustum GetFrustum() { return Frustum::FromMatrix(GetCameraMatrix()); }
+
+  // projected diameter of a world space sphere as a fraction of the viewport height, huge once the camera is inside
+  float GetScreenSize(BoundingSphere const& sphere) const;
+
   static std::shared_ptr<Camera> MakePerspectiveCamera(float fov, float aspect, float near, float far);
 
  protected:
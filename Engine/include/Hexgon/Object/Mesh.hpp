@@ -24,31 +24,63 @@
 #ifndef ENGINE_INCLUDE_HEXGON_OBJECT_MESH_HPP_
 #define ENGINE_INCLUDE_HEXGON_OBJECT_MESH_HPP_
 
+#include <Hexgon/Core/Bounds.hpp>
 #include <Hexgon/Macro.hpp>
 #include <Hexgon/Object/Object3D.hpp>
-#include <vector>
 
 namespace hexgon {
 
+class Camera;
 class Geometry;
 class Material;
 
 class HEX_API Mesh : public Object3D {
  public:
+  // one pixel of a 1080p viewport
+  static constexpr float kDefaultLodError = 1.f / 1080.f;
+
   Mesh(Geometry* geometry, Material* material) : Object3D(), m_geometry(geometry), m_material(material) {}
 
   ~Mesh() override;
 
+  // a child that has another parent is moved here
   void AddChild(Mesh* child);
 
   void RemoveChild(Mesh* child);
 
   Mesh* GetParent() const { return m_parent; }
 
+  Mesh* GetFirstChild() const { return m_first_child; }
+
+  Mesh* GetNextSibling() const { return m_next_sibling; }
+
   Geometry* GetGeometry() const { return m_geometry; }
 
   Material* GetMaterial() const { return m_material; }
 
+  // occluders are rasterized by the OcclusionCuller, pick large, simple and solid meshes
+  void SetOccluder(bool occluder) { m_occluder = occluder; }
+
+  bool IsOccluder() const { return m_occluder; }
+
+  // Switches to the coarsest level of detail whose error projects below `max_screen_error`, a fraction of the
+  // viewport height. Coarser levels are only taken below `1 - hysteresis` times the threshold and the current one is
+  // only left above `1 + hysteresis` times, so a mesh sitting at a threshold doesn't alternate every frame.
+  uint32_t SelectLod(Camera const& camera, float max_screen_error = kDefaultLodError, float hysteresis = 0.2f);
+
+  // level of the geometry to draw, see Geometry::GetLod
+  uint32_t GetLod() const { return m_lod; }
+
+  // free for shaders to use, passed along with the world matrix when the mesh is drawn instanced
+  void SetInstanceData(glm::vec4 const& data) { m_instance_data = data; }
+
+  glm::vec4 const& GetInstanceData() const { return m_instance_data; }
+
+  // geometry bounds in world space, valid after TransformSystem::Update like the world matrix
+  Aabb GetWorldAabb() const;
+
+  BoundingSphere GetWorldBoundingSphere() const;
+
  protected:
   void OnSetPosition(const glm::vec3& pos) override {}
 
@@ -59,8 +91,15 @@ class HEX_API Mesh : public Object3D {
  private:
   Geometry* m_geometry;
   Material* m_material;
+  bool m_occluder = false;
+  uint32_t m_lod = 0;
+  glm::vec4 m_instance_data = glm::vec4(0.f);
   Mesh* m_parent = nullptr;
-  std::vector<Mesh*> m_children = {};
+  // intrusive child list, see Core/Util/LinkedList.hpp
+  Mesh* m_first_child = nullptr;
+  Mesh* m_last_child = nullptr;
+  Mesh* m_prev_sibling = nullptr;
+  Mesh* m_next_sibling = nullptr;
 };
 
 }  // namespace hexgon
@@ -25,25 +25,38 @@
 #define ENGINE_INCLUDE_HEXGON_OBJECT_OBJECT3D_HPP
 
 #include <Hexgon/Macro.hpp>
+#include <Hexgon/Object/TransformSystem.hpp>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 namespace hexgon {
 
+// handle to a transform in the TransformSystem, which owns the data
 class HEX_API Object3D {
  public:
-  Object3D() = default;
-  virtual ~Object3D() = default;
+  Object3D();
+  virtual ~Object3D();
+
+  Object3D(Object3D const&) = delete;
+  Object3D& operator=(Object3D const&) = delete;
 
   void SetPosition(glm::vec3 const& pos);
   void SetRotation(glm::vec3 const& rotation);
   void SetScale(glm::vec3 const& scale);
 
-  glm::vec3 const& GetPosition() const { return m_pos; }
-  glm::vec3 const& GetRotation() const { return m_rotate; }
-  glm::vec3 const& GetScale() const { return m_scale; }
+  glm::vec3 GetPosition() const;
+  glm::vec3 GetRotation() const;
+  glm::vec3 GetScale() const;
+
+  // rotation x, y, z, then translation, then scale
+  glm::mat4 GetLocalMatrix() const;
+
+  glm::mat4 CalculateMatrix() const { return GetLocalMatrix(); }
+
+  // as of the last TransformSystem::Update
+  glm::mat4 const& GetWorldMatrix() const;
 
-  glm::mat4 CalculateMatrix() const;
+  TransformHandle GetTransform() const { return m_transform; }
 
  protected:
   virtual void OnSetPosition(glm::vec3 const& pos) = 0;
@@ -51,9 +64,7 @@ class HEX_API Object3D {
   virtual void OnSetScale(glm::vec3 const& scale) = 0;
 
  private:
-  glm::vec3 m_pos = {};
-  glm::vec3 m_rotate = {};
-  glm::vec3 m_scale = {1.f, 1.f, 1.f};
+  TransformHandle m_transform;
 };
 
 }  // namespace hexgon
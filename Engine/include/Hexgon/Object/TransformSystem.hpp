@@ -0,0 +1,140 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#ifndef ENGINE_INCLUDE_HEXGON_OBJECT_TRANSFORM_SYSTEM_HPP_
+#define ENGINE_INCLUDE_HEXGON_OBJECT_TRANSFORM_SYSTEM_HPP_
+
+#include <Hexgon/Macro.hpp>
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <thread>
+#include <vector>
+
+namespace hexgon {
+
+using TransformHandle = uint32_t;
+
+// Every transform of the process in structure of arrays form. Positions, rotations (as quaternions) and scales live
+// in separate float arrays ordered so parents come before their children, Update composes local matrices in SIMD
+// batches and world matrices level by level on the JobSystem.
+// Not thread safe, create, change and update transforms from one thread. That is the thread which first calls Get(),
+// Application pins it to the main thread. Create, Destroy, SetParent and Update abort on any other thread, so objects
+// (meshes, cameras ...) must not be constructed in Layer::OnPrefetch.
+class HEX_API TransformSystem final {
+ public:
+  static constexpr TransformHandle kInvalidHandle = ~0u;
+
+  ~TransformSystem() = default;
+
+  static TransformSystem* Get();
+
+  TransformHandle Create();
+
+  // children of a destroyed transform become roots
+  void Destroy(TransformHandle handle);
+
+  // pass kInvalidHandle to make `handle` a root, fails if it would create a cycle
+  bool SetParent(TransformHandle handle, TransformHandle parent);
+
+  TransformHandle GetParent(TransformHandle handle) const;
+
+  void SetPosition(TransformHandle handle, glm::vec3 const& pos);
+  // euler angles in radians, applied x then y then z
+  void SetRotation(TransformHandle handle, glm::vec3 const& rotation);
+  void SetScale(TransformHandle handle, glm::vec3 const& scale);
+
+  glm::vec3 GetPosition(TransformHandle handle) const;
+  glm::vec3 GetRotation(TransformHandle handle) const;
+  glm::vec3 GetScale(TransformHandle handle) const;
+
+  // rotation * translation * scale of the current values, does not need Update
+  glm::mat4 CalculateLocalMatrix(TransformHandle handle) const;
+
+  // parent world * local as of the last Update
+  glm::mat4 const& GetWorldMatrix(TransformHandle handle) const;
+
+  // recompose everything changed since the last call, once per frame
+  void Update();
+
+  uint32_t GetCount() const { return static_cast<uint32_t>(m_handles.size()); }
+
+ private:
+  TransformSystem() = default;
+
+  uint32_t IndexOf(TransformHandle handle) const { return m_indices[handle]; }
+
+  // abort when called off the owner thread, dense arrays may be reallocated under readers
+  void CheckThread(const char* func) const;
+
+  // grow or shrink every dense array to hold `count` transforms, padded to whole SIMD batches
+  void Resize(uint32_t count);
+
+  // restore the parent before child order and rebuild the depth levels
+  void SortByDepth();
+
+  void UpdateLocal(uint32_t begin_batch, uint32_t end_batch);
+
+  void UpdateWorld(uint32_t begin, uint32_t end);
+
+  // every array holding one value per dense index
+  template <typename Func>
+  void ForEachArray(Func&& func);
+
+ private:
+  // handle -> dense index, kInvalidHandle for free handles
+  std::vector<uint32_t> m_indices = {};
+  std::vector<TransformHandle> m_free_handles = {};
+
+  // dense, in parent before child order
+  std::vector<TransformHandle> m_handles = {};
+  std::vector<TransformHandle> m_parents = {};
+  std::vector<int32_t> m_parent_indices = {};
+  std::vector<uint32_t> m_child_counts = {};
+  std::vector<float> m_pos_x = {};
+  std::vector<float> m_pos_y = {};
+  std::vector<float> m_pos_z = {};
+  std::vector<float> m_rot_x = {};
+  std::vector<float> m_rot_y = {};
+  std::vector<float> m_rot_z = {};
+  std::vector<float> m_rot_w = {};
+  std::vector<float> m_scale_x = {};
+  std::vector<float> m_scale_y = {};
+  std::vector<float> m_scale_z = {};
+  // euler angles as set, only read back by GetRotation
+  std::vector<glm::vec3> m_euler = {};
+  // upper 3x4 of the local matrices, column major
+  std::array<std::vector<float>, 12> m_local = {};
+  std::vector<glm::mat4> m_world = {};
+  std::vector<uint8_t> m_local_dirty = {};
+  std::vector<uint8_t> m_world_changed = {};
+
+  // [m_levels[d], m_levels[d + 1]) are the transforms at depth d
+  std::vector<uint32_t> m_levels = {};
+  bool m_order_dirty = false;
+  std::thread::id m_owner = std::this_thread::get_id();
+};
+
+}  // namespace hexgon
+
+#endif  // ENGINE_INCLUDE_HEXGON_OBJECT_TRANSFORM_SYSTEM_HPP_
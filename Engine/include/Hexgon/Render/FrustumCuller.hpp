@@ -0,0 +1,79 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#pragma once
+
+#include <Hexgon/Core/Bounds.hpp>
+#include <Hexgon/Macro.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace hexgon {
+
+class Mesh;
+
+// World space bounds in structure of arrays form, tested against a frustum in SIMD batches spread over the
+// JobSystem. Every object keeps the center of its box, the box extent and a sphere radius around the same center,
+// and is visible when neither its box nor its sphere is fully outside one of the planes.
+class HEX_API FrustumCuller final {
+ public:
+  FrustumCuller() = default;
+  ~FrustumCuller() = default;
+
+  void Clear();
+
+  // the returned index is the one reported by Cull
+  uint32_t Add(Aabb const& aabb, BoundingSphere const& sphere);
+
+  void Set(uint32_t index, Aabb const& aabb, BoundingSphere const& sphere);
+
+  // world bounds of every mesh, in parallel, meshes without geometry are never visible
+  void Gather(std::vector<Mesh*> const& meshes);
+
+  uint32_t GetCount() const { return m_count; }
+
+  // indices of the visible objects in ascending order
+  void Cull(Frustum const& frustum, std::vector<uint32_t>& visible);
+
+  // Gather followed by Cull
+  void Cull(Frustum const& frustum, std::vector<Mesh*> const& meshes, std::vector<Mesh*>& visible);
+
+ private:
+  void Resize(uint32_t count);
+
+ private:
+  uint32_t m_count = 0;
+  // padded to the batch size with objects that are never visible
+  std::vector<float> m_center_x = {};
+  std::vector<float> m_center_y = {};
+  std::vector<float> m_center_z = {};
+  std::vector<float> m_extent_x = {};
+  std::vector<float> m_extent_y = {};
+  std::vector<float> m_extent_z = {};
+  std::vector<float> m_radius = {};
+  // per job output, concatenated in job order so the result stays sorted
+  std::vector<std::vector<uint32_t>> m_job_visible = {};
+  std::vector<uint32_t> m_indices = {};
+};
+
+}  // namespace hexgon
@@ -0,0 +1,137 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#pragma once
+
+#include <Hexgon/Macro.hpp>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace hexgon {
+
+class Geometry;
+class Material;
+class Mesh;
+
+// Groups visible meshes drawing the same geometry level with the same material and pipeline into instanced draws.
+// Every batch owns a range of one instance array with some room to grow, so meshes entering or leaving a batch only
+// touch that batch, and only instances whose data actually changed are reported for upload.
+class HEX_API InstanceBatcher final {
+ public:
+  // per instance vertex data, std430 compatible
+  struct Instance {
+    glm::mat4 world = glm::mat4(1.f);
+    // Mesh::GetInstanceData
+    glm::vec4 data = glm::vec4(0.f);
+  };
+
+  // one instanced indexed draw, instances are [first_instance, first_instance + instance_count) of GetInstances()
+  struct Draw {
+    Geometry* geometry = nullptr;
+    Material* material = nullptr;
+    uint32_t pipeline = 0;
+    uint32_t first_index = 0;
+    uint32_t index_count = 0;
+    uint32_t first_instance = 0;
+    uint32_t instance_count = 0;
+  };
+
+  InstanceBatcher() = default;
+  ~InstanceBatcher() = default;
+
+  void Clear();
+
+  // `visible` are the meshes to draw this frame, usually the output of a culler, drawn at Mesh::GetLod. Meshes may be
+  // destroyed once they are no longer passed in.
+  void Update(std::vector<Mesh*> const& visible);
+
+  std::vector<Draw> const& GetDraws() const { return m_draws; }
+
+  std::vector<Instance> const& GetInstances() const { return m_instances; }
+
+  // instances changed by the last Update, everything when the array was resized
+  uint32_t GetDirtyBegin() const { return m_dirty_begin; }
+
+  uint32_t GetDirtyEnd() const { return m_dirty_end; }
+
+  size_t GetBatchCount() const { return m_batches.size(); }
+
+ private:
+  struct Key {
+    Geometry* geometry = nullptr;
+    Material* material = nullptr;
+    uint32_t pipeline = 0;
+    uint32_t lod = 0;
+
+    bool operator==(Key const& other) const {
+      return geometry == other.geometry && material == other.material && pipeline == other.pipeline &&
+             lod == other.lod;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(Key const& key) const;
+  };
+
+  struct Batch {
+    Key key = {};
+    std::vector<Mesh*> members = {};
+    uint32_t first_instance = 0;
+    uint32_t capacity = 0;
+  };
+
+  struct Membership {
+    uint32_t batch = 0;
+    uint32_t slot = 0;
+    uint64_t frame = 0;
+  };
+
+  static Key GetKey(Mesh const* mesh);
+
+  void Insert(Mesh* mesh, Key const& key);
+
+  void Remove(Mesh* mesh, Membership const& membership);
+
+  // gives every batch room for its members, moving only the ones that outgrew their range to the end
+  void Layout(uint32_t live_count);
+
+  // packs all batches back to back and drops the empty ones
+  void Compact();
+
+  void Write(uint32_t index, Instance const& instance);
+
+ private:
+  uint64_t m_frame = 0;
+  std::vector<Batch> m_batches = {};
+  std::unordered_map<Key, uint32_t, KeyHash> m_batch_lookup = {};
+  std::unordered_map<Mesh*, Membership> m_members = {};
+  std::vector<Mesh*> m_removed = {};
+  std::vector<Draw> m_draws = {};
+  std::vector<Instance> m_instances = {};
+  uint32_t m_dirty_begin = 0;
+  uint32_t m_dirty_end = 0;
+};
+
+}  // namespace hexgon
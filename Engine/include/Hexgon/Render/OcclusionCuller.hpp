@@ -0,0 +1,126 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#pragma once
+
+#include <Hexgon/Core/Bounds.hpp>
+#include <Hexgon/Macro.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace hexgon {
+
+class Geometry;
+class Mesh;
+
+// Software occlusion culling. A few occluders are rasterized into a small depth buffer on the CPU, split into tiles
+// rendered in parallel with SIMD, and reduced into a pyramid keeping the farthest depth of each 2x2 block. An
+// occludee is hidden when the nearest point of its bounds lies behind every texel its screen rectangle covers on a
+// pyramid level where that rectangle is at most 2x2 texels.
+//
+//   culler.Begin(camera->GetCameraMatrix());
+//   culler.AddOccluder(wall);
+//   culler.Rasterize();
+//   if (culler.IsVisible(mesh->GetWorldAabb())) ...
+class HEX_API OcclusionCuller final {
+ public:
+  // rounded up to whole tiles
+  explicit OcclusionCuller(uint32_t width = 256, uint32_t height = 128);
+  ~OcclusionCuller() = default;
+
+  void Resize(uint32_t width, uint32_t height);
+
+  // clears the depth buffer and the occluder list
+  void Begin(glm::mat4 const& view_projection);
+
+  // `geometry` has to stay alive until Rasterize
+  void AddOccluder(Geometry const* geometry, glm::mat4 const& world);
+
+  void AddOccluder(Mesh const* mesh);
+
+  // renders the occluders and builds the depth pyramid
+  void Rasterize();
+
+  // world space bounds, conservative: bounds crossing the near plane are always visible
+  bool IsVisible(Aabb const& aabb) const;
+
+  // Begin, the occluders among `meshes`, Rasterize and a parallel visibility test of every mesh
+  void Cull(glm::mat4 const& view_projection, std::vector<Mesh*> const& meshes, std::vector<Mesh*>& visible);
+
+  uint32_t GetWidth() const { return m_width; }
+
+  uint32_t GetHeight() const { return m_height; }
+
+  uint32_t GetLevelCount() const { return static_cast<uint32_t>(m_levels.size()); }
+
+  // depth in normalized device coordinates, far plane 1
+  std::vector<float> const& GetDepth(uint32_t level = 0) const { return m_levels[level].depth; }
+
+ private:
+  struct Occluder {
+    Geometry const* geometry;
+    glm::mat4 world;
+  };
+
+  // screen space edge functions and depth plane, a pixel center (x, y) is inside when all edges are >= 0
+  struct Triangle {
+    float edge_a[3];
+    float edge_b[3];
+    float edge_c[3];
+    float depth_a;
+    float depth_b;
+    float depth_c;
+    int32_t min_x;
+    int32_t min_y;
+    int32_t max_x;
+    int32_t max_y;
+  };
+
+  struct Level {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<float> depth = {};
+  };
+
+  void SetupTriangles(Occluder const& occluder, std::vector<Triangle>& triangles) const;
+
+  void RasterizeTile(uint32_t tile);
+
+  void BuildPyramid();
+
+ private:
+  uint32_t m_width = 0;
+  uint32_t m_height = 0;
+  uint32_t m_tiles_x = 0;
+  uint32_t m_tiles_y = 0;
+  glm::mat4 m_view_projection = glm::mat4(1.f);
+  std::vector<Occluder> m_occluders = {};
+  // per occluder, filled in parallel
+  std::vector<std::vector<Triangle>> m_triangles = {};
+  // per tile, pairs of occluder and triangle index
+  std::vector<std::vector<std::pair<uint32_t, uint32_t>>> m_bins = {};
+  std::vector<Level> m_levels = {};
+  std::vector<uint8_t> m_visible = {};
+};
+
+}  // namespace hexgon
@@ -0,0 +1,103 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#pragma once
+
+#include <Hexgon/Macro.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace hexgon {
+
+// Draws of a frame ordered by a 64 bit key, sorted with a parallel radix sort. Opaque draws are grouped by pipeline,
+// then material, then front to back. Translucent draws come after the opaque ones of their layer and go strictly back
+// to front, state only orders draws at equal depth. Walking the sorted items skips every bind the previous draw
+// already made.
+class HEX_API RenderQueue final {
+ public:
+  static constexpr uint32_t kLayerCount = 16;
+
+  struct Item {
+    uint64_t key = 0;
+    uint32_t pipeline = 0;
+    uint32_t material = 0;
+    // caller's draw, e.g. an index into InstanceBatcher::GetDraws()
+    uint32_t draw = 0;
+    // set by Sort, false when the previous item already bound the same state
+    bool bind_pipeline = false;
+    bool bind_material = false;
+  };
+
+  struct Stats {
+    uint32_t item_count = 0;
+    // binds left after sorting and dropping redundant ones
+    uint32_t pipeline_binds = 0;
+    uint32_t material_binds = 0;
+    // binds the same items needed in submission order, redundant ones dropped as well
+    uint32_t submitted_pipeline_binds = 0;
+    uint32_t submitted_material_binds = 0;
+
+    // binds saved compared to binding pipeline and material for every draw
+    uint32_t GetEliminatedBinds() const { return item_count * 2 - pipeline_binds - material_binds; }
+
+    // binds saved by sorting alone, negative when sorting for the key made the bind count worse
+    int64_t GetSortedAwayBinds() const {
+      return static_cast<int64_t>(submitted_pipeline_binds) + submitted_material_binds - pipeline_binds -
+             material_binds;
+    }
+  };
+
+  RenderQueue() = default;
+  ~RenderQueue() = default;
+
+  void Clear();
+
+  // `layer` below kLayerCount, drawn in ascending order. `depth` is the view space distance, negative counts as 0.
+  // A material is bound again after every pipeline change, its resources may not stay compatible.
+  void Push(uint32_t layer, bool translucent, uint32_t pipeline, uint32_t material, float depth, uint32_t draw);
+
+  void Sort();
+
+  std::vector<Item> const& GetItems() const { return m_items; }
+
+  // of the last Sort
+  Stats const& GetStats() const { return m_stats; }
+
+  // only the low 16 bits of pipeline and material make it into the key, collisions just sort less well
+  static uint64_t MakeKey(uint32_t layer, bool translucent, uint32_t pipeline, uint32_t material, float depth);
+
+ private:
+  // walks the items in their current order, sets the bind flags and returns the number of binds
+  void CountBinds(uint32_t& pipeline_binds, uint32_t& material_binds, bool set_flags);
+
+  void RadixSort();
+
+ private:
+  std::vector<Item> m_items = {};
+  std::vector<Item> m_scratch = {};
+  // per job digit counts of the current pass
+  std::vector<uint32_t> m_histograms = {};
+  Stats m_stats = {};
+};
+
+}  // namespace hexgon
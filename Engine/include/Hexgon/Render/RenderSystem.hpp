@@ -24,7 +24,10 @@
 #pragma once
 
 #include <Hexgon/Macro.hpp>
+#include <Hexgon/Render/Sampler.hpp>
+#include <Hexgon/Render/Texture.hpp>
 #include <memory>
+#include <string>
 
 namespace hexgon {
 
@@ -42,11 +45,37 @@ class HEX_API RenderSystem {
 
   virtual ~RenderSystem() = default;
 
-  static std::unique_ptr<RenderSystem> Init(RenderAPI api, Window* window, bool debug = false);
+  // `device` selects a gpu by index or name, when empty the HEXGON_DEVICE environment variable is used instead.
+  static std::unique_ptr<RenderSystem> Init(RenderAPI api, Window* window, bool debug = false,
+                                            const std::string& device = {});
+
+  // Init split in two steps. Create does the window independent work (instance, driver loading, pipeline cache file)
+  // and may run on a worker thread while the window is created, AttachWindow then creates the surface and the device.
+  static std::unique_ptr<RenderSystem> Create(RenderAPI api, bool debug = false);
+
+  bool AttachWindow(Window* window, const std::string& device = {});
 
   virtual std::unique_ptr<SwapChain> CreateSwapChain() = 0;
 
+  virtual std::shared_ptr<Texture> CreateTexture(TextureDescriptor const& desc) = 0;
+
+  // offscreen color or depth target which can be sampled and read back, pass a depth PixelFormat for depth
+  std::shared_ptr<Texture> CreateRenderTarget(uint32_t width, uint32_t height, PixelFormat format,
+                                              uint32_t sample_count = 1);
+
+  // load a KTX2 file without supercompression, all mip levels and array layers in the file are uploaded
+  virtual std::shared_ptr<Texture> LoadTexture(std::string const& path, bool streaming = false) = 0;
+
+  // whether textures of `format` can be created with `usage` on this device
+  virtual bool IsFormatSupported(PixelFormat format, TextureUsageMask usage) = 0;
+
+  // samplers with equal descriptors are the same object, anisotropy is clamped to the device limit
+  virtual std::shared_ptr<Sampler> CreateSampler(SamplerDescriptor const& desc) = 0;
+
   virtual void ShutDown() = 0;
+
+ protected:
+  virtual bool OnAttachWindow(Window* window, const std::string& device) = 0;
 };
 
 }  // namespace hexgon
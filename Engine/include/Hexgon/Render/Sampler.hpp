@@ -0,0 +1,111 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace hexgon {
+
+enum class FilterMode {
+  kNearest,
+  kLinear,
+};
+
+enum class MipmapMode {
+  kNearest,
+  kLinear,
+};
+
+enum class AddressMode {
+  kRepeat,
+  kMirroredRepeat,
+  kClampToEdge,
+  kClampToBorder,
+};
+
+enum class CompareFunction {
+  kNever,
+  kLess,
+  kEqual,
+  kLessEqual,
+  kGreater,
+  kNotEqual,
+  kGreaterEqual,
+  kAlways,
+};
+
+enum class BorderColor {
+  kTransparentBlack,
+  kOpaqueBlack,
+  kOpaqueWhite,
+};
+
+struct SamplerDescriptor {
+  FilterMode mag_filter = FilterMode::kLinear;
+  FilterMode min_filter = FilterMode::kLinear;
+  MipmapMode mipmap_mode = MipmapMode::kLinear;
+
+  AddressMode address_u = AddressMode::kRepeat;
+  AddressMode address_v = AddressMode::kRepeat;
+  AddressMode address_w = AddressMode::kRepeat;
+
+  // 1 turns anisotropic filtering off, larger values are clamped to what the device supports
+  float max_anisotropy = 1.f;
+
+  float lod_bias = 0.f;
+  float min_lod = 0.f;
+  float max_lod = 1000.f;
+
+  // depth comparison, used by shadow map lookups
+  bool compare_enable = false;
+  CompareFunction compare = CompareFunction::kLessEqual;
+
+  // only used by AddressMode::kClampToBorder
+  BorderColor border_color = BorderColor::kTransparentBlack;
+
+  bool operator==(const SamplerDescriptor& other) const {
+    return mag_filter == other.mag_filter && min_filter == other.min_filter && mipmap_mode == other.mipmap_mode &&
+           address_u == other.address_u && address_v == other.address_v && address_w == other.address_w &&
+           max_anisotropy == other.max_anisotropy && lod_bias == other.lod_bias && min_lod == other.min_lod &&
+           max_lod == other.max_lod && compare_enable == other.compare_enable && compare == other.compare &&
+           border_color == other.border_color;
+  }
+
+  bool operator!=(const SamplerDescriptor& other) const { return !(*this == other); }
+};
+
+// Samplers are immutable and shared, every texture or material asking for the same descriptor gets the same object.
+class Sampler {
+ public:
+  Sampler(SamplerDescriptor desc) : m_desc(desc) {}
+
+  virtual ~Sampler() = default;
+
+  const SamplerDescriptor& GetDescriptor() const { return m_desc; }
+
+ protected:
+  SamplerDescriptor m_desc;
+};
+
+}  // namespace hexgon
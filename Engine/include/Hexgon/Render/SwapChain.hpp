@@ -25,6 +25,7 @@
 
 #include <Hexgon/Macro.hpp>
 #include <cstdint>
+#include <glm/glm.hpp>
 
 namespace hexgon {
 
@@ -39,6 +40,19 @@ class SwapChain {
   virtual uint32_t GetHeight() const = 0;
 
   virtual uint32_t GetMaxBufferCount() const = 0;
+
+  // acquire next back buffer and clear it, returns false if there is nothing to render into this frame
+  virtual bool BeginFrame() = 0;
+
+  // submit and present the frame started by BeginFrame
+  virtual void EndFrame() = 0;
+
+  void SetClearColor(glm::vec4 const& color) { m_clear_color = color; }
+
+  glm::vec4 const& GetClearColor() const { return m_clear_color; }
+
+ private:
+  glm::vec4 m_clear_color = {0.f, 0.f, 0.f, 0.f};
 };
 
 }  // namespace hexgon
@@ -23,9 +23,11 @@
 
 #pragma once
 
+#include <Hexgon/Macro.hpp>
 #include <Hexgon/Render/Type.hpp>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <string>
 
 namespace hexgon {
@@ -41,8 +43,43 @@ enum class PixelFormat {
   kA8UNorm,
   kR8G8B8A8Unorm,
   kB8G8R8A8Unorm,
+  // block compressed, 4x4 blocks
+  kBC1RGBAUnorm,
+  kBC2RGBAUnorm,
+  kBC3RGBAUnorm,
+  kBC4RUnorm,
+  kBC5RGUnorm,
+  kBC6HRGBUFloat,
+  kBC7RGBAUnorm,
+  kETC2R8G8B8Unorm,
+  kETC2R8G8B8A8Unorm,
+  kASTC4x4Unorm,
+  kASTC6x6Unorm,
+  kASTC8x8Unorm,
+  // depth attachments
+  kD16Unorm,
+  kD32Float,
+  kD24UnormS8Uint,
 };
 
+struct PixelFormatInfo {
+  uint32_t block_width = 1;
+  uint32_t block_height = 1;
+  // bytes of one block, 0 for unknown formats
+  uint32_t block_size = 0;
+  bool is_depth = false;
+
+  bool IsCompressed() const { return block_width > 1 || block_height > 1; }
+
+  // bytes of a tightly packed width x height image
+  size_t GetImageSize(uint32_t width, uint32_t height) const {
+    return static_cast<size_t>((width + block_width - 1) / block_width) *
+           ((height + block_height - 1) / block_height) * block_size;
+  }
+};
+
+HEX_API PixelFormatInfo GetPixelFormatInfo(PixelFormat format);
+
 using TextureUsageMask = uint32_t;
 
 enum TextureUsage : TextureUsageMask {
@@ -64,6 +101,14 @@ struct TextureDescriptor {
 
   uint32_t width = 0;
   uint32_t height = 0;
+  uint32_t depth = 1;
+  // 0 means the full chain down to 1x1
+  uint32_t mip_levels = 1;
+  uint32_t array_layers = 1;
+  uint32_t sample_count = 1;
+
+  // only keep the mips requested by Texture::RequestMipLevel resident, under the global texture memory budget
+  bool streaming = false;
 };
 
 struct TextureRange {
@@ -71,14 +116,26 @@ struct TextureRange {
   uint32_t y = 0;
   uint32_t width = 0;
   uint32_t height = 0;
+  uint32_t mip_level = 0;
+  uint32_t array_layer = 0;
 };
 
+// `data` holds the tightly packed texels of the requested range and is only valid during the call, nullptr if the
+// readback was dropped
+using ReadbackCallback = std::function<void(const void* data, size_t len)>;
+
 class Texture {
  public:
-  Texture(TextureDescriptor desc) : m_desc(desc) {}
+  Texture(TextureDescriptor desc) : m_desc(desc) {
+    if (m_desc.mip_levels == 0) {
+      m_desc.mip_levels = CalculateMipLevels(m_desc.width, m_desc.height);
+    }
+  }
 
   virtual ~Texture() = default;
 
+  const TextureDescriptor& GetDescriptor() const { return m_desc; }
+
   TextureType GetTextureType() const { return m_desc.type; }
 
   TextureUsageMask GetUsage() const { return m_desc.usage; }
@@ -89,11 +146,48 @@ class Texture {
 
   uint32_t GetHeight() const { return m_desc.height; }
 
+  uint32_t GetDepth() const { return m_desc.depth; }
+
+  uint32_t GetMipLevels() const { return m_desc.mip_levels; }
+
+  uint32_t GetArrayLayers() const { return m_desc.array_layers; }
+
+  uint32_t GetSampleCount() const { return m_desc.sample_count; }
+
+  bool IsStreaming() const { return m_desc.streaming; }
+
   void UploadData(void* data, size_t len, const TextureRange& range);
 
+  // Data is copied and written together with all other queued updates when the current frame is submitted.
+  // Overlapping and adjacent ranges are merged, later updates win.
+  void QueueUpdate(const void* data, size_t len, const TextureRange& range);
+
+  // Copy `range` to the CPU at the end of the current frame. The callback runs on the render thread once the GPU
+  // finished that frame, the CPU never waits for it. Needs TextureUsage::kCopySrc, depth formats read the depth only.
+  bool Readback(const TextureRange& range, ReadbackCallback callback);
+
+  // fill mip 1 to n from mip 0 on the GPU
+  void GenerateMipmaps();
+
+  // tell a streaming texture the most detailed mip it is sampled with this frame
+  void RequestMipLevel(uint32_t level);
+
+  static uint32_t CalculateMipLevels(uint32_t width, uint32_t height);
+
  protected:
   virtual void OnUploadData(void* data, size_t len, const TextureRange& range) = 0;
 
+  virtual void OnQueueUpdate(const void* data, size_t len, const TextureRange& range) = 0;
+
+  virtual bool OnReadback(const TextureRange& range, ReadbackCallback callback) = 0;
+
+  virtual void OnGenerateMipmaps() = 0;
+
+  virtual void OnRequestMipLevel(uint32_t level) {}
+
+ private:
+  bool CanUpload(const TextureRange& range) const;
+
  private:
   TextureDescriptor m_desc;
 };
@@ -0,0 +1,144 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#pragma once
+
+#include <Hexgon/Macro.hpp>
+#include <Hexgon/Render/Texture.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace hexgon {
+
+class RenderSystem;
+class SkylinePacker;
+
+struct TextureAtlasDescriptor {
+  std::string label = "Atlas";
+  // only uncompressed formats can be packed
+  PixelFormat format = PixelFormat::kR8G8B8A8Unorm;
+
+  uint32_t page_width = 2048;
+  uint32_t page_height = 2048;
+  uint32_t max_pages = 16;
+
+  // texels around every region filled with its edge texels, keeps bilinear filtering from bleeding into neighbours
+  uint32_t padding = 1;
+
+  // keep a CPU copy of every region, required by TextureAtlas::Defragment
+  bool keep_cpu_copy = false;
+};
+
+struct AtlasRegion {
+  uint32_t page = 0;
+
+  // texels inside the page, padding not included
+  uint32_t x = 0;
+  uint32_t y = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+
+  float u0 = 0.f;
+  float v0 = 0.f;
+  float u1 = 0.f;
+  float v1 = 0.f;
+};
+
+using AtlasHandle = uint32_t;
+
+class HEX_API TextureAtlas {
+ public:
+  static constexpr AtlasHandle kInvalidHandle = UINT32_MAX;
+
+  TextureAtlas(RenderSystem* render_system, TextureAtlasDescriptor desc);
+
+  ~TextureAtlas();
+
+  // reserve a width x height region, a new page is added when no existing page has room
+  AtlasHandle Allocate(uint32_t width, uint32_t height);
+
+  // Allocate followed by Update
+  AtlasHandle Add(uint32_t width, uint32_t height, const void* data, size_t len);
+
+  void Free(AtlasHandle handle);
+
+  // write the whole region, `data` is tightly packed. The write is queued and lands with the current frame.
+  bool Update(AtlasHandle handle, const void* data, size_t len);
+
+  bool GetRegion(AtlasHandle handle, AtlasRegion& region) const;
+
+  // Repack all live regions into as few pages as possible. Handles stay valid but regions move, so callers must
+  // fetch them again when GetVersion changes. Returns the number of moved regions.
+  uint32_t Defragment();
+
+  // bumped every time existing regions move
+  uint64_t GetVersion() const;
+
+  uint32_t GetPageCount() const;
+
+  std::shared_ptr<Texture> GetPage(uint32_t index) const;
+
+  // used texels over the texels of all pages
+  float GetOccupancy() const;
+
+ private:
+  struct Entry {
+    bool live = false;
+    uint32_t page = 0;
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels = {};
+  };
+
+  struct Page {
+    std::shared_ptr<Texture> texture;
+    std::unique_ptr<SkylinePacker> packer;
+  };
+
+  bool AddPage();
+
+  bool Place(Entry& entry);
+
+  bool Write(const Entry& entry, const void* data);
+
+  AtlasRegion MakeRegion(const Entry& entry) const;
+
+ private:
+  RenderSystem* m_render_system;
+  TextureAtlasDescriptor m_desc;
+  size_t m_texel_size = 0;
+
+  mutable std::mutex m_mutex = {};
+  std::vector<Page> m_pages;
+  std::vector<Entry> m_entries = {};
+  std::vector<AtlasHandle> m_free_handles = {};
+  uint64_t m_version = 0;
+};
+
+}  // namespace hexgon
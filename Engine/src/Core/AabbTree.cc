@@ -0,0 +1,306 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include <Hexgon/Core/AabbTree.hpp>
+
+namespace hexgon {
+
+namespace {
+
+// fat AABBs stretch this many frames of displacement ahead
+constexpr float kDisplacementScale = 4.f;
+
+}  // namespace
+
+AabbTree::AabbTree(float margin) : m_margin(margin) {}
+
+int32_t AabbTree::Insert(Aabb const& aabb, void* user_data) {
+  int32_t proxy = AllocateNode();
+  Node& node = m_nodes[proxy];
+
+  glm::vec3 margin(m_margin);
+
+  node.aabb = Aabb{aabb.min - margin, aabb.max + margin};
+  node.user_data = user_data;
+  node.height = 0;
+
+  InsertLeaf(proxy);
+  m_proxy_count++;
+
+  return proxy;
+}
+
+void AabbTree::Remove(int32_t proxy) {
+  RemoveLeaf(proxy);
+  FreeNode(proxy);
+  m_proxy_count--;
+}
+
+bool AabbTree::Move(int32_t proxy, Aabb const& aabb, glm::vec3 const& displacement) {
+  glm::vec3 margin(m_margin);
+
+  Aabb fat{aabb.min - margin, aabb.max + margin};
+
+  glm::vec3 ahead = displacement * kDisplacementScale;
+  fat.min += glm::min(ahead, glm::vec3(0.f));
+  fat.max += glm::max(ahead, glm::vec3(0.f));
+
+  Aabb const& current = m_nodes[proxy].aabb;
+
+  if (current.Contains(aabb)) {
+    // an object that stopped or shrank would otherwise keep a needlessly large box
+    glm::vec3 huge_margin = margin * 4.f;
+    Aabb huge{fat.min - huge_margin, fat.max + huge_margin};
+
+    if (huge.Contains(current)) {
+      return false;
+    }
+  }
+
+  RemoveLeaf(proxy);
+  m_nodes[proxy].aabb = fat;
+  InsertLeaf(proxy);
+
+  return true;
+}
+
+float AabbTree::GetAreaRatio() const {
+  if (m_root == kNullNode) {
+    return 0.f;
+  }
+
+  float total = 0.f;
+
+  for (auto const& node : m_nodes) {
+    if (node.height >= 0) {
+      total += node.aabb.GetSurfaceArea();
+    }
+  }
+
+  float root = m_nodes[m_root].aabb.GetSurfaceArea();
+
+  return root > 0.f ? total / root : 0.f;
+}
+
+void AabbTree::Clear() {
+  m_nodes.clear();
+  m_root = kNullNode;
+  m_free_list = kNullNode;
+  m_proxy_count = 0;
+}
+
+int32_t AabbTree::AllocateNode() {
+  if (m_free_list == kNullNode) {
+    m_nodes.emplace_back();
+    return static_cast<int32_t>(m_nodes.size() - 1);
+  }
+
+  int32_t index = m_free_list;
+  m_free_list = m_nodes[index].parent;
+  m_nodes[index] = Node{};
+
+  return index;
+}
+
+void AabbTree::FreeNode(int32_t node) {
+  m_nodes[node].parent = m_free_list;
+  m_nodes[node].height = -1;
+  m_free_list = node;
+}
+
+void AabbTree::InsertLeaf(int32_t leaf) {
+  if (m_root == kNullNode) {
+    m_root = leaf;
+    m_nodes[leaf].parent = kNullNode;
+    return;
+  }
+
+  Aabb const leaf_aabb = m_nodes[leaf].aabb;
+
+  // descend towards the sibling whose merge grows the tree's total surface the least
+  int32_t index = m_root;
+
+  while (!m_nodes[index].IsLeaf()) {
+    Node const& node = m_nodes[index];
+
+    float area = node.aabb.GetSurfaceArea();
+    float combined_area = node.aabb.Merge(leaf_aabb).GetSurfaceArea();
+
+    // pairing with this node creates a parent of the combined size
+    float cost = 2.f * combined_area;
+    // descending further grows this node anyway
+    float inheritance_cost = 2.f * (combined_area - area);
+
+    auto child_cost = [&](int32_t child) {
+      Aabb const& aabb = m_nodes[child].aabb;
+      float merged = aabb.Merge(leaf_aabb).GetSurfaceArea();
+
+      return (m_nodes[child].IsLeaf() ? merged : merged - aabb.GetSurfaceArea()) + inheritance_cost;
+    };
+
+    float cost1 = child_cost(node.child1);
+    float cost2 = child_cost(node.child2);
+
+    if (cost < cost1 && cost < cost2) {
+      break;
+    }
+
+    index = cost1 < cost2 ? node.child1 : node.child2;
+  }
+
+  int32_t sibling = index;
+  int32_t old_parent = m_nodes[sibling].parent;
+  int32_t new_parent = AllocateNode();
+
+  Node& parent = m_nodes[new_parent];
+  parent.parent = old_parent;
+  parent.aabb = leaf_aabb.Merge(m_nodes[sibling].aabb);
+  parent.height = m_nodes[sibling].height + 1;
+  parent.child1 = sibling;
+  parent.child2 = leaf;
+
+  if (old_parent != kNullNode) {
+    if (m_nodes[old_parent].child1 == sibling) {
+      m_nodes[old_parent].child1 = new_parent;
+    } else {
+      m_nodes[old_parent].child2 = new_parent;
+    }
+  } else {
+    m_root = new_parent;
+  }
+
+  m_nodes[sibling].parent = new_parent;
+  m_nodes[leaf].parent = new_parent;
+
+  FixUpwards(m_nodes[leaf].parent);
+}
+
+void AabbTree::RemoveLeaf(int32_t leaf) {
+  if (leaf == m_root) {
+    m_root = kNullNode;
+    return;
+  }
+
+  int32_t parent = m_nodes[leaf].parent;
+  int32_t grand_parent = m_nodes[parent].parent;
+  int32_t sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+  FreeNode(parent);
+
+  if (grand_parent == kNullNode) {
+    m_root = sibling;
+    m_nodes[sibling].parent = kNullNode;
+    return;
+  }
+
+  // the sibling takes the parent's place
+  if (m_nodes[grand_parent].child1 == parent) {
+    m_nodes[grand_parent].child1 = sibling;
+  } else {
+    m_nodes[grand_parent].child2 = sibling;
+  }
+
+  m_nodes[sibling].parent = grand_parent;
+
+  FixUpwards(grand_parent);
+}
+
+void AabbTree::FixUpwards(int32_t index) {
+  while (index != kNullNode) {
+    index = Balance(index);
+
+    Node& node = m_nodes[index];
+    Node const& child1 = m_nodes[node.child1];
+    Node const& child2 = m_nodes[node.child2];
+
+    node.height = 1 + std::max(child1.height, child2.height);
+    node.aabb = child1.aabb.Merge(child2.aabb);
+
+    index = node.parent;
+  }
+}
+
+int32_t AabbTree::Balance(int32_t a) {
+  Node& node_a = m_nodes[a];
+
+  if (node_a.IsLeaf() || node_a.height < 2) {
+    return a;
+  }
+
+  int32_t b = node_a.child1;
+  int32_t c = node_a.child2;
+
+  int32_t balance = m_nodes[c].height - m_nodes[b].height;
+
+  if (balance >= -1 && balance <= 1) {
+    return a;
+  }
+
+  // the taller child `up` becomes the subtree root, `a` takes the place of its shorter child
+  int32_t up = balance > 1 ? c : b;
+  int32_t other = balance > 1 ? b : c;
+
+  Node& node_up = m_nodes[up];
+  int32_t f = node_up.child1;
+  int32_t g = node_up.child2;
+
+  node_up.child1 = a;
+  node_up.parent = node_a.parent;
+  node_a.parent = up;
+
+  if (node_up.parent != kNullNode) {
+    Node& grand_parent = m_nodes[node_up.parent];
+
+    if (grand_parent.child1 == a) {
+      grand_parent.child1 = up;
+    } else {
+      grand_parent.child2 = up;
+    }
+  } else {
+    m_root = up;
+  }
+
+  // the taller grandchild stays with `up`, the shorter one moves under `a`
+  int32_t keep = m_nodes[f].height > m_nodes[g].height ? f : g;
+  int32_t move = keep == f ? g : f;
+
+  node_up.child2 = keep;
+
+  if (balance > 1) {
+    node_a.child2 = move;
+  } else {
+    node_a.child1 = move;
+  }
+
+  m_nodes[move].parent = a;
+
+  node_a.aabb = m_nodes[other].aabb.Merge(m_nodes[move].aabb);
+  node_a.height = 1 + std::max(m_nodes[other].height, m_nodes[move].height);
+
+  node_up.aabb = node_a.aabb.Merge(m_nodes[keep].aabb);
+  node_up.height = 1 + std::max(node_a.height, m_nodes[keep].height);
+
+  return up;
+}
+
+}  // namespace hexgon
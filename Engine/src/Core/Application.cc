@@ -23,6 +23,8 @@
 
 #include <Hexgon/Core/Application.hpp>
 #include <Hexgon/Core/Event.hpp>
+#include <Hexgon/Object/TransformSystem.hpp>
+#include <algorithm>
 
 #include "LogPrivate.hpp"
 
@@ -38,15 +40,46 @@ Application* Application::Create(std::string title, uint32_t width, uint32_t hei
   }
 
   g_instance = new Application;
+  g_instance->m_startup_begin = Clock::now();
+
+  // transforms belong to the thread which first asks for them, make that the main thread
+  TransformSystem::Get();
+
+  // glfw has to be up before the render instance asks it for the surface extensions
+  auto begin = Clock::now();
+  if (!Window::InitPlatform()) {
+    HEX_CORE_ERROR("Failed init window platform.");
+  }
+  g_instance->RecordStage("platform", begin);
+
+  // instance creation and driver loading do not need the window, run them while the window is created
+#if defined(HEX_PLATFORM_WINDOWS) || defined(HEX_PLATFORM_LINUX)
+  auto render_system = std::async(std::launch::async, []() {
+    auto begin = Clock::now();
+    auto ret = RenderSystem::Create(RenderAPI::kVulkan, true);
+    g_instance->RecordStage("render instance", begin);
+
+    return ret;
+  });
+#endif
 
   // init window
+  begin = Clock::now();
   g_instance->m_window = Window::Create(std::move(title), width, height);
 
   g_instance->m_window->SetDelegate(g_instance);
+  g_instance->RecordStage("window", begin);
 
   // init render system
 #if defined(HEX_PLATFORM_WINDOWS) || defined(HEX_PLATFORM_LINUX)
-  g_instance->m_render_system = RenderSystem::Init(RenderAPI::kVulkan, g_instance->m_window.get(), true);
+  g_instance->m_render_system = render_system.get();
+
+  begin = Clock::now();
+  if (g_instance->m_render_system && !g_instance->m_render_system->AttachWindow(g_instance->m_window.get())) {
+    g_instance->m_render_system->ShutDown();
+    g_instance->m_render_system.reset();
+  }
+  g_instance->RecordStage("render device", begin);
 #endif
 
   return g_instance;
@@ -60,17 +93,45 @@ void Application::Run() {
     return;
   }
 
+  auto begin = Clock::now();
   m_swap_chain = m_render_system->CreateSwapChain();
+  RecordStage("swap chain", begin);
+
+  // present a cleared frame as early as possible, layers join once their prefetch is done
+  begin = Clock::now();
+  if (m_swap_chain) {
+    m_swap_chain->SetClearColor(m_window->GetClearColor());
+
+    if (m_swap_chain->BeginFrame()) {
+      m_swap_chain->EndFrame();
+    }
+  }
+  RecordStage("first frame", begin);
 
   m_window->Show();
 }
 
+std::vector<StartupStage> Application::GetStartupStages() const {
+  std::lock_guard<std::mutex> lock(m_startup_mutex);
+
+  return m_startup_stages;
+}
+
 void Application::PushLayer(std::shared_ptr<Layer> const& layer) {
   layer->m_application = this;
+
+  m_prefetch.emplace_back(std::async(std::launch::async, [this, layer]() {
+    auto begin = Clock::now();
+    layer->OnPrefetch();
+    RecordStage("prefetch " + layer->GetLayerName(), begin);
+  }));
+
   m_layer_stack.PushLayer(layer);
 }
 
 void Application::PopLayer(std::shared_ptr<Layer> const& layer) {
+  CollectPrefetch(true);
+
   m_layer_stack.PopLayer(layer);
 
   layer->m_application = nullptr;
@@ -81,6 +142,8 @@ void Application::OnWindowResize(int32_t width, int32_t height) {
 }
 
 void Application::OnWindowClose() {
+  CollectPrefetch(true);
+
   for (auto const& it : m_layer_stack) {
     it->OnDetach();
   }
@@ -92,8 +155,87 @@ void Application::OnWindowClose() {
 }
 
 void Application::OnWindowUpdate() {
-  for (auto const& it : m_layer_stack) {
-    it->OnUpdate(0.f);
+  bool frame_begin = false;
+
+  if (m_swap_chain) {
+    m_swap_chain->SetClearColor(m_window->GetClearColor());
+
+    frame_begin = m_swap_chain->BeginFrame();
+  }
+
+  // until every layer has its assets only cleared frames are presented
+  bool layers_ready = CollectPrefetch(false);
+
+  if (layers_ready) {
+    for (auto const& it : m_layer_stack) {
+      it->OnUpdate(0.f);
+    }
+  }
+
+  // world matrices of everything moved this frame, before anything is drawn with them
+  TransformSystem::Get()->Update();
+
+  if (layers_ready) {
+    for (auto const& it : m_layer_stack) {
+      it->OnRender();
+    }
+  }
+
+  if (frame_begin) {
+    m_swap_chain->EndFrame();
+  }
+
+  if (layers_ready && !m_startup_logged) {
+    LogStartup();
+  }
+}
+
+void Application::RecordStage(std::string name, Clock::time_point begin) {
+  auto end = Clock::now();
+
+  StartupStage stage{};
+  stage.name = std::move(name);
+  stage.begin = std::chrono::duration<double, std::milli>(begin - m_startup_begin).count();
+  stage.end = std::chrono::duration<double, std::milli>(end - m_startup_begin).count();
+
+  std::lock_guard<std::mutex> lock(m_startup_mutex);
+  m_startup_stages.emplace_back(std::move(stage));
+}
+
+bool Application::CollectPrefetch(bool wait) {
+  while (!m_prefetch.empty()) {
+    auto& prefetch = m_prefetch.back();
+
+    if (!wait && prefetch.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      return false;
+    }
+
+    prefetch.get();
+    m_prefetch.pop_back();
+  }
+
+  return true;
+}
+
+void Application::LogStartup() {
+  RecordStage("layers ready", Clock::now());
+
+  m_startup_logged = true;
+
+  auto stages = GetStartupStages();
+
+  std::stable_sort(stages.begin(), stages.end(),
+                   [](StartupStage const& a, StartupStage const& b) { return a.begin < b.begin; });
+
+  for (auto const& stage : stages) {
+    HEX_CORE_INFO("Startup {:<24} {:>9.2f} ms -> {:>9.2f} ms ({:.2f} ms)", stage.name, stage.begin, stage.end,
+                  stage.end - stage.begin);
+  }
+
+  auto first_frame = std::find_if(stages.begin(), stages.end(),
+                                   [](StartupStage const& stage) { return stage.name == "first frame"; });
+  if (first_frame != stages.end()) {
+    HEX_CORE_INFO("Time to first frame {:.2f} ms", first_frame->end);
   }
 }
 
@@ -0,0 +1,104 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include <Hexgon/Core/Bounds.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace hexgon {
+
+Aabb Aabb::Transform(glm::mat4 const& matrix) const {
+  glm::vec3 center = matrix * glm::vec4(GetCenter(), 1.f);
+  glm::vec3 extent = GetExtent();
+  glm::vec3 world_extent(0.f);
+
+  for (int i = 0; i < 3; i++) {
+    world_extent[i] = std::abs(matrix[0][i]) * extent.x + std::abs(matrix[1][i]) * extent.y +
+                      std::abs(matrix[2][i]) * extent.z;
+  }
+
+  return Aabb{center - world_extent, center + world_extent};
+}
+
+BoundingSphere BoundingSphere::Transform(glm::mat4 const& matrix) const {
+  float scale = std::max({glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0])),
+                          glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1])),
+                          glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2]))});
+
+  return BoundingSphere{matrix * glm::vec4(center, 1.f), radius * std::sqrt(scale)};
+}
+
+Frustum Frustum::FromMatrix(glm::mat4 const& view_projection) {
+  auto row = [&view_projection](int i) {
+    return glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+  };
+
+  Frustum frustum{};
+
+  frustum.planes[kLeft] = row(3) + row(0);
+  frustum.planes[kRight] = row(3) - row(0);
+  frustum.planes[kBottom] = row(3) + row(1);
+  frustum.planes[kTop] = row(3) - row(1);
+#if defined(GLM_FORCE_DEPTH_ZERO_TO_ONE)
+  frustum.planes[kNear] = row(2);
+#else
+  frustum.planes[kNear] = row(3) + row(2);
+#endif
+  frustum.planes[kFar] = row(3) - row(2);
+
+  for (auto& plane : frustum.planes) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+
+  return frustum;
+}
+
+bool Frustum::Intersects(Aabb const& aabb) const {
+  glm::vec3 center = aabb.GetCenter();
+  glm::vec3 extent = aabb.GetExtent();
+
+  for (auto const& plane : planes) {
+    glm::vec3 normal(plane);
+
+    float distance = glm::dot(normal, center) + plane.w;
+    float radius = glm::dot(glm::abs(normal), extent);
+
+    if (distance + radius < 0.f) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool Frustum::Intersects(BoundingSphere const& sphere) const {
+  for (auto const& plane : planes) {
+    if (glm::dot(glm::vec3(plane), sphere.center) + plane.w + sphere.radius < 0.f) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}  // namespace hexgon
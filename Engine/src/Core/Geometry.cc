@@ -22,6 +22,10 @@
  */
 
 #include <Hexgon/Core/Geometry.hpp>
+#include <algorithm>
+#include <cmath>
+
+#include "Core/Geometry/Simplifier.hpp"
 
 namespace hexgon {
 
@@ -30,6 +34,73 @@ void Geometry::Build() {
   m_index.clear();
 
   OnBuild();
+
+  m_lods.clear();
+  m_lods.emplace_back(Lod{0, static_cast<uint32_t>(m_index.size()), 0.f});
+
+  m_aabb = {};
+  m_sphere = {};
+
+  size_t count = m_vertex.size() / kVertexStride;
+
+  if (count == 0) {
+    return;
+  }
+
+  auto position = [this](size_t i) {
+    return glm::vec3(m_vertex[i * kVertexStride], m_vertex[i * kVertexStride + 1], m_vertex[i * kVertexStride + 2]);
+  };
+
+  m_aabb.min = m_aabb.max = position(0);
+
+  for (size_t i = 1; i < count; i++) {
+    m_aabb.min = glm::min(m_aabb.min, position(i));
+    m_aabb.max = glm::max(m_aabb.max, position(i));
+  }
+
+  // centered on the box, but only as large as the farthest vertex, which is tighter than the half diagonal
+  float radius2 = 0.f;
+  m_sphere.center = m_aabb.GetCenter();
+
+  for (size_t i = 0; i < count; i++) {
+    glm::vec3 offset = position(i) - m_sphere.center;
+    radius2 = std::max(radius2, glm::dot(offset, offset));
+  }
+
+  m_sphere.radius = std::sqrt(radius2);
+}
+
+void Geometry::GenerateLods(uint32_t max_lod_count, float reduction, float max_error) {
+  if (m_lods.empty()) {
+    return;
+  }
+
+  // a later call replaces the chain
+  m_index.resize(m_lods[0].index_count);
+  m_lods.resize(1);
+
+  Simplifier simplifier(m_vertex, kVertexStride, m_index);
+
+  size_t previous = m_index.size();
+
+  while (m_lods.size() < max_lod_count) {
+    size_t target = static_cast<size_t>(static_cast<float>(previous / 3) * reduction) * 3;
+
+    simplifier.Simplify(target, max_error * m_sphere.radius);
+
+    auto const& indices = simplifier.GetIndices();
+
+    // not worth another draw range when it saves less than a tenth
+    if (indices.empty() || indices.size() * 10 > previous * 9) {
+      break;
+    }
+
+    m_lods.emplace_back(
+        Lod{static_cast<uint32_t>(m_index.size()), static_cast<uint32_t>(indices.size()), simplifier.GetError()});
+    m_index.insert(m_index.end(), indices.begin(), indices.end());
+
+    previous = indices.size();
+  }
 }
 
 }  // namespace hexgon
@@ -42,7 +42,7 @@ static void build_plane(const glm::u32vec3& index, const glm::vec2& uv_dir, cons
   int32_t gridX1 = grid.x + 1;
   int32_t gridY1 = grid.y + 1;
 
-  uint32_t vertexStart = vertics.size() / 8;
+  uint32_t vertexStart = vertics.size() / Geometry::kVertexStride;
   uint32_t vertexCounter = 0;
   for (int32_t iy = 0; iy < gridY1; iy++) {
     float y = iy * segmentHeight - heightHalf;
@@ -129,6 +129,7 @@ std::unique_ptr<Geometry> Geometry::MakeBox(float width, float height, float dep
   auto box = std::make_unique<Box>(width, height, depth, width_segments, height_segments, depth_segments);
 
   box->Build();
+  box->GenerateLods();
 
   return box;
 }
@@ -0,0 +1,499 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include "Core/Geometry/Simplifier.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+namespace hexgon {
+
+namespace {
+
+// border planes are stiffer than the surface, otherwise open edges shrink first
+constexpr double kBorderWeight = 10.0;
+
+// positions closer than this fraction of the mesh extent are welded
+constexpr float kWeldTolerance = 1e-5f;
+
+uint64_t CellKey(glm::ivec3 const& cell) {
+  return (static_cast<uint64_t>(cell.x & 0x1fffff) << 42) | (static_cast<uint64_t>(cell.y & 0x1fffff) << 21) |
+         static_cast<uint64_t>(cell.z & 0x1fffff);
+}
+
+uint64_t EdgeKey(uint32_t a, uint32_t b) {
+  return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+}
+
+}  // namespace
+
+void Simplifier::Quadric::AddPlane(glm::dvec3 const& normal, double distance, double plane_weight) {
+  a00 += plane_weight * normal.x * normal.x;
+  a01 += plane_weight * normal.x * normal.y;
+  a02 += plane_weight * normal.x * normal.z;
+  a03 += plane_weight * normal.x * distance;
+  a11 += plane_weight * normal.y * normal.y;
+  a12 += plane_weight * normal.y * normal.z;
+  a13 += plane_weight * normal.y * distance;
+  a22 += plane_weight * normal.z * normal.z;
+  a23 += plane_weight * normal.z * distance;
+  a33 += plane_weight * distance * distance;
+  weight += plane_weight;
+}
+
+void Simplifier::Quadric::Add(Quadric const& other) {
+  a00 += other.a00;
+  a01 += other.a01;
+  a02 += other.a02;
+  a03 += other.a03;
+  a11 += other.a11;
+  a12 += other.a12;
+  a13 += other.a13;
+  a22 += other.a22;
+  a23 += other.a23;
+  a33 += other.a33;
+  weight += other.weight;
+}
+
+double Simplifier::Quadric::Evaluate(glm::dvec3 const& p) const {
+  return a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z +
+         2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z) + 2.0 * (a03 * p.x + a13 * p.y + a23 * p.z) +
+         a33;
+}
+
+Simplifier::Simplifier(std::vector<float> const& vertices, size_t stride, std::vector<uint32_t> const& indices)
+    : m_indices(indices) {
+  m_indices.resize(m_indices.size() / 3 * 3);
+
+  Weld(vertices, stride);
+
+  // triangles collapsed by welding would only get in the way
+  size_t count = 0;
+  for (size_t i = 0; i < m_indices.size(); i += 3) {
+    uint32_t a = m_group[m_indices[i]];
+    uint32_t b = m_group[m_indices[i + 1]];
+    uint32_t c = m_group[m_indices[i + 2]];
+
+    if (a == b || b == c || c == a) {
+      continue;
+    }
+
+    std::copy(m_indices.begin() + i, m_indices.begin() + i + 3, m_indices.begin() + count);
+    count += 3;
+  }
+
+  m_indices.resize(count);
+
+  ComputeQuadrics();
+
+  m_remap.resize(m_group.size());
+  for (uint32_t i = 0; i < m_remap.size(); i++) {
+    m_remap[i] = i;
+  }
+}
+
+void Simplifier::Simplify(size_t target_index_count, float max_error) {
+  while (m_indices.size() > target_index_count) {
+    if (CollapsePass(target_index_count, max_error) == 0) {
+      break;
+    }
+  }
+}
+
+void Simplifier::Weld(std::vector<float> const& vertices, size_t stride) {
+  size_t count = vertices.size() / stride;
+
+  auto position = [&vertices, stride](size_t i) {
+    return glm::vec3(vertices[i * stride], vertices[i * stride + 1], vertices[i * stride + 2]);
+  };
+
+  glm::vec3 min(0.f);
+  glm::vec3 max(0.f);
+
+  if (count > 0) {
+    min = max = position(0);
+  }
+
+  for (size_t i = 1; i < count; i++) {
+    min = glm::min(min, position(i));
+    max = glm::max(max, position(i));
+  }
+
+  glm::vec3 extent = max - min;
+  float tolerance = std::max(std::max(extent.x, std::max(extent.y, extent.z)) * kWeldTolerance, 1e-12f);
+
+  // cells are as large as the tolerance, so a match is always in one of the 27 cells around a vertex
+  std::unordered_map<uint64_t, uint32_t> cells{};
+  std::vector<uint32_t> next_in_cell{};
+
+  m_group.resize(count);
+  m_positions.clear();
+
+  for (size_t i = 0; i < count; i++) {
+    glm::vec3 p = position(i);
+    glm::ivec3 cell = glm::ivec3(glm::floor((p - min) / tolerance));
+
+    uint32_t group = UINT32_MAX;
+
+    for (int32_t z = -1; z <= 1 && group == UINT32_MAX; z++) {
+      for (int32_t y = -1; y <= 1 && group == UINT32_MAX; y++) {
+        for (int32_t x = -1; x <= 1 && group == UINT32_MAX; x++) {
+          auto it = cells.find(CellKey(cell + glm::ivec3(x, y, z)));
+
+          for (uint32_t g = it == cells.end() ? UINT32_MAX : it->second; g != UINT32_MAX; g = next_in_cell[g]) {
+            glm::vec3 offset = glm::abs(m_positions[g] - p);
+
+            if (std::max(offset.x, std::max(offset.y, offset.z)) <= tolerance) {
+              group = g;
+              break;
+            }
+          }
+        }
+      }
+    }
+
+    if (group == UINT32_MAX) {
+      group = static_cast<uint32_t>(m_positions.size());
+      m_positions.emplace_back(p);
+
+      auto it = cells.emplace(CellKey(cell), UINT32_MAX).first;
+      next_in_cell.emplace_back(it->second);
+      it->second = group;
+    }
+
+    m_group[i] = group;
+  }
+
+  m_wedge_offsets.assign(m_positions.size() + 1, 0);
+
+  for (size_t i = 0; i < count; i++) {
+    m_wedge_offsets[m_group[i] + 1]++;
+  }
+
+  for (size_t g = 0; g < m_positions.size(); g++) {
+    m_wedge_offsets[g + 1] += m_wedge_offsets[g];
+  }
+
+  std::vector<uint32_t> cursor(m_wedge_offsets.begin(), m_wedge_offsets.end() - 1);
+  m_wedges.resize(count);
+
+  for (size_t i = 0; i < count; i++) {
+    m_wedges[cursor[m_group[i]]++] = static_cast<uint32_t>(i);
+  }
+}
+
+void Simplifier::ComputeQuadrics() {
+  size_t group_count = m_positions.size();
+
+  m_quadrics.assign(group_count, Quadric{});
+  m_border.assign(group_count, 0);
+  m_locked.assign(group_count, 0);
+
+  std::unordered_map<uint64_t, uint32_t> edges{};
+  edges.reserve(m_indices.size());
+
+  for (size_t i = 0; i < m_indices.size(); i += 3) {
+    uint32_t g[3] = {m_group[m_indices[i]], m_group[m_indices[i + 1]], m_group[m_indices[i + 2]]};
+
+    glm::dvec3 p0 = m_positions[g[0]];
+    glm::dvec3 normal = glm::cross(glm::dvec3(m_positions[g[1]]) - p0, glm::dvec3(m_positions[g[2]]) - p0);
+    double length = glm::length(normal);
+
+    if (length > 0.0) {
+      normal /= length;
+
+      for (uint32_t k = 0; k < 3; k++) {
+        m_quadrics[g[k]].AddPlane(normal, -glm::dot(normal, p0), length * 0.5);
+      }
+    }
+
+    for (uint32_t k = 0; k < 3; k++) {
+      edges[EdgeKey(g[k], g[(k + 1) % 3])]++;
+    }
+  }
+
+  for (size_t i = 0; i < m_indices.size(); i += 3) {
+    uint32_t g[3] = {m_group[m_indices[i]], m_group[m_indices[i + 1]], m_group[m_indices[i + 2]]};
+
+    glm::dvec3 p0 = m_positions[g[0]];
+    glm::dvec3 normal = glm::cross(glm::dvec3(m_positions[g[1]]) - p0, glm::dvec3(m_positions[g[2]]) - p0);
+
+    for (uint32_t k = 0; k < 3; k++) {
+      uint32_t a = g[k];
+      uint32_t b = g[(k + 1) % 3];
+      uint32_t count = edges[EdgeKey(a, b)];
+
+      // more than two triangles on an edge, nothing sensible can be collapsed there
+      if (count > 2) {
+        m_locked[a] = m_locked[b] = 1;
+        continue;
+      }
+
+      if (count != 1) {
+        continue;
+      }
+
+      m_border[a] = m_border[b] = 1;
+
+      glm::dvec3 pa = m_positions[a];
+      glm::dvec3 edge = glm::dvec3(m_positions[b]) - pa;
+      glm::dvec3 plane = glm::cross(edge, normal);
+      double length = glm::length(plane);
+
+      if (length > 0.0) {
+        plane /= length;
+
+        double weight = glm::dot(edge, edge) * kBorderWeight;
+
+        m_quadrics[a].AddPlane(plane, -glm::dot(plane, pa), weight);
+        m_quadrics[b].AddPlane(plane, -glm::dot(plane, pa), weight);
+      }
+    }
+  }
+}
+
+void Simplifier::BuildAdjacency() {
+  m_adjacency_offsets.assign(m_positions.size() + 1, 0);
+
+  for (auto index : m_indices) {
+    m_adjacency_offsets[m_group[index] + 1]++;
+  }
+
+  for (size_t g = 0; g < m_positions.size(); g++) {
+    m_adjacency_offsets[g + 1] += m_adjacency_offsets[g];
+  }
+
+  std::vector<uint32_t> cursor(m_adjacency_offsets.begin(), m_adjacency_offsets.end() - 1);
+  m_adjacency.resize(m_indices.size());
+
+  for (size_t i = 0; i < m_indices.size(); i++) {
+    m_adjacency[cursor[m_group[m_indices[i]]]++] = static_cast<uint32_t>(i / 3);
+  }
+}
+
+float Simplifier::GetCollapseError(uint32_t from, uint32_t to) const {
+  Quadric quadric = m_quadrics[from];
+  quadric.Add(m_quadrics[to]);
+
+  if (quadric.weight <= 0.0) {
+    return 0.f;
+  }
+
+  return static_cast<float>(std::sqrt(std::max(quadric.Evaluate(m_positions[to]), 0.0) / quadric.weight));
+}
+
+bool Simplifier::TryCollapse(Collapse const& collapse, size_t& removed) {
+  uint32_t from = collapse.from;
+  uint32_t to = collapse.to;
+
+  uint32_t const* begin = m_adjacency.data() + m_adjacency_offsets[from];
+  uint32_t const* end = m_adjacency.data() + m_adjacency_offsets[from + 1];
+
+  auto has_group = [this](uint32_t triangle, uint32_t group) {
+    return m_group[m_indices[triangle * 3]] == group || m_group[m_indices[triangle * 3 + 1]] == group ||
+           m_group[m_indices[triangle * 3 + 2]] == group;
+  };
+
+  size_t shared = 0;
+  for (auto it = begin; it != end; it++) {
+    shared += has_group(*it, to) ? 1 : 0;
+  }
+
+  // a border vertex only slides along its border edge
+  if (shared == 0 || (m_border[from] && shared != 1)) {
+    return false;
+  }
+
+  glm::vec3 target = m_positions[to];
+
+  for (auto it = begin; it != end; it++) {
+    if (has_group(*it, to)) {
+      continue;
+    }
+
+    glm::vec3 p[3];
+    for (uint32_t k = 0; k < 3; k++) {
+      p[k] = m_positions[m_group[m_indices[*it * 3 + k]]];
+    }
+
+    glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+    for (uint32_t k = 0; k < 3; k++) {
+      if (m_group[m_indices[*it * 3 + k]] == from) {
+        p[k] = target;
+      }
+    }
+
+    glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+    if (glm::dot(before, after) <= 0.f) {
+      return false;
+    }
+  }
+
+  // every wedge lands on the wedge of `to` it shares a triangle with, a wedge that has none sits on the other side of
+  // a seam which this edge doesn't run along
+  m_wedge_targets.clear();
+
+  for (uint32_t w = m_wedge_offsets[from]; w < m_wedge_offsets[from + 1]; w++) {
+    uint32_t wedge = m_wedges[w];
+    uint32_t wedge_target = UINT32_MAX;
+    bool used = false;
+
+    for (auto it = begin; it != end && wedge_target == UINT32_MAX; it++) {
+      uint32_t const* triangle = &m_indices[*it * 3];
+
+      if (triangle[0] != wedge && triangle[1] != wedge && triangle[2] != wedge) {
+        continue;
+      }
+
+      used = true;
+
+      for (uint32_t k = 0; k < 3; k++) {
+        if (m_group[triangle[k]] == to) {
+          wedge_target = triangle[k];
+        }
+      }
+    }
+
+    if (used && wedge_target == UINT32_MAX) {
+      return false;
+    }
+
+    m_wedge_targets.emplace_back(used ? wedge_target : wedge);
+  }
+
+  for (uint32_t w = m_wedge_offsets[from]; w < m_wedge_offsets[from + 1]; w++) {
+    m_remap[m_wedges[w]] = m_wedge_targets[w - m_wedge_offsets[from]];
+  }
+
+  m_quadrics[to].Add(m_quadrics[from]);
+
+  // triangles around `from` change, nothing touching them may collapse again before the adjacency is rebuilt
+  for (auto it = begin; it != end; it++) {
+    for (uint32_t k = 0; k < 3; k++) {
+      m_touched[m_group[m_indices[*it * 3 + k]]] = 1;
+    }
+  }
+
+  removed += shared;
+
+  return true;
+}
+
+size_t Simplifier::CollapsePass(size_t target_index_count, float max_error) {
+  BuildAdjacency();
+
+  std::vector<uint64_t> edges{};
+  edges.reserve(m_indices.size());
+
+  for (size_t i = 0; i < m_indices.size(); i += 3) {
+    for (uint32_t k = 0; k < 3; k++) {
+      edges.emplace_back(EdgeKey(m_group[m_indices[i + k]], m_group[m_indices[i + (k + 1) % 3]]));
+    }
+  }
+
+  std::sort(edges.begin(), edges.end());
+  edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+  std::vector<Collapse> collapses{};
+  collapses.reserve(edges.size());
+
+  auto can_collapse = [this](uint32_t from, uint32_t to) {
+    return !m_locked[from] && (!m_border[from] || m_border[to]);
+  };
+
+  for (auto edge : edges) {
+    uint32_t a = static_cast<uint32_t>(edge >> 32);
+    uint32_t b = static_cast<uint32_t>(edge & 0xffffffff);
+
+    Collapse collapse{a, b, std::numeric_limits<float>::max()};
+
+    if (can_collapse(a, b)) {
+      collapse.error = GetCollapseError(a, b);
+    }
+
+    if (can_collapse(b, a)) {
+      float error = GetCollapseError(b, a);
+
+      if (error < collapse.error) {
+        collapse = Collapse{b, a, error};
+      }
+    }
+
+    if (collapse.error <= max_error) {
+      collapses.emplace_back(collapse);
+    }
+  }
+
+  if (collapses.empty()) {
+    return 0;
+  }
+
+  std::sort(collapses.begin(), collapses.end(),
+            [](Collapse const& a, Collapse const& b) { return a.error < b.error; });
+
+  // only the cheaper half goes in one pass, the rest is scored again against the simplified neighbourhood
+  size_t limit = (collapses.size() + 1) / 2;
+  size_t budget = (m_indices.size() - target_index_count + 2) / 3;
+  size_t removed = 0;
+  size_t performed = 0;
+
+  m_touched.assign(m_positions.size(), 0);
+
+  for (size_t i = 0; i < limit && removed < budget; i++) {
+    auto const& collapse = collapses[i];
+
+    if (m_touched[collapse.from] || m_touched[collapse.to]) {
+      continue;
+    }
+
+    if (TryCollapse(collapse, removed)) {
+      m_error = std::max(m_error, collapse.error);
+      performed++;
+    }
+  }
+
+  size_t count = 0;
+  for (size_t i = 0; i < m_indices.size(); i += 3) {
+    uint32_t a = m_remap[m_indices[i]];
+    uint32_t b = m_remap[m_indices[i + 1]];
+    uint32_t c = m_remap[m_indices[i + 2]];
+
+    if (m_group[a] == m_group[b] || m_group[b] == m_group[c] || m_group[c] == m_group[a]) {
+      continue;
+    }
+
+    m_indices[count++] = a;
+    m_indices[count++] = b;
+    m_indices[count++] = c;
+  }
+
+  m_indices.resize(count);
+
+  return performed;
+}
+
+}  // namespace hexgon
@@ -0,0 +1,109 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#ifndef ENGINE_SRC_CORE_GEOMETRY_SIMPLIFIER_HPP_
+#define ENGINE_SRC_CORE_GEOMETRY_SIMPLIFIER_HPP_
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace hexgon {
+
+// Quadric error metric simplification by half edge collapses, vertices only ever move onto one of their neighbours
+// so every level keeps using the original vertex buffer. Vertices sharing a position are welded, attribute seams
+// and open borders only collapse along themselves, which keeps uv and normal discontinuities intact.
+class Simplifier {
+ public:
+  // `stride` floats per vertex, the position comes first
+  Simplifier(std::vector<float> const& vertices, size_t stride, std::vector<uint32_t> const& indices);
+
+  // collapses until no more than `target_index_count` indices are left or the next collapse would move the surface
+  // further than `max_error`, can be called again with a lower target to continue
+  void Simplify(size_t target_index_count, float max_error);
+
+  std::vector<uint32_t> const& GetIndices() const { return m_indices; }
+
+  // largest distance the surface moved so far, in object space
+  float GetError() const { return m_error; }
+
+ private:
+  // symmetric 4x4 matrix of summed plane equations, weighted by triangle area
+  struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+    double a11 = 0, a12 = 0, a13 = 0;
+    double a22 = 0, a23 = 0;
+    double a33 = 0;
+    double weight = 0;
+
+    void AddPlane(glm::dvec3 const& normal, double distance, double weight);
+
+    void Add(Quadric const& other);
+
+    double Evaluate(glm::dvec3 const& p) const;
+  };
+
+  struct Collapse {
+    uint32_t from = 0;
+    uint32_t to = 0;
+    float error = 0.f;
+  };
+
+  void Weld(std::vector<float> const& vertices, size_t stride);
+
+  // plane quadrics of every triangle, open borders add a perpendicular plane to hold them in place
+  void ComputeQuadrics();
+
+  void BuildAdjacency();
+
+  float GetCollapseError(uint32_t from, uint32_t to) const;
+
+  // maps the wedges of `collapse.from` onto the wedges of `collapse.to`, false if the collapse breaks a seam, a
+  // border or flips a triangle
+  bool TryCollapse(Collapse const& collapse, size_t& removed);
+
+  size_t CollapsePass(size_t target_index_count, float max_error);
+
+ private:
+  std::vector<uint32_t> m_indices = {};
+  // welded position of every vertex
+  std::vector<uint32_t> m_group = {};
+  std::vector<glm::vec3> m_positions = {};
+  // vertices of every welded position
+  std::vector<uint32_t> m_wedge_offsets = {};
+  std::vector<uint32_t> m_wedges = {};
+  std::vector<uint8_t> m_border = {};
+  std::vector<uint8_t> m_locked = {};
+  std::vector<Quadric> m_quadrics = {};
+  // triangles around every welded position
+  std::vector<uint32_t> m_adjacency_offsets = {};
+  std::vector<uint32_t> m_adjacency = {};
+  std::vector<uint32_t> m_remap = {};
+  std::vector<uint8_t> m_touched = {};
+  std::vector<uint32_t> m_wedge_targets = {};
+  float m_error = 0.f;
+};
+
+}  // namespace hexgon
+
+#endif  // ENGINE_SRC_CORE_GEOMETRY_SIMPLIFIER_HPP_
@@ -0,0 +1,156 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include <Hexgon/Core/JobSystem.hpp>
+#include <algorithm>
+#include <atomic>
+
+namespace hexgon {
+
+namespace {
+
+thread_local uint32_t t_thread_index = 0;
+
+}  // namespace
+
+struct JobSystem::Batch {
+  ChunkFunc const* func = nullptr;
+  uint32_t count = 0;
+  uint32_t chunk_size = 0;
+  uint32_t chunk_count = 0;
+  std::atomic<uint32_t> next{0};
+  std::atomic<uint32_t> done{0};
+};
+
+JobSystem* JobSystem::Get() {
+  // function local statics are initialized once even when first called from several threads
+  static JobSystem g_instance(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+
+  return &g_instance;
+}
+
+uint32_t JobSystem::GetCurrentThreadIndex() { return t_thread_index; }
+
+JobSystem::JobSystem(uint32_t worker_count) {
+  m_workers.reserve(worker_count);
+
+  for (uint32_t i = 0; i < worker_count; i++) {
+    m_workers.emplace_back(&JobSystem::WorkerLoop, this, i + 1);
+  }
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+
+  m_cv.notify_all();
+
+  for (auto& worker : m_workers) {
+    worker.join();
+  }
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t chunk_size, const ChunkFunc& func) {
+  if (count == 0) {
+    return;
+  }
+
+  chunk_size = std::max(chunk_size, 1u);
+
+  uint32_t chunk_count = (count + chunk_size - 1) / chunk_size;
+
+  if (chunk_count == 1 || m_workers.empty()) {
+    func(0, count, t_thread_index);
+    return;
+  }
+
+  auto batch = std::make_shared<Batch>();
+  batch->func = &func;
+  batch->count = count;
+  batch->chunk_size = chunk_size;
+  batch->chunk_count = chunk_count;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_batches.emplace_back(batch);
+  }
+
+  m_cv.notify_all();
+
+  RunBatch(batch, t_thread_index);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_done_cv.wait(lock, [&batch] { return batch->done.load() == batch->chunk_count; });
+}
+
+void JobSystem::WorkerLoop(uint32_t thread_index) {
+  t_thread_index = thread_index;
+
+  while (true) {
+    std::shared_ptr<Batch> batch;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait(lock, [this] { return m_stop || !m_batches.empty(); });
+
+      if (m_stop) {
+        return;
+      }
+
+      batch = m_batches.front();
+    }
+
+    RunBatch(batch, thread_index);
+  }
+}
+
+void JobSystem::RunBatch(const std::shared_ptr<Batch>& batch, uint32_t thread_index) {
+  while (true) {
+    uint32_t chunk = batch->next.fetch_add(1);
+
+    if (chunk >= batch->chunk_count) {
+      break;
+    }
+
+    uint32_t begin = chunk * batch->chunk_size;
+    uint32_t end = std::min(begin + batch->chunk_size, batch->count);
+
+    (*batch->func)(begin, end, thread_index);
+
+    if (batch->done.fetch_add(1) + 1 == batch->chunk_count) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_done_cv.notify_all();
+    }
+  }
+
+  // all chunks are taken, stop handing this batch out
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto it = std::find(m_batches.begin(), m_batches.end(), batch);
+  if (it != m_batches.end()) {
+    m_batches.erase(it);
+  }
+}
+
+}  // namespace hexgon
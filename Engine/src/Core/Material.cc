@@ -22,5 +22,16 @@
  */
 
 #include <Hexgon/Core/Material.hpp>
+#include <atomic>
 
-namespace hexgon {}  // namespace hexgon
+namespace hexgon {
+
+namespace {
+
+std::atomic<uint32_t> g_next_material_id{1};
+
+}  // namespace
+
+Material::Material() : m_id(g_next_material_id.fetch_add(1, std::memory_order_relaxed)) {}
+
+}  // namespace hexgon
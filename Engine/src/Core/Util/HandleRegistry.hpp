@@ -0,0 +1,209 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace hexgon {
+
+// 32 bit slot index and 32 bit generation, the generation changes every time a slot is released so old handles to a
+// reused slot are detected instead of resolving to the new owner
+struct ResourceHandle {
+  static constexpr uint32_t kInvalidIndex = UINT32_MAX;
+
+  uint32_t index = kInvalidIndex;
+  uint32_t generation = 0;
+
+  bool IsValid() const { return index != kInvalidIndex; }
+
+  uint64_t GetValue() const { return (static_cast<uint64_t>(generation) << 32) | index; }
+
+  bool operator==(ResourceHandle const& other) const {
+    return index == other.index && generation == other.generation;
+  }
+
+  bool operator!=(ResourceHandle const& other) const { return !(*this == other); }
+};
+
+// Slots live in fixed size blocks which are never moved or freed while the registry is alive, so `Get` only needs
+// atomic loads. `Allocate` and `Release` are serialized by a mutex and can be called from any thread.
+template <typename T, uint32_t BlockSize = 1024, uint32_t MaxBlocks = 1024>
+class HandleRegistry {
+  static_assert((BlockSize & (BlockSize - 1)) == 0, "BlockSize must be power of two");
+
+ public:
+  HandleRegistry() {
+    for (auto& block : m_blocks) {
+      block.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  ~HandleRegistry() {
+    for (auto& block : m_blocks) {
+      delete[] block.load(std::memory_order_relaxed);
+    }
+  }
+
+  HandleRegistry(HandleRegistry const&) = delete;
+  HandleRegistry& operator=(HandleRegistry const&) = delete;
+
+  ResourceHandle Allocate(T* value) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint32_t index = ResourceHandle::kInvalidIndex;
+
+    if (!m_free_list.empty()) {
+      index = m_free_list.back();
+      m_free_list.pop_back();
+    } else {
+      if (m_slot_count == BlockSize * MaxBlocks) {
+        return {};
+      }
+
+      index = m_slot_count++;
+
+      auto& block = m_blocks[index / BlockSize];
+      if (block.load(std::memory_order_relaxed) == nullptr) {
+        block.store(new Slot[BlockSize], std::memory_order_release);
+      }
+    }
+
+    Slot& slot = GetSlot(index);
+    slot.value.store(value, std::memory_order_release);
+
+    m_live_count.fetch_add(1, std::memory_order_relaxed);
+
+    return ResourceHandle{index, slot.generation.load(std::memory_order_relaxed)};
+  }
+
+  // returns false if the handle is stale or was never allocated
+  bool Release(ResourceHandle handle) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!IsAlive(handle)) {
+      return false;
+    }
+
+    Slot& slot = GetSlot(handle.index);
+    // bump the generation first, readers which loaded the old value see the mismatch on their second check
+    slot.generation.fetch_add(1, std::memory_order_acq_rel);
+    slot.value.store(nullptr, std::memory_order_release);
+
+    m_free_list.emplace_back(handle.index);
+    m_live_count.fetch_sub(1, std::memory_order_relaxed);
+
+    return true;
+  }
+
+  // lock free, returns nullptr for stale handles
+  T* Get(ResourceHandle handle) const {
+    if (!IsAlive(handle)) {
+      return nullptr;
+    }
+
+    Slot const& slot = GetSlot(handle.index);
+
+    T* value = slot.value.load(std::memory_order_acquire);
+
+    if (slot.generation.load(std::memory_order_acquire) != handle.generation) {
+      return nullptr;
+    }
+
+    return value;
+  }
+
+  bool IsAlive(ResourceHandle handle) const {
+    if (handle.index >= m_slot_count.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    auto block = m_blocks[handle.index / BlockSize].load(std::memory_order_acquire);
+    if (block == nullptr) {
+      return false;
+    }
+
+    return block[handle.index % BlockSize].generation.load(std::memory_order_acquire) == handle.generation;
+  }
+
+  uint32_t GetLiveCount() const { return m_live_count.load(std::memory_order_relaxed); }
+
+  // visit every live value, allocation and release are blocked while visiting
+  template <typename F>
+  void ForEach(F&& func) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (uint32_t i = 0; i < m_slot_count; i++) {
+      T* value = GetSlot(i).value.load(std::memory_order_acquire);
+      if (value) {
+        func(ResourceHandle{i, GetSlot(i).generation.load(std::memory_order_relaxed)}, value);
+      }
+    }
+  }
+
+  // release every slot, all outstanding handles become stale
+  void Clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_free_list.clear();
+
+    for (uint32_t i = m_slot_count; i > 0; i--) {
+      Slot& slot = GetSlot(i - 1);
+
+      if (slot.value.load(std::memory_order_relaxed)) {
+        slot.generation.fetch_add(1, std::memory_order_acq_rel);
+        slot.value.store(nullptr, std::memory_order_release);
+      }
+
+      m_free_list.emplace_back(i - 1);
+    }
+
+    m_live_count.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  struct Slot {
+    std::atomic<T*> value = {nullptr};
+    std::atomic<uint32_t> generation = {0};
+  };
+
+  Slot& GetSlot(uint32_t index) { return m_blocks[index / BlockSize].load(std::memory_order_acquire)[index % BlockSize]; }
+
+  Slot const& GetSlot(uint32_t index) const {
+    return m_blocks[index / BlockSize].load(std::memory_order_acquire)[index % BlockSize];
+  }
+
+ private:
+  std::array<std::atomic<Slot*>, MaxBlocks> m_blocks;
+  std::atomic<uint32_t> m_slot_count = {0};
+  std::atomic<uint32_t> m_live_count = {0};
+  std::mutex m_mutex = {};
+  std::vector<uint32_t> m_free_list = {};
+};
+
+}  // namespace hexgon
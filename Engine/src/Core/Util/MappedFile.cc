@@ -0,0 +1,148 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include "Core/Util/MappedFile.hpp"
+
+#ifdef HEX_PLATFORM_WINDOWS
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "LogPrivate.hpp"
+
+namespace hexgon {
+
+MappedFile::~MappedFile() { Close(); }
+
+#ifdef HEX_PLATFORM_WINDOWS
+
+bool MappedFile::Open(const std::string& path) {
+  Close();
+
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    HEX_CORE_ERROR("Failed open file {}.", path);
+    return false;
+  }
+
+  LARGE_INTEGER size{};
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    HEX_CORE_ERROR("Failed get size of file {}.", path);
+    CloseHandle(file);
+    return false;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    HEX_CORE_ERROR("Failed map file {}.", path);
+    CloseHandle(file);
+    return false;
+  }
+
+  m_data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (m_data == nullptr) {
+    HEX_CORE_ERROR("Failed map view of file {}.", path);
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+
+  m_size = static_cast<size_t>(size.QuadPart);
+  m_file = file;
+  m_mapping = mapping;
+
+  return true;
+}
+
+void MappedFile::Close() {
+  if (m_data) {
+    UnmapViewOfFile(m_data);
+  }
+
+  if (m_mapping) {
+    CloseHandle(m_mapping);
+  }
+
+  if (m_file) {
+    CloseHandle(m_file);
+  }
+
+  m_data = nullptr;
+  m_size = 0;
+  m_file = nullptr;
+  m_mapping = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path) {
+  Close();
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    HEX_CORE_ERROR("Failed open file {}.", path);
+    return false;
+  }
+
+  struct stat st {};
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    HEX_CORE_ERROR("Failed get size of file {}.", path);
+    close(fd);
+    return false;
+  }
+
+  void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping keeps its own reference to the file
+  close(fd);
+
+  if (data == MAP_FAILED) {
+    HEX_CORE_ERROR("Failed map file {}.", path);
+    return false;
+  }
+
+  // payloads are read front to back exactly once
+  madvise(data, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+
+  m_data = static_cast<const uint8_t*>(data);
+  m_size = static_cast<size_t>(st.st_size);
+
+  return true;
+}
+
+void MappedFile::Close() {
+  if (m_data) {
+    munmap(const_cast<uint8_t*>(m_data), m_size);
+  }
+
+  m_data = nullptr;
+  m_size = 0;
+}
+
+#endif
+
+}  // namespace hexgon
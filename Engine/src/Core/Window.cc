@@ -70,10 +70,7 @@ class GLFWWindowImpl : public Window {
   void Shutdown() override { m_running = false; }
 
   void Init() {
-    glfwInit();
-
-    // error callback
-    glfwSetErrorCallback(GLFWErrorCallback);
+    InitPlatform();
 
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
     glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
@@ -172,6 +169,14 @@ class GLFWWindowImpl : public Window {
   double m_cursor_y = 0.0;
 };
 
+bool Window::InitPlatform() {
+  // error callback, set first so a failing init is reported
+  glfwSetErrorCallback(GLFWErrorCallback);
+
+  // a no-op once glfw is initialized
+  return glfwInit() == GLFW_TRUE;
+}
+
 std::unique_ptr<Window> Window::Create(std::string title, uint32_t width, uint32_t height) {
   auto window = std::make_unique<GLFWWindowImpl>(std::move(title), width, height);
 
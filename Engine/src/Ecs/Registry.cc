@@ -0,0 +1,401 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include <Hexgon/Ecs/Registry.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+#include "LogPrivate.hpp"
+
+namespace hexgon {
+
+namespace {
+
+constexpr size_t kChunkAlignment = 64;
+
+// entries are written once under the mutex before their id is handed out and never change, so they are read without
+// locking
+struct ComponentTable {
+  std::mutex mutex;
+  std::array<ComponentInfo, kMaxComponents> infos;
+  ComponentId count = 0;
+  std::unordered_map<std::string, ComponentId> ids;
+};
+
+ComponentTable& GetComponentTable() {
+  static ComponentTable table{};
+  return table;
+}
+
+uint8_t* AllocateChunk() {
+  return static_cast<uint8_t*>(::operator new(Registry::kChunkSize, std::align_val_t{kChunkAlignment}));
+}
+
+void FreeChunk(uint8_t* data) { ::operator delete(data, std::align_val_t{kChunkAlignment}); }
+
+size_t AlignUp(size_t value, size_t align) { return (value + align - 1) & ~(align - 1); }
+
+}  // namespace
+
+ComponentId RegisterComponent(ComponentInfo const& info) {
+  auto& table = GetComponentTable();
+  std::lock_guard<std::mutex> lock(table.mutex);
+
+  auto it = table.ids.find(info.name);
+
+  if (it != table.ids.end()) {
+    return it->second;
+  }
+
+  if (table.count >= kMaxComponents) {
+    // any id handed out now would alias the storage of another type
+    HEX_CORE_ERROR("Too many component types, at most {} are supported, cannot register {}", kMaxComponents,
+                   info.name);
+    std::abort();
+  }
+
+  ComponentId id = table.count++;
+
+  table.infos[id] = info;
+  table.ids.emplace(info.name, id);
+
+  return id;
+}
+
+ComponentInfo const& GetComponentInfo(ComponentId id) { return GetComponentTable().infos[id]; }
+
+Registry::Registry() { m_empty_archetype = FindArchetype({}); }
+
+Registry::~Registry() {
+  for (auto& archetype : m_archetypes) {
+    for (auto& chunk : archetype->chunks) {
+      for (size_t slot = 0; slot < archetype->components.size(); slot++) {
+        auto const& info = archetype->infos[slot];
+        uint8_t* column = Column(*archetype, chunk, static_cast<int16_t>(slot));
+
+        for (uint32_t row = 0; row < chunk.count; row++) {
+          info.destroy(column + row * info.size);
+        }
+      }
+
+      FreeChunk(chunk.data);
+    }
+  }
+}
+
+Entity Registry::Create() {
+  uint32_t index;
+
+  if (!m_free_entities.empty()) {
+    index = m_free_entities.back();
+    m_free_entities.pop_back();
+  } else {
+    index = static_cast<uint32_t>(m_records.size());
+    m_records.emplace_back();
+  }
+
+  Record& record = m_records[index];
+  Entity entity{index, record.generation};
+
+  auto location = AllocateRow(m_empty_archetype);
+
+  record.archetype = m_empty_archetype;
+  record.chunk = location.first;
+  record.row = location.second;
+
+  reinterpret_cast<Entity*>(m_empty_archetype->chunks[record.chunk].data)[record.row] = entity;
+  m_entity_count++;
+
+  return entity;
+}
+
+void Registry::Destroy(Entity entity) {
+  if (!IsAlive(entity)) {
+    return;
+  }
+
+  Record& record = m_records[entity.index];
+  Archetype* archetype = record.archetype;
+  Chunk& chunk = archetype->chunks[record.chunk];
+
+  for (size_t slot = 0; slot < archetype->components.size(); slot++) {
+    auto const& info = archetype->infos[slot];
+    info.destroy(Column(*archetype, chunk, static_cast<int16_t>(slot)) + record.row * info.size);
+  }
+
+  FillHole(archetype, record.chunk, record.row);
+
+  record.archetype = nullptr;
+  record.generation++;
+  m_free_entities.push_back(entity.index);
+  m_entity_count--;
+}
+
+bool Registry::IsAlive(Entity entity) const {
+  return entity.index < m_records.size() && m_records[entity.index].archetype &&
+         m_records[entity.index].generation == entity.generation;
+}
+
+uint32_t Registry::GetChunkCount() const {
+  uint32_t count = 0;
+
+  for (auto const& archetype : m_archetypes) {
+    count += static_cast<uint32_t>(archetype->chunks.size());
+  }
+
+  return count;
+}
+
+void* Registry::AddComponent(Entity entity, ComponentId id) {
+  if (!IsAlive(entity)) {
+    HEX_CORE_ERROR("Cannot add a component to a destroyed entity");
+    return nullptr;
+  }
+
+  Record& record = m_records[entity.index];
+  Archetype* source = record.archetype;
+
+  if (source->mask.test(id)) {
+    return GetComponent(entity, id, true);
+  }
+
+  Archetype* target;
+  auto edge = source->add_edges.find(id);
+
+  if (edge != source->add_edges.end()) {
+    target = edge->second;
+  } else {
+    auto components = source->components;
+    components.push_back(id);
+
+    target = FindArchetype(std::move(components));
+    source->add_edges.emplace(id, target);
+  }
+
+  if (!target) {
+    return nullptr;
+  }
+
+  MoveEntity(record, target);
+
+  return GetComponent(entity, id, false);
+}
+
+void Registry::RemoveComponent(Entity entity, ComponentId id) {
+  if (!IsAlive(entity) || !m_records[entity.index].archetype->mask.test(id)) {
+    return;
+  }
+
+  Record& record = m_records[entity.index];
+  Archetype* source = record.archetype;
+
+  Archetype* target;
+  auto edge = source->remove_edges.find(id);
+
+  if (edge != source->remove_edges.end()) {
+    target = edge->second;
+  } else {
+    auto components = source->components;
+    components.erase(std::find(components.begin(), components.end(), id));
+
+    target = FindArchetype(std::move(components));
+    source->remove_edges.emplace(id, target);
+  }
+
+  MoveEntity(record, target);
+}
+
+void* Registry::GetComponent(Entity entity, ComponentId id, bool write) {
+  if (!IsAlive(entity)) {
+    return nullptr;
+  }
+
+  Record const& record = m_records[entity.index];
+  Archetype const& archetype = *record.archetype;
+  int16_t slot = archetype.slots[id];
+
+  if (slot < 0) {
+    return nullptr;
+  }
+
+  Chunk& chunk = record.archetype->chunks[record.chunk];
+
+  if (write) {
+    chunk.versions[slot] = ++m_version;
+  }
+
+  return Column(archetype, chunk, slot) + record.row * archetype.infos[slot].size;
+}
+
+Registry::Archetype* Registry::FindArchetype(std::vector<ComponentId> components) {
+  Mask mask{};
+
+  for (auto id : components) {
+    mask.set(id);
+  }
+
+  auto it = m_archetype_lookup.find(mask);
+
+  if (it != m_archetype_lookup.end()) {
+    return it->second;
+  }
+
+  std::sort(components.begin(), components.end());
+
+  std::vector<ComponentInfo> infos{};
+
+  size_t row_size = sizeof(Entity);
+
+  for (auto id : components) {
+    infos.push_back(GetComponentInfo(id));
+    row_size += infos.back().size;
+  }
+
+  // shrink until the padding between the arrays fits as well
+  auto capacity = static_cast<uint32_t>(kChunkSize / row_size);
+  std::vector<uint32_t> offsets{};
+
+  for (; capacity > 0; capacity--) {
+    offsets.clear();
+
+    size_t offset = sizeof(Entity) * capacity;
+
+    for (auto const& info : infos) {
+      offset = AlignUp(offset, info.align);
+      offsets.push_back(static_cast<uint32_t>(offset));
+      offset += info.size * capacity;
+    }
+
+    if (offset <= kChunkSize) {
+      break;
+    }
+  }
+
+  if (capacity == 0) {
+    HEX_CORE_ERROR("Archetype with {} components does not fit into a {} byte chunk", components.size(), kChunkSize);
+    return nullptr;
+  }
+
+  auto archetype = std::make_unique<Archetype>();
+
+  archetype->mask = mask;
+  archetype->components = std::move(components);
+  archetype->offsets = std::move(offsets);
+  archetype->infos = std::move(infos);
+  archetype->slots.fill(-1);
+  archetype->capacity = capacity;
+
+  for (size_t slot = 0; slot < archetype->components.size(); slot++) {
+    archetype->slots[archetype->components[slot]] = static_cast<int16_t>(slot);
+  }
+
+  Archetype* result = archetype.get();
+
+  m_archetypes.push_back(std::move(archetype));
+  m_archetype_lookup.emplace(mask, result);
+
+  return result;
+}
+
+std::pair<uint32_t, uint32_t> Registry::AllocateRow(Archetype* archetype) {
+  if (archetype->chunks.empty() || archetype->chunks.back().count == archetype->capacity) {
+    Chunk chunk{};
+    chunk.data = AllocateChunk();
+    chunk.versions.resize(archetype->components.size(), 0);
+
+    archetype->chunks.push_back(std::move(chunk));
+  }
+
+  auto index = static_cast<uint32_t>(archetype->chunks.size() - 1);
+  Chunk& chunk = archetype->chunks[index];
+
+  // a new row is a change of every component in the chunk
+  std::fill(chunk.versions.begin(), chunk.versions.end(), ++m_version);
+
+  return {index, chunk.count++};
+}
+
+void Registry::FillHole(Archetype* archetype, uint32_t chunk, uint32_t row) {
+  auto last_index = static_cast<uint32_t>(archetype->chunks.size() - 1);
+  Chunk& last = archetype->chunks[last_index];
+  uint32_t last_row = last.count - 1;
+
+  if (chunk != last_index || row != last_row) {
+    Chunk& hole = archetype->chunks[chunk];
+    auto* entities = reinterpret_cast<Entity*>(hole.data);
+    Entity moved = reinterpret_cast<Entity*>(last.data)[last_row];
+
+    for (size_t slot = 0; slot < archetype->components.size(); slot++) {
+      auto const& info = archetype->infos[slot];
+      auto s = static_cast<int16_t>(slot);
+
+      info.relocate(Column(*archetype, hole, s) + row * info.size, Column(*archetype, last, s) + last_row * info.size);
+    }
+
+    entities[row] = moved;
+    m_records[moved.index].chunk = chunk;
+    m_records[moved.index].row = row;
+
+    std::fill(hole.versions.begin(), hole.versions.end(), ++m_version);
+  }
+
+  if (--last.count == 0) {
+    FreeChunk(last.data);
+    archetype->chunks.pop_back();
+  }
+}
+
+void Registry::MoveEntity(Record& record, Archetype* target) {
+  Archetype* source = record.archetype;
+  auto location = AllocateRow(target);
+
+  Chunk& from = source->chunks[record.chunk];
+  Chunk& to = target->chunks[location.first];
+
+  reinterpret_cast<Entity*>(to.data)[location.second] = reinterpret_cast<Entity*>(from.data)[record.row];
+
+  for (size_t slot = 0; slot < source->components.size(); slot++) {
+    ComponentId id = source->components[slot];
+    auto const& info = source->infos[slot];
+    uint8_t* src = Column(*source, from, static_cast<int16_t>(slot)) + record.row * info.size;
+    int16_t target_slot = target->slots[id];
+
+    if (target_slot >= 0) {
+      info.relocate(Column(*target, to, target_slot) + location.second * info.size, src);
+    } else {
+      info.destroy(src);
+    }
+  }
+
+  FillHole(source, record.chunk, record.row);
+
+  record.archetype = target;
+  record.chunk = location.first;
+  record.row = location.second;
+}
+
+}  // namespace hexgon
@@ -0,0 +1,55 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include <Hexgon/Ecs/SceneComponents.hpp>
+#include <Hexgon/Object/Camera.hpp>
+#include <Hexgon/Object/Mesh.hpp>
+
+namespace hexgon {
+
+Entity AddMesh(Registry& registry, Mesh* mesh, bool with_children) {
+  if (!mesh) {
+    return {};
+  }
+
+  Entity entity = registry.Create(TransformComponent{mesh->GetTransform()},
+                                  MeshComponent{mesh, mesh->GetGeometry(), mesh->GetMaterial()});
+
+  if (with_children) {
+    for (Mesh* child = mesh->GetFirstChild(); child; child = child->GetNextSibling()) {
+      AddMesh(registry, child, true);
+    }
+  }
+
+  return entity;
+}
+
+Entity AddCamera(Registry& registry, Camera* camera) {
+  if (!camera) {
+    return {};
+  }
+
+  return registry.Create(TransformComponent{camera->GetTransform()}, CameraComponent{camera});
+}
+
+}  // namespace hexgon
@@ -22,6 +22,7 @@
  */
 
 #include <Hexgon/Object/Camera.hpp>
+#include <limits>
 
 namespace hexgon {
 
@@ -31,24 +32,36 @@ Camera::Camera(glm::mat4 const& project)
 }
 
 glm::mat4 Camera::GetCameraMatrix() {
-  auto matrix = CalculateMatrix();
+  auto const& matrix = GetLocalMatrix();
 
-  m_up = matrix * glm::vec4(m_up, 0.f);
-  glm::vec3 forward = matrix * glm::vec4(m_forward, 0.f);
+  // the stored up vector stays in object space, rotating it in place would accumulate over calls
+  glm::vec3 up = matrix * glm::vec4(m_up, 0.f);
 
   m_target = GetPosition() + GetForward();
 
-  glm::mat4 view = glm::lookAt(GetPosition(), m_target, m_up);
+  glm::mat4 view = glm::lookAt(GetPosition(), m_target, up);
 
   return m_proj * view;
 }
 
 glm::vec3 Camera::GetForward() const {
-  glm::vec3 forward = CalculateMatrix() * glm::vec4(m_forward, 0.f);
+  glm::vec3 forward = GetLocalMatrix() * glm::vec4(m_forward, 0.f);
 
   return glm::normalize(forward);
 }
 
+float Camera::GetScreenSize(BoundingSphere const& sphere) const {
+  // world space, a parented camera's local position is relative to its parent
+  float distance = glm::length(sphere.center - glm::vec3(GetWorldMatrix()[3]));
+
+  if (distance <= sphere.radius) {
+    return std::numeric_limits<float>::max();
+  }
+
+  // m_proj[1][1] is the cotangent of half the vertical fov for perspective projections
+  return sphere.radius * std::abs(m_proj[1][1]) / distance;
+}
+
 void Camera::OnSetPosition(const glm::vec3& pos) {}
 
 void Camera::OnSetRotation(const glm::vec3& rotation) {}
@@ -23,35 +23,109 @@
 
 #include <Hexgon/Core/Geometry.hpp>
 #include <Hexgon/Core/Material.hpp>
+#include <Hexgon/Object/Camera.hpp>
 #include <Hexgon/Object/Mesh.hpp>
 #include <algorithm>
 
+#include "Core/Util/LinkedList.hpp"
+
 namespace hexgon {
 
-Mesh::~Mesh() = default;
+using SiblingList = LinkedList<Mesh>;
+
+Mesh::~Mesh() {
+  while (m_first_child) {
+    RemoveChild(m_first_child);
+  }
+
+  if (m_parent) {
+    m_parent->RemoveChild(this);
+  }
+}
+
+Aabb Mesh::GetWorldAabb() const {
+  if (!m_geometry) {
+    return {};
+  }
+
+  return m_geometry->GetAabb().Transform(GetWorldMatrix());
+}
+
+BoundingSphere Mesh::GetWorldBoundingSphere() const {
+  if (!m_geometry) {
+    return {};
+  }
+
+  return m_geometry->GetBoundingSphere().Transform(GetWorldMatrix());
+}
+
+uint32_t Mesh::SelectLod(Camera const& camera, float max_screen_error, float hysteresis) {
+  if (!m_geometry || m_geometry->GetLodCount() <= 1 || m_geometry->GetBoundingSphere().radius <= 0.f) {
+    m_lod = 0;
+    return m_lod;
+  }
+
+  uint32_t count = static_cast<uint32_t>(m_geometry->GetLodCount());
+
+  // errors scale with the mesh just like its bounding sphere, so the ratio of both carries over to the screen
+  float screen_size = camera.GetScreenSize(GetWorldBoundingSphere());
+  float scale = screen_size / (2.f * m_geometry->GetBoundingSphere().radius);
+
+  // exact levels stay exact even with the camera inside the bounds
+  auto screen_error = [this, scale](uint32_t level) {
+    float error = m_geometry->GetLod(level).error;
+    return error > 0.f ? error * scale : 0.f;
+  };
+
+  float enter = max_screen_error * (1.f - hysteresis);
+  float leave = max_screen_error * (1.f + hysteresis);
+
+  uint32_t lod = std::min(m_lod, count - 1);
+
+  while (lod + 1 < count && screen_error(lod + 1) <= enter) {
+    lod++;
+  }
+
+  while (lod > 0 && screen_error(lod) > leave) {
+    lod--;
+  }
+
+  m_lod = lod;
+
+  return m_lod;
+}
 
 void Mesh::AddChild(Mesh* child) {
-  auto it = std::find_if(m_children.begin(), m_children.end(), [child](Mesh* m) { return m == child; });
+  if (child == nullptr || child == this || child->m_parent == this) {
+    return;
+  }
 
-  if (it != m_children.end()) {
+  // world matrices come from the transform hierarchy, which refuses `child` if it is an ancestor of this mesh
+  if (!TransformSystem::Get()->SetParent(child->GetTransform(), GetTransform())) {
     return;
   }
 
-  m_children.emplace_back(child);
+  if (auto old_parent = child->m_parent) {
+    SiblingList::Remove<&Mesh::m_prev_sibling, &Mesh::m_next_sibling>(child, &old_parent->m_first_child,
+                                                                      &old_parent->m_last_child);
+  }
+
+  SiblingList::Insert<&Mesh::m_prev_sibling, &Mesh::m_next_sibling>(child, m_last_child, nullptr, &m_first_child,
+                                                                    &m_last_child);
 
   child->m_parent = this;
 }
 
 void Mesh::RemoveChild(Mesh* child) {
-  auto it = std::find_if(m_children.begin(), m_children.end(), [child](Mesh* m) { return m == child; });
-
-  if (it == m_children.end()) {
+  if (child == nullptr || child->m_parent != this) {
     return;
   }
 
-  (*it)->m_parent = nullptr;
+  SiblingList::Remove<&Mesh::m_prev_sibling, &Mesh::m_next_sibling>(child, &m_first_child, &m_last_child);
+
+  child->m_parent = nullptr;
 
-  m_children.erase(it);
+  TransformSystem::Get()->SetParent(child->GetTransform(), TransformSystem::kInvalidHandle);
 }
 
 }  // namespace hexgon
@@ -25,35 +25,36 @@
 
 namespace hexgon {
 
+Object3D::Object3D() : m_transform(TransformSystem::Get()->Create()) {}
+
+Object3D::~Object3D() { TransformSystem::Get()->Destroy(m_transform); }
+
 void Object3D::SetPosition(const glm::vec3 &pos) {
   OnSetPosition(pos);
 
-  m_pos = pos;
+  TransformSystem::Get()->SetPosition(m_transform, pos);
 }
 
 void Object3D::SetRotation(const glm::vec3 &rotation) {
   OnSetRotation(rotation);
 
-  m_rotate = rotation;
+  TransformSystem::Get()->SetRotation(m_transform, rotation);
 }
 
 void Object3D::SetScale(const glm::vec3 &scale) {
   OnSetScale(scale);
 
-  m_scale = scale;
+  TransformSystem::Get()->SetScale(m_transform, scale);
 }
 
-glm::mat4 Object3D::CalculateMatrix() const {
-  glm::mat4 ret = glm::identity<glm::mat4>();
-  ret = glm::rotate(ret, m_rotate.x, {1.f, 0.f, 0.f});
-  ret = glm::rotate(ret, m_rotate.y, {0.f, 1.f, 0.f});
-  ret = glm::rotate(ret, m_rotate.z, {0.f, 0.f, 1.f});
+glm::vec3 Object3D::GetPosition() const { return TransformSystem::Get()->GetPosition(m_transform); }
 
-  ret = glm::translate(ret, m_pos);
+glm::vec3 Object3D::GetRotation() const { return TransformSystem::Get()->GetRotation(m_transform); }
 
-  ret = glm::scale(ret, m_scale);
+glm::vec3 Object3D::GetScale() const { return TransformSystem::Get()->GetScale(m_transform); }
 
-  return ret;
-}
+glm::mat4 Object3D::GetLocalMatrix() const { return TransformSystem::Get()->CalculateLocalMatrix(m_transform); }
+
+const glm::mat4 &Object3D::GetWorldMatrix() const { return TransformSystem::Get()->GetWorldMatrix(m_transform); }
 
 }  // namespace hexgon
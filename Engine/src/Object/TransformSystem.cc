@@ -0,0 +1,532 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include <Hexgon/Core/JobSystem.hpp>
+#include <Hexgon/Object/TransformSystem.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <glm/gtc/quaternion.hpp>
+
+#include "LogPrivate.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HEX_TRANSFORM_SSE 1
+#include <immintrin.h>
+#endif
+
+namespace hexgon {
+
+namespace {
+
+// dense arrays are padded to a multiple of this, the widest lane count
+constexpr uint32_t kBatch = 8;
+
+constexpr uint32_t kLocalBatchesPerJob = 256;
+constexpr uint32_t kWorldPerJob = 2048;
+
+#if defined(__AVX2__)
+using Lanes = __m256;
+constexpr uint32_t kLaneCount = 8;
+
+inline Lanes Load(const float* p) { return _mm256_loadu_ps(p); }
+inline void Store(float* p, Lanes v) { _mm256_storeu_ps(p, v); }
+inline Lanes Splat(float v) { return _mm256_set1_ps(v); }
+inline Lanes Add(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+inline Lanes Sub(Lanes a, Lanes b) { return _mm256_sub_ps(a, b); }
+inline Lanes Mul(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+#elif defined(HEX_TRANSFORM_SSE)
+using Lanes = __m128;
+constexpr uint32_t kLaneCount = 4;
+
+inline Lanes Load(const float* p) { return _mm_loadu_ps(p); }
+inline void Store(float* p, Lanes v) { _mm_storeu_ps(p, v); }
+inline Lanes Splat(float v) { return _mm_set1_ps(v); }
+inline Lanes Add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+inline Lanes Sub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+inline Lanes Mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+#else
+using Lanes = float;
+constexpr uint32_t kLaneCount = 1;
+
+inline Lanes Load(const float* p) { return *p; }
+inline void Store(float* p, Lanes v) { *p = v; }
+inline Lanes Splat(float v) { return v; }
+inline Lanes Add(Lanes a, Lanes b) { return a + b; }
+inline Lanes Sub(Lanes a, Lanes b) { return a - b; }
+inline Lanes Mul(Lanes a, Lanes b) { return a * b; }
+#endif
+
+static_assert(kBatch % kLaneCount == 0, "batch has to be whole lanes");
+
+uint32_t PaddedCount(uint32_t count) { return (count + kBatch - 1) / kBatch * kBatch; }
+
+template <typename T>
+void Permute(std::vector<T>& values, const std::vector<uint32_t>& order) {
+  std::vector<T> result(values);
+
+  for (size_t i = 0; i < order.size(); i++) {
+    result[i] = values[order[i]];
+  }
+
+  values.swap(result);
+}
+
+}  // namespace
+
+TransformSystem* TransformSystem::Get() {
+  static TransformSystem* g_instance = new TransformSystem;
+
+  return g_instance;
+}
+
+void TransformSystem::CheckThread(const char* func) const {
+  if (std::this_thread::get_id() != m_owner) {
+    HEX_CORE_ERROR("TransformSystem::{} called off the thread owning the transforms.", func);
+    std::abort();
+  }
+}
+
+template <typename Func>
+void TransformSystem::ForEachArray(Func&& func) {
+  func(m_handles);
+  func(m_parents);
+  func(m_child_counts);
+  func(m_pos_x);
+  func(m_pos_y);
+  func(m_pos_z);
+  func(m_rot_x);
+  func(m_rot_y);
+  func(m_rot_z);
+  func(m_rot_w);
+  func(m_scale_x);
+  func(m_scale_y);
+  func(m_scale_z);
+  func(m_euler);
+  func(m_world);
+  func(m_local_dirty);
+  func(m_world_changed);
+
+  for (auto& column : m_local) {
+    func(column);
+  }
+}
+
+TransformHandle TransformSystem::Create() {
+  CheckThread("Create");
+
+  TransformHandle handle = kInvalidHandle;
+
+  if (!m_free_handles.empty()) {
+    handle = m_free_handles.back();
+    m_free_handles.pop_back();
+  } else {
+    handle = static_cast<TransformHandle>(m_indices.size());
+    m_indices.emplace_back(kInvalidHandle);
+  }
+
+  uint32_t index = GetCount();
+  Resize(index + 1);
+
+  m_indices[handle] = index;
+  m_handles[index] = handle;
+  m_parents[index] = kInvalidHandle;
+  m_parent_indices[index] = -1;
+  m_child_counts[index] = 0;
+  m_pos_x[index] = m_pos_y[index] = m_pos_z[index] = 0.f;
+  m_rot_x[index] = m_rot_y[index] = m_rot_z[index] = 0.f;
+  m_rot_w[index] = 1.f;
+  m_scale_x[index] = m_scale_y[index] = m_scale_z[index] = 1.f;
+  m_euler[index] = glm::vec3(0.f);
+  m_world[index] = glm::mat4(1.f);
+  m_local_dirty[index] = 1;
+  m_world_changed[index] = 0;
+
+  // a new root at the end breaks the depth levels
+  m_order_dirty = true;
+
+  return handle;
+}
+
+void TransformSystem::Destroy(TransformHandle handle) {
+  CheckThread("Destroy");
+
+  if (handle >= m_indices.size() || m_indices[handle] == kInvalidHandle) {
+    HEX_CORE_ERROR("Destroy invalid transform {}.", handle);
+    return;
+  }
+
+  uint32_t index = IndexOf(handle);
+
+  SetParent(handle, kInvalidHandle);
+
+  if (m_child_counts[index] > 0) {
+    for (uint32_t i = 0; i < GetCount(); i++) {
+      if (m_parents[i] == handle) {
+        m_parents[i] = kInvalidHandle;
+        m_local_dirty[i] = 1;
+      }
+    }
+  }
+
+  // swap the last transform into the hole
+  uint32_t last = GetCount() - 1;
+  if (index != last) {
+    ForEachArray([index, last](auto& values) { values[index] = values[last]; });
+
+    m_indices[m_handles[index]] = index;
+  }
+
+  m_local_dirty[last] = 0;
+  m_indices[handle] = kInvalidHandle;
+  m_free_handles.emplace_back(handle);
+
+  Resize(last);
+
+  m_order_dirty = true;
+}
+
+bool TransformSystem::SetParent(TransformHandle handle, TransformHandle parent) {
+  CheckThread("SetParent");
+
+  uint32_t index = IndexOf(handle);
+
+  if (m_parents[index] == parent) {
+    return true;
+  }
+
+  for (auto it = parent; it != kInvalidHandle; it = m_parents[IndexOf(it)]) {
+    if (it == handle) {
+      HEX_CORE_ERROR("Transform {} can not be parented to its own descendant {}.", handle, parent);
+      return false;
+    }
+  }
+
+  if (m_parents[index] != kInvalidHandle) {
+    m_child_counts[IndexOf(m_parents[index])]--;
+  }
+
+  if (parent != kInvalidHandle) {
+    m_child_counts[IndexOf(parent)]++;
+  }
+
+  m_parents[index] = parent;
+  m_local_dirty[index] = 1;
+  m_order_dirty = true;
+
+  return true;
+}
+
+TransformHandle TransformSystem::GetParent(TransformHandle handle) const { return m_parents[IndexOf(handle)]; }
+
+void TransformSystem::SetPosition(TransformHandle handle, const glm::vec3& pos) {
+  uint32_t index = IndexOf(handle);
+
+  m_pos_x[index] = pos.x;
+  m_pos_y[index] = pos.y;
+  m_pos_z[index] = pos.z;
+  m_local_dirty[index] = 1;
+}
+
+void TransformSystem::SetRotation(TransformHandle handle, const glm::vec3& rotation) {
+  uint32_t index = IndexOf(handle);
+
+  glm::quat q = glm::angleAxis(rotation.x, glm::vec3{1.f, 0.f, 0.f}) *
+                glm::angleAxis(rotation.y, glm::vec3{0.f, 1.f, 0.f}) *
+                glm::angleAxis(rotation.z, glm::vec3{0.f, 0.f, 1.f});
+
+  m_rot_x[index] = q.x;
+  m_rot_y[index] = q.y;
+  m_rot_z[index] = q.z;
+  m_rot_w[index] = q.w;
+  m_euler[index] = rotation;
+  m_local_dirty[index] = 1;
+}
+
+void TransformSystem::SetScale(TransformHandle handle, const glm::vec3& scale) {
+  uint32_t index = IndexOf(handle);
+
+  m_scale_x[index] = scale.x;
+  m_scale_y[index] = scale.y;
+  m_scale_z[index] = scale.z;
+  m_local_dirty[index] = 1;
+}
+
+glm::vec3 TransformSystem::GetPosition(TransformHandle handle) const {
+  uint32_t index = IndexOf(handle);
+
+  return {m_pos_x[index], m_pos_y[index], m_pos_z[index]};
+}
+
+glm::vec3 TransformSystem::GetRotation(TransformHandle handle) const { return m_euler[IndexOf(handle)]; }
+
+glm::vec3 TransformSystem::GetScale(TransformHandle handle) const {
+  uint32_t index = IndexOf(handle);
+
+  return {m_scale_x[index], m_scale_y[index], m_scale_z[index]};
+}
+
+glm::mat4 TransformSystem::CalculateLocalMatrix(TransformHandle handle) const {
+  uint32_t index = IndexOf(handle);
+
+  glm::quat q{m_rot_w[index], m_rot_x[index], m_rot_y[index], m_rot_z[index]};
+  glm::mat3 r = glm::mat3_cast(q);
+
+  glm::mat4 ret{1.f};
+  ret[0] = glm::vec4(r[0] * m_scale_x[index], 0.f);
+  ret[1] = glm::vec4(r[1] * m_scale_y[index], 0.f);
+  ret[2] = glm::vec4(r[2] * m_scale_z[index], 0.f);
+  ret[3] = glm::vec4(r * glm::vec3{m_pos_x[index], m_pos_y[index], m_pos_z[index]}, 1.f);
+
+  return ret;
+}
+
+const glm::mat4& TransformSystem::GetWorldMatrix(TransformHandle handle) const { return m_world[IndexOf(handle)]; }
+
+void TransformSystem::Update() {
+  CheckThread("Update");
+
+  if (m_handles.empty()) {
+    return;
+  }
+
+  if (m_order_dirty) {
+    SortByDepth();
+  }
+
+  auto job_system = JobSystem::Get();
+
+  uint32_t batch_count = PaddedCount(GetCount()) / kBatch;
+
+  job_system->ParallelFor(batch_count, kLocalBatchesPerJob,
+                          [this](uint32_t begin, uint32_t end, uint32_t) { UpdateLocal(begin, end); });
+
+  // a level only depends on the one above it
+  for (size_t depth = 0; depth + 1 < m_levels.size(); depth++) {
+    uint32_t base = m_levels[depth];
+
+    job_system->ParallelFor(m_levels[depth + 1] - base, kWorldPerJob,
+                            [this, base](uint32_t begin, uint32_t end, uint32_t) {
+                              UpdateWorld(base + begin, base + end);
+                            });
+  }
+}
+
+void TransformSystem::Resize(uint32_t count) {
+  uint32_t padded = PaddedCount(count);
+
+  m_handles.resize(count);
+  m_parents.resize(count);
+  m_parent_indices.resize(count);
+  m_child_counts.resize(count);
+  m_euler.resize(count);
+  m_world.resize(count);
+  m_world_changed.resize(count);
+
+  // padding lanes hold an identity transform so the SIMD pass never reads garbage
+  m_pos_x.resize(padded, 0.f);
+  m_pos_y.resize(padded, 0.f);
+  m_pos_z.resize(padded, 0.f);
+  m_rot_x.resize(padded, 0.f);
+  m_rot_y.resize(padded, 0.f);
+  m_rot_z.resize(padded, 0.f);
+  m_rot_w.resize(padded, 1.f);
+  m_scale_x.resize(padded, 1.f);
+  m_scale_y.resize(padded, 1.f);
+  m_scale_z.resize(padded, 1.f);
+  m_local_dirty.resize(padded, 0);
+
+  for (auto& column : m_local) {
+    column.resize(padded, 0.f);
+  }
+}
+
+void TransformSystem::SortByDepth() {
+  uint32_t count = GetCount();
+
+  for (uint32_t i = 0; i < count; i++) {
+    m_parent_indices[i] = m_parents[i] == kInvalidHandle ? -1 : static_cast<int32_t>(IndexOf(m_parents[i]));
+  }
+
+  // depth of every transform, walking up until a known one
+  std::vector<int32_t> depths(count, -1);
+  std::vector<uint32_t> path{};
+  uint32_t max_depth = 0;
+
+  for (uint32_t i = 0; i < count; i++) {
+    int32_t it = static_cast<int32_t>(i);
+    while (it >= 0 && depths[it] < 0) {
+      path.emplace_back(static_cast<uint32_t>(it));
+      it = m_parent_indices[it];
+    }
+
+    int32_t depth = it >= 0 ? depths[it] : -1;
+    while (!path.empty()) {
+      depths[path.back()] = ++depth;
+      path.pop_back();
+    }
+
+    max_depth = std::max(max_depth, static_cast<uint32_t>(depths[i]));
+  }
+
+  // stable counting sort by depth, keeps the current order inside a level
+  m_levels.assign(max_depth + 2, 0);
+  for (uint32_t i = 0; i < count; i++) {
+    m_levels[depths[i] + 1]++;
+  }
+
+  for (size_t d = 1; d < m_levels.size(); d++) {
+    m_levels[d] += m_levels[d - 1];
+  }
+
+  std::vector<uint32_t> order(count);
+  std::vector<uint32_t> cursor(m_levels.begin(), m_levels.end() - 1);
+  for (uint32_t i = 0; i < count; i++) {
+    order[cursor[depths[i]]++] = i;
+  }
+
+  ForEachArray([&order](auto& values) { Permute(values, order); });
+
+  for (uint32_t i = 0; i < count; i++) {
+    m_indices[m_handles[i]] = i;
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    m_parent_indices[i] = m_parents[i] == kInvalidHandle ? -1 : static_cast<int32_t>(IndexOf(m_parents[i]));
+  }
+
+  m_order_dirty = false;
+}
+
+void TransformSystem::UpdateLocal(uint32_t begin_batch, uint32_t end_batch) {
+  for (uint32_t batch = begin_batch; batch < end_batch; batch++) {
+    uint32_t base = batch * kBatch;
+
+    uint64_t dirty = 0;
+    static_assert(kBatch == sizeof(dirty), "one dirty byte per transform");
+    std::memcpy(&dirty, m_local_dirty.data() + base, sizeof(dirty));
+
+    if (dirty == 0) {
+      continue;
+    }
+
+    for (uint32_t i = base; i < base + kBatch; i += kLaneCount) {
+      Lanes x = Load(m_rot_x.data() + i);
+      Lanes y = Load(m_rot_y.data() + i);
+      Lanes z = Load(m_rot_z.data() + i);
+      Lanes w = Load(m_rot_w.data() + i);
+
+      Lanes x2 = Add(x, x);
+      Lanes y2 = Add(y, y);
+      Lanes z2 = Add(z, z);
+
+      Lanes xx = Mul(x, x2);
+      Lanes yy = Mul(y, y2);
+      Lanes zz = Mul(z, z2);
+      Lanes xy = Mul(x, y2);
+      Lanes xz = Mul(x, z2);
+      Lanes yz = Mul(y, z2);
+      Lanes wx = Mul(w, x2);
+      Lanes wy = Mul(w, y2);
+      Lanes wz = Mul(w, z2);
+
+      Lanes one = Splat(1.f);
+
+      // rotation columns
+      Lanes r[9] = {
+          Sub(one, Add(yy, zz)), Add(xy, wz), Sub(xz, wy),  //
+          Sub(xy, wz), Sub(one, Add(xx, zz)), Add(yz, wx),  //
+          Add(xz, wy), Sub(yz, wx), Sub(one, Add(xx, yy)),  //
+      };
+
+      Lanes s[3] = {Load(m_scale_x.data() + i), Load(m_scale_y.data() + i), Load(m_scale_z.data() + i)};
+      Lanes p[3] = {Load(m_pos_x.data() + i), Load(m_pos_y.data() + i), Load(m_pos_z.data() + i)};
+
+      for (uint32_t c = 0; c < 3; c++) {
+        for (uint32_t row = 0; row < 3; row++) {
+          Store(m_local[c * 3 + row].data() + i, Mul(r[c * 3 + row], s[c]));
+        }
+      }
+
+      // translation is rotated but not scaled, same as rotate * translate * scale
+      for (uint32_t row = 0; row < 3; row++) {
+        Lanes t = Add(Add(Mul(r[row], p[0]), Mul(r[3 + row], p[1])), Mul(r[6 + row], p[2]));
+        Store(m_local[9 + row].data() + i, t);
+      }
+    }
+  }
+}
+
+void TransformSystem::UpdateWorld(uint32_t begin, uint32_t end) {
+  for (uint32_t i = begin; i < end; i++) {
+    int32_t parent = m_parent_indices[i];
+
+    bool changed = m_local_dirty[i] || (parent >= 0 && m_world_changed[parent]);
+
+    m_world_changed[i] = changed;
+    m_local_dirty[i] = 0;
+
+    if (!changed) {
+      continue;
+    }
+
+    float* out = &m_world[i][0].x;
+
+    if (parent < 0) {
+      for (uint32_t c = 0; c < 4; c++) {
+        for (uint32_t row = 0; row < 3; row++) {
+          out[c * 4 + row] = m_local[c * 3 + row][i];
+        }
+        out[c * 4 + 3] = c == 3 ? 1.f : 0.f;
+      }
+      continue;
+    }
+
+    const float* in = &m_world[parent][0].x;
+
+#ifdef HEX_TRANSFORM_SSE
+    __m128 p0 = _mm_loadu_ps(in);
+    __m128 p1 = _mm_loadu_ps(in + 4);
+    __m128 p2 = _mm_loadu_ps(in + 8);
+    __m128 p3 = _mm_loadu_ps(in + 12);
+
+    for (uint32_t c = 0; c < 4; c++) {
+      __m128 col = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p0, _mm_set1_ps(m_local[c * 3][i])),
+                                         _mm_mul_ps(p1, _mm_set1_ps(m_local[c * 3 + 1][i]))),
+                              _mm_mul_ps(p2, _mm_set1_ps(m_local[c * 3 + 2][i])));
+
+      _mm_storeu_ps(out + c * 4, c == 3 ? _mm_add_ps(col, p3) : col);
+    }
+#else
+    for (uint32_t c = 0; c < 4; c++) {
+      for (uint32_t row = 0; row < 4; row++) {
+        float v = in[row] * m_local[c * 3][i] + in[4 + row] * m_local[c * 3 + 1][i] +
+                  in[8 + row] * m_local[c * 3 + 2][i];
+        out[c * 4 + row] = c == 3 ? v + in[12 + row] : v;
+      }
+    }
+#endif
+  }
+}
+
+}  // namespace hexgon
@@ -0,0 +1,240 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include <Hexgon/Core/JobSystem.hpp>
+#include <Hexgon/Object/Mesh.hpp>
+#include <Hexgon/Render/FrustumCuller.hpp>
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HEX_CULLER_SSE 1
+#include <immintrin.h>
+#endif
+
+namespace hexgon {
+
+namespace {
+
+// arrays are padded to a multiple of this, the widest lane count
+constexpr uint32_t kBatch = 8;
+
+constexpr uint32_t kBatchesPerJob = 512;
+constexpr uint32_t kGatherPerJob = 1024;
+
+// radius of padding and geometry-less objects, outside of every plane
+constexpr float kNeverVisible = -FLT_MAX;
+
+#if defined(__AVX2__)
+using Lanes = __m256;
+constexpr uint32_t kLaneCount = 8;
+
+inline Lanes Load(const float* p) { return _mm256_loadu_ps(p); }
+inline Lanes Splat(float v) { return _mm256_set1_ps(v); }
+inline Lanes AddLanes(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+inline Lanes MulLanes(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+inline Lanes MinLanes(Lanes a, Lanes b) { return _mm256_min_ps(a, b); }
+inline uint32_t NegativeMask(Lanes v) {
+  return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_LT_OQ)));
+}
+#elif defined(HEX_CULLER_SSE)
+using Lanes = __m128;
+constexpr uint32_t kLaneCount = 4;
+
+inline Lanes Load(const float* p) { return _mm_loadu_ps(p); }
+inline Lanes Splat(float v) { return _mm_set1_ps(v); }
+inline Lanes AddLanes(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+inline Lanes MulLanes(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+inline Lanes MinLanes(Lanes a, Lanes b) { return _mm_min_ps(a, b); }
+inline uint32_t NegativeMask(Lanes v) {
+  return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmplt_ps(v, _mm_setzero_ps())));
+}
+#else
+using Lanes = float;
+constexpr uint32_t kLaneCount = 1;
+
+inline Lanes Load(const float* p) { return *p; }
+inline Lanes Splat(float v) { return v; }
+inline Lanes AddLanes(Lanes a, Lanes b) { return a + b; }
+inline Lanes MulLanes(Lanes a, Lanes b) { return a * b; }
+inline Lanes MinLanes(Lanes a, Lanes b) { return std::min(a, b); }
+inline uint32_t NegativeMask(Lanes v) { return v < 0.f ? 1u : 0u; }
+#endif
+
+static_assert(kBatch % kLaneCount == 0, "batch has to be whole lanes");
+
+constexpr uint32_t kAllLanes = (1u << kLaneCount) - 1;
+
+uint32_t PaddedCount(uint32_t count) { return (count + kBatch - 1) / kBatch * kBatch; }
+
+inline uint32_t LowestBit(uint32_t mask) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return index;
+#else
+  return static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+}
+
+struct PlaneLanes {
+  Lanes x, y, z, w;
+  Lanes abs_x, abs_y, abs_z;
+};
+
+}  // namespace
+
+void FrustumCuller::Clear() { Resize(0); }
+
+uint32_t FrustumCuller::Add(Aabb const& aabb, BoundingSphere const& sphere) {
+  uint32_t index = m_count;
+
+  Resize(m_count + 1);
+  Set(index, aabb, sphere);
+
+  return index;
+}
+
+void FrustumCuller::Set(uint32_t index, Aabb const& aabb, BoundingSphere const& sphere) {
+  glm::vec3 center = aabb.GetCenter();
+  glm::vec3 extent = aabb.GetExtent();
+
+  // both volumes are tested around the box center, so the sphere grows by how far its own center is off
+  float radius = sphere.radius + glm::length(sphere.center - center);
+
+  m_center_x[index] = center.x;
+  m_center_y[index] = center.y;
+  m_center_z[index] = center.z;
+  m_extent_x[index] = extent.x;
+  m_extent_y[index] = extent.y;
+  m_extent_z[index] = extent.z;
+  m_radius[index] = radius;
+}
+
+void FrustumCuller::Gather(std::vector<Mesh*> const& meshes) {
+  Resize(static_cast<uint32_t>(meshes.size()));
+
+  JobSystem::Get()->ParallelFor(m_count, kGatherPerJob, [this, &meshes](uint32_t begin, uint32_t end, uint32_t) {
+    for (uint32_t i = begin; i < end; i++) {
+      if (meshes[i]->GetGeometry()) {
+        Set(i, meshes[i]->GetWorldAabb(), meshes[i]->GetWorldBoundingSphere());
+      } else {
+        Set(i, {}, BoundingSphere{glm::vec3(0.f), kNeverVisible});
+      }
+    }
+  });
+}
+
+void FrustumCuller::Cull(Frustum const& frustum, std::vector<uint32_t>& visible) {
+  visible.clear();
+
+  uint32_t batch_count = PaddedCount(m_count) / kBatch;
+  uint32_t job_count = (batch_count + kBatchesPerJob - 1) / kBatchesPerJob;
+
+  if (m_job_visible.size() < job_count) {
+    m_job_visible.resize(job_count);
+  }
+
+  // without workers the whole range may arrive as a single job
+  for (uint32_t job = 0; job < job_count; job++) {
+    m_job_visible[job].clear();
+  }
+
+  std::array<PlaneLanes, Frustum::kPlaneCount> planes{};
+
+  for (size_t p = 0; p < planes.size(); p++) {
+    auto const& plane = frustum.planes[p];
+
+    planes[p].x = Splat(plane.x);
+    planes[p].y = Splat(plane.y);
+    planes[p].z = Splat(plane.z);
+    planes[p].w = Splat(plane.w);
+    planes[p].abs_x = Splat(std::abs(plane.x));
+    planes[p].abs_y = Splat(std::abs(plane.y));
+    planes[p].abs_z = Splat(std::abs(plane.z));
+  }
+
+  JobSystem::Get()->ParallelFor(batch_count, kBatchesPerJob, [&](uint32_t begin, uint32_t end, uint32_t) {
+    auto& output = m_job_visible[begin / kBatchesPerJob];
+
+    for (uint32_t i = begin * kBatch; i < end * kBatch; i += kLaneCount) {
+      Lanes cx = Load(&m_center_x[i]);
+      Lanes cy = Load(&m_center_y[i]);
+      Lanes cz = Load(&m_center_z[i]);
+      Lanes ex = Load(&m_extent_x[i]);
+      Lanes ey = Load(&m_extent_y[i]);
+      Lanes ez = Load(&m_extent_z[i]);
+      Lanes radius = Load(&m_radius[i]);
+
+      uint32_t outside = 0;
+
+      for (auto const& plane : planes) {
+        Lanes distance = AddLanes(AddLanes(MulLanes(plane.x, cx), MulLanes(plane.y, cy)),
+                                  AddLanes(MulLanes(plane.z, cz), plane.w));
+        Lanes box_radius = AddLanes(AddLanes(MulLanes(plane.abs_x, ex), MulLanes(plane.abs_y, ey)),
+                                    MulLanes(plane.abs_z, ez));
+
+        // outside when either volume is entirely behind the plane
+        outside |= NegativeMask(AddLanes(distance, MinLanes(box_radius, radius)));
+      }
+
+      for (uint32_t mask = ~outside & kAllLanes; mask; mask &= mask - 1) {
+        output.push_back(i + LowestBit(mask));
+      }
+    }
+  });
+
+  for (uint32_t job = 0; job < job_count; job++) {
+    visible.insert(visible.end(), m_job_visible[job].begin(), m_job_visible[job].end());
+  }
+}
+
+void FrustumCuller::Cull(Frustum const& frustum, std::vector<Mesh*> const& meshes, std::vector<Mesh*>& visible) {
+  Gather(meshes);
+  Cull(frustum, m_indices);
+
+  visible.clear();
+
+  for (auto index : m_indices) {
+    visible.push_back(meshes[index]);
+  }
+}
+
+void FrustumCuller::Resize(uint32_t count) {
+  uint32_t padded = PaddedCount(count);
+
+  for (auto* values : {&m_center_x, &m_center_y, &m_center_z, &m_extent_x, &m_extent_y, &m_extent_z}) {
+    values->resize(padded, 0.f);
+  }
+
+  m_radius.resize(padded, kNeverVisible);
+
+  // shrinking leaves stale objects in the padding
+  std::fill(m_radius.begin() + count, m_radius.end(), kNeverVisible);
+
+  m_count = count;
+}
+
+}  // namespace hexgon
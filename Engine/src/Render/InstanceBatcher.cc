@@ -0,0 +1,264 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include <Hexgon/Core/Geometry.hpp>
+#include <Hexgon/Core/Material.hpp>
+#include <Hexgon/Object/Mesh.hpp>
+#include <Hexgon/Render/InstanceBatcher.hpp>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+#include "Core/Util/HashCombine.hpp"
+
+namespace hexgon {
+
+namespace {
+
+constexpr uint32_t kMinCapacity = 4;
+
+// room for members joining later, so a batch rarely has to move
+uint32_t GrowCapacity(uint32_t count) { return std::max(count + count / 2, kMinCapacity); }
+
+}  // namespace
+
+size_t InstanceBatcher::KeyHash::operator()(Key const& key) const {
+  size_t seed = 0;
+
+  HashCombine(seed, key.geometry);
+  HashCombine(seed, key.material);
+  HashCombine(seed, key.pipeline);
+  HashCombine(seed, key.lod);
+
+  return seed;
+}
+
+void InstanceBatcher::Clear() {
+  m_batches.clear();
+  m_batch_lookup.clear();
+  m_members.clear();
+  m_draws.clear();
+  m_instances.clear();
+  m_dirty_begin = 0;
+  m_dirty_end = 0;
+}
+
+void InstanceBatcher::Update(std::vector<Mesh*> const& visible) {
+  m_frame++;
+
+  uint32_t live_count = 0;
+
+  for (auto mesh : visible) {
+    if (!mesh->GetGeometry()) {
+      continue;
+    }
+
+    Key key = GetKey(mesh);
+
+    auto it = m_members.find(mesh);
+
+    if (it != m_members.end()) {
+      if (it->second.frame == m_frame) {
+        continue;
+      }
+
+      if (m_batches[it->second.batch].key == key) {
+        it->second.frame = m_frame;
+        live_count++;
+        continue;
+      }
+
+      Remove(mesh, it->second);
+      m_members.erase(it);
+    }
+
+    Insert(mesh, key);
+    live_count++;
+  }
+
+  m_removed.clear();
+
+  for (auto const& member : m_members) {
+    if (member.second.frame != m_frame) {
+      m_removed.emplace_back(member.first);
+    }
+  }
+
+  for (auto mesh : m_removed) {
+    auto it = m_members.find(mesh);
+
+    Remove(mesh, it->second);
+    m_members.erase(it);
+  }
+
+  size_t old_size = m_instances.size();
+
+  Layout(live_count);
+
+  m_dirty_begin = UINT32_MAX;
+  m_dirty_end = 0;
+
+  // a resized buffer has to be uploaded as a whole
+  if (m_instances.size() != old_size) {
+    m_dirty_begin = 0;
+    m_dirty_end = static_cast<uint32_t>(m_instances.size());
+  }
+
+  m_draws.clear();
+
+  for (auto const& batch : m_batches) {
+    if (batch.members.empty()) {
+      continue;
+    }
+
+    auto const& lod = batch.key.geometry->GetLod(batch.key.lod);
+
+    for (uint32_t slot = 0; slot < batch.members.size(); slot++) {
+      Mesh* mesh = batch.members[slot];
+
+      Write(batch.first_instance + slot, Instance{mesh->GetWorldMatrix(), mesh->GetInstanceData()});
+    }
+
+    m_draws.emplace_back(Draw{batch.key.geometry, batch.key.material, batch.key.pipeline, lod.first_index,
+                              lod.index_count, batch.first_instance, static_cast<uint32_t>(batch.members.size())});
+  }
+
+  if (m_dirty_begin > m_dirty_end) {
+    m_dirty_begin = m_dirty_end = 0;
+  }
+}
+
+InstanceBatcher::Key InstanceBatcher::GetKey(Mesh const* mesh) {
+  Key key{};
+
+  key.geometry = mesh->GetGeometry();
+  key.material = mesh->GetMaterial();
+  key.pipeline = key.material ? key.material->GetPipeline() : 0;
+  key.lod = std::min(mesh->GetLod(), static_cast<uint32_t>(std::max<size_t>(key.geometry->GetLodCount(), 1) - 1));
+
+  return key;
+}
+
+void InstanceBatcher::Insert(Mesh* mesh, Key const& key) {
+  auto it = m_batch_lookup.find(key);
+
+  if (it == m_batch_lookup.end()) {
+    it = m_batch_lookup.emplace(key, static_cast<uint32_t>(m_batches.size())).first;
+
+    m_batches.emplace_back();
+    m_batches.back().key = key;
+  }
+
+  auto& batch = m_batches[it->second];
+
+  m_members[mesh] = Membership{it->second, static_cast<uint32_t>(batch.members.size()), m_frame};
+  batch.members.emplace_back(mesh);
+}
+
+void InstanceBatcher::Remove(Mesh* mesh, Membership const& membership) {
+  auto& members = m_batches[membership.batch].members;
+
+  // swap with the last member, only that one changes its slot
+  Mesh* last = members.back();
+  members[membership.slot] = last;
+  members.pop_back();
+
+  if (last != mesh) {
+    m_members[last].slot = membership.slot;
+  }
+}
+
+void InstanceBatcher::Layout(uint32_t live_count) {
+  // moved and emptied batches leave holes behind, pack everything once most of the array is holes
+  if (static_cast<size_t>(live_count) * 4 < m_instances.size()) {
+    Compact();
+    return;
+  }
+
+  auto end = static_cast<uint32_t>(m_instances.size());
+
+  for (auto& batch : m_batches) {
+    auto count = static_cast<uint32_t>(batch.members.size());
+
+    if (count <= batch.capacity) {
+      continue;
+    }
+
+    batch.capacity = GrowCapacity(count);
+    batch.first_instance = end;
+    end += batch.capacity;
+  }
+
+  m_instances.resize(end);
+}
+
+void InstanceBatcher::Compact() {
+  std::vector<uint32_t> remap(m_batches.size(), UINT32_MAX);
+
+  uint32_t count = 0;
+  uint32_t end = 0;
+
+  for (uint32_t i = 0; i < m_batches.size(); i++) {
+    auto& batch = m_batches[i];
+
+    if (batch.members.empty()) {
+      m_batch_lookup.erase(batch.key);
+      continue;
+    }
+
+    batch.capacity = GrowCapacity(static_cast<uint32_t>(batch.members.size()));
+    batch.first_instance = end;
+    end += batch.capacity;
+
+    remap[i] = count;
+
+    if (count != i) {
+      m_batch_lookup[batch.key] = count;
+      m_batches[count] = std::move(batch);
+    }
+
+    count++;
+  }
+
+  m_batches.resize(count);
+
+  for (auto& member : m_members) {
+    member.second.batch = remap[member.second.batch];
+  }
+
+  m_instances.resize(end);
+}
+
+void InstanceBatcher::Write(uint32_t index, Instance const& instance) {
+  // the array mirrors what was uploaded, unchanged instances don't need to go again
+  if (std::memcmp(&m_instances[index], &instance, sizeof(Instance)) == 0) {
+    return;
+  }
+
+  m_instances[index] = instance;
+
+  m_dirty_begin = std::min(m_dirty_begin, index);
+  m_dirty_end = std::max(m_dirty_end, index + 1);
+}
+
+}  // namespace hexgon
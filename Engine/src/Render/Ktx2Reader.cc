@@ -0,0 +1,129 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include "Render/Ktx2Reader.hpp"
+
+#include <cstring>
+
+#include "LogPrivate.hpp"
+
+namespace hexgon {
+
+namespace {
+
+constexpr uint8_t kKtx2Identifier[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+struct Ktx2Header {
+  uint8_t identifier[12];
+  uint32_t vk_format;
+  uint32_t type_size;
+  uint32_t pixel_width;
+  uint32_t pixel_height;
+  uint32_t pixel_depth;
+  uint32_t layer_count;
+  uint32_t face_count;
+  uint32_t level_count;
+  uint32_t supercompression_scheme;
+  uint32_t dfd_byte_offset;
+  uint32_t dfd_byte_length;
+  uint32_t kvd_byte_offset;
+  uint32_t kvd_byte_length;
+  uint64_t sgd_byte_offset;
+  uint64_t sgd_byte_length;
+};
+
+struct Ktx2LevelIndex {
+  uint64_t byte_offset;
+  uint64_t byte_length;
+  uint64_t uncompressed_byte_length;
+};
+
+static_assert(sizeof(Ktx2Header) == 80, "KTX2 header layout");
+static_assert(sizeof(Ktx2LevelIndex) == 24, "KTX2 level index layout");
+
+}  // namespace
+
+bool Ktx2Reader::Open(const std::string& path) {
+  if (!m_file.Open(path)) {
+    return false;
+  }
+
+  const uint8_t* data = m_file.GetData();
+  size_t size = m_file.GetSize();
+
+  Ktx2Header header{};
+  if (size < sizeof(header)) {
+    HEX_CORE_ERROR("{} is too small to be a KTX2 file.", path);
+    return false;
+  }
+
+  std::memcpy(&header, data, sizeof(header));
+
+  if (std::memcmp(header.identifier, kKtx2Identifier, sizeof(kKtx2Identifier)) != 0) {
+    HEX_CORE_ERROR("{} is not a KTX2 file.", path);
+    return false;
+  }
+
+  if (header.supercompression_scheme != 0) {
+    HEX_CORE_ERROR("{} uses supercompression scheme {} which is not supported.", path,
+                   header.supercompression_scheme);
+    return false;
+  }
+
+  if (header.vk_format == 0 || header.pixel_width == 0) {
+    HEX_CORE_ERROR("{} has no usable format or size.", path);
+    return false;
+  }
+
+  uint32_t index_count = header.level_count == 0 ? 1 : header.level_count;
+  if (sizeof(header) + sizeof(Ktx2LevelIndex) * index_count > size) {
+    HEX_CORE_ERROR("{} level index is truncated.", path);
+    return false;
+  }
+
+  m_levels.resize(index_count);
+  for (uint32_t i = 0; i < index_count; i++) {
+    Ktx2LevelIndex index{};
+    std::memcpy(&index, data + sizeof(header) + sizeof(Ktx2LevelIndex) * i, sizeof(index));
+
+    if (index.byte_offset + index.byte_length > size || index.byte_offset + index.byte_length < index.byte_offset) {
+      HEX_CORE_ERROR("{} level {} is out of file bounds.", path, i);
+      return false;
+    }
+
+    m_levels[i].data = data + index.byte_offset;
+    m_levels[i].size = static_cast<size_t>(index.byte_length);
+  }
+
+  m_vk_format = header.vk_format;
+  m_width = header.pixel_width;
+  m_height = header.pixel_height;
+  m_depth = header.pixel_depth;
+  m_layer_count = header.layer_count;
+  m_face_count = header.face_count;
+  m_level_count = header.level_count;
+
+  return true;
+}
+
+}  // namespace hexgon
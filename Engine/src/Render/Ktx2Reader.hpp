@@ -0,0 +1,81 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Core/Util/MappedFile.hpp"
+
+namespace hexgon {
+
+// Parses a KTX2 container in place. Level payloads point into the mapped file and can be copied straight into
+// staging memory. Supercompressed files (BasisLZ, zstd, zlib) are rejected.
+class Ktx2Reader {
+ public:
+  struct Level {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+  };
+
+  Ktx2Reader() = default;
+
+  bool Open(std::string const& path);
+
+  // VkFormat value stored in the header, 0 for VK_FORMAT_UNDEFINED
+  uint32_t GetVkFormat() const { return m_vk_format; }
+
+  uint32_t GetWidth() const { return m_width; }
+
+  // 0 for 1D textures
+  uint32_t GetHeight() const { return m_height; }
+
+  // 0 for 1D and 2D textures
+  uint32_t GetDepth() const { return m_depth; }
+
+  // 0 if the texture is not an array
+  uint32_t GetLayerCount() const { return m_layer_count; }
+
+  uint32_t GetFaceCount() const { return m_face_count; }
+
+  // 0 means the file only contains level 0 and the other levels should be generated
+  uint32_t GetLevelCount() const { return m_level_count; }
+
+  // all layers, faces and slices of one mip level, tightly packed
+  Level const& GetLevel(uint32_t level) const { return m_levels[level]; }
+
+ private:
+  MappedFile m_file = {};
+  uint32_t m_vk_format = 0;
+  uint32_t m_width = 0;
+  uint32_t m_height = 0;
+  uint32_t m_depth = 0;
+  uint32_t m_layer_count = 0;
+  uint32_t m_face_count = 0;
+  uint32_t m_level_count = 0;
+  std::vector<Level> m_levels = {};
+};
+
+}  // namespace hexgon
@@ -0,0 +1,466 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include <Hexgon/Core/Geometry.hpp>
+#include <Hexgon/Core/JobSystem.hpp>
+#include <Hexgon/Object/Mesh.hpp>
+#include <Hexgon/Render/OcclusionCuller.hpp>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HEX_OCCLUSION_SSE 1
+#include <immintrin.h>
+#endif
+
+namespace hexgon {
+
+namespace {
+
+// tile width is a multiple of every lane count, so lane groups never straddle tiles
+constexpr int32_t kTileWidth = 32;
+constexpr int32_t kTileHeight = 32;
+
+constexpr uint32_t kPyramidRowsPerJob = 16;
+constexpr uint32_t kTestsPerJob = 256;
+
+#if defined(__AVX2__)
+using Lanes = __m256;
+constexpr uint32_t kLaneCount = 8;
+
+inline Lanes Load(const float* p) { return _mm256_loadu_ps(p); }
+inline void Store(float* p, Lanes v) { _mm256_storeu_ps(p, v); }
+inline Lanes Splat(float v) { return _mm256_set1_ps(v); }
+inline Lanes AddLanes(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+inline Lanes MulLanes(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+inline Lanes MinLanes(Lanes a, Lanes b) { return _mm256_min_ps(a, b); }
+inline Lanes LaneOffsets() { return _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f); }
+// `a` where `test` >= 0, `b` elsewhere
+inline Lanes SelectNonNegative(Lanes test, Lanes a, Lanes b) {
+  return _mm256_blendv_ps(b, a, _mm256_cmp_ps(test, _mm256_setzero_ps(), _CMP_GE_OQ));
+}
+#elif defined(HEX_OCCLUSION_SSE)
+using Lanes = __m128;
+constexpr uint32_t kLaneCount = 4;
+
+inline Lanes Load(const float* p) { return _mm_loadu_ps(p); }
+inline void Store(float* p, Lanes v) { _mm_storeu_ps(p, v); }
+inline Lanes Splat(float v) { return _mm_set1_ps(v); }
+inline Lanes AddLanes(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+inline Lanes MulLanes(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+inline Lanes MinLanes(Lanes a, Lanes b) { return _mm_min_ps(a, b); }
+inline Lanes LaneOffsets() { return _mm_setr_ps(0.f, 1.f, 2.f, 3.f); }
+inline Lanes SelectNonNegative(Lanes test, Lanes a, Lanes b) {
+  Lanes mask = _mm_cmpge_ps(test, _mm_setzero_ps());
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+#else
+using Lanes = float;
+constexpr uint32_t kLaneCount = 1;
+
+inline Lanes Load(const float* p) { return *p; }
+inline void Store(float* p, Lanes v) { *p = v; }
+inline Lanes Splat(float v) { return v; }
+inline Lanes AddLanes(Lanes a, Lanes b) { return a + b; }
+inline Lanes MulLanes(Lanes a, Lanes b) { return a * b; }
+inline Lanes MinLanes(Lanes a, Lanes b) { return std::min(a, b); }
+inline Lanes LaneOffsets() { return 0.f; }
+inline Lanes SelectNonNegative(Lanes test, Lanes a, Lanes b) { return test >= 0.f ? a : b; }
+#endif
+
+static_assert(kTileWidth % kLaneCount == 0, "tiles have to be whole lanes");
+
+// signed distance to the near plane in clip space, matching the depth range glm projects to
+inline float NearDistance(glm::vec4 const& v) {
+#if defined(GLM_FORCE_DEPTH_ZERO_TO_ONE)
+  return v.z;
+#else
+  return v.z + v.w;
+#endif
+}
+
+inline glm::vec4 Lerp(glm::vec4 const& a, glm::vec4 const& b, float t) { return a + (b - a) * t; }
+
+uint32_t RoundUp(uint32_t value, int32_t multiple) {
+  auto step = static_cast<uint32_t>(multiple);
+  return std::max((value + step - 1) / step, 1u) * step;
+}
+
+}  // namespace
+
+OcclusionCuller::OcclusionCuller(uint32_t width, uint32_t height) { Resize(width, height); }
+
+void OcclusionCuller::Resize(uint32_t width, uint32_t height) {
+  m_width = RoundUp(width, kTileWidth);
+  m_height = RoundUp(height, kTileHeight);
+  m_tiles_x = m_width / static_cast<uint32_t>(kTileWidth);
+  m_tiles_y = m_height / static_cast<uint32_t>(kTileHeight);
+
+  m_bins.resize(m_tiles_x * m_tiles_y);
+  m_levels.clear();
+
+  uint32_t level_width = m_width;
+  uint32_t level_height = m_height;
+
+  while (true) {
+    Level level{};
+    level.width = level_width;
+    level.height = level_height;
+    level.depth.resize(level_width * level_height, 1.f);
+
+    m_levels.push_back(std::move(level));
+
+    if (level_width == 1 && level_height == 1) {
+      break;
+    }
+
+    level_width = (level_width + 1) / 2;
+    level_height = (level_height + 1) / 2;
+  }
+}
+
+void OcclusionCuller::Begin(glm::mat4 const& view_projection) {
+  m_view_projection = view_projection;
+  m_occluders.clear();
+
+  std::fill(m_levels[0].depth.begin(), m_levels[0].depth.end(), 1.f);
+}
+
+void OcclusionCuller::AddOccluder(Geometry const* geometry, glm::mat4 const& world) {
+  if (geometry && geometry->GetIndexCount() > 0) {
+    m_occluders.push_back(Occluder{geometry, world});
+  }
+}
+
+void OcclusionCuller::AddOccluder(Mesh const* mesh) { AddOccluder(mesh->GetGeometry(), mesh->GetWorldMatrix()); }
+
+void OcclusionCuller::Rasterize() {
+  m_triangles.resize(m_occluders.size());
+
+  JobSystem::Get()->ParallelFor(static_cast<uint32_t>(m_occluders.size()), 1,
+                                [this](uint32_t begin, uint32_t end, uint32_t) {
+                                  for (uint32_t i = begin; i < end; i++) {
+                                    SetupTriangles(m_occluders[i], m_triangles[i]);
+                                  }
+                                });
+
+  for (auto& bin : m_bins) {
+    bin.clear();
+  }
+
+  for (uint32_t o = 0; o < m_triangles.size(); o++) {
+    for (uint32_t t = 0; t < m_triangles[o].size(); t++) {
+      Triangle const& triangle = m_triangles[o][t];
+
+      for (int32_t ty = triangle.min_y / kTileHeight; ty <= triangle.max_y / kTileHeight; ty++) {
+        for (int32_t tx = triangle.min_x / kTileWidth; tx <= triangle.max_x / kTileWidth; tx++) {
+          m_bins[ty * m_tiles_x + tx].emplace_back(o, t);
+        }
+      }
+    }
+  }
+
+  JobSystem::Get()->ParallelFor(static_cast<uint32_t>(m_bins.size()), 1,
+                                [this](uint32_t begin, uint32_t end, uint32_t) {
+                                  for (uint32_t tile = begin; tile < end; tile++) {
+                                    RasterizeTile(tile);
+                                  }
+                                });
+
+  BuildPyramid();
+}
+
+bool OcclusionCuller::IsVisible(Aabb const& aabb) const {
+  float min_x = static_cast<float>(m_width);
+  float min_y = static_cast<float>(m_height);
+  float max_x = 0.f;
+  float max_y = 0.f;
+  float min_depth = 1.f;
+
+  for (uint32_t corner = 0; corner < 8; corner++) {
+    glm::vec3 point((corner & 1) ? aabb.max.x : aabb.min.x, (corner & 2) ? aabb.max.y : aabb.min.y,
+                    (corner & 4) ? aabb.max.z : aabb.min.z);
+
+    glm::vec4 clip = m_view_projection * glm::vec4(point, 1.f);
+
+    // the projected rectangle is unbounded once a corner is behind the camera
+    if (NearDistance(clip) < 0.f || clip.w <= 0.f) {
+      return true;
+    }
+
+    float x = (clip.x / clip.w * 0.5f + 0.5f) * m_width;
+    float y = (clip.y / clip.w * 0.5f + 0.5f) * m_height;
+
+    min_x = std::min(min_x, x);
+    min_y = std::min(min_y, y);
+    max_x = std::max(max_x, x);
+    max_y = std::max(max_y, y);
+    min_depth = std::min(min_depth, clip.z / clip.w);
+  }
+
+  auto x0 = static_cast<int32_t>(std::max(std::floor(min_x), 0.f));
+  auto y0 = static_cast<int32_t>(std::max(std::floor(min_y), 0.f));
+  auto x1 = static_cast<int32_t>(std::min(std::floor(max_x), m_width - 1.f));
+  auto y1 = static_cast<int32_t>(std::min(std::floor(max_y), m_height - 1.f));
+
+  // off screen
+  if (x0 > x1 || y0 > y1) {
+    return false;
+  }
+
+  uint32_t level = 0;
+
+  while (level + 1 < m_levels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) {
+    level++;
+  }
+
+  Level const& pyramid = m_levels[level];
+  float max_depth = 0.f;
+
+  for (int32_t y = y0 >> level; y <= (y1 >> level); y++) {
+    for (int32_t x = x0 >> level; x <= (x1 >> level); x++) {
+      max_depth = std::max(max_depth, pyramid.depth[y * pyramid.width + x]);
+    }
+  }
+
+  return min_depth <= max_depth;
+}
+
+void OcclusionCuller::Cull(glm::mat4 const& view_projection, std::vector<Mesh*> const& meshes,
+                           std::vector<Mesh*>& visible) {
+  Begin(view_projection);
+
+  for (auto mesh : meshes) {
+    if (mesh->IsOccluder()) {
+      AddOccluder(mesh);
+    }
+  }
+
+  Rasterize();
+
+  m_visible.resize(meshes.size());
+
+  JobSystem::Get()->ParallelFor(static_cast<uint32_t>(meshes.size()), kTestsPerJob,
+                                [this, &meshes](uint32_t begin, uint32_t end, uint32_t) {
+                                  for (uint32_t i = begin; i < end; i++) {
+                                    m_visible[i] = meshes[i]->GetGeometry() && IsVisible(meshes[i]->GetWorldAabb());
+                                  }
+                                });
+
+  visible.clear();
+
+  for (size_t i = 0; i < meshes.size(); i++) {
+    if (m_visible[i]) {
+      visible.push_back(meshes[i]);
+    }
+  }
+}
+
+void OcclusionCuller::SetupTriangles(Occluder const& occluder, std::vector<Triangle>& triangles) const {
+  triangles.clear();
+
+  auto const& vertices = occluder.geometry->GetVertices();
+  auto const& indices = occluder.geometry->GetIndices();
+
+  glm::mat4 matrix = m_view_projection * occluder.world;
+
+  std::vector<glm::vec4> clip(vertices.size() / Geometry::kVertexStride);
+
+  for (size_t i = 0; i < clip.size(); i++) {
+    const float* position = &vertices[i * Geometry::kVertexStride];
+    clip[i] = matrix * glm::vec4(position[0], position[1], position[2], 1.f);
+  }
+
+  auto emit = [this, &triangles](glm::vec4 const& c0, glm::vec4 const& c1, glm::vec4 const& c2) {
+    float x[3], y[3], z[3];
+    glm::vec4 const* corners[3] = {&c0, &c1, &c2};
+
+    for (int i = 0; i < 3; i++) {
+      float inverse_w = 1.f / corners[i]->w;
+
+      x[i] = (corners[i]->x * inverse_w * 0.5f + 0.5f) * m_width;
+      y[i] = (corners[i]->y * inverse_w * 0.5f + 0.5f) * m_height;
+      z[i] = corners[i]->z * inverse_w;
+    }
+
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+
+    if (std::abs(area) < 1e-6f) {
+      return;
+    }
+
+    // occluders are two sided, wind everything counter clockwise
+    if (area < 0.f) {
+      std::swap(x[1], x[2]);
+      std::swap(y[1], y[2]);
+      std::swap(z[1], z[2]);
+      area = -area;
+    }
+
+    Triangle triangle{};
+
+    triangle.min_x = std::max(static_cast<int32_t>(std::floor(std::min({x[0], x[1], x[2]}))), 0);
+    triangle.min_y = std::max(static_cast<int32_t>(std::floor(std::min({y[0], y[1], y[2]}))), 0);
+    triangle.max_x = std::min(static_cast<int32_t>(std::ceil(std::max({x[0], x[1], x[2]}))),
+                              static_cast<int32_t>(m_width) - 1);
+    triangle.max_y = std::min(static_cast<int32_t>(std::ceil(std::max({y[0], y[1], y[2]}))),
+                              static_cast<int32_t>(m_height) - 1);
+
+    if (triangle.min_x > triangle.max_x || triangle.min_y > triangle.max_y) {
+      return;
+    }
+
+    // edge i runs from vertex i to vertex i + 1, positive on the inner side
+    for (int i = 0; i < 3; i++) {
+      int j = (i + 1) % 3;
+
+      triangle.edge_a[i] = y[i] - y[j];
+      triangle.edge_b[i] = x[j] - x[i];
+      triangle.edge_c[i] = x[i] * y[j] - x[j] * y[i];
+    }
+
+    // barycentrics of vertex 1 and 2 come from the edges facing them
+    float dz1 = (z[1] - z[0]) / area;
+    float dz2 = (z[2] - z[0]) / area;
+
+    triangle.depth_a = triangle.edge_a[2] * dz1 + triangle.edge_a[0] * dz2;
+    triangle.depth_b = triangle.edge_b[2] * dz1 + triangle.edge_b[0] * dz2;
+    triangle.depth_c = z[0] + triangle.edge_c[2] * dz1 + triangle.edge_c[0] * dz2;
+
+    triangles.push_back(triangle);
+  };
+
+  // the full detail level, a simplified one may poke out of the real surface and hide what is visible
+  size_t index_count = occluder.geometry->GetIndexCount();
+
+  for (size_t i = 0; i + 2 < index_count; i += 3) {
+    glm::vec4 const corners[3] = {clip[indices[i]], clip[indices[i + 1]], clip[indices[i + 2]]};
+    float distances[3] = {NearDistance(corners[0]), NearDistance(corners[1]), NearDistance(corners[2])};
+
+    if (distances[0] >= 0.f && distances[1] >= 0.f && distances[2] >= 0.f) {
+      emit(corners[0], corners[1], corners[2]);
+      continue;
+    }
+
+    // clip against the near plane, leaving a triangle or a quad
+    glm::vec4 polygon[4];
+    int count = 0;
+
+    for (int a = 0; a < 3; a++) {
+      int b = (a + 1) % 3;
+
+      if (distances[a] >= 0.f) {
+        polygon[count++] = corners[a];
+      }
+
+      if ((distances[a] >= 0.f) != (distances[b] >= 0.f)) {
+        polygon[count++] = Lerp(corners[a], corners[b], distances[a] / (distances[a] - distances[b]));
+      }
+    }
+
+    for (int v = 2; v < count; v++) {
+      emit(polygon[0], polygon[v - 1], polygon[v]);
+    }
+  }
+}
+
+void OcclusionCuller::RasterizeTile(uint32_t tile) {
+  auto tile_x = static_cast<int32_t>(tile % m_tiles_x) * kTileWidth;
+  auto tile_y = static_cast<int32_t>(tile / m_tiles_x) * kTileHeight;
+
+  float* depth = m_levels[0].depth.data();
+  Lanes offsets = LaneOffsets();
+  Lanes far_depth = Splat(1.f);
+
+  for (auto const& it : m_bins[tile]) {
+    Triangle const& triangle = m_triangles[it.first][it.second];
+
+    // lane groups start aligned inside the tile
+    int32_t x0 = std::max(triangle.min_x, tile_x) / static_cast<int32_t>(kLaneCount) * static_cast<int32_t>(kLaneCount);
+    int32_t x1 = std::min(triangle.max_x, tile_x + kTileWidth - 1);
+    int32_t y0 = std::max(triangle.min_y, tile_y);
+    int32_t y1 = std::min(triangle.max_y, tile_y + kTileHeight - 1);
+
+    Lanes edge_a[3], edge_b[3], edge_c[3];
+
+    for (int i = 0; i < 3; i++) {
+      edge_a[i] = Splat(triangle.edge_a[i]);
+      edge_b[i] = Splat(triangle.edge_b[i]);
+      edge_c[i] = Splat(triangle.edge_c[i]);
+    }
+
+    Lanes depth_a = Splat(triangle.depth_a);
+
+    for (int32_t y = y0; y <= y1; y++) {
+      float center_y = y + 0.5f;
+
+      Lanes row_edge[3];
+
+      for (int i = 0; i < 3; i++) {
+        row_edge[i] = AddLanes(MulLanes(edge_b[i], Splat(center_y)), edge_c[i]);
+      }
+
+      Lanes row_depth = Splat(triangle.depth_b * center_y + triangle.depth_c);
+
+      for (int32_t x = x0; x <= x1; x += static_cast<int32_t>(kLaneCount)) {
+        Lanes center_x = AddLanes(Splat(x + 0.5f), offsets);
+
+        Lanes inside = MinLanes(MinLanes(AddLanes(MulLanes(edge_a[0], center_x), row_edge[0]),
+                                         AddLanes(MulLanes(edge_a[1], center_x), row_edge[1])),
+                                AddLanes(MulLanes(edge_a[2], center_x), row_edge[2]));
+
+        Lanes triangle_depth = AddLanes(MulLanes(depth_a, center_x), row_depth);
+
+        float* pixels = depth + y * m_width + x;
+
+        Store(pixels, MinLanes(Load(pixels), SelectNonNegative(inside, triangle_depth, far_depth)));
+      }
+    }
+  }
+}
+
+void OcclusionCuller::BuildPyramid() {
+  for (size_t l = 1; l < m_levels.size(); l++) {
+    Level const& source = m_levels[l - 1];
+    Level& target = m_levels[l];
+
+    JobSystem::Get()->ParallelFor(
+        target.height, kPyramidRowsPerJob, [&source, &target](uint32_t begin, uint32_t end, uint32_t) {
+          for (uint32_t y = begin; y < end; y++) {
+            uint32_t y0 = y * 2;
+            uint32_t y1 = std::min(y0 + 1, source.height - 1);
+
+            for (uint32_t x = 0; x < target.width; x++) {
+              uint32_t x0 = x * 2;
+              uint32_t x1 = std::min(x0 + 1, source.width - 1);
+
+              target.depth[y * target.width + x] =
+                  std::max(std::max(source.depth[y0 * source.width + x0], source.depth[y0 * source.width + x1]),
+                           std::max(source.depth[y1 * source.width + x0], source.depth[y1 * source.width + x1]));
+            }
+          }
+        });
+  }
+}
+
+}  // namespace hexgon
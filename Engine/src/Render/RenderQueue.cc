@@ -0,0 +1,185 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include <Hexgon/Core/JobSystem.hpp>
+#include <Hexgon/Render/RenderQueue.hpp>
+#include <algorithm>
+#include <cstring>
+
+namespace hexgon {
+
+namespace {
+
+constexpr uint32_t kRadixBits = 8;
+constexpr uint32_t kBucketCount = 1u << kRadixBits;
+constexpr uint32_t kPassCount = 64 / kRadixBits;
+constexpr uint32_t kItemsPerJob = 4096;
+// below this a comparison sort wins over eight passes of histograms
+constexpr uint32_t kMinRadixCount = 256;
+
+constexpr uint32_t kLayerShift = 60;
+constexpr uint32_t kTranslucentShift = 59;
+constexpr uint64_t kIdMask = 0xffff;
+constexpr uint64_t kDepthMask = 0xffffff;
+
+}  // namespace
+
+void RenderQueue::Clear() {
+  m_items.clear();
+  m_stats = {};
+}
+
+void RenderQueue::Push(uint32_t layer, bool translucent, uint32_t pipeline, uint32_t material, float depth,
+                       uint32_t draw) {
+  Item item{};
+  item.key = MakeKey(layer, translucent, pipeline, material, depth);
+  item.pipeline = pipeline;
+  item.material = material;
+  item.draw = draw;
+
+  m_items.emplace_back(item);
+}
+
+void RenderQueue::Sort() {
+  m_stats = {};
+  m_stats.item_count = static_cast<uint32_t>(m_items.size());
+
+  CountBinds(m_stats.submitted_pipeline_binds, m_stats.submitted_material_binds, false);
+
+  RadixSort();
+
+  CountBinds(m_stats.pipeline_binds, m_stats.material_binds, true);
+}
+
+uint64_t RenderQueue::MakeKey(uint32_t layer, bool translucent, uint32_t pipeline, uint32_t material, float depth) {
+  // the bits of a non negative float grow with its value, the top 24 keep the exponent and 15 bits of mantissa
+  float clamped = depth > 0.f ? depth : 0.f;
+  uint32_t depth_bits = 0;
+  std::memcpy(&depth_bits, &clamped, sizeof(float));
+
+  uint64_t depth_key = depth_bits >> 8;
+
+  uint64_t key = static_cast<uint64_t>(std::min(layer, kLayerCount - 1)) << kLayerShift;
+
+  if (!translucent) {
+    // state first, depth only orders draws sharing pipeline and material
+    key |= (pipeline & kIdMask) << 43;
+    key |= (material & kIdMask) << 27;
+    key |= depth_key << 3;
+  } else {
+    // blending needs back to front, inverted depth goes before any state
+    key |= 1ull << kTranslucentShift;
+    key |= (~depth_key & kDepthMask) << 35;
+    key |= (pipeline & kIdMask) << 19;
+    key |= (material & kIdMask) << 3;
+  }
+
+  return key;
+}
+
+void RenderQueue::CountBinds(uint32_t& pipeline_binds, uint32_t& material_binds, bool set_flags) {
+  pipeline_binds = 0;
+  material_binds = 0;
+
+  for (size_t i = 0; i < m_items.size(); i++) {
+    auto& item = m_items[i];
+
+    bool bind_pipeline = i == 0 || item.pipeline != m_items[i - 1].pipeline;
+    bool bind_material = bind_pipeline || item.material != m_items[i - 1].material;
+
+    pipeline_binds += bind_pipeline ? 1 : 0;
+    material_binds += bind_material ? 1 : 0;
+
+    if (set_flags) {
+      item.bind_pipeline = bind_pipeline;
+      item.bind_material = bind_material;
+    }
+  }
+}
+
+void RenderQueue::RadixSort() {
+  auto count = static_cast<uint32_t>(m_items.size());
+
+  if (count < kMinRadixCount) {
+    std::stable_sort(m_items.begin(), m_items.end(), [](Item const& a, Item const& b) { return a.key < b.key; });
+    return;
+  }
+
+  // a pass over a digit every key shares would only copy
+  uint64_t differing = 0;
+  for (auto const& item : m_items) {
+    differing |= item.key ^ m_items[0].key;
+  }
+
+  uint32_t job_count = (count + kItemsPerJob - 1) / kItemsPerJob;
+
+  m_scratch.resize(count);
+  m_histograms.resize(job_count * kBucketCount);
+
+  for (uint32_t pass = 0; pass < kPassCount; pass++) {
+    uint32_t shift = pass * kRadixBits;
+
+    if (((differing >> shift) & (kBucketCount - 1)) == 0) {
+      continue;
+    }
+
+    // one histogram per block of items, whichever thread ends up running it
+    JobSystem::Get()->ParallelFor(job_count, 1, [this, shift, count](uint32_t begin, uint32_t end, uint32_t) {
+      for (uint32_t job = begin; job < end; job++) {
+        uint32_t* histogram = &m_histograms[job * kBucketCount];
+
+        std::fill(histogram, histogram + kBucketCount, 0);
+
+        for (uint32_t i = job * kItemsPerJob; i < std::min((job + 1) * kItemsPerJob, count); i++) {
+          histogram[(m_items[i].key >> shift) & (kBucketCount - 1)]++;
+        }
+      }
+    });
+
+    // digit major, job minor, so equal digits keep their order and the sort stays stable
+    uint32_t offset = 0;
+    for (uint32_t digit = 0; digit < kBucketCount; digit++) {
+      for (uint32_t job = 0; job < job_count; job++) {
+        uint32_t& slot = m_histograms[job * kBucketCount + digit];
+        uint32_t digit_count = slot;
+
+        slot = offset;
+        offset += digit_count;
+      }
+    }
+
+    JobSystem::Get()->ParallelFor(job_count, 1, [this, shift, count](uint32_t begin, uint32_t end, uint32_t) {
+      for (uint32_t job = begin; job < end; job++) {
+        uint32_t* offsets = &m_histograms[job * kBucketCount];
+
+        for (uint32_t i = job * kItemsPerJob; i < std::min((job + 1) * kItemsPerJob, count); i++) {
+          m_scratch[offsets[(m_items[i].key >> shift) & (kBucketCount - 1)]++] = m_items[i];
+        }
+      }
+    });
+
+    m_items.swap(m_scratch);
+  }
+}
+
+}  // namespace hexgon
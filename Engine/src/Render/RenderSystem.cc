@@ -23,6 +23,8 @@
 
 #include <Hexgon/Render/RenderSystem.hpp>
 
+#include <cstdlib>
+
 #include "LogPrivate.hpp"
 
 #if defined(HEX_PLATFORM_WINDOWS) || defined(HEX_PLATFORM_LINUX)
@@ -31,17 +33,59 @@
 
 namespace hexgon {
 
-std::unique_ptr<RenderSystem> RenderSystem::Init(RenderAPI api, Window* window, bool debug) {
+std::unique_ptr<RenderSystem> RenderSystem::Init(RenderAPI api, Window* window, bool debug,
+                                                 const std::string& device) {
+  auto ret = Create(api, debug);
+
+  if (ret && !ret->AttachWindow(window, device)) {
+    ret->ShutDown();
+    ret.reset();
+  }
+
+  return ret;
+}
+
+std::unique_ptr<RenderSystem> RenderSystem::Create(RenderAPI api, bool debug) {
 #if defined(HEX_PLATFORM_WINDOWS) || defined(HEX_PLATFORM_LINUX)
   if (api == RenderAPI::kMetal) {
     HEX_CORE_ERROR("Not support Metal API!");
     return std::unique_ptr<RenderSystem>();
   }
 
-  return RenderSystemVk::Init(window, debug);
+  return RenderSystemVk::Create(debug);
 #else
 #error "Not Support Platform"
 #endif
 }
 
+bool RenderSystem::AttachWindow(Window* window, const std::string& device) {
+  std::string preferred = device;
+  if (preferred.empty()) {
+    if (const char* env = std::getenv("HEXGON_DEVICE")) {
+      preferred = env;
+    }
+  }
+
+  return OnAttachWindow(window, preferred);
+}
+
+std::shared_ptr<Texture> RenderSystem::CreateRenderTarget(uint32_t width, uint32_t height, PixelFormat format,
+                                                          uint32_t sample_count) {
+  TextureDescriptor desc{};
+  desc.label = GetPixelFormatInfo(format).is_depth ? "Depth Target" : "Render Target";
+  desc.format = format;
+  desc.usage = TextureUsage::kRenderTarget | TextureUsage::kCopySrc;
+  desc.storage = StorageMode::kDevicePrivate;
+  desc.width = width;
+  desc.height = height;
+  desc.sample_count = sample_count;
+
+  // multisample targets are resolved into a single sample target before anyone reads them
+  if (sample_count == 1) {
+    desc.usage |= TextureUsage::kShaderRead;
+  }
+
+  return CreateTexture(desc);
+}
+
 }  // namespace hexgon
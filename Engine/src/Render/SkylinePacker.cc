@@ -0,0 +1,238 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include "Render/SkylinePacker.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace hexgon {
+
+void SkylinePacker::Reset(uint32_t width, uint32_t height) {
+  m_width = width;
+  m_height = height;
+  m_used_area = 0;
+
+  m_skyline.clear();
+  m_skyline.emplace_back(Node{0, 0, width});
+
+  m_free_rects.clear();
+}
+
+bool SkylinePacker::Insert(uint32_t width, uint32_t height, Rect& result) {
+  if (width == 0 || height == 0 || width > m_width || height > m_height) {
+    return false;
+  }
+
+  if (InsertFree(width, height, result)) {
+    m_used_area += static_cast<uint64_t>(width) * height;
+    return true;
+  }
+
+  size_t best_index = m_skyline.size();
+  uint32_t best_y = std::numeric_limits<uint32_t>::max();
+  uint32_t best_width = std::numeric_limits<uint32_t>::max();
+
+  for (size_t i = 0; i < m_skyline.size(); i++) {
+    uint32_t y = 0;
+    if (!FitSkyline(i, width, height, y)) {
+      continue;
+    }
+
+    // lowest top edge first, then the narrowest node to keep wide gaps for wide rectangles
+    if (y + height < best_y || (y + height == best_y && m_skyline[i].width < best_width)) {
+      best_index = i;
+      best_y = y + height;
+      best_width = m_skyline[i].width;
+    }
+  }
+
+  if (best_index == m_skyline.size()) {
+    return false;
+  }
+
+  result = Rect{m_skyline[best_index].x, best_y - height, width, height};
+
+  AddSkylineLevel(best_index, result);
+
+  m_used_area += static_cast<uint64_t>(width) * height;
+
+  return true;
+}
+
+void SkylinePacker::Release(const Rect& rect) {
+  m_used_area -= static_cast<uint64_t>(rect.width) * rect.height;
+
+  if (m_used_area == 0) {
+    Reset(m_width, m_height);
+    return;
+  }
+
+  Rect merged = rect;
+
+  // grow the released rectangle with free neighbours sharing a whole edge
+  bool changed = true;
+  while (changed) {
+    changed = false;
+
+    for (size_t i = 0; i < m_free_rects.size(); i++) {
+      const Rect& other = m_free_rects[i];
+
+      bool same_row = other.y == merged.y && other.height == merged.height &&
+                      (other.x + other.width == merged.x || merged.x + merged.width == other.x);
+      bool same_column = other.x == merged.x && other.width == merged.width &&
+                         (other.y + other.height == merged.y || merged.y + merged.height == other.y);
+
+      if (same_row) {
+        merged = Rect{std::min(other.x, merged.x), merged.y, other.width + merged.width, merged.height};
+      } else if (same_column) {
+        merged = Rect{merged.x, std::min(other.y, merged.y), merged.width, other.height + merged.height};
+      } else {
+        continue;
+      }
+
+      m_free_rects[i] = m_free_rects.back();
+      m_free_rects.pop_back();
+      changed = true;
+      break;
+    }
+  }
+
+  m_free_rects.emplace_back(merged);
+}
+
+bool SkylinePacker::InsertFree(uint32_t width, uint32_t height, Rect& result) {
+  size_t best = m_free_rects.size();
+  uint64_t best_waste = std::numeric_limits<uint64_t>::max();
+
+  for (size_t i = 0; i < m_free_rects.size(); i++) {
+    const Rect& rect = m_free_rects[i];
+
+    if (rect.width < width || rect.height < height) {
+      continue;
+    }
+
+    uint64_t waste = static_cast<uint64_t>(rect.width) * rect.height - static_cast<uint64_t>(width) * height;
+    if (waste < best_waste) {
+      best = i;
+      best_waste = waste;
+    }
+  }
+
+  if (best == m_free_rects.size()) {
+    return false;
+  }
+
+  Rect rect = m_free_rects[best];
+  m_free_rects[best] = m_free_rects.back();
+  m_free_rects.pop_back();
+
+  result = Rect{rect.x, rect.y, width, height};
+
+  // guillotine split, the cut goes along the shorter leftover so the bigger piece stays as square as possible
+  uint32_t right_width = rect.width - width;
+  uint32_t bottom_height = rect.height - height;
+
+  if (right_width < bottom_height) {
+    if (right_width > 0) {
+      m_free_rects.emplace_back(Rect{rect.x + width, rect.y, right_width, height});
+    }
+
+    if (bottom_height > 0) {
+      m_free_rects.emplace_back(Rect{rect.x, rect.y + height, rect.width, bottom_height});
+    }
+  } else {
+    if (right_width > 0) {
+      m_free_rects.emplace_back(Rect{rect.x + width, rect.y, right_width, rect.height});
+    }
+
+    if (bottom_height > 0) {
+      m_free_rects.emplace_back(Rect{rect.x, rect.y + height, width, bottom_height});
+    }
+  }
+
+  return true;
+}
+
+bool SkylinePacker::FitSkyline(size_t index, uint32_t width, uint32_t height, uint32_t& y) const {
+  uint32_t x = m_skyline[index].x;
+  if (x + width > m_width) {
+    return false;
+  }
+
+  y = 0;
+  uint32_t remaining = width;
+
+  for (size_t i = index; remaining > 0; i++) {
+    if (i == m_skyline.size()) {
+      return false;
+    }
+
+    y = std::max(y, m_skyline[i].y);
+
+    if (y + height > m_height) {
+      return false;
+    }
+
+    remaining -= std::min(remaining, m_skyline[i].width);
+  }
+
+  return true;
+}
+
+void SkylinePacker::AddSkylineLevel(size_t index, const Rect& rect) {
+  m_skyline.insert(m_skyline.begin() + index, Node{rect.x, rect.y + rect.height, rect.width});
+
+  // nodes under the new level shrink or disappear
+  for (size_t i = index + 1; i < m_skyline.size();) {
+    Node& prev = m_skyline[i - 1];
+    Node& node = m_skyline[i];
+
+    if (node.x >= prev.x + prev.width) {
+      break;
+    }
+
+    uint32_t shrink = prev.x + prev.width - node.x;
+
+    if (node.width <= shrink) {
+      m_skyline.erase(m_skyline.begin() + i);
+      continue;
+    }
+
+    node.x += shrink;
+    node.width -= shrink;
+    break;
+  }
+
+  // neighbours at the same height become one node
+  for (size_t i = 0; i + 1 < m_skyline.size();) {
+    if (m_skyline[i].y == m_skyline[i + 1].y) {
+      m_skyline[i].width += m_skyline[i + 1].width;
+      m_skyline.erase(m_skyline.begin() + i + 1);
+    } else {
+      i++;
+    }
+  }
+}
+
+}  // namespace hexgon
@@ -0,0 +1,79 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace hexgon {
+
+// Bottom-left skyline packer for one atlas page. Released rectangles go to a free list which is searched before the
+// skyline, so pages can be refilled at runtime without repacking.
+class SkylinePacker {
+ public:
+  struct Rect {
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+  };
+
+  SkylinePacker() = default;
+
+  void Reset(uint32_t width, uint32_t height);
+
+  bool Insert(uint32_t width, uint32_t height, Rect& result);
+
+  void Release(const Rect& rect);
+
+  uint64_t GetUsedArea() const { return m_used_area; }
+
+  uint32_t GetWidth() const { return m_width; }
+
+  uint32_t GetHeight() const { return m_height; }
+
+ private:
+  struct Node {
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t width = 0;
+  };
+
+  bool InsertFree(uint32_t width, uint32_t height, Rect& result);
+
+  // lowest y a width x height rectangle can sit at when its left edge is on node `index`
+  bool FitSkyline(size_t index, uint32_t width, uint32_t height, uint32_t& y) const;
+
+  void AddSkylineLevel(size_t index, const Rect& rect);
+
+ private:
+  uint32_t m_width = 0;
+  uint32_t m_height = 0;
+  uint64_t m_used_area = 0;
+  std::vector<Node> m_skyline = {};
+  std::vector<Rect> m_free_rects = {};
+};
+
+}  // namespace hexgon
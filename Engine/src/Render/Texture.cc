@@ -27,13 +27,130 @@
 
 namespace hexgon {
 
+PixelFormatInfo GetPixelFormatInfo(PixelFormat format) {
+  switch (format) {
+    case PixelFormat::kA8UNorm:
+      return {1, 1, 1};
+    case PixelFormat::kR8G8B8A8Unorm:
+    case PixelFormat::kB8G8R8A8Unorm:
+      return {1, 1, 4};
+    case PixelFormat::kBC1RGBAUnorm:
+    case PixelFormat::kBC4RUnorm:
+    case PixelFormat::kETC2R8G8B8Unorm:
+      return {4, 4, 8};
+    case PixelFormat::kBC2RGBAUnorm:
+    case PixelFormat::kBC3RGBAUnorm:
+    case PixelFormat::kBC5RGUnorm:
+    case PixelFormat::kBC6HRGBUFloat:
+    case PixelFormat::kBC7RGBAUnorm:
+    case PixelFormat::kETC2R8G8B8A8Unorm:
+    case PixelFormat::kASTC4x4Unorm:
+      return {4, 4, 16};
+    case PixelFormat::kASTC6x6Unorm:
+      return {6, 6, 16};
+    case PixelFormat::kASTC8x8Unorm:
+      return {8, 8, 16};
+    case PixelFormat::kD16Unorm:
+      return {1, 1, 2, true};
+    case PixelFormat::kD32Float:
+    case PixelFormat::kD24UnormS8Uint:
+      // only the depth aspect is copied, packed into 4 bytes
+      return {1, 1, 4, true};
+    default:
+      return {};
+  }
+}
+
 void Texture::UploadData(void* data, size_t len, const TextureRange& range) {
+  if (!CanUpload(range)) {
+    return;
+  }
+
+  OnUploadData(data, len, range);
+}
+
+void Texture::QueueUpdate(const void* data, size_t len, const TextureRange& range) {
+  if (!CanUpload(range)) {
+    return;
+  }
+
+  OnQueueUpdate(data, len, range);
+}
+
+bool Texture::Readback(const TextureRange& range, ReadbackCallback callback) {
+  if (!callback) {
+    return false;
+  }
+
+  if (!(m_desc.usage & TextureUsage::kCopySrc)) {
+    HEX_CORE_ERROR("Texture {} is not created with TextureUsage::kCopySrc.", m_desc.label);
+    return false;
+  }
+
+  if (range.mip_level >= m_desc.mip_levels || range.array_layer >= m_desc.array_layers) {
+    HEX_CORE_ERROR("Readback range mip {} layer {} out of texture {}.", range.mip_level, range.array_layer,
+                   m_desc.label);
+    return false;
+  }
+
+  if (m_desc.sample_count > 1 || m_desc.streaming) {
+    HEX_CORE_ERROR("Texture {} can not be read back, resolve or copy it first.", m_desc.label);
+    return false;
+  }
+
+  return OnReadback(range, std::move(callback));
+}
+
+bool Texture::CanUpload(const TextureRange& range) const {
   if (m_desc.storage != StorageMode::kHostVisible) {
     HEX_CORE_ERROR("Texture with StorageMode::kDevicePrivate can not upload by user.");
+    return false;
+  }
+
+  if (range.mip_level >= m_desc.mip_levels || range.array_layer >= m_desc.array_layers) {
+    HEX_CORE_ERROR("Upload range mip {} layer {} out of texture {}.", range.mip_level, range.array_layer, m_desc.label);
+    return false;
+  }
+
+  if (m_desc.sample_count > 1) {
+    HEX_CORE_ERROR("Multisample texture {} can not upload by user.", m_desc.label);
+    return false;
+  }
+
+  return true;
+}
+
+void Texture::GenerateMipmaps() {
+  if (m_desc.mip_levels <= 1) {
     return;
   }
 
-  OnUploadData(data, len, range);
+  if (m_desc.sample_count > 1) {
+    HEX_CORE_ERROR("Multisample texture {} can not have mipmaps.", m_desc.label);
+    return;
+  }
+
+  OnGenerateMipmaps();
+}
+
+void Texture::RequestMipLevel(uint32_t level) {
+  if (!m_desc.streaming) {
+    return;
+  }
+
+  OnRequestMipLevel(level < m_desc.mip_levels ? level : m_desc.mip_levels - 1);
+}
+
+uint32_t Texture::CalculateMipLevels(uint32_t width, uint32_t height) {
+  uint32_t size = width > height ? width : height;
+  uint32_t levels = 1;
+
+  while (size > 1) {
+    size >>= 1;
+    levels++;
+  }
+
+  return levels;
 }
 
 }  // namespace hexgon
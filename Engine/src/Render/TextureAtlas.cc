@@ -0,0 +1,389 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include <Hexgon/Render/RenderSystem.hpp>
+#include <Hexgon/Render/TextureAtlas.hpp>
+#include <algorithm>
+#include <cstring>
+
+#include "LogPrivate.hpp"
+#include "Render/SkylinePacker.hpp"
+
+namespace hexgon {
+
+TextureAtlas::TextureAtlas(RenderSystem* render_system, TextureAtlasDescriptor desc)
+    : m_render_system(render_system), m_desc(std::move(desc)) {
+  PixelFormatInfo info = GetPixelFormatInfo(m_desc.format);
+
+  if (info.IsCompressed() || info.block_size == 0) {
+    HEX_CORE_ERROR("Texture atlas {} needs an uncompressed pixel format", m_desc.label);
+    return;
+  }
+
+  m_texel_size = info.block_size;
+}
+
+TextureAtlas::~TextureAtlas() = default;
+
+AtlasHandle TextureAtlas::Allocate(uint32_t width, uint32_t height) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (m_texel_size == 0) {
+    return kInvalidHandle;
+  }
+
+  if (width == 0 || height == 0 || width + 2 * m_desc.padding > m_desc.page_width ||
+      height + 2 * m_desc.padding > m_desc.page_height) {
+    HEX_CORE_ERROR("Region {}x{} does not fit into a page of atlas {}", width, height, m_desc.label);
+    return kInvalidHandle;
+  }
+
+  Entry entry{};
+  entry.width = width;
+  entry.height = height;
+
+  if (!Place(entry)) {
+    HEX_CORE_ERROR("Texture atlas {} is full, {} pages in use", m_desc.label, m_pages.size());
+    return kInvalidHandle;
+  }
+
+  entry.live = true;
+
+  AtlasHandle handle;
+  if (!m_free_handles.empty()) {
+    handle = m_free_handles.back();
+    m_free_handles.pop_back();
+    m_entries[handle] = std::move(entry);
+  } else {
+    handle = static_cast<AtlasHandle>(m_entries.size());
+    m_entries.emplace_back(std::move(entry));
+  }
+
+  return handle;
+}
+
+AtlasHandle TextureAtlas::Add(uint32_t width, uint32_t height, const void* data, size_t len) {
+  AtlasHandle handle = Allocate(width, height);
+
+  if (handle != kInvalidHandle && !Update(handle, data, len)) {
+    Free(handle);
+    return kInvalidHandle;
+  }
+
+  return handle;
+}
+
+void TextureAtlas::Free(AtlasHandle handle) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (handle >= m_entries.size() || !m_entries[handle].live) {
+    return;
+  }
+
+  Entry& entry = m_entries[handle];
+  uint32_t padding = m_desc.padding;
+
+  m_pages[entry.page].packer->Release(SkylinePacker::Rect{entry.x - padding, entry.y - padding,
+                                                          entry.width + 2 * padding, entry.height + 2 * padding});
+
+  entry = Entry{};
+  m_free_handles.emplace_back(handle);
+}
+
+bool TextureAtlas::Update(AtlasHandle handle, const void* data, size_t len) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (handle >= m_entries.size() || !m_entries[handle].live) {
+    HEX_CORE_ERROR("Update of an invalid region in texture atlas {}", m_desc.label);
+    return false;
+  }
+
+  Entry& entry = m_entries[handle];
+  size_t size = static_cast<size_t>(entry.width) * entry.height * m_texel_size;
+
+  if (data == nullptr || len < size) {
+    HEX_CORE_ERROR("Region of texture atlas {} needs {} bytes, got {}", m_desc.label, size, len);
+    return false;
+  }
+
+  if (m_desc.keep_cpu_copy) {
+    entry.pixels.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+  }
+
+  return Write(entry, data);
+}
+
+bool TextureAtlas::GetRegion(AtlasHandle handle, AtlasRegion& region) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (handle >= m_entries.size() || !m_entries[handle].live) {
+    return false;
+  }
+
+  region = MakeRegion(m_entries[handle]);
+
+  return true;
+}
+
+uint32_t TextureAtlas::Defragment() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (m_pages.empty()) {
+    return 0;
+  }
+
+  if (!m_desc.keep_cpu_copy) {
+    HEX_CORE_ERROR("Texture atlas {} is created without keep_cpu_copy and can not defragment", m_desc.label);
+    return 0;
+  }
+
+  std::vector<AtlasHandle> order;
+  for (AtlasHandle i = 0; i < m_entries.size(); i++) {
+    if (m_entries[i].live) {
+      order.emplace_back(i);
+    }
+  }
+
+  // tallest first packs the skyline tightest
+  std::sort(order.begin(), order.end(), [this](AtlasHandle a, AtlasHandle b) {
+    const Entry& ea = m_entries[a];
+    const Entry& eb = m_entries[b];
+    return ea.height != eb.height ? ea.height > eb.height : ea.width > eb.width;
+  });
+
+  // pack into fresh packers first so a failed repack leaves the atlas untouched
+  std::vector<std::unique_ptr<SkylinePacker>> packers;
+  std::vector<SkylinePacker::Rect> slots(order.size());
+  std::vector<uint32_t> slot_pages(order.size());
+  uint32_t padding = m_desc.padding;
+
+  for (size_t i = 0; i < order.size(); i++) {
+    const Entry& entry = m_entries[order[i]];
+    uint32_t width = entry.width + 2 * padding;
+    uint32_t height = entry.height + 2 * padding;
+
+    bool placed = false;
+    for (size_t p = 0; p < packers.size() && !placed; p++) {
+      if (packers[p]->Insert(width, height, slots[i])) {
+        slot_pages[i] = static_cast<uint32_t>(p);
+        placed = true;
+      }
+    }
+
+    if (!placed) {
+      if (packers.size() >= m_desc.max_pages) {
+        HEX_CORE_WARN("Texture atlas {} can not be repacked into {} pages", m_desc.label, m_desc.max_pages);
+        return 0;
+      }
+
+      packers.emplace_back(std::make_unique<SkylinePacker>());
+      packers.back()->Reset(m_desc.page_width, m_desc.page_height);
+      packers.back()->Insert(width, height, slots[i]);
+      slot_pages[i] = static_cast<uint32_t>(packers.size() - 1);
+    }
+  }
+
+  while (m_pages.size() < packers.size()) {
+    if (!AddPage()) {
+      return 0;
+    }
+  }
+
+  // pages left empty at the end are dropped, their textures die with the last outside reference
+  m_pages.resize(std::max<size_t>(packers.size(), 1));
+
+  for (size_t p = 0; p < m_pages.size(); p++) {
+    if (p < packers.size()) {
+      m_pages[p].packer = std::move(packers[p]);
+    } else {
+      m_pages[p].packer->Reset(m_desc.page_width, m_desc.page_height);
+    }
+  }
+
+  uint32_t moved = 0;
+
+  for (size_t i = 0; i < order.size(); i++) {
+    Entry& entry = m_entries[order[i]];
+    uint32_t x = slots[i].x + padding;
+    uint32_t y = slots[i].y + padding;
+
+    if (entry.page == slot_pages[i] && entry.x == x && entry.y == y) {
+      continue;
+    }
+
+    entry.page = slot_pages[i];
+    entry.x = x;
+    entry.y = y;
+    moved++;
+
+    if (!entry.pixels.empty()) {
+      Write(entry, entry.pixels.data());
+    }
+  }
+
+  if (moved > 0) {
+    m_version++;
+  }
+
+  return moved;
+}
+
+uint64_t TextureAtlas::GetVersion() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_version;
+}
+
+uint32_t TextureAtlas::GetPageCount() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return static_cast<uint32_t>(m_pages.size());
+}
+
+std::shared_ptr<Texture> TextureAtlas::GetPage(uint32_t index) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (index >= m_pages.size()) {
+    return nullptr;
+  }
+
+  return m_pages[index].texture;
+}
+
+float TextureAtlas::GetOccupancy() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (m_pages.empty()) {
+    return 0.f;
+  }
+
+  uint64_t used = 0;
+  for (const Page& page : m_pages) {
+    used += page.packer->GetUsedArea();
+  }
+
+  uint64_t total = static_cast<uint64_t>(m_desc.page_width) * m_desc.page_height * m_pages.size();
+
+  return static_cast<float>(static_cast<double>(used) / static_cast<double>(total));
+}
+
+bool TextureAtlas::AddPage() {
+  if (m_pages.size() >= m_desc.max_pages) {
+    return false;
+  }
+
+  TextureDescriptor desc{};
+  desc.label = m_desc.label + " page " + std::to_string(m_pages.size());
+  desc.format = m_desc.format;
+  desc.usage = TextureUsage::kShaderRead | TextureUsage::kCopyDst;
+  desc.width = m_desc.page_width;
+  desc.height = m_desc.page_height;
+
+  auto texture = m_render_system->CreateTexture(desc);
+  if (!texture) {
+    HEX_CORE_ERROR("Failed to create page {} of texture atlas {}", m_pages.size(), m_desc.label);
+    return false;
+  }
+
+  Page page{};
+  page.texture = std::move(texture);
+  page.packer = std::make_unique<SkylinePacker>();
+  page.packer->Reset(m_desc.page_width, m_desc.page_height);
+
+  m_pages.emplace_back(std::move(page));
+
+  return true;
+}
+
+bool TextureAtlas::Place(Entry& entry) {
+  uint32_t padding = m_desc.padding;
+  uint32_t width = entry.width + 2 * padding;
+  uint32_t height = entry.height + 2 * padding;
+
+  SkylinePacker::Rect slot{};
+
+  for (size_t p = 0;; p++) {
+    if (p == m_pages.size() && !AddPage()) {
+      return false;
+    }
+
+    if (m_pages[p].packer->Insert(width, height, slot)) {
+      entry.page = static_cast<uint32_t>(p);
+      entry.x = slot.x + padding;
+      entry.y = slot.y + padding;
+      return true;
+    }
+  }
+}
+
+bool TextureAtlas::Write(const Entry& entry, const void* data) {
+  uint32_t padding = m_desc.padding;
+  uint32_t width = entry.width + 2 * padding;
+  uint32_t height = entry.height + 2 * padding;
+
+  const auto* src = static_cast<const uint8_t*>(data);
+  std::vector<uint8_t> padded(static_cast<size_t>(width) * height * m_texel_size);
+
+  // clamp to edge, every padding texel repeats the closest texel of the region
+  for (uint32_t y = 0; y < height; y++) {
+    uint32_t sy = std::min(std::max(y, padding) - padding, entry.height - 1);
+    const uint8_t* src_row = src + static_cast<size_t>(sy) * entry.width * m_texel_size;
+    uint8_t* dst_row = padded.data() + static_cast<size_t>(y) * width * m_texel_size;
+
+    for (uint32_t x = 0; x < padding; x++) {
+      std::memcpy(dst_row + x * m_texel_size, src_row, m_texel_size);
+      std::memcpy(dst_row + (padding + entry.width + x) * m_texel_size,
+                  src_row + (entry.width - 1) * m_texel_size, m_texel_size);
+    }
+
+    std::memcpy(dst_row + padding * m_texel_size, src_row, static_cast<size_t>(entry.width) * m_texel_size);
+  }
+
+  TextureRange range{};
+  range.x = entry.x - padding;
+  range.y = entry.y - padding;
+  range.width = width;
+  range.height = height;
+
+  m_pages[entry.page].texture->QueueUpdate(padded.data(), padded.size(), range);
+
+  return true;
+}
+
+AtlasRegion TextureAtlas::MakeRegion(const Entry& entry) const {
+  auto page_width = static_cast<float>(m_desc.page_width);
+  auto page_height = static_cast<float>(m_desc.page_height);
+
+  AtlasRegion region{};
+  region.page = entry.page;
+  region.x = entry.x;
+  region.y = entry.y;
+  region.width = entry.width;
+  region.height = entry.height;
+  region.u0 = static_cast<float>(entry.x) / page_width;
+  region.v0 = static_cast<float>(entry.y) / page_height;
+  region.u1 = static_cast<float>(entry.x + entry.width) / page_width;
+  region.v1 = static_cast<float>(entry.y + entry.height) / page_height;
+
+  return region;
+}
+
+}  // namespace hexgon
@@ -0,0 +1,207 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include "Render/Vulkan/BindlessTableVk.hpp"
+
+#include <algorithm>
+
+#include "LogPrivate.hpp"
+#include "Render/Vulkan/DispatchVk.hpp"
+
+namespace hexgon {
+
+std::vector<SamplerDescriptor> BindlessTextureTableVk::StaticSamplers() {
+  std::vector<SamplerDescriptor> samplers(kStaticSamplerCount);
+
+  samplers[kLinearRepeat].max_anisotropy = 16.f;
+
+  samplers[kLinearClamp].address_u = AddressMode::kClampToEdge;
+  samplers[kLinearClamp].address_v = AddressMode::kClampToEdge;
+  samplers[kLinearClamp].address_w = AddressMode::kClampToEdge;
+
+  samplers[kNearestRepeat].mag_filter = FilterMode::kNearest;
+  samplers[kNearestRepeat].min_filter = FilterMode::kNearest;
+  samplers[kNearestRepeat].mipmap_mode = MipmapMode::kNearest;
+
+  samplers[kNearestClamp] = samplers[kNearestRepeat];
+  samplers[kNearestClamp].address_u = AddressMode::kClampToEdge;
+  samplers[kNearestClamp].address_v = AddressMode::kClampToEdge;
+  samplers[kNearestClamp].address_w = AddressMode::kClampToEdge;
+
+  samplers[kShadowCompare] = samplers[kLinearClamp];
+  samplers[kShadowCompare].compare_enable = true;
+  samplers[kShadowCompare].compare = CompareFunction::kLessEqual;
+
+  return samplers;
+}
+
+bool BindlessTextureTableVk::Init(VkDevice device, uint32_t max_textures, const std::vector<VkSampler>& samplers) {
+  m_device = device;
+  m_capacity = max_textures;
+
+  if (samplers.size() != kStaticSamplerCount ||
+      std::find(samplers.begin(), samplers.end(), VK_NULL_HANDLE) != samplers.end()) {
+    HEX_CORE_ERROR("Bindless texture table is missing its static samplers.");
+    return false;
+  }
+
+  // the variable sized array has to be the last binding
+  VkDescriptorSetLayoutBinding bindings[2] = {};
+  bindings[0].binding = 0;
+  bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+  bindings[0].descriptorCount = kStaticSamplerCount;
+  bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+  bindings[0].pImmutableSamplers = samplers.data();
+
+  bindings[1].binding = kTextureBinding;
+  bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+  bindings[1].descriptorCount = m_capacity;
+  bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+
+  VkDescriptorBindingFlags binding_flags[2] = {
+      0,
+      VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+          VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT,
+  };
+
+  VkDescriptorSetLayoutBindingFlagsCreateInfo flags_info{
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO};
+  flags_info.bindingCount = 2;
+  flags_info.pBindingFlags = binding_flags;
+
+  VkDescriptorSetLayoutCreateInfo layout_info{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+  layout_info.pNext = &flags_info;
+  layout_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+  layout_info.bindingCount = 2;
+  layout_info.pBindings = bindings;
+
+  if (g_vk.vkCreateDescriptorSetLayout(m_device, &layout_info, nullptr, &m_layout) != VK_SUCCESS) {
+    HEX_CORE_ERROR("Failed create bindless texture set layout.");
+    return false;
+  }
+
+  VkDescriptorPoolSize pool_sizes[2] = {
+      {VK_DESCRIPTOR_TYPE_SAMPLER, kStaticSamplerCount},
+      {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, m_capacity},
+  };
+
+  VkDescriptorPoolCreateInfo pool_info{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+  pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+  pool_info.maxSets = 1;
+  pool_info.poolSizeCount = 2;
+  pool_info.pPoolSizes = pool_sizes;
+
+  if (g_vk.vkCreateDescriptorPool(m_device, &pool_info, nullptr, &m_pool) != VK_SUCCESS) {
+    HEX_CORE_ERROR("Failed create bindless texture descriptor pool.");
+    return false;
+  }
+
+  VkDescriptorSetVariableDescriptorCountAllocateInfo count_info{
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO};
+  count_info.descriptorSetCount = 1;
+  count_info.pDescriptorCounts = &m_capacity;
+
+  VkDescriptorSetAllocateInfo alloc_info{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+  alloc_info.pNext = &count_info;
+  alloc_info.descriptorPool = m_pool;
+  alloc_info.descriptorSetCount = 1;
+  alloc_info.pSetLayouts = &m_layout;
+
+  if (g_vk.vkAllocateDescriptorSets(m_device, &alloc_info, &m_set) != VK_SUCCESS) {
+    HEX_CORE_ERROR("Failed allocate bindless texture descriptor set.");
+    return false;
+  }
+
+  HEX_CORE_INFO("Bindless texture table enabled with {} slots.", m_capacity);
+
+  return true;
+}
+
+void BindlessTextureTableVk::Destroy() {
+  if (m_pool) {
+    g_vk.vkDestroyDescriptorPool(m_device, m_pool, nullptr);
+    m_pool = VK_NULL_HANDLE;
+    m_set = VK_NULL_HANDLE;
+  }
+
+  if (m_layout) {
+    g_vk.vkDestroyDescriptorSetLayout(m_device, m_layout, nullptr);
+    m_layout = VK_NULL_HANDLE;
+  }
+
+  m_free_indices.clear();
+  m_next_index = 0;
+}
+
+uint32_t BindlessTextureTableVk::Register(VkImageView view, VkImageLayout layout) {
+  // the descriptor set is externally synchronized, so writes happen under the same lock as the slot allocation
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  uint32_t index = kInvalidIndex;
+  if (!m_free_indices.empty()) {
+    index = m_free_indices.back();
+    m_free_indices.pop_back();
+  } else if (m_next_index < m_capacity) {
+    index = m_next_index++;
+  }
+
+  if (index == kInvalidIndex) {
+    HEX_CORE_ERROR("Bindless texture table is full ({} slots).", m_capacity);
+    return index;
+  }
+
+  Write(index, view, layout);
+
+  return index;
+}
+
+void BindlessTextureTableVk::Unregister(uint32_t index) {
+  if (index >= m_capacity) {
+    return;
+  }
+
+  // the slot is left partially bound, shaders must not sample it until it is registered again. Callers release slots
+  // through GpuResourceDelegateVk::OnReleaseLater, frames in flight may still sample them
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_free_indices.emplace_back(index);
+}
+
+void BindlessTextureTableVk::Write(uint32_t index, VkImageView view, VkImageLayout layout) {
+  VkDescriptorImageInfo image_info{};
+  image_info.imageView = view;
+  image_info.imageLayout = layout;
+
+  VkWriteDescriptorSet write{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+  write.dstSet = m_set;
+  write.dstBinding = kTextureBinding;
+  write.dstArrayElement = index;
+  write.descriptorCount = 1;
+  write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+  write.pImageInfo = &image_info;
+
+  // update after bind allows writing slots while the set is bound in a recording command buffer, update unused while
+  // pending writing slots no submitted frame uses while those frames are still running
+  g_vk.vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+}
+
+}  // namespace hexgon
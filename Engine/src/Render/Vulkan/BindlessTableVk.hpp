@@ -0,0 +1,88 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <Hexgon/Render/Sampler.hpp>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace hexgon {
+
+// One global descriptor set holding a variable sized array of sampled images (descriptor indexing).
+// Materials reference a texture by the index returned from Register(), so draws never rebind descriptor sets for
+// textures. The samplers of StaticSamplers() are immutable samplers of the same set. Shader side declares:
+//   layout(set = 0, binding = 0) uniform sampler g_samplers[kStaticSamplerCount];
+//   layout(set = 0, binding = 1) uniform texture2D g_textures[];
+class BindlessTextureTableVk {
+ public:
+  static constexpr uint32_t kInvalidIndex = UINT32_MAX;
+  static constexpr uint32_t kTextureBinding = 1;
+
+  // index into g_samplers
+  enum StaticSampler : uint32_t {
+    kLinearRepeat,
+    kLinearClamp,
+    kNearestRepeat,
+    kNearestClamp,
+    kShadowCompare,
+    kStaticSamplerCount,
+  };
+
+  BindlessTextureTableVk() = default;
+
+  static std::vector<SamplerDescriptor> StaticSamplers();
+
+  // `samplers` must hold kStaticSamplerCount samplers in StaticSampler order and outlive the table
+  bool Init(VkDevice device, uint32_t max_textures, const std::vector<VkSampler>& samplers);
+
+  void Destroy();
+
+  uint32_t Register(VkImageView view, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+  void Unregister(uint32_t index);
+
+  VkDescriptorSetLayout GetLayout() const { return m_layout; }
+
+  VkDescriptorSet GetSet() const { return m_set; }
+
+  uint32_t GetCapacity() const { return m_capacity; }
+
+ private:
+  void Write(uint32_t index, VkImageView view, VkImageLayout layout);
+
+ private:
+  VkDevice m_device = {};
+  VkDescriptorSetLayout m_layout = {};
+  VkDescriptorPool m_pool = {};
+  VkDescriptorSet m_set = {};
+  uint32_t m_capacity = {};
+  uint32_t m_next_index = {};
+  std::vector<uint32_t> m_free_indices = {};
+  std::mutex m_mutex = {};
+};
+
+}  // namespace hexgon
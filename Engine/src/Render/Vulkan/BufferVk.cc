@@ -0,0 +1,41 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include "Render/Vulkan/BufferVk.hpp"
+
+namespace hexgon {
+
+BufferVk::BufferVk(VkBuffer buffer, VkDeviceMemory memory, VkDeviceSize size, void* mapped)
+    : GpuResourceVk(), m_buffer(buffer), m_memory(memory), m_size(size), m_mapped(mapped) {}
+
+BufferVk::~BufferVk() { ReleaseHandles(); }
+
+void BufferVk::ReleaseHandles() {
+  // memory is unmapped implicitly when it is freed
+  m_mapped = nullptr;
+
+  ReleaseLater(VK_OBJECT_TYPE_BUFFER, m_buffer);
+  ReleaseLater(VK_OBJECT_TYPE_DEVICE_MEMORY, m_memory);
+}
+
+}  // namespace hexgon
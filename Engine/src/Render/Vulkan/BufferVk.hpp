@@ -0,0 +1,54 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "Render/Vulkan/GpuResourceVk.hpp"
+
+namespace hexgon {
+
+class BufferVk : public GpuResourceVk {
+ public:
+  BufferVk(VkBuffer buffer, VkDeviceMemory memory, VkDeviceSize size, void* mapped);
+
+  ~BufferVk() override;
+
+  VkBuffer GetBuffer() const { return m_buffer; }
+
+  VkDeviceSize GetSize() const { return m_size; }
+
+  // nullptr if buffer is not host visible
+  void* GetMappedData() const { return m_mapped; }
+
+  void ReleaseHandles() override;
+
+ private:
+  VkBuffer m_buffer;
+  VkDeviceMemory m_memory;
+  VkDeviceSize m_size;
+  void* m_mapped;
+};
+
+}  // namespace hexgon
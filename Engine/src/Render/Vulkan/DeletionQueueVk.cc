@@ -0,0 +1,135 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include "Render/Vulkan/DeletionQueueVk.hpp"
+
+#include <algorithm>
+
+#include "LogPrivate.hpp"
+#include "Render/Vulkan/DispatchVk.hpp"
+
+namespace hexgon {
+
+namespace {
+
+template <typename T>
+T CastHandle(uint64_t handle) {
+  return reinterpret_cast<T>(handle);
+}
+
+}  // namespace
+
+void DeletionQueueVk::Push(uint64_t frame, VkObjectType type, uint64_t handle) {
+  if (handle == 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.emplace_back(Entry{frame, type, handle});
+}
+
+void DeletionQueueVk::Push(uint64_t frame, std::function<void()> release) {
+  if (!release) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.emplace_back(Entry{frame, VK_OBJECT_TYPE_UNKNOWN, 0, std::move(release)});
+}
+
+void DeletionQueueVk::Collect(uint64_t completed_frame) {
+  std::vector<Entry> ready{};
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // entries are pushed in frame order, an entry stuck behind a newer one only waits a little longer
+    auto it = std::find_if(m_entries.begin(), m_entries.end(),
+                           [completed_frame](Entry const& entry) { return entry.frame > completed_frame; });
+
+    ready.assign(m_entries.begin(), it);
+    m_entries.erase(m_entries.begin(), it);
+  }
+
+  for (auto const& entry : ready) {
+    Destroy(entry);
+  }
+}
+
+void DeletionQueueVk::Flush() {
+  std::vector<Entry> ready{};
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ready.swap(m_entries);
+  }
+
+  for (auto const& entry : ready) {
+    Destroy(entry);
+  }
+}
+
+size_t DeletionQueueVk::GetPendingCount() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_entries.size();
+}
+
+void DeletionQueueVk::Destroy(const Entry& entry) {
+  if (entry.release) {
+    entry.release();
+    return;
+  }
+
+  switch (entry.type) {
+    case VK_OBJECT_TYPE_IMAGE:
+      g_vk.vkDestroyImage(m_device, CastHandle<VkImage>(entry.handle), nullptr);
+      break;
+    case VK_OBJECT_TYPE_IMAGE_VIEW:
+      g_vk.vkDestroyImageView(m_device, CastHandle<VkImageView>(entry.handle), nullptr);
+      break;
+    case VK_OBJECT_TYPE_BUFFER:
+      g_vk.vkDestroyBuffer(m_device, CastHandle<VkBuffer>(entry.handle), nullptr);
+      break;
+    case VK_OBJECT_TYPE_DEVICE_MEMORY:
+      g_vk.vkFreeMemory(m_device, CastHandle<VkDeviceMemory>(entry.handle), nullptr);
+      break;
+    case VK_OBJECT_TYPE_SAMPLER:
+      g_vk.vkDestroySampler(m_device, CastHandle<VkSampler>(entry.handle), nullptr);
+      break;
+    case VK_OBJECT_TYPE_FRAMEBUFFER:
+      g_vk.vkDestroyFramebuffer(m_device, CastHandle<VkFramebuffer>(entry.handle), nullptr);
+      break;
+    case VK_OBJECT_TYPE_RENDER_PASS:
+      g_vk.vkDestroyRenderPass(m_device, CastHandle<VkRenderPass>(entry.handle), nullptr);
+      break;
+    case VK_OBJECT_TYPE_PIPELINE:
+      g_vk.vkDestroyPipeline(m_device, CastHandle<VkPipeline>(entry.handle), nullptr);
+      break;
+    case VK_OBJECT_TYPE_DESCRIPTOR_POOL:
+      g_vk.vkDestroyDescriptorPool(m_device, CastHandle<VkDescriptorPool>(entry.handle), nullptr);
+      break;
+    default:
+      HEX_CORE_ERROR("DeletionQueue: unsupported object type {}.", static_cast<int32_t>(entry.type));
+      break;
+  }
+}
+
+}  // namespace hexgon
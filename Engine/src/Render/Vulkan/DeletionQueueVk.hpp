@@ -0,0 +1,73 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace hexgon {
+
+// Vulkan objects released at runtime are parked here until the GPU finished the frame they were released in.
+// Destroying a resource never waits for the device this way.
+class DeletionQueueVk {
+ public:
+  DeletionQueueVk() = default;
+
+  void Init(VkDevice device) { m_device = device; }
+
+  // `frame` is the frame being recorded on the CPU when the object was released
+  void Push(uint64_t frame, VkObjectType type, uint64_t handle);
+
+  // anything that is not a vulkan object, e.g. a slot of a descriptor array, called on the thread collecting it
+  void Push(uint64_t frame, std::function<void()> release);
+
+  // destroy everything released in frames up to and including `completed_frame`
+  void Collect(uint64_t completed_frame);
+
+  // destroy everything, device must be idle
+  void Flush();
+
+  size_t GetPendingCount();
+
+ private:
+  struct Entry {
+    uint64_t frame = 0;
+    VkObjectType type = VK_OBJECT_TYPE_UNKNOWN;
+    uint64_t handle = 0;
+    std::function<void()> release = {};
+  };
+
+  void Destroy(Entry const& entry);
+
+ private:
+  VkDevice m_device = {};
+  std::mutex m_mutex = {};
+  std::vector<Entry> m_entries = {};
+};
+
+}  // namespace hexgon
@@ -0,0 +1,319 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include "Render/Vulkan/DescriptorAllocatorVk.hpp"
+
+#include <algorithm>
+#include <functional>
+
+#include "Core/Util/HashCombine.hpp"
+#include "LogPrivate.hpp"
+#include "Render/Vulkan/DispatchVk.hpp"
+#include "Render/Vulkan/GpuResourceVk.hpp"
+
+namespace hexgon {
+
+namespace {
+
+constexpr uint32_t kMaxSetsPerPool = 4096;
+
+}  // namespace
+
+void DescriptorAllocatorVk::Init(VkDevice device, uint32_t initial_sets, std::vector<DescriptorPoolSizeRatio> ratios,
+                                 VkDescriptorPoolCreateFlags flags) {
+  m_device = device;
+  m_flags = flags;
+  m_ratios = std::move(ratios);
+  m_sets_per_pool = std::max(initial_sets, 1u);
+}
+
+VkDescriptorSet DescriptorAllocatorVk::Allocate(VkDescriptorSetLayout layout, uint32_t variable_count) {
+  if (!m_current_pool) {
+    m_current_pool = GrabPool();
+
+    if (!m_current_pool) {
+      HEX_CORE_ERROR("Failed allocate descriptor set, no descriptor pool.");
+      return VK_NULL_HANDLE;
+    }
+  }
+
+  VkDescriptorSetAllocateInfo info{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+  info.descriptorPool = m_current_pool;
+  info.descriptorSetCount = 1;
+  info.pSetLayouts = &layout;
+
+  VkDescriptorSetVariableDescriptorCountAllocateInfo variable_info{
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO};
+  if (variable_count > 0) {
+    variable_info.descriptorSetCount = 1;
+    variable_info.pDescriptorCounts = &variable_count;
+
+    info.pNext = &variable_info;
+  }
+
+  VkDescriptorSet set = {};
+  VkResult result = g_vk.vkAllocateDescriptorSets(m_device, &info, &set);
+
+  if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+    // current pool is exhausted, move on to the next one in chain
+    m_full_pools.emplace_back(m_current_pool);
+    m_current_pool = GrabPool();
+
+    if (!m_current_pool) {
+      HEX_CORE_ERROR("Failed allocate descriptor set, no descriptor pool.");
+      return VK_NULL_HANDLE;
+    }
+
+    info.descriptorPool = m_current_pool;
+    result = g_vk.vkAllocateDescriptorSets(m_device, &info, &set);
+  }
+
+  if (result != VK_SUCCESS) {
+    HEX_CORE_ERROR("Failed allocate descriptor set.");
+    return VK_NULL_HANDLE;
+  }
+
+  return set;
+}
+
+void DescriptorAllocatorVk::Reset() {
+  if (m_current_pool) {
+    m_full_pools.emplace_back(m_current_pool);
+    m_current_pool = VK_NULL_HANDLE;
+  }
+
+  for (auto pool : m_full_pools) {
+    g_vk.vkResetDescriptorPool(m_device, pool, 0);
+    m_ready_pools.emplace_back(pool);
+  }
+
+  m_full_pools.clear();
+}
+
+void DescriptorAllocatorVk::Destroy() {
+  if (m_current_pool) {
+    m_full_pools.emplace_back(m_current_pool);
+    m_current_pool = VK_NULL_HANDLE;
+  }
+
+  for (auto pool : m_full_pools) {
+    g_vk.vkDestroyDescriptorPool(m_device, pool, nullptr);
+  }
+
+  for (auto pool : m_ready_pools) {
+    g_vk.vkDestroyDescriptorPool(m_device, pool, nullptr);
+  }
+
+  m_full_pools.clear();
+  m_ready_pools.clear();
+}
+
+std::vector<DescriptorPoolSizeRatio> DescriptorAllocatorVk::DefaultRatios() {
+  return {
+      {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.f},
+      {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f},
+      {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.f},
+      {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.f},
+      {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.f},
+      {VK_DESCRIPTOR_TYPE_SAMPLER, 1.f},
+      {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.f},
+  };
+}
+
+VkDescriptorPool DescriptorAllocatorVk::GrabPool() {
+  if (!m_ready_pools.empty()) {
+    auto pool = m_ready_pools.back();
+    m_ready_pools.pop_back();
+    return pool;
+  }
+
+  auto pool = CreatePool(m_sets_per_pool);
+
+  // next pool is bigger, so a busy frame only needs a few pools after warming up
+  m_sets_per_pool = std::min(m_sets_per_pool + m_sets_per_pool / 2, kMaxSetsPerPool);
+
+  return pool;
+}
+
+VkDescriptorPool DescriptorAllocatorVk::CreatePool(uint32_t set_count) {
+  std::vector<VkDescriptorPoolSize> sizes{};
+  sizes.reserve(m_ratios.size());
+
+  for (auto const& ratio : m_ratios) {
+    sizes.emplace_back(VkDescriptorPoolSize{ratio.type, std::max(static_cast<uint32_t>(ratio.ratio * set_count), 1u)});
+  }
+
+  VkDescriptorPoolCreateInfo info{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+  info.flags = m_flags;
+  info.maxSets = set_count;
+  info.poolSizeCount = static_cast<uint32_t>(sizes.size());
+  info.pPoolSizes = sizes.data();
+
+  VkDescriptorPool pool = {};
+  if (g_vk.vkCreateDescriptorPool(m_device, &info, nullptr, &pool) != VK_SUCCESS) {
+    HEX_CORE_ERROR("Failed create descriptor pool with {} sets.", set_count);
+    return VK_NULL_HANDLE;
+  }
+
+  return pool;
+}
+
+bool DescriptorBindingVk::operator==(const DescriptorBindingVk& other) const {
+  return binding == other.binding && type == other.type && image.sampler == other.image.sampler &&
+         image.imageView == other.image.imageView && image.imageLayout == other.image.imageLayout &&
+         buffer.buffer == other.buffer.buffer && buffer.offset == other.buffer.offset &&
+         buffer.range == other.buffer.range;
+}
+
+void DescriptorSetCacheVk::Init(VkDevice device, GpuResourceDelegateVk* delegate) {
+  m_device = device;
+  m_delegate = delegate;
+  m_allocator.Init(device, 64, DescriptorAllocatorVk::DefaultRatios());
+}
+
+VkDescriptorSet DescriptorSetCacheVk::GetOrCreate(VkDescriptorSetLayout layout,
+                                                  const std::vector<DescriptorBindingVk>& bindings) {
+  Key key{layout, bindings};
+
+  std::sort(key.bindings.begin(), key.bindings.end(),
+            [](DescriptorBindingVk const& a, DescriptorBindingVk const& b) { return a.binding < b.binding; });
+
+  // textures evict their views from any thread
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto it = m_sets.find(key);
+  if (it != m_sets.end()) {
+    return it->second;
+  }
+
+  VkDescriptorSet set = VK_NULL_HANDLE;
+
+  // every binding of the key is written below, a recycled set of the same layout is as good as a new one
+  auto free_sets = m_free_sets.find(layout);
+  if (free_sets != m_free_sets.end() && !free_sets->second.empty()) {
+    set = free_sets->second.back();
+    free_sets->second.pop_back();
+  } else {
+    set = m_allocator.Allocate(layout);
+  }
+
+  if (!set) {
+    return VK_NULL_HANDLE;
+  }
+
+  std::vector<VkWriteDescriptorSet> writes{};
+  writes.reserve(key.bindings.size());
+
+  for (auto const& binding : key.bindings) {
+    VkWriteDescriptorSet write{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write.dstSet = set;
+    write.dstBinding = binding.binding;
+    write.descriptorCount = 1;
+    write.descriptorType = binding.type;
+
+    switch (binding.type) {
+      case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+      case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+      case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+      case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+        write.pBufferInfo = &binding.buffer;
+        break;
+      default:
+        write.pImageInfo = &binding.image;
+        break;
+    }
+
+    writes.emplace_back(write);
+  }
+
+  g_vk.vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+  m_sets.emplace(std::move(key), set);
+
+  return set;
+}
+
+void DescriptorSetCacheVk::Evict(VkImageView view) {
+  if (!view) {
+    return;
+  }
+
+  std::vector<std::pair<VkDescriptorSetLayout, VkDescriptorSet>> evicted{};
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto it = m_sets.begin(); it != m_sets.end();) {
+      auto const& bindings = it->first.bindings;
+      bool uses_view = std::any_of(bindings.begin(), bindings.end(), [view](DescriptorBindingVk const& binding) {
+        return binding.image.imageView == view;
+      });
+
+      if (uses_view) {
+        evicted.emplace_back(it->first.layout, it->second);
+        it = m_sets.erase(it);
+      } else {
+        it++;
+      }
+    }
+  }
+
+  if (evicted.empty() || !m_delegate) {
+    return;
+  }
+
+  m_delegate->OnReleaseLater([this, evicted]() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto const& it : evicted) {
+      m_free_sets[it.first].emplace_back(it.second);
+    }
+  });
+}
+
+void DescriptorSetCacheVk::Destroy() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_sets.clear();
+  m_free_sets.clear();
+  m_allocator.Destroy();
+}
+
+size_t DescriptorSetCacheVk::KeyHash::operator()(const Key& key) const {
+  size_t seed = 0;
+
+  HashCombine(seed, reinterpret_cast<uint64_t>(key.layout));
+
+  for (auto const& binding : key.bindings) {
+    HashCombine(seed, binding.binding);
+    HashCombine(seed, static_cast<uint32_t>(binding.type));
+    HashCombine(seed, reinterpret_cast<uint64_t>(binding.image.imageView));
+    HashCombine(seed, reinterpret_cast<uint64_t>(binding.image.sampler));
+    HashCombine(seed, reinterpret_cast<uint64_t>(binding.buffer.buffer));
+    HashCombine(seed, binding.buffer.offset);
+    HashCombine(seed, binding.buffer.range);
+  }
+
+  return seed;
+}
+
+}  // namespace hexgon
@@ -0,0 +1,125 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace hexgon {
+
+class GpuResourceDelegateVk;
+
+struct DescriptorPoolSizeRatio {
+  VkDescriptorType type = {};
+  float ratio = 1.f;
+};
+
+// Hands out descriptor sets from a chain of VkDescriptorPool. When the current pool runs out a new one is grabbed (or
+// created, each one bigger than the last), and Reset() recycles every pool at once instead of freeing sets one by one.
+class DescriptorAllocatorVk {
+ public:
+  DescriptorAllocatorVk() = default;
+
+  void Init(VkDevice device, uint32_t initial_sets, std::vector<DescriptorPoolSizeRatio> ratios,
+            VkDescriptorPoolCreateFlags flags = 0);
+
+  VkDescriptorSet Allocate(VkDescriptorSetLayout layout, uint32_t variable_count = 0);
+
+  // all sets allocated from this allocator are invalid after reset
+  void Reset();
+
+  void Destroy();
+
+  static std::vector<DescriptorPoolSizeRatio> DefaultRatios();
+
+ private:
+  VkDescriptorPool GrabPool();
+
+  VkDescriptorPool CreatePool(uint32_t set_count);
+
+ private:
+  VkDevice m_device = {};
+  VkDescriptorPoolCreateFlags m_flags = {};
+  std::vector<DescriptorPoolSizeRatio> m_ratios = {};
+  uint32_t m_sets_per_pool = {};
+  VkDescriptorPool m_current_pool = {};
+  std::vector<VkDescriptorPool> m_ready_pools = {};
+  std::vector<VkDescriptorPool> m_full_pools = {};
+};
+
+struct DescriptorBindingVk {
+  uint32_t binding = {};
+  VkDescriptorType type = {};
+  VkDescriptorImageInfo image = {};
+  VkDescriptorBufferInfo buffer = {};
+
+  bool operator==(const DescriptorBindingVk& other) const;
+};
+
+// Descriptor sets whose content never changes (material textures, static uniform buffers ...) are created once and
+// shared by every user asking for the same layout and bindings. Evicted sets are reused for the same layout once the
+// frames in flight are done with them.
+class DescriptorSetCacheVk {
+ public:
+  DescriptorSetCacheVk() = default;
+
+  // `delegate` defers the reuse of evicted sets
+  void Init(VkDevice device, GpuResourceDelegateVk* delegate);
+
+  VkDescriptorSet GetOrCreate(VkDescriptorSetLayout layout, const std::vector<DescriptorBindingVk>& bindings);
+
+  // forget every set referencing `view` before the view is destroyed or replaced. Command buffers in flight may still
+  // use the sets, they are handed out again after those are done.
+  void Evict(VkImageView view);
+
+  size_t GetSetCount() const { return m_sets.size(); }
+
+  void Destroy();
+
+ private:
+  struct Key {
+    VkDescriptorSetLayout layout = {};
+    std::vector<DescriptorBindingVk> bindings = {};
+
+    bool operator==(const Key& other) const { return layout == other.layout && bindings == other.bindings; }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const;
+  };
+
+ private:
+  VkDevice m_device = {};
+  GpuResourceDelegateVk* m_delegate = nullptr;
+  DescriptorAllocatorVk m_allocator = {};
+  std::mutex m_mutex = {};
+  std::unordered_map<Key, VkDescriptorSet, KeyHash> m_sets = {};
+  std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>> m_free_sets = {};
+};
+
+}  // namespace hexgon
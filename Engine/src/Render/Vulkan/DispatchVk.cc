@@ -0,0 +1,81 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include "Render/Vulkan/DispatchVk.hpp"
+
+#include "LogPrivate.hpp"
+
+namespace hexgon {
+
+DispatchVk g_vk = {};
+
+bool DispatchVk::LoadInstance(VkInstance instance) {
+  bool ret = true;
+
+#define HEX_VK_LOAD_FUNCTION(name)                                             \
+  name = reinterpret_cast<PFN_##name>(vkGetInstanceProcAddr(instance, #name)); \
+  if (!name) {                                                                 \
+    HEX_CORE_ERROR("Missing vulkan instance function {}.", #name);             \
+    ret = false;                                                               \
+  }
+  HEX_VK_INSTANCE_FUNCTIONS(HEX_VK_LOAD_FUNCTION)
+#undef HEX_VK_LOAD_FUNCTION
+
+  vkCreateDebugReportCallbackEXT = reinterpret_cast<PFN_vkCreateDebugReportCallbackEXT>(
+      vkGetInstanceProcAddr(instance, "vkCreateDebugReportCallbackEXT"));
+  vkDestroyDebugReportCallbackEXT = reinterpret_cast<PFN_vkDestroyDebugReportCallbackEXT>(
+      vkGetInstanceProcAddr(instance, "vkDestroyDebugReportCallbackEXT"));
+
+  return ret;
+}
+
+bool DispatchVk::LoadDevice(VkDevice device) {
+  bool ret = true;
+
+#define HEX_VK_LOAD_FUNCTION(name)                                         \
+  name = reinterpret_cast<PFN_##name>(vkGetDeviceProcAddr(device, #name)); \
+  if (!name) {                                                             \
+    HEX_CORE_ERROR("Missing vulkan device function {}.", #name);           \
+    ret = false;                                                           \
+  }
+  HEX_VK_DEVICE_FUNCTIONS(HEX_VK_LOAD_FUNCTION)
+#undef HEX_VK_LOAD_FUNCTION
+
+  // devices below 1.3 only expose the extension names
+  vkCmdBeginRendering = reinterpret_cast<PFN_vkCmdBeginRendering>(vkGetDeviceProcAddr(device, "vkCmdBeginRendering"));
+  vkCmdEndRendering = reinterpret_cast<PFN_vkCmdEndRendering>(vkGetDeviceProcAddr(device, "vkCmdEndRendering"));
+
+  if (!vkCmdBeginRendering || !vkCmdEndRendering) {
+    vkCmdBeginRendering =
+        reinterpret_cast<PFN_vkCmdBeginRendering>(vkGetDeviceProcAddr(device, "vkCmdBeginRenderingKHR"));
+    vkCmdEndRendering = reinterpret_cast<PFN_vkCmdEndRendering>(vkGetDeviceProcAddr(device, "vkCmdEndRenderingKHR"));
+  }
+
+  // the core name needs the drawIndirectCount feature of 1.2, the extension name works wherever it is enabled
+  vkCmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCount>(
+      vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR"));
+
+  return ret;
+}
+
+}  // namespace hexgon
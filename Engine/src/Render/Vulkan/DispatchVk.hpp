@@ -0,0 +1,155 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+// Every vulkan entry point the engine calls after instance creation. Instance level functions are resolved through
+// vkGetInstanceProcAddr and device level ones through vkGetDeviceProcAddr, so calls go straight to the driver instead
+// of through the loader trampolines. Add new functions to these lists, the table and loader are generated from them.
+#define HEX_VK_INSTANCE_FUNCTIONS(X)           \
+  X(vkCreateDevice)                            \
+  X(vkDestroyInstance)                         \
+  X(vkDestroySurfaceKHR)                       \
+  X(vkEnumerateDeviceExtensionProperties)      \
+  X(vkEnumeratePhysicalDevices)                \
+  X(vkGetPhysicalDeviceFeatures)               \
+  X(vkGetPhysicalDeviceFeatures2)              \
+  X(vkGetPhysicalDeviceFormatProperties)       \
+  X(vkGetPhysicalDeviceImageFormatProperties)  \
+  X(vkGetPhysicalDeviceMemoryProperties)       \
+  X(vkGetPhysicalDeviceMemoryProperties2)      \
+  X(vkGetPhysicalDeviceProperties)             \
+  X(vkGetPhysicalDeviceProperties2)            \
+  X(vkGetPhysicalDeviceQueueFamilyProperties)  \
+  X(vkGetPhysicalDeviceSurfaceCapabilitiesKHR) \
+  X(vkGetPhysicalDeviceSurfaceFormatsKHR)      \
+  X(vkGetPhysicalDeviceSurfaceSupportKHR)
+
+#define HEX_VK_DEVICE_FUNCTIONS(X) \
+  X(vkAcquireNextImageKHR)         \
+  X(vkAllocateCommandBuffers)      \
+  X(vkAllocateDescriptorSets)      \
+  X(vkAllocateMemory)              \
+  X(vkBeginCommandBuffer)          \
+  X(vkBindBufferMemory)            \
+  X(vkBindImageMemory)             \
+  X(vkCmdBeginRenderPass)          \
+  X(vkCmdBindDescriptorSets)       \
+  X(vkCmdBindPipeline)             \
+  X(vkCmdBlitImage)                \
+  X(vkCmdClearColorImage)          \
+  X(vkCmdCopyBuffer)               \
+  X(vkCmdCopyBufferToImage)        \
+  X(vkCmdCopyImage)                \
+  X(vkCmdCopyImageToBuffer)        \
+  X(vkCmdDispatch)                 \
+  X(vkCmdDrawIndexedIndirect)      \
+  X(vkCmdEndRenderPass)            \
+  X(vkCmdExecuteCommands)          \
+  X(vkCmdFillBuffer)               \
+  X(vkCmdPipelineBarrier)          \
+  X(vkCmdUpdateBuffer)             \
+  X(vkCreateBuffer)                \
+  X(vkCreateCommandPool)           \
+  X(vkCreateComputePipelines)      \
+  X(vkCreateDescriptorPool)        \
+  X(vkCreateDescriptorSetLayout)   \
+  X(vkCreateFence)                 \
+  X(vkCreateFramebuffer)           \
+  X(vkCreateImage)                 \
+  X(vkCreateImageView)             \
+  X(vkCreatePipelineCache)         \
+  X(vkCreatePipelineLayout)        \
+  X(vkCreateRenderPass)            \
+  X(vkCreateSampler)               \
+  X(vkCreateSemaphore)             \
+  X(vkCreateShaderModule)          \
+  X(vkCreateSwapchainKHR)          \
+  X(vkDestroyBuffer)               \
+  X(vkDestroyCommandPool)          \
+  X(vkDestroyDescriptorPool)       \
+  X(vkDestroyDescriptorSetLayout)  \
+  X(vkDestroyDevice)               \
+  X(vkDestroyFence)                \
+  X(vkDestroyFramebuffer)          \
+  X(vkDestroyImage)                \
+  X(vkDestroyImageView)            \
+  X(vkDestroyPipeline)             \
+  X(vkDestroyPipelineCache)        \
+  X(vkDestroyPipelineLayout)       \
+  X(vkDestroyRenderPass)           \
+  X(vkDestroySampler)              \
+  X(vkDestroySemaphore)            \
+  X(vkDestroyShaderModule)         \
+  X(vkDestroySwapchainKHR)         \
+  X(vkDeviceWaitIdle)              \
+  X(vkEndCommandBuffer)            \
+  X(vkFreeCommandBuffers)          \
+  X(vkFreeMemory)                  \
+  X(vkGetBufferMemoryRequirements) \
+  X(vkGetDeviceQueue)              \
+  X(vkGetImageMemoryRequirements)  \
+  X(vkGetPipelineCacheData)        \
+  X(vkGetSwapchainImagesKHR)       \
+  X(vkMapMemory)                   \
+  X(vkQueuePresentKHR)             \
+  X(vkQueueSubmit)                 \
+  X(vkResetCommandPool)            \
+  X(vkResetDescriptorPool)         \
+  X(vkResetFences)                 \
+  X(vkUpdateDescriptorSets)        \
+  X(vkWaitForFences)
+
+namespace hexgon {
+
+struct DispatchVk {
+#define HEX_VK_DECLARE_FUNCTION(name) PFN_##name name = nullptr;
+  HEX_VK_INSTANCE_FUNCTIONS(HEX_VK_DECLARE_FUNCTION)
+  HEX_VK_DEVICE_FUNCTIONS(HEX_VK_DECLARE_FUNCTION)
+#undef HEX_VK_DECLARE_FUNCTION
+
+  // optional, nullptr when the instance has no VK_EXT_debug_report
+  PFN_vkCreateDebugReportCallbackEXT vkCreateDebugReportCallbackEXT = nullptr;
+  PFN_vkDestroyDebugReportCallbackEXT vkDestroyDebugReportCallbackEXT = nullptr;
+
+  // optional, core 1.3 entry points or their VK_KHR_dynamic_rendering aliases
+  PFN_vkCmdBeginRendering vkCmdBeginRendering = nullptr;
+  PFN_vkCmdEndRendering vkCmdEndRendering = nullptr;
+
+  // optional, VK_KHR_draw_indirect_count, only valid when RenderSystemVk::IsDrawIndirectCountSupported
+  PFN_vkCmdDrawIndexedIndirectCount vkCmdDrawIndexedIndirectCount = nullptr;
+
+  // false if a required function is missing
+  bool LoadInstance(VkInstance instance);
+
+  bool LoadDevice(VkDevice device);
+
+  void Reset() { *this = DispatchVk{}; }
+};
+
+// the engine drives a single instance and device, RenderSystemVk loads and resets it
+extern DispatchVk g_vk;
+
+}  // namespace hexgon
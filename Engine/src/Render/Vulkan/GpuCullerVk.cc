@@ -0,0 +1,447 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include "Render/Vulkan/GpuCullerVk.hpp"
+
+#include <HexgonShaders.hpp>
+#include <algorithm>
+#include <cstring>
+
+#include "LogPrivate.hpp"
+#include "Render/Vulkan/DispatchVk.hpp"
+#include "Render/Vulkan/RenderSystemVk.hpp"
+
+namespace hexgon {
+
+namespace {
+
+constexpr uint32_t kGroupSize = 64;
+constexpr uint32_t kMinCapacity = 256;
+
+constexpr uint32_t kBindingFrame = 0;
+constexpr uint32_t kBindingObjects = 1;
+constexpr uint32_t kBindingTransforms = 2;
+constexpr uint32_t kBindingDraws = 3;
+constexpr uint32_t kBindingCount = 4;
+constexpr uint32_t kBindingPyramid = 5;
+constexpr uint32_t kBindingTotal = 6;
+
+// std140 layout of GpuCulling.comp
+struct FrameData {
+  glm::vec4 planes[Frustum::kPlaneCount];
+  glm::mat4 pyramid_view_projection;
+  uint32_t object_count;
+  uint32_t pyramid_width;
+  uint32_t pyramid_height;
+  uint32_t pyramid_levels;
+  uint32_t occlusion;
+  uint32_t depth_zero_to_one;
+  uint32_t padding[2];
+};
+
+static_assert(sizeof(GpuCullerVk::Object) == 64, "Object layout must match GpuCulling.comp");
+static_assert(sizeof(FrameData) == 192, "FrameData layout must match GpuCulling.comp");
+
+void PipelineBarrier(VkCommandBuffer cmd, VkPipelineStageFlags src_stage, VkAccessFlags src_access,
+                     VkPipelineStageFlags dst_stage, VkAccessFlags dst_access) {
+  VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+  barrier.srcAccessMask = src_access;
+  barrier.dstAccessMask = dst_access;
+
+  g_vk.vkCmdPipelineBarrier(cmd, src_stage, dst_stage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+}  // namespace
+
+bool GpuCullerVk::Init(RenderSystemVk* render_system, uint32_t frame_count) {
+  m_render_system = render_system;
+  m_device = render_system->GetDevice();
+
+  if (!render_system->GetEnabledFeatures().drawIndirectFirstInstance) {
+    HEX_CORE_ERROR("GPU culling needs drawIndirectFirstInstance.");
+    return false;
+  }
+
+  if (!CreatePipeline()) {
+    return false;
+  }
+
+  m_descriptor_allocator.Init(m_device, std::max(frame_count, 1u),
+                              {
+                                  {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.f},
+                                  {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5.f},
+                              });
+
+  m_frames.resize(std::max(frame_count, 1u));
+
+  for (auto& frame : m_frames) {
+    frame.set = m_descriptor_allocator.Allocate(m_set_layout);
+
+    if (!frame.set) {
+      return false;
+    }
+  }
+
+  m_frame_buffer = render_system->CreateBuffer(
+      sizeof(FrameData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, false);
+  // count and draws are transfer sources so tests can read them back
+  m_count_buffer = render_system->CreateBuffer(
+      sizeof(uint32_t),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+          VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      false);
+
+  return m_frame_buffer && m_count_buffer;
+}
+
+void GpuCullerVk::Destroy() {
+  m_frame_buffer.reset();
+  m_object_buffer.reset();
+  m_transform_buffer.reset();
+  m_draw_buffer.reset();
+  m_count_buffer.reset();
+  m_frames.clear();
+
+  m_descriptor_allocator.Destroy();
+
+  if (m_pipeline) {
+    g_vk.vkDestroyPipeline(m_device, m_pipeline, nullptr);
+    m_pipeline = VK_NULL_HANDLE;
+  }
+
+  if (m_pipeline_layout) {
+    g_vk.vkDestroyPipelineLayout(m_device, m_pipeline_layout, nullptr);
+    m_pipeline_layout = VK_NULL_HANDLE;
+  }
+
+  if (m_set_layout) {
+    g_vk.vkDestroyDescriptorSetLayout(m_device, m_set_layout, nullptr);
+    m_set_layout = VK_NULL_HANDLE;
+  }
+
+  m_capacity = 0;
+}
+
+void GpuCullerVk::SetObjectCount(uint32_t count) {
+  if (count < m_object_count) {
+    m_dirty.erase(std::remove_if(m_dirty.begin(), m_dirty.end(), [count](uint32_t index) { return index >= count; }),
+                  m_dirty.end());
+  }
+
+  m_objects.resize(count);
+  m_transforms.resize(count, glm::mat4(1.f));
+  m_dirty_flags.resize(count, 0);
+
+  for (uint32_t i = m_object_count; i < count; i++) {
+    MarkDirty(i);
+  }
+
+  m_object_count = count;
+}
+
+void GpuCullerVk::SetObject(uint32_t index, Aabb const& aabb, BoundingSphere const& sphere, uint32_t index_count,
+                            uint32_t first_index, int32_t vertex_offset) {
+  auto& object = m_objects[index];
+
+  object.sphere = glm::vec4(sphere.center, sphere.radius);
+  object.aabb_center = glm::vec4(aabb.GetCenter(), 0.f);
+  object.aabb_extent = glm::vec4(aabb.GetExtent(), 0.f);
+  object.index_count = index_count;
+  object.first_index = first_index;
+  object.vertex_offset = vertex_offset;
+
+  MarkDirty(index);
+}
+
+void GpuCullerVk::SetTransform(uint32_t index, glm::mat4 const& world) {
+  m_transforms[index] = world;
+
+  MarkDirty(index);
+}
+
+void GpuCullerVk::Cull(VkCommandBuffer cmd, uint32_t frame_slot, glm::mat4 const& view_projection,
+                       DepthPyramid const* pyramid) {
+  if (m_object_count == 0) {
+    return;
+  }
+
+  if (!Reserve()) {
+    return;
+  }
+
+  auto& frame = m_frames[frame_slot % m_frames.size()];
+
+  // previous frames may still read the shared buffers, every write below has to wait for them
+  PipelineBarrier(cmd,
+                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+                      VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                  VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+                  VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+  RecordUploads(cmd, frame);
+
+  FrameData frame_data{};
+
+  auto frustum = Frustum::FromMatrix(view_projection);
+  for (uint32_t i = 0; i < Frustum::kPlaneCount; i++) {
+    frame_data.planes[i] = frustum.planes[i];
+  }
+
+  frame_data.object_count = m_object_count;
+
+#ifdef GLM_FORCE_DEPTH_ZERO_TO_ONE
+  frame_data.depth_zero_to_one = 1;
+#endif
+
+  if (pyramid && pyramid->buffer) {
+    frame_data.pyramid_view_projection = pyramid->view_projection;
+    frame_data.pyramid_width = pyramid->width;
+    frame_data.pyramid_height = pyramid->height;
+    frame_data.pyramid_levels = pyramid->level_count;
+    frame_data.occlusion = pyramid->level_count > 0 ? 1 : 0;
+  }
+
+  g_vk.vkCmdUpdateBuffer(cmd, m_frame_buffer->GetBuffer(), 0, sizeof(FrameData), &frame_data);
+  g_vk.vkCmdFillBuffer(cmd, m_count_buffer->GetBuffer(), 0, sizeof(uint32_t), 0);
+
+  if (!m_render_system->IsDrawIndirectCountSupported()) {
+    // the whole buffer is drawn, commands past the count have to draw nothing
+    g_vk.vkCmdFillBuffer(cmd, m_draw_buffer->GetBuffer(), 0,
+                         sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(m_object_count), 0);
+  }
+
+  PipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                  VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+  VkDescriptorBufferInfo buffer_infos[kBindingTotal] = {
+      {m_frame_buffer->GetBuffer(), 0, VK_WHOLE_SIZE},
+      {m_object_buffer->GetBuffer(), 0, VK_WHOLE_SIZE},
+      {m_transform_buffer->GetBuffer(), 0, VK_WHOLE_SIZE},
+      {m_draw_buffer->GetBuffer(), 0, VK_WHOLE_SIZE},
+      {m_count_buffer->GetBuffer(), 0, VK_WHOLE_SIZE},
+      // never read without occlusion, but the binding still needs a valid buffer
+      {frame_data.occlusion ? pyramid->buffer : m_object_buffer->GetBuffer(), 0, VK_WHOLE_SIZE},
+  };
+
+  VkWriteDescriptorSet writes[kBindingTotal] = {};
+  for (uint32_t i = 0; i < kBindingTotal; i++) {
+    writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[i].dstSet = frame.set;
+    writes[i].dstBinding = i;
+    writes[i].descriptorCount = 1;
+    writes[i].descriptorType =
+        i == kBindingFrame ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[i].pBufferInfo = &buffer_infos[i];
+  }
+
+  g_vk.vkUpdateDescriptorSets(m_device, kBindingTotal, writes, 0, nullptr);
+
+  g_vk.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+  g_vk.vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline_layout, 0, 1, &frame.set, 0,
+                               nullptr);
+  g_vk.vkCmdDispatch(cmd, (m_object_count + kGroupSize - 1) / kGroupSize, 1, 1);
+
+  PipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+}
+
+void GpuCullerVk::Draw(VkCommandBuffer cmd) {
+  if (m_object_count == 0 || !m_draw_buffer) {
+    return;
+  }
+
+  constexpr uint32_t kStride = sizeof(VkDrawIndexedIndirectCommand);
+
+  if (m_render_system->IsDrawIndirectCountSupported()) {
+    g_vk.vkCmdDrawIndexedIndirectCount(cmd, m_draw_buffer->GetBuffer(), 0, m_count_buffer->GetBuffer(), 0,
+                                       m_object_count, kStride);
+  } else if (m_render_system->GetEnabledFeatures().multiDrawIndirect) {
+    g_vk.vkCmdDrawIndexedIndirect(cmd, m_draw_buffer->GetBuffer(), 0, m_object_count, kStride);
+  } else {
+    for (uint32_t i = 0; i < m_object_count; i++) {
+      g_vk.vkCmdDrawIndexedIndirect(cmd, m_draw_buffer->GetBuffer(), static_cast<VkDeviceSize>(i) * kStride, 1,
+                                    kStride);
+    }
+  }
+}
+
+bool GpuCullerVk::CreatePipeline() {
+  VkDescriptorSetLayoutBinding bindings[kBindingTotal] = {};
+  for (uint32_t i = 0; i < kBindingTotal; i++) {
+    bindings[i].binding = i;
+    bindings[i].descriptorType =
+        i == kBindingFrame ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[i].descriptorCount = 1;
+    bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  }
+
+  VkDescriptorSetLayoutCreateInfo layout_info{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+  layout_info.bindingCount = kBindingTotal;
+  layout_info.pBindings = bindings;
+
+  if (g_vk.vkCreateDescriptorSetLayout(m_device, &layout_info, nullptr, &m_set_layout) != VK_SUCCESS) {
+    HEX_CORE_ERROR("Failed create GPU culling set layout.");
+    return false;
+  }
+
+  VkPipelineLayoutCreateInfo pipeline_layout_info{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+  pipeline_layout_info.setLayoutCount = 1;
+  pipeline_layout_info.pSetLayouts = &m_set_layout;
+
+  if (g_vk.vkCreatePipelineLayout(m_device, &pipeline_layout_info, nullptr, &m_pipeline_layout) != VK_SUCCESS) {
+    HEX_CORE_ERROR("Failed create GPU culling pipeline layout.");
+    return false;
+  }
+
+  VkShaderModuleCreateInfo module_info{VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+  module_info.codeSize = GpuCulling_comp_spv_size;
+  module_info.pCode = reinterpret_cast<uint32_t const*>(GpuCulling_comp_spv);
+
+  VkShaderModule module = {};
+  if (g_vk.vkCreateShaderModule(m_device, &module_info, nullptr, &module) != VK_SUCCESS) {
+    HEX_CORE_ERROR("Failed create GPU culling shader module.");
+    return false;
+  }
+
+  VkComputePipelineCreateInfo pipeline_info{VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+  pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipeline_info.stage.module = module;
+  pipeline_info.stage.pName = "main";
+  pipeline_info.layout = m_pipeline_layout;
+
+  VkResult result = g_vk.vkCreateComputePipelines(m_device, m_render_system->GetPipelineCache(), 1, &pipeline_info,
+                                                  nullptr, &m_pipeline);
+
+  g_vk.vkDestroyShaderModule(m_device, module, nullptr);
+
+  if (result != VK_SUCCESS) {
+    HEX_CORE_ERROR("Failed create GPU culling pipeline.");
+    return false;
+  }
+
+  return true;
+}
+
+bool GpuCullerVk::Reserve() {
+  if (m_object_count <= m_capacity) {
+    return true;
+  }
+
+  uint32_t capacity = std::max(std::max(m_capacity * 2, m_object_count), kMinCapacity);
+
+  auto object_buffer = m_render_system->CreateBuffer(
+      sizeof(Object) * static_cast<VkDeviceSize>(capacity),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, false);
+  auto transform_buffer = m_render_system->CreateBuffer(
+      sizeof(glm::mat4) * static_cast<VkDeviceSize>(capacity),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, false);
+  auto draw_buffer = m_render_system->CreateBuffer(
+      sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(capacity),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+          VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      false);
+
+  if (!object_buffer || !transform_buffer || !draw_buffer) {
+    HEX_CORE_ERROR("Failed grow GPU culling buffers to {} objects.", capacity);
+    return false;
+  }
+
+  // the old buffers are released through the deletion queue once no frame uses them anymore
+  m_object_buffer = std::move(object_buffer);
+  m_transform_buffer = std::move(transform_buffer);
+  m_draw_buffer = std::move(draw_buffer);
+  m_capacity = capacity;
+
+  for (uint32_t i = 0; i < m_object_count; i++) {
+    MarkDirty(i);
+  }
+
+  return true;
+}
+
+void GpuCullerVk::MarkDirty(uint32_t index) {
+  if (m_dirty_flags[index]) {
+    return;
+  }
+
+  m_dirty_flags[index] = 1;
+  m_dirty.emplace_back(index);
+}
+
+void GpuCullerVk::RecordUploads(VkCommandBuffer cmd, FrameSlot& frame) {
+  if (m_dirty.empty()) {
+    return;
+  }
+
+  std::sort(m_dirty.begin(), m_dirty.end());
+
+  VkDeviceSize transform_offset = sizeof(Object) * static_cast<VkDeviceSize>(m_dirty.size());
+  VkDeviceSize size = transform_offset + sizeof(glm::mat4) * static_cast<VkDeviceSize>(m_dirty.size());
+
+  if (!frame.staging || frame.staging->GetSize() < size) {
+    frame.staging = m_render_system->CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, true);
+
+    if (!frame.staging) {
+      HEX_CORE_ERROR("Failed create GPU culling staging buffer with size {}.", size);
+      return;
+    }
+  }
+
+  auto* data = static_cast<uint8_t*>(frame.staging->GetMappedData());
+
+  std::vector<VkBufferCopy> object_copies{};
+  std::vector<VkBufferCopy> transform_copies{};
+
+  for (size_t i = 0; i < m_dirty.size(); i++) {
+    uint32_t index = m_dirty[i];
+
+    std::memcpy(data + sizeof(Object) * i, &m_objects[index], sizeof(Object));
+    std::memcpy(data + transform_offset + sizeof(glm::mat4) * i, &m_transforms[index], sizeof(glm::mat4));
+
+    m_dirty_flags[index] = 0;
+
+    // consecutive objects are staged consecutively as well, one region covers the whole run
+    if (i > 0 && m_dirty[i - 1] + 1 == index) {
+      object_copies.back().size += sizeof(Object);
+      transform_copies.back().size += sizeof(glm::mat4);
+      continue;
+    }
+
+    object_copies.emplace_back(VkBufferCopy{sizeof(Object) * i, sizeof(Object) * static_cast<VkDeviceSize>(index),
+                                            sizeof(Object)});
+    transform_copies.emplace_back(VkBufferCopy{transform_offset + sizeof(glm::mat4) * i,
+                                               sizeof(glm::mat4) * static_cast<VkDeviceSize>(index),
+                                               sizeof(glm::mat4)});
+  }
+
+  m_dirty.clear();
+
+  g_vk.vkCmdCopyBuffer(cmd, frame.staging->GetBuffer(), m_object_buffer->GetBuffer(),
+                       static_cast<uint32_t>(object_copies.size()), object_copies.data());
+  g_vk.vkCmdCopyBuffer(cmd, frame.staging->GetBuffer(), m_transform_buffer->GetBuffer(),
+                       static_cast<uint32_t>(transform_copies.size()), transform_copies.data());
+}
+
+}  // namespace hexgon
@@ -0,0 +1,137 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <Hexgon/Core/Bounds.hpp>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+#include "Render/Vulkan/BufferVk.hpp"
+#include "Render/Vulkan/DescriptorAllocatorVk.hpp"
+
+namespace hexgon {
+
+class RenderSystemVk;
+
+// GPU driven culling. Object bounds and world transforms live in device local storage buffers, updated from a
+// staging buffer with only the objects that changed. Cull records a compute pass testing every object against the
+// frustum, and optionally against a depth pyramid of the previous frame, which appends an indexed indirect command
+// per visible object and counts them. Draw consumes the commands with draw-indirect-count.
+// Object i is drawn with firstInstance i, vertex shaders read its transform from GetTransformBuffer() at
+// gl_InstanceIndex. All objects index into the one index and vertex buffer bound by the caller.
+class GpuCullerVk {
+ public:
+  // std430 layout of GpuCulling.comp
+  struct Object {
+    glm::vec4 sphere = {};
+    glm::vec4 aabb_center = {};
+    glm::vec4 aabb_extent = {};
+    uint32_t index_count = 0;
+    uint32_t first_index = 0;
+    int32_t vertex_offset = 0;
+    uint32_t padding = 0;
+  };
+
+  // farthest depth pyramid laid out like OcclusionCuller, every level back to back
+  struct DepthPyramid {
+    VkBuffer buffer = {};
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t level_count = 0;
+    // the camera the pyramid was rendered with
+    glm::mat4 view_projection = glm::mat4(1.f);
+  };
+
+  GpuCullerVk() = default;
+
+  // `frame_count` frames may be in flight, fails without drawIndirectFirstInstance
+  bool Init(RenderSystemVk* render_system, uint32_t frame_count);
+
+  void Destroy();
+
+  void SetObjectCount(uint32_t count);
+
+  uint32_t GetObjectCount() const { return m_object_count; }
+
+  void SetObject(uint32_t index, Aabb const& aabb, BoundingSphere const& sphere, uint32_t index_count,
+                 uint32_t first_index, int32_t vertex_offset);
+
+  void SetTransform(uint32_t index, glm::mat4 const& world);
+
+  // outside of a render pass, the resources of `frame_slot` must not be used by the GPU anymore
+  void Cull(VkCommandBuffer cmd, uint32_t frame_slot, glm::mat4 const& view_projection,
+            DepthPyramid const* pyramid = nullptr);
+
+  // inside a render pass, with a pipeline and the shared index buffer bound
+  void Draw(VkCommandBuffer cmd);
+
+  VkBuffer GetTransformBuffer() const { return m_transform_buffer ? m_transform_buffer->GetBuffer() : VK_NULL_HANDLE; }
+
+  VkBuffer GetDrawBuffer() const { return m_draw_buffer ? m_draw_buffer->GetBuffer() : VK_NULL_HANDLE; }
+
+  VkBuffer GetCountBuffer() const { return m_count_buffer ? m_count_buffer->GetBuffer() : VK_NULL_HANDLE; }
+
+ private:
+  struct FrameSlot {
+    std::unique_ptr<BufferVk> staging = {};
+    VkDescriptorSet set = {};
+  };
+
+  bool CreatePipeline();
+
+  // grow the device buffers to the object count, everything is uploaded again after a reallocation
+  bool Reserve();
+
+  void MarkDirty(uint32_t index);
+
+  void RecordUploads(VkCommandBuffer cmd, FrameSlot& frame);
+
+ private:
+  RenderSystemVk* m_render_system = nullptr;
+  VkDevice m_device = {};
+  VkDescriptorSetLayout m_set_layout = {};
+  VkPipelineLayout m_pipeline_layout = {};
+  VkPipeline m_pipeline = {};
+  DescriptorAllocatorVk m_descriptor_allocator = {};
+  std::vector<FrameSlot> m_frames = {};
+
+  uint32_t m_object_count = 0;
+  uint32_t m_capacity = 0;
+  std::vector<Object> m_objects = {};
+  std::vector<glm::mat4> m_transforms = {};
+  std::vector<uint8_t> m_dirty_flags = {};
+  std::vector<uint32_t> m_dirty = {};
+
+  std::unique_ptr<BufferVk> m_frame_buffer = {};
+  std::unique_ptr<BufferVk> m_object_buffer = {};
+  std::unique_ptr<BufferVk> m_transform_buffer = {};
+  std::unique_ptr<BufferVk> m_draw_buffer = {};
+  std::unique_ptr<BufferVk> m_count_buffer = {};
+};
+
+}  // namespace hexgon
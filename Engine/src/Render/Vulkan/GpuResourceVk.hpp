@@ -23,8 +23,14 @@
 
 #pragma once
 
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
 #include <string>
 
+#include "Core/Util/HandleRegistry.hpp"
+
 namespace hexgon {
 
 class GpuResourceVk;
@@ -34,13 +40,17 @@ class GpuResourceDelegateVk {
   virtual ~GpuResourceDelegateVk() = default;
 
   virtual void OnResourceDispose(GpuResourceVk*) = 0;
+
+  // vulkan object owned by a resource is no longer needed, it may still be used by frames in flight
+  virtual void OnReleaseHandle(VkObjectType type, uint64_t handle) = 0;
+
+  // anything else frames in flight may still use, e.g. a descriptor set or a bindless slot. `release` runs once the
+  // frame being recorded now is done on the GPU
+  virtual void OnReleaseLater(std::function<void()> release) = 0;
 };
 
 class GpuResourceVk {
  public:
-  GpuResourceVk* mem_prev = nullptr;
-  GpuResourceVk* mem_next = nullptr;
-
   GpuResourceVk() = default;
 
   virtual ~GpuResourceVk() {
@@ -55,9 +65,27 @@ class GpuResourceVk {
 
   void SetDelegate(GpuResourceDelegateVk* delegate) { m_delegate = delegate; }
 
+  ResourceHandle GetHandle() const { return m_handle; }
+
+  void SetHandle(ResourceHandle handle) { m_handle = handle; }
+
+  // give every vulkan object back to the delegate, subclass must call this in its destructor
+  virtual void ReleaseHandles() = 0;
+
+ protected:
+  template <typename T>
+  void ReleaseLater(VkObjectType type, T& handle) {
+    if (m_delegate && handle) {
+      m_delegate->OnReleaseHandle(type, reinterpret_cast<uint64_t>(handle));
+    }
+
+    handle = VK_NULL_HANDLE;
+  }
+
  private:
   std::string m_label;
   GpuResourceDelegateVk* m_delegate = nullptr;
+  ResourceHandle m_handle = {};
 };
 
-}  // namespace hexgon
\ No newline at end of file
+}  // namespace hexgon
@@ -0,0 +1,275 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include "Render/Vulkan/ReadbackQueueVk.hpp"
+
+#include <algorithm>
+
+#include "LogPrivate.hpp"
+#include "Render/Vulkan/DispatchVk.hpp"
+#include "Render/Vulkan/RenderSystemVk.hpp"
+#include "Render/Vulkan/TextureVk.hpp"
+#include "Render/Vulkan/VulkanUtil.hpp"
+
+namespace hexgon {
+
+namespace {
+
+// buffers grow in steps so readbacks of slightly different sizes share them
+constexpr VkDeviceSize kBufferGranularity = 64 * 1024;
+
+}  // namespace
+
+void ReadbackQueueVk::Queue(TextureVk* texture, const TextureRange& range, ReadbackCallback callback) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  texture->m_pending_readbacks++;
+
+  m_queued.emplace_back(Request{texture, range, std::move(callback)});
+}
+
+void ReadbackQueueVk::Discard(TextureVk* texture) {
+  std::vector<ReadbackCallback> dropped{};
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = std::stable_partition(m_queued.begin(), m_queued.end(),
+                                    [texture](Request const& request) { return request.texture != texture; });
+
+    for (auto drop = it; drop != m_queued.end(); drop++) {
+      dropped.emplace_back(std::move(drop->callback));
+    }
+
+    m_queued.erase(it, m_queued.end());
+    texture->m_pending_readbacks = 0;
+  }
+
+  for (auto const& callback : dropped) {
+    callback(nullptr, 0);
+  }
+}
+
+void ReadbackQueueVk::Record(RenderSystemVk* render_system, VkCommandBuffer cmd, uint64_t frame) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (m_queued.empty()) {
+    return;
+  }
+
+  std::vector<Request> deferred{};
+  bool recorded = false;
+
+  for (auto& request : m_queued) {
+    TextureVk* texture = request.texture;
+    PixelFormatInfo format_info = GetPixelFormatInfo(texture->GetFormat());
+    VkExtent3D extent = TextureVk::GetMipExtent(texture->GetDescriptor(), request.range.mip_level);
+    size_t size = format_info.GetImageSize(request.range.width, request.range.height) * extent.depth;
+
+    size_t index = AcquireSlot(render_system, size);
+    if (index == kMaxBuffers) {
+      deferred.emplace_back(std::move(request));
+      continue;
+    }
+
+    Slot& slot = m_slots[index];
+    slot.busy = true;
+    slot.frame = frame;
+    slot.size = size;
+    slot.callback = std::move(request.callback);
+
+    std::lock_guard<std::mutex> texture_lock(texture->m_mutex);
+
+    VkFormat format = TextureVk::ToVkFormat(texture->GetFormat());
+    VkImageAspectFlags aspect = format_info.is_depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VulkanUtil::FormatAspect(format);
+    VkImageLayout ready_layout = texture->GetReadyLayout();
+
+    // every request gets its own barriers, the same texture may be read more than once in a frame
+    VkImageMemoryBarrier barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = texture->mInfo.image;
+    barrier.subresourceRange = {VulkanUtil::FormatAspect(format), request.range.mip_level, 1,
+                                request.range.array_layer, 1};
+    barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.oldLayout = texture->mInfo.layout;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    g_vk.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                              nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource = {aspect, request.range.mip_level, request.range.array_layer, 1};
+    region.imageOffset = {static_cast<int32_t>(request.range.x), static_cast<int32_t>(request.range.y), 0};
+    region.imageExtent = {request.range.width, request.range.height, extent.depth};
+
+    g_vk.vkCmdCopyImageToBuffer(cmd, barrier.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer->GetBuffer(), 1,
+                                &region);
+
+    // later passes sample or render to the texture again, they must not start before the copy read it
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    if (ready_layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) {
+      barrier.dstAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    } else if (ready_layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
+      barrier.dstAccessMask |=
+          VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    }
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = ready_layout;
+
+    g_vk.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0,
+                              nullptr, 1, &barrier);
+
+    texture->mInfo.layout = ready_layout;
+    texture->m_pending_readbacks--;
+    recorded = true;
+  }
+
+  if (recorded) {
+    // make the copies visible to the host once the frame fence is signaled
+    VkMemoryBarrier host_barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    host_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    host_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+
+    g_vk.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &host_barrier, 0,
+                              nullptr, 0, nullptr);
+  }
+
+  if (!deferred.empty()) {
+    HEX_CORE_WARN("Readback ring is full, {} readbacks wait for the next frame.", deferred.size());
+  }
+
+  m_queued = std::move(deferred);
+}
+
+void ReadbackQueueVk::Collect(uint64_t completed_frame) {
+  std::vector<size_t> ready{};
+  std::vector<ReadbackCallback> callbacks{};
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (size_t i = 0; i < m_slots.size(); i++) {
+      if (m_slots[i].busy && m_slots[i].frame <= completed_frame) {
+        ready.emplace_back(i);
+        callbacks.emplace_back(std::move(m_slots[i].callback));
+      }
+    }
+  }
+
+  if (ready.empty()) {
+    return;
+  }
+
+  // callbacks run without the lock so they can queue new readbacks. Slots are only handed out again by Record, which
+  // runs on this same thread.
+  for (size_t i = 0; i < ready.size(); i++) {
+    Slot const& slot = m_slots[ready[i]];
+    callbacks[i](slot.buffer->GetMappedData(), slot.size);
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  for (size_t index : ready) {
+    m_slots[index].busy = false;
+    m_slots[index].callback = {};
+  }
+}
+
+void ReadbackQueueVk::Clear() {
+  Collect(UINT64_MAX);
+
+  std::vector<Request> dropped{};
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    dropped = std::move(m_queued);
+    m_queued.clear();
+    m_slots.clear();
+  }
+
+  for (auto const& request : dropped) {
+    request.texture->m_pending_readbacks = 0;
+    request.callback(nullptr, 0);
+  }
+}
+
+size_t ReadbackQueueVk::GetPendingCount() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  size_t count = m_queued.size();
+  for (auto const& slot : m_slots) {
+    count += slot.busy ? 1 : 0;
+  }
+
+  return count;
+}
+
+size_t ReadbackQueueVk::AcquireSlot(RenderSystemVk* render_system, size_t size) {
+  size_t best = kMaxBuffers;
+  size_t smaller = kMaxBuffers;
+
+  for (size_t i = 0; i < m_slots.size(); i++) {
+    if (m_slots[i].busy) {
+      continue;
+    }
+
+    if (m_slots[i].buffer->GetSize() < size) {
+      smaller = i;
+    } else if (best == kMaxBuffers || m_slots[i].buffer->GetSize() < m_slots[best].buffer->GetSize()) {
+      best = i;
+    }
+  }
+
+  if (best != kMaxBuffers) {
+    return best;
+  }
+
+  size_t index = smaller;
+  if (m_slots.size() < kMaxBuffers) {
+    index = m_slots.size();
+  } else if (index == kMaxBuffers) {
+    return kMaxBuffers;
+  }
+
+  VkDeviceSize buffer_size = (size + kBufferGranularity - 1) / kBufferGranularity * kBufferGranularity;
+
+  auto buffer = render_system->CreateBuffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, true);
+  if (!buffer) {
+    return kMaxBuffers;
+  }
+
+  if (index == m_slots.size()) {
+    m_slots.emplace_back();
+  }
+
+  // a replaced buffer goes through the deletion queue, the GPU is not using it anymore anyway
+  m_slots[index].buffer = std::move(buffer);
+
+  return index;
+}
+
+}  // namespace hexgon
@@ -0,0 +1,92 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <Hexgon/Render/Texture.hpp>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Render/Vulkan/BufferVk.hpp"
+
+namespace hexgon {
+
+class RenderSystemVk;
+class TextureVk;
+
+// Asynchronous texture readback. Copies are recorded at the end of a frame into a ring of persistently mapped host
+// visible buffers, and the callbacks run when that frame's fence is seen signaled, so the CPU never waits for the
+// GPU. Requests which find no free buffer stay queued for the next frame.
+class ReadbackQueueVk {
+ public:
+  // buffers in flight at most, roughly frames in flight times readbacks per frame
+  static constexpr size_t kMaxBuffers = 16;
+
+  ReadbackQueueVk() = default;
+
+  // `range` is already validated against the texture
+  void Queue(TextureVk* texture, TextureRange const& range, ReadbackCallback callback);
+
+  // drop queued readbacks of a texture which is being destroyed, their callbacks get nullptr
+  void Discard(TextureVk* texture);
+
+  // record copies of queued requests into `cmd`, which is submitted as frame `frame`
+  void Record(RenderSystemVk* render_system, VkCommandBuffer cmd, uint64_t frame);
+
+  // run callbacks of every copy recorded in frames up to and including `completed_frame`
+  void Collect(uint64_t completed_frame);
+
+  // device must be idle, finished copies are delivered and the rest are dropped
+  void Clear();
+
+  size_t GetPendingCount();
+
+ private:
+  struct Request {
+    TextureVk* texture = nullptr;
+    TextureRange range = {};
+    ReadbackCallback callback = {};
+  };
+
+  struct Slot {
+    std::unique_ptr<BufferVk> buffer = {};
+    uint64_t frame = 0;
+    size_t size = 0;
+    bool busy = false;
+    ReadbackCallback callback = {};
+  };
+
+  // smallest idle buffer holding `size` bytes, a new or regrown one if there is none, kMaxBuffers if the ring is full
+  size_t AcquireSlot(RenderSystemVk* render_system, size_t size);
+
+ private:
+  std::mutex m_mutex = {};
+  std::vector<Request> m_queued = {};
+  std::vector<Slot> m_slots = {};
+};
+
+}  // namespace hexgon
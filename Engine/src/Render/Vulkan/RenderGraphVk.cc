@@ -0,0 +1,770 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include "Render/Vulkan/RenderGraphVk.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+
+#include "LogPrivate.hpp"
+#include "Render/Vulkan/DispatchVk.hpp"
+#include "Render/Vulkan/GpuResourceVk.hpp"
+#include "Render/Vulkan/RenderPassCacheVk.hpp"
+#include "Render/Vulkan/VulkanUtil.hpp"
+
+namespace hexgon {
+
+namespace {
+
+struct AccessState {
+  VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+  VkPipelineStageFlags stage = 0;
+  VkAccessFlags access = 0;
+  VkImageUsageFlags usage = 0;
+  bool write = false;
+};
+
+AccessState GetAccessState(RGAccess access) {
+  switch (access) {
+    case RGAccess::kColorAttachment:
+      return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+              VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+              VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true};
+    case RGAccess::kDepthAttachment:
+      return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+              VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+              VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+              VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true};
+    case RGAccess::kDepthRead:
+      return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+              VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+              VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, false};
+    case RGAccess::kSampled:
+      return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+              VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+              VK_IMAGE_USAGE_SAMPLED_BIT, false};
+    case RGAccess::kStorageRead:
+      return {VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+              VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_USAGE_STORAGE_BIT, false};
+    case RGAccess::kStorageWrite:
+      return {VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+              VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_USAGE_STORAGE_BIT, true};
+    case RGAccess::kTransferSrc:
+      return {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+              VK_IMAGE_USAGE_TRANSFER_SRC_BIT, false};
+    case RGAccess::kTransferDst:
+      return {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+              VK_IMAGE_USAGE_TRANSFER_DST_BIT, true};
+    case RGAccess::kPresent:
+      return {VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, false};
+  }
+
+  return {};
+}
+
+const char* AccessName(RGAccess access) {
+  switch (access) {
+    case RGAccess::kColorAttachment:
+      return "color-attachment";
+    case RGAccess::kDepthAttachment:
+      return "depth-attachment";
+    case RGAccess::kDepthRead:
+      return "depth-read";
+    case RGAccess::kSampled:
+      return "sampled";
+    case RGAccess::kStorageRead:
+      return "storage-read";
+    case RGAccess::kStorageWrite:
+      return "storage-write";
+    case RGAccess::kTransferSrc:
+      return "transfer-src";
+    case RGAccess::kTransferDst:
+      return "transfer-dst";
+    case RGAccess::kPresent:
+      return "present";
+  }
+
+  return "unknown";
+}
+
+const char* LayoutName(VkImageLayout layout) {
+  switch (layout) {
+    case VK_IMAGE_LAYOUT_UNDEFINED:
+      return "UNDEFINED";
+    case VK_IMAGE_LAYOUT_GENERAL:
+      return "GENERAL";
+    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+      return "COLOR_ATTACHMENT";
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+      return "DEPTH_STENCIL_ATTACHMENT";
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+      return "DEPTH_STENCIL_READ_ONLY";
+    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+      return "SHADER_READ_ONLY";
+    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+      return "TRANSFER_SRC";
+    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+      return "TRANSFER_DST";
+    case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+      return "PRESENT_SRC";
+    default:
+      return "OTHER";
+  }
+}
+
+VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+}
+
+bool Overlap(int32_t a_begin, int32_t a_end, int32_t b_begin, int32_t b_end) {
+  return a_begin <= b_end && b_begin <= a_end;
+}
+
+}  // namespace
+
+RGResource RGPassBuilder::Read(RGResource resource, RGAccess access) {
+  m_graph->m_passes[m_pass].reads.emplace_back(RenderGraphVk::AccessInfo{resource, access});
+  return resource;
+}
+
+RGResource RGPassBuilder::Write(RGResource resource, RGAccess access, bool overwrite) {
+  m_graph->m_passes[m_pass].writes.emplace_back(RenderGraphVk::AccessInfo{resource, access, overwrite});
+  return resource;
+}
+
+RenderGraphVk::RenderGraphVk(VkDevice device, VkPhysicalDevice phy_device, GpuResourceDelegateVk* delegate,
+                             RenderPassCacheVk* render_pass_cache)
+    : m_device(device), m_phy_device(phy_device), m_delegate(delegate), m_render_pass_cache(render_pass_cache) {}
+
+RenderGraphVk::~RenderGraphVk() { ReleaseTransients(); }
+
+RGResource RenderGraphVk::CreateImage(std::string name, const RGImageDesc& desc) {
+  Resource resource{};
+  resource.name = std::move(name);
+  resource.desc = desc;
+
+  m_resources.emplace_back(std::move(resource));
+  m_compiled = false;
+
+  return static_cast<RGResource>(m_resources.size() - 1);
+}
+
+RGResource RenderGraphVk::ImportImage(std::string name, const RGImageDesc& desc, VkImage image, VkImageView view,
+                                      VkImageLayout initial_layout, RGAccess final_access) {
+  Resource resource{};
+  resource.name = std::move(name);
+  resource.desc = desc;
+  resource.imported = true;
+  resource.initial_layout = initial_layout;
+  resource.final_access = final_access;
+  resource.image = image;
+  resource.view = view;
+
+  m_resources.emplace_back(std::move(resource));
+  m_compiled = false;
+
+  return static_cast<RGResource>(m_resources.size() - 1);
+}
+
+void RenderGraphVk::UpdateImportedImage(RGResource resource, VkImage image, VkImageView view) {
+  if (resource >= m_resources.size() || !m_resources[resource].imported) {
+    HEX_CORE_ERROR("RenderGraph: resource {} is not an imported image.", resource);
+    return;
+  }
+
+  m_resources[resource].image = image;
+  m_resources[resource].view = view;
+}
+
+void RenderGraphVk::AddPass(std::string name, const SetupFunc& setup, ExecuteFunc execute) {
+  Pass pass{};
+  pass.name = std::move(name);
+  pass.execute = std::move(execute);
+
+  m_passes.emplace_back(std::move(pass));
+
+  RGPassBuilder builder{this, static_cast<uint32_t>(m_passes.size() - 1)};
+  setup(builder);
+
+  m_passes.back().side_effect = builder.m_side_effect;
+  m_compiled = false;
+}
+
+void RenderGraphVk::MarkOutput(RGResource resource) {
+  m_resources[resource].output = true;
+  m_compiled = false;
+}
+
+bool RenderGraphVk::Compile() {
+  ReleaseTransients();
+
+  CullPasses();
+
+  ComputeLifetimes();
+
+  if (!AllocateTransients()) {
+    ReleaseTransients();
+    return false;
+  }
+
+  BuildBarriers();
+
+  m_compiled = true;
+
+  return true;
+}
+
+void RenderGraphVk::Execute(VkCommandBuffer cmd) const {
+  if (!m_compiled) {
+    HEX_CORE_ERROR("RenderGraph: Execute called before Compile.");
+    return;
+  }
+
+  for (size_t i = 0; i < m_order.size(); i++) {
+    RecordBarriers(cmd, m_pass_barriers[i]);
+
+    auto const& pass = m_passes[m_order[i]];
+    if (pass.execute) {
+      pass.execute(cmd, *this);
+    }
+  }
+
+  RecordBarriers(cmd, m_final_barriers);
+}
+
+void RenderGraphVk::Reset() {
+  ReleaseTransients();
+
+  m_passes.clear();
+  m_resources.clear();
+  m_compiled = false;
+}
+
+void RenderGraphVk::CullPasses() {
+  for (auto& pass : m_passes) {
+    pass.culled = true;
+  }
+
+  std::vector<bool> needed(m_resources.size(), false);
+  for (size_t i = 0; i < m_resources.size(); i++) {
+    needed[i] = m_resources[i].output;
+  }
+
+  // passes are declared in submission order, walking backwards finds every producer of a needed result
+  for (size_t i = m_passes.size(); i-- > 0;) {
+    auto& pass = m_passes[i];
+
+    bool live = pass.side_effect;
+    for (auto const& write : pass.writes) {
+      live = live || needed[write.resource];
+    }
+
+    if (!live) {
+      continue;
+    }
+
+    pass.culled = false;
+
+    // only a full overwrite ends the dependency, loading writes still need the earlier producers
+    for (auto const& write : pass.writes) {
+      if (write.overwrite) {
+        needed[write.resource] = false;
+      }
+    }
+
+    for (auto const& read : pass.reads) {
+      needed[read.resource] = true;
+    }
+  }
+
+  m_order.clear();
+  for (uint32_t i = 0; i < m_passes.size(); i++) {
+    if (!m_passes[i].culled) {
+      m_order.emplace_back(i);
+    }
+  }
+}
+
+void RenderGraphVk::ComputeLifetimes() {
+  for (auto& resource : m_resources) {
+    resource.first_pass = -1;
+    resource.last_pass = -1;
+    resource.usage = 0;
+  }
+
+  for (size_t i = 0; i < m_order.size(); i++) {
+    auto const& pass = m_passes[m_order[i]];
+
+    auto touch = [this, i](AccessInfo const& info) {
+      auto& resource = m_resources[info.resource];
+
+      if (resource.first_pass < 0) {
+        resource.first_pass = static_cast<int32_t>(i);
+      }
+      resource.last_pass = static_cast<int32_t>(i);
+      resource.usage |= GetAccessState(info.access).usage;
+    };
+
+    std::for_each(pass.reads.begin(), pass.reads.end(), touch);
+    std::for_each(pass.writes.begin(), pass.writes.end(), touch);
+  }
+}
+
+bool RenderGraphVk::AllocateTransients() {
+  std::vector<RGResource> transients{};
+  std::vector<VkMemoryRequirements> requirements(m_resources.size());
+
+  m_transient_requested_size = 0;
+
+  for (RGResource i = 0; i < m_resources.size(); i++) {
+    auto& resource = m_resources[i];
+    if (resource.imported || resource.first_pass < 0) {
+      continue;
+    }
+
+    VkImageCreateInfo info{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+    info.imageType = VK_IMAGE_TYPE_2D;
+    info.format = resource.desc.format;
+    info.extent = {resource.desc.width, resource.desc.height, 1};
+    info.mipLevels = 1;
+    info.arrayLayers = 1;
+    info.samples = resource.desc.samples;
+    info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    info.usage = resource.usage;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (g_vk.vkCreateImage(m_device, &info, nullptr, &resource.image) != VK_SUCCESS) {
+      HEX_CORE_ERROR("RenderGraph: failed create transient image {}.", resource.name);
+      return false;
+    }
+
+    g_vk.vkGetImageMemoryRequirements(m_device, resource.image, &requirements[i]);
+
+    resource.size = requirements[i].size;
+    m_transient_requested_size += resource.size;
+
+    transients.emplace_back(i);
+  }
+
+  // place biggest first, every image takes the lowest offset not used by any image alive at the same time
+  std::sort(transients.begin(), transients.end(),
+            [this](RGResource a, RGResource b) { return m_resources[a].size > m_resources[b].size; });
+
+  std::vector<RGResource> placed{};
+
+  for (auto index : transients) {
+    auto& resource = m_resources[index];
+    auto const& req = requirements[index];
+
+    uint32_t type_index = VulkanUtil::FindMemoryType(m_phy_device, req.memoryTypeBits,
+                                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (type_index == UINT32_MAX) {
+      HEX_CORE_ERROR("RenderGraph: no device local memory for transient image {}.", resource.name);
+      return false;
+    }
+
+    auto memory_it = std::find_if(m_memories.begin(), m_memories.end(),
+                                  [type_index](Memory const& m) { return m.type_index == type_index; });
+    if (memory_it == m_memories.end()) {
+      m_memories.emplace_back(Memory{type_index});
+      memory_it = std::prev(m_memories.end());
+    }
+
+    resource.memory_index = static_cast<uint32_t>(std::distance(m_memories.begin(), memory_it));
+
+    VkDeviceSize offset = 0;
+    bool moved = true;
+    while (moved) {
+      moved = false;
+
+      for (auto other_index : placed) {
+        auto const& other = m_resources[other_index];
+        if (other.memory_index != resource.memory_index ||
+            !Overlap(resource.first_pass, resource.last_pass, other.first_pass, other.last_pass)) {
+          continue;
+        }
+
+        if (offset < other.offset + other.size && other.offset < offset + resource.size) {
+          offset = AlignUp(other.offset + other.size, req.alignment);
+          moved = true;
+        }
+      }
+    }
+
+    resource.offset = offset;
+    memory_it->size = std::max(memory_it->size, offset + resource.size);
+
+    // remember the previous user of this memory for the debug dump
+    int32_t alias_last_pass = -1;
+    for (auto other_index : placed) {
+      auto const& other = m_resources[other_index];
+      if (other.memory_index == resource.memory_index && other.last_pass < resource.first_pass &&
+          other.last_pass > alias_last_pass && offset < other.offset + other.size &&
+          other.offset < offset + resource.size) {
+        resource.alias_of = other_index;
+        alias_last_pass = other.last_pass;
+      }
+    }
+
+    placed.emplace_back(index);
+  }
+
+  m_transient_memory_size = 0;
+
+  for (auto& memory : m_memories) {
+    VkMemoryAllocateInfo info{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+    info.allocationSize = memory.size;
+    info.memoryTypeIndex = memory.type_index;
+
+    if (g_vk.vkAllocateMemory(m_device, &info, nullptr, &memory.memory) != VK_SUCCESS) {
+      HEX_CORE_ERROR("RenderGraph: failed allocate {} bytes transient memory.", memory.size);
+      return false;
+    }
+
+    m_transient_memory_size += memory.size;
+  }
+
+  for (auto index : transients) {
+    auto& resource = m_resources[index];
+
+    g_vk.vkBindImageMemory(m_device, resource.image, m_memories[resource.memory_index].memory, resource.offset);
+
+    VkImageViewCreateInfo info{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+    info.image = resource.image;
+    info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    info.format = resource.desc.format;
+    info.subresourceRange = {VulkanUtil::FormatAspect(resource.desc.format), 0, 1, 0, 1};
+
+    if (g_vk.vkCreateImageView(m_device, &info, nullptr, &resource.view) != VK_SUCCESS) {
+      HEX_CORE_ERROR("RenderGraph: failed create view for transient image {}.", resource.name);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void RenderGraphVk::BuildBarriers() {
+  struct State {
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags stage = 0;
+    VkAccessFlags access = 0;
+    bool write = false;
+    bool initialized = false;
+  };
+
+  std::vector<State> states(m_resources.size());
+
+  for (size_t i = 0; i < m_resources.size(); i++) {
+    if (m_resources[i].imported) {
+      // whatever happened before the graph, including swapchain acquire semaphore wait
+      states[i].layout = m_resources[i].initial_layout;
+      states[i].stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+      states[i].initialized = true;
+    }
+  }
+
+  m_pass_barriers.assign(m_order.size(), {});
+  m_final_barriers.clear();
+
+  for (size_t i = 0; i < m_order.size(); i++) {
+    auto const& pass = m_passes[m_order[i]];
+
+    // merge all accesses of one resource inside a pass
+    std::unordered_map<RGResource, AccessState> accesses{};
+
+    auto merge = [&accesses](AccessInfo const& info) {
+      auto state = GetAccessState(info.access);
+      auto it = accesses.find(info.resource);
+
+      if (it == accesses.end()) {
+        accesses.emplace(info.resource, state);
+        return;
+      }
+
+      if (it->second.layout != state.layout) {
+        HEX_CORE_WARN("RenderGraph: resource {} used with different layouts in one pass.", info.resource);
+        state.stage |= it->second.stage;
+        state.access |= it->second.access;
+        state.write = state.write || it->second.write;
+        it->second = state;
+        return;
+      }
+
+      it->second.stage |= state.stage;
+      it->second.access |= state.access;
+      it->second.write = it->second.write || state.write;
+    };
+
+    std::for_each(pass.reads.begin(), pass.reads.end(), merge);
+    std::for_each(pass.writes.begin(), pass.writes.end(), merge);
+
+    for (auto const& it : accesses) {
+      RGResource index = it.first;
+      auto const& want = it.second;
+      auto& state = states[index];
+      auto const& resource = m_resources[index];
+
+      if (!state.initialized) {
+        // first use of a transient image, content is undefined and the memory may still be in use by the images
+        // it aliases
+        Barrier barrier{};
+        barrier.resource = index;
+        barrier.old_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.new_layout = want.layout;
+        barrier.src_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        barrier.dst_stage = want.stage;
+        barrier.dst_access = want.access;
+
+        for (size_t j = 0; j < m_resources.size(); j++) {
+          auto const& other = m_resources[j];
+          if (j == index || other.imported || other.memory_index != resource.memory_index ||
+              other.last_pass < 0 || other.last_pass >= resource.first_pass) {
+            continue;
+          }
+
+          if (resource.offset < other.offset + other.size && other.offset < resource.offset + resource.size) {
+            barrier.src_stage |= states[j].stage;
+            barrier.src_access |= states[j].access;
+          }
+        }
+
+        m_pass_barriers[i].emplace_back(barrier);
+
+        state = {want.layout, want.stage, want.access, want.write, true};
+        continue;
+      }
+
+      if (state.layout == want.layout && !state.write && !want.write) {
+        // read after read in same layout, later writers must wait for every reader
+        state.stage |= want.stage;
+        state.access |= want.access;
+        continue;
+      }
+
+      Barrier barrier{};
+      barrier.resource = index;
+      barrier.old_layout = state.layout;
+      barrier.new_layout = want.layout;
+      barrier.src_stage = state.stage;
+      barrier.src_access = state.write ? state.access : 0;
+      barrier.dst_stage = want.stage;
+      barrier.dst_access = want.access;
+
+      m_pass_barriers[i].emplace_back(barrier);
+
+      state = {want.layout, want.stage, want.access, want.write, true};
+    }
+  }
+
+  for (RGResource i = 0; i < m_resources.size(); i++) {
+    auto const& resource = m_resources[i];
+    if (!resource.imported || resource.first_pass < 0) {
+      continue;
+    }
+
+    auto want = GetAccessState(resource.final_access);
+    auto const& state = states[i];
+
+    if (state.layout == want.layout && !state.write) {
+      continue;
+    }
+
+    Barrier barrier{};
+    barrier.resource = i;
+    barrier.old_layout = state.layout;
+    barrier.new_layout = want.layout;
+    barrier.src_stage = state.stage;
+    barrier.src_access = state.write ? state.access : 0;
+    barrier.dst_stage = want.stage;
+    barrier.dst_access = want.access;
+
+    m_final_barriers.emplace_back(barrier);
+  }
+}
+
+void RenderGraphVk::RecordBarriers(VkCommandBuffer cmd, const std::vector<Barrier>& barriers) const {
+  if (barriers.empty()) {
+    return;
+  }
+
+  VkPipelineStageFlags src_stage = 0;
+  VkPipelineStageFlags dst_stage = 0;
+
+  std::vector<VkImageMemoryBarrier> image_barriers{};
+  image_barriers.reserve(barriers.size());
+
+  for (auto const& barrier : barriers) {
+    auto const& resource = m_resources[barrier.resource];
+
+    VkImageMemoryBarrier image_barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+    image_barrier.srcAccessMask = barrier.src_access;
+    image_barrier.dstAccessMask = barrier.dst_access;
+    image_barrier.oldLayout = barrier.old_layout;
+    image_barrier.newLayout = barrier.new_layout;
+    image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.image = resource.image;
+    image_barrier.subresourceRange = {VulkanUtil::FormatAspect(resource.desc.format), 0, VK_REMAINING_MIP_LEVELS, 0,
+                                      VK_REMAINING_ARRAY_LAYERS};
+
+    image_barriers.emplace_back(image_barrier);
+
+    src_stage |= barrier.src_stage;
+    dst_stage |= barrier.dst_stage;
+  }
+
+  g_vk.vkCmdPipelineBarrier(cmd, src_stage ? src_stage : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                            dst_stage ? dst_stage : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr,
+                            static_cast<uint32_t>(image_barriers.size()), image_barriers.data());
+}
+
+void RenderGraphVk::ReleaseTransients() {
+  for (auto& resource : m_resources) {
+    if (resource.imported) {
+      continue;
+    }
+
+    if (resource.view) {
+      if (m_render_pass_cache) {
+        m_render_pass_cache->Evict(resource.view);
+      }
+
+      ReleaseHandle(VK_OBJECT_TYPE_IMAGE_VIEW, reinterpret_cast<uint64_t>(resource.view));
+      resource.view = VK_NULL_HANDLE;
+    }
+
+    if (resource.image) {
+      ReleaseHandle(VK_OBJECT_TYPE_IMAGE, reinterpret_cast<uint64_t>(resource.image));
+      resource.image = VK_NULL_HANDLE;
+    }
+
+    resource.memory_index = UINT32_MAX;
+    resource.alias_of = kInvalidRGResource;
+  }
+
+  for (auto& memory : m_memories) {
+    if (memory.memory) {
+      ReleaseHandle(VK_OBJECT_TYPE_DEVICE_MEMORY, reinterpret_cast<uint64_t>(memory.memory));
+    }
+  }
+
+  m_memories.clear();
+  m_order.clear();
+  m_pass_barriers.clear();
+  m_final_barriers.clear();
+  m_transient_memory_size = 0;
+  m_transient_requested_size = 0;
+  m_compiled = false;
+}
+
+void RenderGraphVk::ReleaseHandle(VkObjectType type, uint64_t handle) {
+  if (m_delegate) {
+    m_delegate->OnReleaseHandle(type, handle);
+    return;
+  }
+
+  switch (type) {
+    case VK_OBJECT_TYPE_IMAGE_VIEW:
+      g_vk.vkDestroyImageView(m_device, reinterpret_cast<VkImageView>(handle), nullptr);
+      break;
+    case VK_OBJECT_TYPE_IMAGE:
+      g_vk.vkDestroyImage(m_device, reinterpret_cast<VkImage>(handle), nullptr);
+      break;
+    case VK_OBJECT_TYPE_DEVICE_MEMORY:
+      g_vk.vkFreeMemory(m_device, reinterpret_cast<VkDeviceMemory>(handle), nullptr);
+      break;
+    default:
+      break;
+  }
+}
+
+std::string RenderGraphVk::Dump() const {
+  std::string result =
+      fmt::format("RenderGraph: {} passes ({} culled), {} resources\n", m_passes.size(),
+                  m_passes.size() - m_order.size(), m_resources.size());
+
+  auto dump_barriers = [this, &result](std::vector<Barrier> const& barriers) {
+    for (auto const& barrier : barriers) {
+      result += fmt::format("    barrier {}: {} -> {}\n", m_resources[barrier.resource].name,
+                            LayoutName(barrier.old_layout), LayoutName(barrier.new_layout));
+    }
+  };
+
+  for (size_t i = 0; i < m_order.size(); i++) {
+    auto const& pass = m_passes[m_order[i]];
+
+    result += fmt::format("  pass [{}] {}\n", i, pass.name);
+    dump_barriers(m_pass_barriers[i]);
+
+    for (auto const& read : pass.reads) {
+      result += fmt::format("    read  {} ({})\n", m_resources[read.resource].name, AccessName(read.access));
+    }
+
+    for (auto const& write : pass.writes) {
+      result += fmt::format("    write {} ({})\n", m_resources[write.resource].name, AccessName(write.access));
+    }
+  }
+
+  for (auto const& pass : m_passes) {
+    if (pass.culled) {
+      result += fmt::format("  pass [-] {} (culled)\n", pass.name);
+    }
+  }
+
+  if (!m_final_barriers.empty()) {
+    result += "  final\n";
+    dump_barriers(m_final_barriers);
+  }
+
+  result += "  resources\n";
+
+  for (auto const& resource : m_resources) {
+    result += fmt::format("    {} {}x{} format {} lifetime [{}, {}]", resource.name, resource.desc.width,
+                          resource.desc.height, static_cast<int32_t>(resource.desc.format), resource.first_pass,
+                          resource.last_pass);
+
+    if (resource.imported) {
+      result += " imported";
+    } else if (resource.memory_index != UINT32_MAX) {
+      result += fmt::format(" memory {} offset {} size {}", resource.memory_index, resource.offset, resource.size);
+
+      if (resource.alias_of != kInvalidRGResource) {
+        result += fmt::format(" aliases {}", m_resources[resource.alias_of].name);
+      }
+    } else {
+      result += " unused";
+    }
+
+    result += "\n";
+  }
+
+  result += fmt::format("  transient memory: requested {} bytes, allocated {} bytes\n", m_transient_requested_size,
+                        m_transient_memory_size);
+
+  return result;
+}
+
+}  // namespace hexgon
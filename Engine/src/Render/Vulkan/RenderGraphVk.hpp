@@ -0,0 +1,219 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace hexgon {
+
+class GpuResourceDelegateVk;
+class RenderGraphVk;
+class RenderPassCacheVk;
+
+using RGResource = uint32_t;
+
+constexpr RGResource kInvalidRGResource = UINT32_MAX;
+
+enum class RGAccess {
+  kColorAttachment,
+  kDepthAttachment,
+  kDepthRead,
+  kSampled,
+  kStorageRead,
+  kStorageWrite,
+  kTransferSrc,
+  kTransferDst,
+  kPresent,
+};
+
+struct RGImageDesc {
+  VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+};
+
+class RGPassBuilder {
+  friend class RenderGraphVk;
+
+ public:
+  RGResource Read(RGResource resource, RGAccess access);
+
+  // `overwrite` means every texel is replaced without reading the old content (clear or don't care load op, full
+  // storage write). Otherwise the pass keeps what earlier passes wrote and depends on them like a read.
+  RGResource Write(RGResource resource, RGAccess access, bool overwrite = false);
+
+  // pass is never culled, even if nothing reads its output
+  void SetSideEffect() { m_side_effect = true; }
+
+ private:
+  RGPassBuilder(RenderGraphVk* graph, uint32_t pass) : m_graph(graph), m_pass(pass) {}
+
+ private:
+  RenderGraphVk* m_graph;
+  uint32_t m_pass;
+  bool m_side_effect = false;
+};
+
+// Frame graph of passes working on images.
+// Passes declare what they read and write during setup, Compile() culls passes whose results are never consumed,
+// computes layout transitions and barriers between passes, and places transient images whose lifetimes do not overlap
+// on the same device memory.
+class RenderGraphVk {
+  friend class RGPassBuilder;
+
+ public:
+  using SetupFunc = std::function<void(RGPassBuilder&)>;
+  using ExecuteFunc = std::function<void(VkCommandBuffer, RenderGraphVk const&)>;
+
+  // transient images go to `delegate` when the graph is recompiled or reset, frames in flight may still use them.
+  // Without a delegate they are destroyed at once and the device has to be idle. Framebuffers `render_pass_cache`
+  // built on transient images are released together with the images.
+  RenderGraphVk(VkDevice device, VkPhysicalDevice phy_device, GpuResourceDelegateVk* delegate,
+                RenderPassCacheVk* render_pass_cache = nullptr);
+
+  ~RenderGraphVk();
+
+  RGResource CreateImage(std::string name, RGImageDesc const& desc);
+
+  // external image like swapchain back buffer, `final_access` is the state left after graph execution
+  RGResource ImportImage(std::string name, RGImageDesc const& desc, VkImage image, VkImageView view,
+                         VkImageLayout initial_layout, RGAccess final_access);
+
+  // an imported image can be swapped every frame without recompiling, e.g. the acquired swapchain image
+  void UpdateImportedImage(RGResource resource, VkImage image, VkImageView view);
+
+  void AddPass(std::string name, SetupFunc const& setup, ExecuteFunc execute);
+
+  void MarkOutput(RGResource resource);
+
+  bool Compile();
+
+  void Execute(VkCommandBuffer cmd) const;
+
+  // drop all passes and resources, graph can be built again after this
+  void Reset();
+
+  std::string Dump() const;
+
+  VkImage GetImage(RGResource resource) const { return m_resources[resource].image; }
+
+  VkImageView GetImageView(RGResource resource) const { return m_resources[resource].view; }
+
+  RGImageDesc const& GetImageDesc(RGResource resource) const { return m_resources[resource].desc; }
+
+  VkDeviceSize GetTransientMemorySize() const { return m_transient_memory_size; }
+
+  VkDeviceSize GetTransientRequestedSize() const { return m_transient_requested_size; }
+
+ private:
+  struct AccessInfo {
+    RGResource resource = kInvalidRGResource;
+    RGAccess access = {};
+    bool overwrite = false;
+  };
+
+  struct Pass {
+    std::string name = {};
+    ExecuteFunc execute = {};
+    std::vector<AccessInfo> reads = {};
+    std::vector<AccessInfo> writes = {};
+    bool side_effect = false;
+    bool culled = false;
+  };
+
+  struct Resource {
+    std::string name = {};
+    RGImageDesc desc = {};
+    bool imported = false;
+    bool output = false;
+    VkImageLayout initial_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    RGAccess final_access = RGAccess::kSampled;
+    VkImageUsageFlags usage = 0;
+    // lifetime in compiled pass order
+    int32_t first_pass = -1;
+    int32_t last_pass = -1;
+    // aliasing
+    uint32_t memory_index = UINT32_MAX;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    RGResource alias_of = kInvalidRGResource;
+    VkImage image = {};
+    VkImageView view = {};
+  };
+
+  struct Barrier {
+    RGResource resource = kInvalidRGResource;
+    VkImageLayout old_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkImageLayout new_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags src_stage = 0;
+    VkPipelineStageFlags dst_stage = 0;
+    VkAccessFlags src_access = 0;
+    VkAccessFlags dst_access = 0;
+  };
+
+  struct Memory {
+    uint32_t type_index = UINT32_MAX;
+    VkDeviceSize size = 0;
+    VkDeviceMemory memory = {};
+  };
+
+ private:
+  void CullPasses();
+
+  void ComputeLifetimes();
+
+  bool AllocateTransients();
+
+  void BuildBarriers();
+
+  void RecordBarriers(VkCommandBuffer cmd, std::vector<Barrier> const& barriers) const;
+
+  void ReleaseTransients();
+
+  void ReleaseHandle(VkObjectType type, uint64_t handle);
+
+ private:
+  VkDevice m_device;
+  VkPhysicalDevice m_phy_device;
+  GpuResourceDelegateVk* m_delegate;
+  RenderPassCacheVk* m_render_pass_cache;
+  std::vector<Pass> m_passes = {};
+  std::vector<Resource> m_resources = {};
+  // compiled data
+  std::vector<uint32_t> m_order = {};
+  std::vector<std::vector<Barrier>> m_pass_barriers = {};
+  std::vector<Barrier> m_final_barriers = {};
+  std::vector<Memory> m_memories = {};
+  VkDeviceSize m_transient_memory_size = 0;
+  VkDeviceSize m_transient_requested_size = 0;
+  bool m_compiled = false;
+};
+
+}  // namespace hexgon
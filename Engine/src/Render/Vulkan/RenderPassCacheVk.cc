@@ -0,0 +1,528 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include "Render/Vulkan/RenderPassCacheVk.hpp"
+
+#include <algorithm>
+#include <functional>
+
+#include "Core/Util/HashCombine.hpp"
+#include "LogPrivate.hpp"
+#include "Render/Vulkan/DispatchVk.hpp"
+#include "Render/Vulkan/GpuResourceVk.hpp"
+#include "Render/Vulkan/VulkanUtil.hpp"
+
+namespace hexgon {
+
+namespace {
+
+bool HasStencil(VkFormat format) { return VulkanUtil::FormatAspect(format) & VK_IMAGE_ASPECT_STENCIL_BIT; }
+
+}  // namespace
+
+void RenderPassCacheVk::Init(VkDevice device, GpuResourceDelegateVk* delegate, bool dynamic_rendering,
+                             bool imageless_framebuffer) {
+  m_device = device;
+  m_delegate = delegate;
+  m_imageless = imageless_framebuffer;
+
+  // the dispatch table resolves the core or the extension entry points
+  m_dynamic_rendering = dynamic_rendering && g_vk.vkCmdBeginRendering && g_vk.vkCmdEndRendering;
+
+  HEX_CORE_INFO("Passes use {}.", m_dynamic_rendering ? "dynamic rendering"
+                                  : m_imageless      ? "render passes with imageless framebuffers"
+                                                     : "render passes");
+}
+
+void RenderPassCacheVk::BeginRendering(VkCommandBuffer cmd, const RenderingInfoVk& info, bool secondaries) {
+  if (m_dynamic_rendering) {
+    BeginDynamic(cmd, info, secondaries);
+    return;
+  }
+
+  std::vector<VkImageView> views = CollectViews(info);
+  std::vector<VkClearValue> clear_values(views.size());
+
+  for (size_t i = 0; i < info.colors.size(); i++) {
+    clear_values[i] = info.colors[i].clear;
+  }
+
+  if (info.depth.format != VK_FORMAT_UNDEFINED) {
+    clear_values.back() = info.depth.clear;
+  }
+
+  VkRenderPassBeginInfo begin_info{VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    begin_info.renderPass = GetRenderPassLocked(MakeKey(info, false));
+    begin_info.framebuffer = GetFramebufferLocked(info);
+  }
+
+  if (!begin_info.renderPass || !begin_info.framebuffer) {
+    return;
+  }
+
+  begin_info.renderArea = {{0, 0}, {info.width, info.height}};
+  begin_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
+  begin_info.pClearValues = clear_values.data();
+
+  VkRenderPassAttachmentBeginInfo attachment_info{VK_STRUCTURE_TYPE_RENDER_PASS_ATTACHMENT_BEGIN_INFO};
+  if (m_imageless) {
+    attachment_info.attachmentCount = static_cast<uint32_t>(views.size());
+    attachment_info.pAttachments = views.data();
+    begin_info.pNext = &attachment_info;
+  }
+
+  g_vk.vkCmdBeginRenderPass(cmd, &begin_info,
+                            secondaries ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+}
+
+void RenderPassCacheVk::EndRendering(VkCommandBuffer cmd) {
+  if (m_dynamic_rendering) {
+    g_vk.vkCmdEndRendering(cmd);
+  } else {
+    g_vk.vkCmdEndRenderPass(cmd);
+  }
+}
+
+VkRenderPass RenderPassCacheVk::GetRenderPass(const RenderingInfoVk& info) {
+  if (m_dynamic_rendering) {
+    return VK_NULL_HANDLE;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  return GetRenderPassLocked(MakeKey(info, false));
+}
+
+VkPipelineRenderingCreateInfo RenderPassCacheVk::GetPipelineRendering(const RenderingInfoVk& info,
+                                                                     std::vector<VkFormat>& formats) const {
+  formats.clear();
+  for (auto const& color : info.colors) {
+    formats.emplace_back(color.format);
+  }
+
+  VkPipelineRenderingCreateInfo rendering{VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO};
+  rendering.colorAttachmentCount = static_cast<uint32_t>(formats.size());
+  rendering.pColorAttachmentFormats = formats.data();
+  rendering.depthAttachmentFormat = info.depth.format;
+  rendering.stencilAttachmentFormat = HasStencil(info.depth.format) ? info.depth.format : VK_FORMAT_UNDEFINED;
+
+  return rendering;
+}
+
+void RenderPassCacheVk::GetInheritance(const RenderingInfoVk& info, RenderingInheritanceVk& inheritance) {
+  inheritance.info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+
+  if (!m_dynamic_rendering) {
+    inheritance.info.renderPass = GetRenderPass(info);
+    inheritance.info.subpass = 0;
+    return;
+  }
+
+  inheritance.color_formats.clear();
+  for (auto const& color : info.colors) {
+    inheritance.color_formats.emplace_back(color.format);
+  }
+
+  VkSampleCountFlagBits samples = info.colors.empty() ? info.depth.samples : info.colors.front().samples;
+
+  inheritance.rendering = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO};
+  inheritance.rendering.colorAttachmentCount = static_cast<uint32_t>(inheritance.color_formats.size());
+  inheritance.rendering.pColorAttachmentFormats = inheritance.color_formats.data();
+  inheritance.rendering.depthAttachmentFormat = info.depth.format;
+  inheritance.rendering.stencilAttachmentFormat =
+      HasStencil(info.depth.format) ? info.depth.format : VK_FORMAT_UNDEFINED;
+  inheritance.rendering.rasterizationSamples = samples;
+
+  inheritance.info.pNext = &inheritance.rendering;
+}
+
+void RenderPassCacheVk::Trim(uint64_t frame) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_frame = frame;
+
+  for (auto it = m_framebuffers.begin(); it != m_framebuffers.end();) {
+    if (it->second.last_used + kFramebufferLifetime < frame) {
+      // frames in flight may still reference it, the delegate destroys it once they are done
+      m_delegate->OnReleaseHandle(VK_OBJECT_TYPE_FRAMEBUFFER, reinterpret_cast<uint64_t>(it->second.framebuffer));
+      it = m_framebuffers.erase(it);
+    } else {
+      it++;
+    }
+  }
+}
+
+void RenderPassCacheVk::Evict(VkImageView view) {
+  if (!view || m_imageless) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  for (auto it = m_framebuffers.begin(); it != m_framebuffers.end();) {
+    auto const& views = it->first.views;
+
+    if (std::find(views.begin(), views.end(), view) != views.end()) {
+      m_delegate->OnReleaseHandle(VK_OBJECT_TYPE_FRAMEBUFFER, reinterpret_cast<uint64_t>(it->second.framebuffer));
+      it = m_framebuffers.erase(it);
+    } else {
+      it++;
+    }
+  }
+}
+
+size_t RenderPassCacheVk::GetRenderPassCount() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_render_passes.size();
+}
+
+size_t RenderPassCacheVk::GetFramebufferCount() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_framebuffers.size();
+}
+
+void RenderPassCacheVk::Destroy() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  for (auto const& it : m_framebuffers) {
+    g_vk.vkDestroyFramebuffer(m_device, it.second.framebuffer, nullptr);
+  }
+
+  for (auto const& it : m_render_passes) {
+    g_vk.vkDestroyRenderPass(m_device, it.second, nullptr);
+  }
+
+  m_framebuffers.clear();
+  m_render_passes.clear();
+}
+
+RenderPassCacheVk::RenderPassKey RenderPassCacheVk::MakeKey(const RenderingInfoVk& info, bool compatible) {
+  auto make = [compatible](const RenderingAttachmentVk& attachment) {
+    AttachmentKey key{};
+    key.format = attachment.format;
+    key.samples = attachment.samples;
+    key.resolve = attachment.resolve_view != VK_NULL_HANDLE;
+
+    if (!compatible) {
+      key.load_op = attachment.load_op;
+      key.store_op = attachment.store_op;
+    }
+
+    return key;
+  };
+
+  RenderPassKey key{};
+  for (auto const& color : info.colors) {
+    key.colors.emplace_back(make(color));
+  }
+
+  if (info.depth.format != VK_FORMAT_UNDEFINED) {
+    key.depth = make(info.depth);
+    // depth resolve needs VK_KHR_depth_stencil_resolve, not supported here
+    key.depth.resolve = false;
+  }
+
+  return key;
+}
+
+VkRenderPass RenderPassCacheVk::GetRenderPassLocked(const RenderPassKey& key) {
+  auto it = m_render_passes.find(key);
+  if (it != m_render_passes.end()) {
+    return it->second;
+  }
+
+  std::vector<VkAttachmentDescription> attachments{};
+  std::vector<VkAttachmentReference> color_refs{};
+  std::vector<VkAttachmentReference> resolve_refs{};
+
+  for (auto const& color : key.colors) {
+    VkAttachmentDescription desc{};
+    desc.format = color.format;
+    desc.samples = color.samples;
+    desc.loadOp = color.load_op;
+    desc.storeOp = color.store_op;
+    desc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    desc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    desc.initialLayout = color.load_op == VK_ATTACHMENT_LOAD_OP_LOAD ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+                                                                     : VK_IMAGE_LAYOUT_UNDEFINED;
+    desc.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    color_refs.push_back({static_cast<uint32_t>(attachments.size()), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL});
+    attachments.emplace_back(desc);
+  }
+
+  for (auto const& color : key.colors) {
+    if (!color.resolve) {
+      resolve_refs.push_back({VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED});
+      continue;
+    }
+
+    VkAttachmentDescription desc{};
+    desc.format = color.format;
+    desc.samples = VK_SAMPLE_COUNT_1_BIT;
+    desc.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    desc.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    desc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    desc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    desc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    desc.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    resolve_refs.push_back({static_cast<uint32_t>(attachments.size()), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL});
+    attachments.emplace_back(desc);
+  }
+
+  bool has_resolve = std::any_of(key.colors.begin(), key.colors.end(), [](auto const& c) { return c.resolve; });
+
+  VkAttachmentReference depth_ref{};
+  bool has_depth = key.depth.format != VK_FORMAT_UNDEFINED;
+
+  if (has_depth) {
+    bool stencil = HasStencil(key.depth.format);
+
+    VkAttachmentDescription desc{};
+    desc.format = key.depth.format;
+    desc.samples = key.depth.samples;
+    desc.loadOp = key.depth.load_op;
+    desc.storeOp = key.depth.store_op;
+    desc.stencilLoadOp = stencil ? key.depth.load_op : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    desc.stencilStoreOp = stencil ? key.depth.store_op : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    desc.initialLayout = key.depth.load_op == VK_ATTACHMENT_LOAD_OP_LOAD
+                             ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+                             : VK_IMAGE_LAYOUT_UNDEFINED;
+    desc.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    depth_ref = {static_cast<uint32_t>(attachments.size()), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+    attachments.emplace_back(desc);
+  }
+
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = static_cast<uint32_t>(color_refs.size());
+  subpass.pColorAttachments = color_refs.data();
+  subpass.pResolveAttachments = has_resolve ? resolve_refs.data() : nullptr;
+  subpass.pDepthStencilAttachment = has_depth ? &depth_ref : nullptr;
+
+  // barriers around the pass come from the render graph, the subpass has no external dependencies of its own
+  VkRenderPassCreateInfo create_info{VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
+  create_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+  create_info.pAttachments = attachments.data();
+  create_info.subpassCount = 1;
+  create_info.pSubpasses = &subpass;
+
+  VkRenderPass render_pass = VK_NULL_HANDLE;
+  if (g_vk.vkCreateRenderPass(m_device, &create_info, nullptr, &render_pass) != VK_SUCCESS) {
+    HEX_CORE_ERROR("Failed create render pass with {} color attachments.", key.colors.size());
+    return VK_NULL_HANDLE;
+  }
+
+  m_render_passes.emplace(key, render_pass);
+
+  return render_pass;
+}
+
+VkFramebuffer RenderPassCacheVk::GetFramebufferLocked(const RenderingInfoVk& info) {
+  FramebufferKey key{};
+  key.render_pass = GetRenderPassLocked(MakeKey(info, true));
+  key.width = info.width;
+  key.height = info.height;
+  key.layers = info.layers;
+
+  if (!key.render_pass) {
+    return VK_NULL_HANDLE;
+  }
+
+  // same order as CollectViews
+  std::vector<VkFormat> formats{};
+  for (auto const& color : info.colors) {
+    key.usages.emplace_back(color.usage);
+    formats.emplace_back(color.format);
+  }
+
+  for (auto const& color : info.colors) {
+    if (color.resolve_view) {
+      key.usages.emplace_back(color.resolve_usage);
+      formats.emplace_back(color.format);
+    }
+  }
+
+  if (info.depth.format != VK_FORMAT_UNDEFINED) {
+    key.usages.emplace_back(info.depth.usage);
+    formats.emplace_back(info.depth.format);
+  }
+
+  if (!m_imageless) {
+    key.views = CollectViews(info);
+  }
+
+  auto it = m_framebuffers.find(key);
+  if (it != m_framebuffers.end()) {
+    it->second.last_used = m_frame;
+    return it->second.framebuffer;
+  }
+
+  std::vector<VkFramebufferAttachmentImageInfo> image_infos(formats.size());
+  for (size_t i = 0; i < formats.size(); i++) {
+    image_infos[i] = {VK_STRUCTURE_TYPE_FRAMEBUFFER_ATTACHMENT_IMAGE_INFO};
+    image_infos[i].usage = key.usages[i];
+    image_infos[i].width = info.width;
+    image_infos[i].height = info.height;
+    image_infos[i].layerCount = info.layers;
+    image_infos[i].viewFormatCount = 1;
+    image_infos[i].pViewFormats = &formats[i];
+  }
+
+  VkFramebufferAttachmentsCreateInfo attachments_info{VK_STRUCTURE_TYPE_FRAMEBUFFER_ATTACHMENTS_CREATE_INFO};
+  attachments_info.attachmentImageInfoCount = static_cast<uint32_t>(image_infos.size());
+  attachments_info.pAttachmentImageInfos = image_infos.data();
+
+  VkFramebufferCreateInfo create_info{VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
+  create_info.renderPass = key.render_pass;
+  create_info.attachmentCount = static_cast<uint32_t>(formats.size());
+  create_info.width = info.width;
+  create_info.height = info.height;
+  create_info.layers = info.layers;
+
+  if (m_imageless) {
+    create_info.pNext = &attachments_info;
+    create_info.flags = VK_FRAMEBUFFER_CREATE_IMAGELESS_BIT;
+  } else {
+    create_info.pAttachments = key.views.data();
+  }
+
+  Framebuffer framebuffer{};
+  framebuffer.last_used = m_frame;
+
+  if (g_vk.vkCreateFramebuffer(m_device, &create_info, nullptr, &framebuffer.framebuffer) != VK_SUCCESS) {
+    HEX_CORE_ERROR("Failed create {}x{} framebuffer.", info.width, info.height);
+    return VK_NULL_HANDLE;
+  }
+
+  m_framebuffers.emplace(std::move(key), framebuffer);
+
+  return framebuffer.framebuffer;
+}
+
+std::vector<VkImageView> RenderPassCacheVk::CollectViews(const RenderingInfoVk& info) {
+  std::vector<VkImageView> views{};
+
+  for (auto const& color : info.colors) {
+    views.emplace_back(color.view);
+  }
+
+  for (auto const& color : info.colors) {
+    if (color.resolve_view) {
+      views.emplace_back(color.resolve_view);
+    }
+  }
+
+  if (info.depth.format != VK_FORMAT_UNDEFINED) {
+    views.emplace_back(info.depth.view);
+  }
+
+  return views;
+}
+
+void RenderPassCacheVk::BeginDynamic(VkCommandBuffer cmd, const RenderingInfoVk& info, bool secondaries) {
+  std::vector<VkRenderingAttachmentInfo> colors(info.colors.size());
+
+  for (size_t i = 0; i < info.colors.size(); i++) {
+    auto const& color = info.colors[i];
+
+    colors[i] = {VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+    colors[i].imageView = color.view;
+    colors[i].imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colors[i].loadOp = color.load_op;
+    colors[i].storeOp = color.store_op;
+    colors[i].clearValue = color.clear;
+
+    if (color.resolve_view) {
+      colors[i].resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
+      colors[i].resolveImageView = color.resolve_view;
+      colors[i].resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    }
+  }
+
+  VkRenderingAttachmentInfo depth{VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+  depth.imageView = info.depth.view;
+  depth.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  depth.loadOp = info.depth.load_op;
+  depth.storeOp = info.depth.store_op;
+  depth.clearValue = info.depth.clear;
+
+  bool has_depth = info.depth.format != VK_FORMAT_UNDEFINED;
+
+  VkRenderingInfo rendering{VK_STRUCTURE_TYPE_RENDERING_INFO};
+  rendering.flags = secondaries ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0;
+  rendering.renderArea = {{0, 0}, {info.width, info.height}};
+  rendering.layerCount = info.layers;
+  rendering.colorAttachmentCount = static_cast<uint32_t>(colors.size());
+  rendering.pColorAttachments = colors.data();
+  rendering.pDepthAttachment = has_depth ? &depth : nullptr;
+  rendering.pStencilAttachment = has_depth && HasStencil(info.depth.format) ? &depth : nullptr;
+
+  g_vk.vkCmdBeginRendering(cmd, &rendering);
+}
+
+size_t RenderPassCacheVk::KeyHash::operator()(const RenderPassKey& key) const {
+  size_t seed = 0;
+
+  auto hash_attachment = [&seed](const AttachmentKey& attachment) {
+    HashCombine(seed, static_cast<uint32_t>(attachment.format));
+    HashCombine(seed, static_cast<uint32_t>(attachment.samples));
+    HashCombine(seed, static_cast<uint32_t>(attachment.load_op));
+    HashCombine(seed, static_cast<uint32_t>(attachment.store_op));
+    HashCombine(seed, attachment.resolve);
+  };
+
+  for (auto const& color : key.colors) {
+    hash_attachment(color);
+  }
+
+  hash_attachment(key.depth);
+
+  return seed;
+}
+
+size_t RenderPassCacheVk::KeyHash::operator()(const FramebufferKey& key) const {
+  size_t seed = 0;
+
+  HashCombine(seed, reinterpret_cast<uint64_t>(key.render_pass));
+  HashCombine(seed, key.width);
+  HashCombine(seed, key.height);
+  HashCombine(seed, key.layers);
+
+  for (auto usage : key.usages) {
+    HashCombine(seed, usage);
+  }
+
+  for (auto view : key.views) {
+    HashCombine(seed, reinterpret_cast<uint64_t>(view));
+  }
+
+  return seed;
+}
+
+}  // namespace hexgon
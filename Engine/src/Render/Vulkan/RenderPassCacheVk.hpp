@@ -0,0 +1,181 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace hexgon {
+
+class GpuResourceDelegateVk;
+
+struct RenderingAttachmentVk {
+  VkImageView view = {};
+  VkFormat format = VK_FORMAT_UNDEFINED;
+  VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+  VkAttachmentLoadOp load_op = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  VkAttachmentStoreOp store_op = VK_ATTACHMENT_STORE_OP_STORE;
+  VkClearValue clear = {};
+  // usage the image was created with, imageless framebuffers are matched against it
+  VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  // single sample color image the attachment is resolved into at the end of the pass
+  VkImageView resolve_view = {};
+  VkImageUsageFlags resolve_usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+};
+
+// Attachments are expected in COLOR_ATTACHMENT_OPTIMAL / DEPTH_STENCIL_ATTACHMENT_OPTIMAL when the pass starts (any
+// layout if the load op does not load) and are left in that layout, transitions belong to the render graph.
+struct RenderingInfoVk {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t layers = 1;
+  std::vector<RenderingAttachmentVk> colors = {};
+  // no depth attachment while format is VK_FORMAT_UNDEFINED
+  RenderingAttachmentVk depth = {};
+};
+
+// secondary command buffers recorded inside a pass inherit from this, keep it alive until they are begun
+struct RenderingInheritanceVk {
+  VkCommandBufferInheritanceInfo info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+  VkCommandBufferInheritanceRenderingInfo rendering = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO};
+  std::vector<VkFormat> color_formats = {};
+};
+
+// Begins passes either with VK_KHR_dynamic_rendering, which needs no objects at all, or with cached render passes and
+// imageless framebuffers. Render passes are keyed by attachment formats, sample counts and load/store ops.
+// Framebuffers only depend on the attachment formats and extent, so every compatible pass shares them and a new
+// swapchain of the same size and format finds its framebuffer already there.
+class RenderPassCacheVk {
+ public:
+  // framebuffers not used for this many frames are released
+  static constexpr uint64_t kFramebufferLifetime = 120;
+
+  RenderPassCacheVk() = default;
+
+  void Init(VkDevice device, GpuResourceDelegateVk* delegate, bool dynamic_rendering, bool imageless_framebuffer);
+
+  bool IsDynamicRendering() const { return m_dynamic_rendering; }
+
+  // `secondaries` when the pass content is recorded into secondary command buffers
+  void BeginRendering(VkCommandBuffer cmd, RenderingInfoVk const& info, bool secondaries = false);
+
+  void EndRendering(VkCommandBuffer cmd);
+
+  // VK_NULL_HANDLE with dynamic rendering, pipelines then chain GetPipelineRendering instead
+  VkRenderPass GetRenderPass(RenderingInfoVk const& info);
+
+  VkPipelineRenderingCreateInfo GetPipelineRendering(RenderingInfoVk const& info, std::vector<VkFormat>& formats) const;
+
+  void GetInheritance(RenderingInfoVk const& info, RenderingInheritanceVk& inheritance);
+
+  // release framebuffers which have not been used for kFramebufferLifetime frames
+  void Trim(uint64_t frame);
+
+  // release every framebuffer built on `view` before the view is destroyed, a new view may get the same handle value.
+  // Nothing to do with imageless framebuffers, they do not reference views.
+  void Evict(VkImageView view);
+
+  size_t GetRenderPassCount();
+
+  size_t GetFramebufferCount();
+
+  void Destroy();
+
+ private:
+  struct AttachmentKey {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    VkAttachmentLoadOp load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    VkAttachmentStoreOp store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    bool resolve = false;
+
+    bool operator==(const AttachmentKey& other) const {
+      return format == other.format && samples == other.samples && load_op == other.load_op &&
+             store_op == other.store_op && resolve == other.resolve;
+    }
+  };
+
+  struct RenderPassKey {
+    std::vector<AttachmentKey> colors = {};
+    AttachmentKey depth = {};
+
+    bool operator==(const RenderPassKey& other) const { return colors == other.colors && depth == other.depth; }
+  };
+
+  struct FramebufferKey {
+    VkRenderPass render_pass = {};
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t layers = 1;
+    std::vector<VkImageUsageFlags> usages = {};
+    // only without imageless framebuffer support
+    std::vector<VkImageView> views = {};
+
+    bool operator==(const FramebufferKey& other) const {
+      return render_pass == other.render_pass && width == other.width && height == other.height &&
+             layers == other.layers && usages == other.usages && views == other.views;
+    }
+  };
+
+  struct Framebuffer {
+    VkFramebuffer framebuffer = {};
+    uint64_t last_used = 0;
+  };
+
+  struct KeyHash {
+    size_t operator()(const RenderPassKey& key) const;
+
+    size_t operator()(const FramebufferKey& key) const;
+  };
+
+  // `compatible` drops load/store ops, render passes only differing in them share framebuffers
+  static RenderPassKey MakeKey(RenderingInfoVk const& info, bool compatible);
+
+  VkRenderPass GetRenderPassLocked(RenderPassKey const& key);
+
+  VkFramebuffer GetFramebufferLocked(RenderingInfoVk const& info);
+
+  // framebuffer attachment order: colors, resolve targets of the colors, depth
+  static std::vector<VkImageView> CollectViews(RenderingInfoVk const& info);
+
+  void BeginDynamic(VkCommandBuffer cmd, RenderingInfoVk const& info, bool secondaries);
+
+ private:
+  VkDevice m_device = {};
+  GpuResourceDelegateVk* m_delegate = nullptr;
+  bool m_dynamic_rendering = false;
+  bool m_imageless = false;
+
+  std::mutex m_mutex = {};
+  uint64_t m_frame = 0;
+  std::unordered_map<RenderPassKey, VkRenderPass, KeyHash> m_render_passes = {};
+  std::unordered_map<FramebufferKey, Framebuffer, KeyHash> m_framebuffers = {};
+};
+
+}  // namespace hexgon
@@ -26,62 +26,98 @@
 #include <GLFW/glfw3.h>
 
 #include <Hexgon/Core/Window.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include <set>
 #include <vector>
 
 #include "LogPrivate.hpp"
+#include "Render/Ktx2Reader.hpp"
+#include "Render/Vulkan/DispatchVk.hpp"
 #include "Render/Vulkan/SwapChainVk.hpp"
+#include "Render/Vulkan/TextureVk.hpp"
 #include "Render/Vulkan/VulkanUtil.hpp"
 
 namespace hexgon {
 
-std::unique_ptr<RenderSystem> RenderSystemVk::Init(Window* window, bool debug) {
-  std::unique_ptr<RenderSystemVk> ret;
+namespace {
+
+const char* const kPipelineCacheFile = "pipeline_cache.bin";
+
+}  // namespace
+
+std::unique_ptr<RenderSystem> RenderSystemVk::Create(bool debug) {
+  auto ret = std::make_unique<RenderSystemVk>();
+
   // step 1 create vulkan instance
-  VkInstance instance = {};
-  VkDebugReportCallbackEXT debug_ins = {};
+  std::tie(ret->m_vk_instance, ret->m_vk_debug_reporter) = VulkanUtil::CreateInstance(debug);
+
+  if (!ret->m_vk_instance) {
+    return std::unique_ptr<RenderSystem>();
+  }
+
+  ret->m_is_debug = debug;
 
-  std::tie(instance, debug_ins) = VulkanUtil::CreateInstance(debug);
+  // the first enumeration loads the drivers, do it here instead of on the thread waiting for the window
+  uint32_t device_count = 0;
+  g_vk.vkEnumeratePhysicalDevices(ret->m_vk_instance, &device_count, nullptr);
 
-  if (!instance) {
-    return ret;
+  // pipeline cache of the previous run, validated against the device once it is known
+  std::ifstream cache_file(kPipelineCacheFile, std::ios::binary);
+  if (cache_file) {
+    ret->m_pipeline_cache_data.assign(std::istreambuf_iterator<char>(cache_file), std::istreambuf_iterator<char>());
+  }
+
+  return ret;
+}
+
+bool RenderSystemVk::OnAttachWindow(Window* window, const std::string& device) {
+  if (m_device) {
+    HEX_CORE_ERROR("Render system is already attached to a window.");
+    return false;
   }
 
   // step 2 create vulkan surface
-  VkSurfaceKHR surface{};
-  if (glfwCreateWindowSurface(instance, reinterpret_cast<GLFWwindow*>(window->GetNativeWindow()), nullptr, &surface) !=
-      VK_SUCCESS) {
+  if (glfwCreateWindowSurface(m_vk_instance, reinterpret_cast<GLFWwindow*>(window->GetNativeWindow()), nullptr,
+                              &m_vk_surface) != VK_SUCCESS) {
     HEX_CORE_ERROR("Failed create vulkan display surface");
-    return ret;
+    return false;
   }
 
   // step 3 query gpu device
-  auto device_info = VulkanUtil::QueryDevice(instance, surface);
+  auto device_info = VulkanUtil::QueryDevice(m_vk_instance, m_vk_surface, device);
 
   if (!device_info.device) {
     HEX_CORE_ERROR("Can not find usable vulkan device.");
-    return ret;
+    return false;
   }
 
-  ret = std::make_unique<RenderSystemVk>();
-
-  if (!ret->InitVulkan(instance, surface, device_info)) {
-    ret->ShutDown();
-    ret.reset();
+  return InitVulkan(m_vk_instance, m_vk_surface, device_info);
+}
 
-    return ret;
+bool RenderSystemVk::InitHeadless(const std::string& device) {
+  if (m_device) {
+    HEX_CORE_ERROR("Render system is already initialized.");
+    return false;
   }
 
-  ret->m_vk_debug_reporter = debug_ins;
+  auto device_info = VulkanUtil::QueryDevice(m_vk_instance, VK_NULL_HANDLE, device);
 
-  return ret;
+  if (!device_info.device) {
+    HEX_CORE_ERROR("Can not find usable vulkan device.");
+    return false;
+  }
+
+  return InitVulkan(m_vk_instance, VK_NULL_HANDLE, device_info);
 }
 
 std::unique_ptr<SwapChain> RenderSystemVk::CreateSwapChain() {
   std::unique_ptr<SwapChain> result{};
   // surface capabilities
   VkSurfaceCapabilitiesKHR surface_capabilities{};
-  if (vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_phy_device, m_vk_surface, &surface_capabilities) != VK_SUCCESS) {
+  if (g_vk.vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_phy_device, m_vk_surface, &surface_capabilities) != VK_SUCCESS) {
     HEX_CORE_ERROR("Failed Get surface capabilities.");
     return result;
   }
@@ -110,14 +146,24 @@ std::unique_ptr<SwapChain> RenderSystemVk::CreateSwapChain() {
 
   VkSwapchainKHR vk_swap_chain{};
 
+  // one more image than minimum so acquire does not block on the presentation engine, maxImageCount 0 means no limit
+  uint32_t image_count = surface_capabilities.minImageCount + 1;
+  if (surface_capabilities.maxImageCount > 0) {
+    image_count = std::min(image_count, surface_capabilities.maxImageCount);
+  }
+
   VkSwapchainCreateInfoKHR create_info{};
   create_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
   create_info.surface = m_vk_surface;
-  create_info.minImageCount = surface_capabilities.maxImageCount;
+  create_info.minImageCount = image_count;
   create_info.imageFormat = format;
   create_info.imageExtent = surface_capabilities.currentExtent;
   create_info.imageArrayLayers = 1;
   create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  // clear at frame begin is a transfer command
+  if (surface_capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) {
+    create_info.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  }
   create_info.queueFamilyIndexCount = queue_families.size();
   create_info.pQueueFamilyIndices = queue_families.data();
 
@@ -131,35 +177,333 @@ std::unique_ptr<SwapChain> RenderSystemVk::CreateSwapChain() {
   create_info.compositeAlpha = surface_composite;
   create_info.presentMode = VK_PRESENT_MODE_FIFO_KHR;
 
-  if (vkCreateSwapchainKHR(m_device, &create_info, nullptr, &vk_swap_chain) != VK_SUCCESS) {
+  if (g_vk.vkCreateSwapchainKHR(m_device, &create_info, nullptr, &vk_swap_chain) != VK_SUCCESS) {
     HEX_CORE_ERROR("Failed to create vulkan swap chain");
     return result;
   }
 
-  result.reset(new SwapChainVk(m_device, vk_swap_chain, surface_capabilities, format));
+  result.reset(new SwapChainVk(this, vk_swap_chain, surface_capabilities, format));
 
   return result;
 }
 
+std::shared_ptr<Texture> RenderSystemVk::CreateTexture(const TextureDescriptor& desc) {
+  auto texture = TextureVk::Create(this, desc);
+
+  if (texture) {
+    SaveResource(texture.get());
+  }
+
+  return texture;
+}
+
+std::shared_ptr<Texture> RenderSystemVk::LoadTexture(const std::string& path, bool streaming) {
+  Ktx2Reader reader{};
+  if (!reader.Open(path)) {
+    return nullptr;
+  }
+
+  TextureDescriptor desc{};
+  desc.label = path;
+  desc.format = TextureVk::FromVkFormat(static_cast<VkFormat>(reader.GetVkFormat()));
+  desc.usage = TextureUsage::kShaderRead | TextureUsage::kCopyDst;
+  desc.storage = StorageMode::kHostVisible;
+  desc.type = reader.GetDepth() > 0 ? TextureType::k3D : reader.GetHeight() > 0 ? TextureType::k2D : TextureType::k1D;
+  desc.width = reader.GetWidth();
+  desc.height = std::max(1u, reader.GetHeight());
+  desc.depth = std::max(1u, reader.GetDepth());
+  desc.array_layers = std::max(1u, reader.GetLayerCount());
+  // level count 0 asks the loader to generate the chain, which is what mip_levels 0 means as well
+  desc.mip_levels = reader.GetLevelCount();
+  desc.streaming = streaming;
+
+  if (desc.format == PixelFormat::kUnknown) {
+    HEX_CORE_ERROR("VkFormat {} of {} is not supported.", reader.GetVkFormat(), path);
+    return nullptr;
+  }
+
+  if (reader.GetFaceCount() != 1) {
+    HEX_CORE_ERROR("Cube map {} is not supported.", path);
+    return nullptr;
+  }
+
+  if (!IsFormatSupported(desc.format, desc.usage)) {
+    HEX_CORE_ERROR("Format of {} is not supported by this device.", path);
+    return nullptr;
+  }
+
+  // block compressed levels cannot be generated by blits, without a chain in the file only level 0 is loaded
+  bool generate_mipmaps = reader.GetLevelCount() == 0 && !GetPixelFormatInfo(desc.format).IsCompressed();
+  if (reader.GetLevelCount() == 0 && !generate_mipmaps) {
+    HEX_CORE_WARN("{} has no mip chain and a compressed format, only level 0 is loaded.", path);
+    desc.mip_levels = 1;
+  }
+
+  auto texture = TextureVk::Create(this, desc);
+  if (!texture) {
+    return nullptr;
+  }
+
+  SaveResource(texture.get());
+
+  uint32_t level_count = std::max(1u, reader.GetLevelCount());
+
+  if (streaming) {
+    // streaming textures keep their own copy, so evicted levels can come back after the file is closed
+    for (uint32_t l = 0; l < level_count; l++) {
+      auto const& level = reader.GetLevel(l);
+      VkExtent3D extent = TextureVk::GetMipExtent(texture->GetDescriptor(), l);
+      size_t layer_size = level.size / desc.array_layers;
+
+      for (uint32_t layer = 0; layer < desc.array_layers; layer++) {
+        TextureRange range{0, 0, extent.width, extent.height, l, layer};
+        texture->UploadData(const_cast<uint8_t*>(level.data) + layer_size * layer, layer_size, range);
+      }
+    }
+
+    return texture;
+  }
+
+  // payloads go from the mapped file straight into staging memory
+  std::vector<TextureVk::LevelSource> sources{};
+  for (uint32_t l = 0; l < level_count; l++) {
+    auto const& level = reader.GetLevel(l);
+    sources.emplace_back(TextureVk::LevelSource{l, level.data, level.size});
+  }
+
+  if (!texture->UploadLevels(sources)) {
+    HEX_CORE_ERROR("Failed upload {}.", path);
+    return nullptr;
+  }
+
+  if (generate_mipmaps) {
+    texture->GenerateMipmaps();
+  }
+
+  return texture;
+}
+
+std::shared_ptr<Sampler> RenderSystemVk::CreateSampler(const SamplerDescriptor& desc) {
+  return m_sampler_cache.GetOrCreate(desc);
+}
+
+bool RenderSystemVk::IsFormatSupported(PixelFormat format, TextureUsageMask usage) {
+  VkFormat vk_format = TextureVk::ToVkFormat(format);
+  if (vk_format == VK_FORMAT_UNDEFINED) {
+    return false;
+  }
+
+  // compressed formats are only usable when their feature is enabled on the device
+  if ((format >= PixelFormat::kBC1RGBAUnorm && format <= PixelFormat::kBC7RGBAUnorm &&
+       !m_enabled_features.textureCompressionBC) ||
+      ((format == PixelFormat::kETC2R8G8B8Unorm || format == PixelFormat::kETC2R8G8B8A8Unorm) &&
+       !m_enabled_features.textureCompressionETC2) ||
+      (format >= PixelFormat::kASTC4x4Unorm && format <= PixelFormat::kASTC8x8Unorm &&
+       !m_enabled_features.textureCompressionASTC_LDR)) {
+    return false;
+  }
+
+  VkFormatProperties properties{};
+  g_vk.vkGetPhysicalDeviceFormatProperties(m_phy_device, vk_format, &properties);
+
+  VkFormatFeatureFlags required = 0;
+  if (usage & TextureUsage::kShaderRead) {
+    required |= VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+  }
+
+  if (usage & TextureUsage::kShaderWrite) {
+    required |= VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT;
+  }
+
+  if (usage & TextureUsage::kRenderTarget) {
+    required |= GetPixelFormatInfo(format).is_depth ? VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
+                                                    : VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT;
+  }
+
+  if (usage & TextureUsage::kCopySrc) {
+    required |= VK_FORMAT_FEATURE_TRANSFER_SRC_BIT;
+  }
+
+  if (usage & TextureUsage::kCopyDst) {
+    required |= VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+  }
+
+  return (properties.optimalTilingFeatures & required) == required;
+}
+
 void RenderSystemVk::ShutDown() {
   if (m_device) {
-    vkDestroyDevice(m_device, nullptr);
+    // only place allowed to wait for the whole device
+    g_vk.vkDeviceWaitIdle(m_device);
+
+    m_texture_streamer.Clear();
+    m_texture_update_batch.Clear();
+    m_readback_queue.Clear();
+
+    // resources outliving the render system give up their vulkan objects now
+    m_resources.ForEach([](ResourceHandle, GpuResourceVk* res) {
+      res->ReleaseHandles();
+      res->SetDelegate(nullptr);
+      res->SetHandle({});
+    });
+    m_resources.Clear();
+
+    m_deletion_queue.Flush();
+  }
+
+  if (m_bindless_table) {
+    m_bindless_table->Destroy();
+    m_bindless_table.reset();
+  }
+
+  if (m_device) {
+    m_descriptor_set_cache.Destroy();
+    m_sampler_cache.Destroy();
+    m_render_pass_cache.Destroy();
+
+    SavePipelineCache();
+
+    if (m_immediate_fence) {
+      g_vk.vkDestroyFence(m_device, m_immediate_fence, nullptr);
+      m_immediate_fence = nullptr;
+    }
+
+    if (m_immediate_pool) {
+      g_vk.vkDestroyCommandPool(m_device, m_immediate_pool, nullptr);
+      m_immediate_pool = nullptr;
+      m_immediate_cmd = nullptr;
+    }
+
+    g_vk.vkDestroyDevice(m_device, nullptr);
     m_device = nullptr;
   }
 
   if (m_vk_surface) {
-    vkDestroySurfaceKHR(m_vk_instance, m_vk_surface, nullptr);
+    g_vk.vkDestroySurfaceKHR(m_vk_instance, m_vk_surface, nullptr);
     m_vk_surface = nullptr;
   }
 
+  if (m_vk_debug_reporter && g_vk.vkDestroyDebugReportCallbackEXT) {
+    g_vk.vkDestroyDebugReportCallbackEXT(m_vk_instance, m_vk_debug_reporter, nullptr);
+    m_vk_debug_reporter = nullptr;
+  }
+
   if (m_vk_instance) {
-    vkDestroyInstance(m_vk_instance, nullptr);
+    g_vk.vkDestroyInstance(m_vk_instance, nullptr);
     m_vk_instance = nullptr;
   }
+
+  g_vk.Reset();
 }
 
 void RenderSystemVk::OnResourceDispose(GpuResourceVk* resource) { RemoveResource(resource); }
 
+bool RenderSystemVk::BeginFrame(uint64_t frame, VkCommandBuffer upload_cmd) {
+  m_current_frame = frame;
+
+  // resident mips only change before any command of this frame is recorded
+  bool recorded = m_texture_streamer.Update(frame, upload_cmd);
+
+  m_render_pass_cache.Trim(frame);
+
+  return recorded;
+}
+
+void RenderSystemVk::OnReleaseHandle(VkObjectType type, uint64_t handle) {
+  m_deletion_queue.Push(m_current_frame.load(), type, handle);
+}
+
+void RenderSystemVk::OnReleaseLater(std::function<void()> release) {
+  m_deletion_queue.Push(m_current_frame.load(), std::move(release));
+}
+
+std::unique_ptr<BufferVk> RenderSystemVk::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
+                                                       bool host_visible) {
+  VkBufferCreateInfo buffer_info{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+  buffer_info.size = size;
+  buffer_info.usage = usage;
+  buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  VkBuffer buffer = {};
+  if (g_vk.vkCreateBuffer(m_device, &buffer_info, nullptr, &buffer) != VK_SUCCESS) {
+    HEX_CORE_ERROR("Failed create buffer with size {}.", size);
+    return nullptr;
+  }
+
+  VkMemoryRequirements requirements{};
+  g_vk.vkGetBufferMemoryRequirements(m_device, buffer, &requirements);
+
+  VkMemoryPropertyFlags properties = host_visible
+                                         ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+                                         : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+  VkMemoryAllocateInfo alloc_info{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+  alloc_info.allocationSize = requirements.size;
+  alloc_info.memoryTypeIndex = VulkanUtil::FindMemoryType(m_phy_device, requirements.memoryTypeBits, properties);
+
+  VkDeviceMemory memory = {};
+  if (alloc_info.memoryTypeIndex == UINT32_MAX ||
+      g_vk.vkAllocateMemory(m_device, &alloc_info, nullptr, &memory) != VK_SUCCESS) {
+    HEX_CORE_ERROR("Failed allocate {} bytes buffer memory.", requirements.size);
+    g_vk.vkDestroyBuffer(m_device, buffer, nullptr);
+    return nullptr;
+  }
+
+  g_vk.vkBindBufferMemory(m_device, buffer, memory, 0);
+
+  void* mapped = nullptr;
+  if (host_visible) {
+    g_vk.vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+  }
+
+  auto result = std::make_unique<BufferVk>(buffer, memory, size, mapped);
+  result->SetDelegate(this);
+
+  SaveResource(result.get());
+
+  return result;
+}
+
+bool RenderSystemVk::ImmediateSubmit(const std::function<void(VkCommandBuffer)>& func) {
+  std::lock_guard<std::mutex> lock(m_immediate_mutex);
+
+  g_vk.vkResetCommandPool(m_device, m_immediate_pool, 0);
+
+  VkCommandBufferBeginInfo begin_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+  begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+  g_vk.vkBeginCommandBuffer(m_immediate_cmd, &begin_info);
+
+  func(m_immediate_cmd);
+
+  g_vk.vkEndCommandBuffer(m_immediate_cmd);
+
+  VkSubmitInfo submit_info{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+  submit_info.commandBufferCount = 1;
+  submit_info.pCommandBuffers = &m_immediate_cmd;
+
+  g_vk.vkResetFences(m_device, 1, &m_immediate_fence);
+
+  if (SubmitGraphic(submit_info, m_immediate_fence) != VK_SUCCESS) {
+    HEX_CORE_ERROR("Failed submit immediate command buffer.");
+    return false;
+  }
+
+  return g_vk.vkWaitForFences(m_device, 1, &m_immediate_fence, VK_TRUE, UINT64_MAX) == VK_SUCCESS;
+}
+
+VkResult RenderSystemVk::SubmitGraphic(const VkSubmitInfo& info, VkFence fence) {
+  std::lock_guard<std::mutex> lock(m_queue_mutex);
+
+  return g_vk.vkQueueSubmit(m_graphic_queue, 1, &info, fence);
+}
+
+VkResult RenderSystemVk::Present(const VkPresentInfoKHR& info) {
+  std::lock_guard<std::mutex> lock(m_queue_mutex);
+
+  return g_vk.vkQueuePresentKHR(m_present_queue, &info);
+}
+
 bool RenderSystemVk::InitVulkan(VkInstance instance, VkSurfaceKHR surface, const PhysicalDeviceInfo& device_info) {
   m_vk_instance = instance;
   m_vk_surface = surface;
@@ -188,58 +532,315 @@ bool RenderSystemVk::InitVulkan(VkInstance instance, VkSurfaceKHR surface, const
 
   VkPhysicalDeviceFeatures device_features{};
 
-  device_features.samplerAnisotropy = VK_TRUE;
-  device_features.sampleRateShading = VK_TRUE;
+  // optional features and block compression are enabled wherever the hardware has them
+  {
+    VkPhysicalDeviceFeatures supported{};
+    g_vk.vkGetPhysicalDeviceFeatures(m_phy_device, &supported);
+
+    device_features.samplerAnisotropy = supported.samplerAnisotropy;
+    device_features.sampleRateShading = supported.sampleRateShading;
+    device_features.textureCompressionBC = supported.textureCompressionBC;
+    device_features.textureCompressionETC2 = supported.textureCompressionETC2;
+    device_features.textureCompressionASTC_LDR = supported.textureCompressionASTC_LDR;
+    // GPU driven draws, see GpuCullerVk
+    device_features.multiDrawIndirect = supported.multiDrawIndirect;
+    device_features.drawIndirectFirstInstance = supported.drawIndirectFirstInstance;
+  }
+
+  std::vector<const char*> device_extension{};
+  if (surface) {
+    device_extension.emplace_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+  }
+
+  uint32_t extension_count;
+  g_vk.vkEnumerateDeviceExtensionProperties(m_phy_device, nullptr, &extension_count, nullptr);
+
+  std::vector<VkExtensionProperties> extension_properties(extension_count);
+  g_vk.vkEnumerateDeviceExtensionProperties(m_phy_device, nullptr, &extension_count, extension_properties.data());
+
+  auto has_extension = [&extension_properties](const char* name) {
+    return std::find_if(extension_properties.begin(), extension_properties.end(), [name](VkExtensionProperties prop) {
+             return std::strcmp(prop.extensionName, name) == 0;
+           }) != extension_properties.end();
+  };
+
+  if (has_extension("VK_KHR_portability_subset")) {
+    // VUID-VkDeviceCreateInfo-pProperties-04451
+    device_extension.emplace_back("VK_KHR_portability_subset");
+  }
+
+
+  // descriptor indexing is optional, without it there is no bindless texture table
+  VkPhysicalDeviceDescriptorIndexingFeatures indexing_features{
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES};
+  VkPhysicalDeviceDescriptorIndexingProperties indexing_properties{
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES};
+  {
+    VkPhysicalDeviceProperties2 properties{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
+    properties.pNext = &indexing_properties;
+    g_vk.vkGetPhysicalDeviceProperties2(m_phy_device, &properties);
+
+    bool core_indexing = properties.properties.apiVersion >= VK_API_VERSION_1_2;
+
+    if (core_indexing || has_extension(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+      VkPhysicalDeviceFeatures2 features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+      features.pNext = &indexing_features;
+      g_vk.vkGetPhysicalDeviceFeatures2(m_phy_device, &features);
+
+      m_bindless_supported = indexing_features.runtimeDescriptorArray &&
+                             indexing_features.descriptorBindingPartiallyBound &&
+                             indexing_features.descriptorBindingVariableDescriptorCount &&
+                             indexing_features.descriptorBindingSampledImageUpdateAfterBind &&
+                             indexing_features.descriptorBindingUpdateUnusedWhilePending &&
+                             indexing_features.shaderSampledImageArrayNonUniformIndexing;
+    }
+
+    if (m_bindless_supported && !core_indexing) {
+      device_extension.emplace_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+      device_extension.emplace_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+    }
+  }
+
+  // compute culling writes the draw count on the GPU
+  if (has_extension(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME)) {
+    device_extension.emplace_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    m_draw_indirect_count_supported = true;
+  }
 
-  std::vector<const char*> device_extension{VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+  // lets the texture streamer size its budget from what the driver reports
+  if (has_extension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+    device_extension.emplace_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    m_memory_budget_supported = true;
+  }
 
+  // passes begin with dynamic rendering where available, otherwise with cached render passes and framebuffers
+  VkPhysicalDeviceImagelessFramebufferFeatures imageless_features{
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGELESS_FRAMEBUFFER_FEATURES};
+  VkPhysicalDeviceDynamicRenderingFeatures dynamic_rendering_features{
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES};
   {
-    uint32_t count;
-    vkEnumerateDeviceExtensionProperties(m_phy_device, nullptr, &count, nullptr);
+    VkPhysicalDeviceProperties properties{};
+    g_vk.vkGetPhysicalDeviceProperties(m_phy_device, &properties);
+
+    bool imageless_available = properties.apiVersion >= VK_API_VERSION_1_2 ||
+                               has_extension(VK_KHR_IMAGELESS_FRAMEBUFFER_EXTENSION_NAME);
+    // the extension depends on create_renderpass2 and depth_stencil_resolve, both core since 1.2
+    bool dynamic_available =
+        properties.apiVersion >= VK_API_VERSION_1_3 ||
+        (properties.apiVersion >= VK_API_VERSION_1_2 && has_extension(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME));
+
+    void* chain = nullptr;
+    if (dynamic_available) {
+      dynamic_rendering_features.pNext = chain;
+      chain = &dynamic_rendering_features;
+    }
 
-    std::vector<VkExtensionProperties> properties(count);
-    vkEnumerateDeviceExtensionProperties(m_phy_device, nullptr, &count, properties.data());
+    if (imageless_available) {
+      imageless_features.pNext = chain;
+      chain = &imageless_features;
+    }
 
-    auto it = std::find_if(properties.begin(), properties.end(), [](VkExtensionProperties prop) {
-      return std::strcmp(prop.extensionName, "VK_KHR_portability_subset") == 0;
-    });
+    VkPhysicalDeviceFeatures2 features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+    features.pNext = chain;
+    g_vk.vkGetPhysicalDeviceFeatures2(m_phy_device, &features);
+
+    m_imageless_supported = imageless_available && imageless_features.imagelessFramebuffer;
+    m_dynamic_rendering_supported = dynamic_available && dynamic_rendering_features.dynamicRendering;
+
+    if (m_imageless_supported && properties.apiVersion < VK_API_VERSION_1_2) {
+      device_extension.emplace_back(VK_KHR_IMAGELESS_FRAMEBUFFER_EXTENSION_NAME);
+    }
 
-    if (it != properties.end()) {
-      // VUID-VkDeviceCreateInfo-pProperties-04451
-      device_extension.emplace_back("VK_KHR_portability_subset");
+    if (m_dynamic_rendering_supported && properties.apiVersion < VK_API_VERSION_1_3) {
+      device_extension.emplace_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
     }
   }
 
-  // we need the VK_KHR_imageless_framebuffer extension
-  device_extension.emplace_back(VK_KHR_IMAGELESS_FRAMEBUFFER_EXTENSION_NAME);
+  // only enable what the bindless table needs
+  VkPhysicalDeviceDescriptorIndexingFeatures enabled_indexing{
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES};
+  enabled_indexing.runtimeDescriptorArray = VK_TRUE;
+  enabled_indexing.descriptorBindingPartiallyBound = VK_TRUE;
+  enabled_indexing.descriptorBindingVariableDescriptorCount = VK_TRUE;
+  enabled_indexing.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+  // the global set is always pending, slots are written while frames in flight sample other slots
+  enabled_indexing.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+  enabled_indexing.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+
+  VkPhysicalDeviceImagelessFramebufferFeatures enabled_imageless{
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGELESS_FRAMEBUFFER_FEATURES};
+  enabled_imageless.imagelessFramebuffer = VK_TRUE;
+
+  VkPhysicalDeviceDynamicRenderingFeatures enabled_dynamic_rendering{
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES};
+  enabled_dynamic_rendering.dynamicRendering = VK_TRUE;
+
+  void* feature_chain = nullptr;
+  if (m_bindless_supported) {
+    enabled_indexing.pNext = feature_chain;
+    feature_chain = &enabled_indexing;
+  }
+
+  if (m_imageless_supported) {
+    enabled_imageless.pNext = feature_chain;
+    feature_chain = &enabled_imageless;
+  }
+
+  if (m_dynamic_rendering_supported) {
+    enabled_dynamic_rendering.pNext = feature_chain;
+    feature_chain = &enabled_dynamic_rendering;
+  }
 
   VkDeviceCreateInfo create_info{VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
+  create_info.pNext = feature_chain;
   create_info.pQueueCreateInfos = queue_create_info.data();
   create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_info.size());
   create_info.pEnabledFeatures = &device_features;
   create_info.enabledExtensionCount = static_cast<uint32_t>(device_extension.size());
   create_info.ppEnabledExtensionNames = device_extension.data();
 
-  if (vkCreateDevice(m_phy_device, &create_info, nullptr, &m_device) != VK_SUCCESS) {
+  if (g_vk.vkCreateDevice(m_phy_device, &create_info, nullptr, &m_device) != VK_SUCCESS) {
     HEX_CORE_ERROR("Failed create logical vulkan device.");
     return false;
   }
 
-  vkGetDeviceQueue(m_device, device_info.graphic_queue_index, 0, &m_graphic_queue);
-  vkGetDeviceQueue(m_device, device_info.present_queue_index, 0, &m_present_queue);
+  // from here on device calls skip the loader
+  if (!g_vk.LoadDevice(m_device)) {
+    HEX_CORE_ERROR("Failed load vulkan device functions.");
+    vkDestroyDevice(m_device, nullptr);
+    m_device = nullptr;
+    return false;
+  }
+
+  m_enabled_features = device_features;
+  m_draw_indirect_count_supported = m_draw_indirect_count_supported && g_vk.vkCmdDrawIndexedIndirectCount;
+
+  g_vk.vkGetDeviceQueue(m_device, device_info.graphic_queue_index, 0, &m_graphic_queue);
+  g_vk.vkGetDeviceQueue(m_device, device_info.present_queue_index, 0, &m_present_queue);
+
+  m_deletion_queue.Init(m_device);
+
+  m_descriptor_set_cache.Init(m_device, this);
+
+  m_sampler_cache.Init(m_device, m_phy_device, m_enabled_features.samplerAnisotropy);
+
+  m_render_pass_cache.Init(m_device, this, m_dynamic_rendering_supported, m_imageless_supported);
+
+  CreatePipelineCache();
+
+  m_texture_streamer.Init(m_phy_device, m_memory_budget_supported);
+
+  // one time commands for uploads outside of frames
+  {
+    VkCommandPoolCreateInfo pool_info{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    pool_info.queueFamilyIndex = m_graphic_queue_index;
+
+    g_vk.vkCreateCommandPool(m_device, &pool_info, nullptr, &m_immediate_pool);
+
+    VkCommandBufferAllocateInfo cmd_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+    cmd_info.commandPool = m_immediate_pool;
+    cmd_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmd_info.commandBufferCount = 1;
+
+    g_vk.vkAllocateCommandBuffers(m_device, &cmd_info, &m_immediate_cmd);
+
+    VkFenceCreateInfo fence_info{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    g_vk.vkCreateFence(m_device, &fence_info, nullptr, &m_immediate_fence);
+  }
+
+  if (m_bindless_supported) {
+    uint32_t max_textures = std::min({kMaxBindlessTextures,
+                                      indexing_properties.maxDescriptorSetUpdateAfterBindSampledImages,
+                                      indexing_properties.maxPerStageDescriptorUpdateAfterBindSampledImages});
+
+    // the common samplers are baked into the bindless layout, see BindlessTextureTableVk
+    std::vector<VkSampler> samplers{};
+    for (auto const& desc : BindlessTextureTableVk::StaticSamplers()) {
+      samplers.emplace_back(m_sampler_cache.GetSampler(desc));
+    }
+
+    m_bindless_table = std::make_unique<BindlessTextureTableVk>();
+
+    if (!m_bindless_table->Init(m_device, max_textures, samplers)) {
+      m_bindless_table->Destroy();
+      m_bindless_table.reset();
+    }
+  }
 
   return true;
 }
 
+void RenderSystemVk::CreatePipelineCache() {
+  VkPhysicalDeviceProperties properties{};
+  g_vk.vkGetPhysicalDeviceProperties(m_phy_device, &properties);
+
+  // drivers ignore data of another device, but only after parsing it. Check the header first so a stale file is
+  // simply dropped
+  VkPipelineCacheHeaderVersionOne header{};
+  bool matches = false;
+  if (m_pipeline_cache_data.size() >= sizeof(header)) {
+    std::memcpy(&header, m_pipeline_cache_data.data(), sizeof(header));
+
+    matches = header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+              header.vendorID == properties.vendorID && header.deviceID == properties.deviceID &&
+              std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+  }
+
+  VkPipelineCacheCreateInfo create_info{VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+  if (matches) {
+    create_info.initialDataSize = m_pipeline_cache_data.size();
+    create_info.pInitialData = m_pipeline_cache_data.data();
+  }
+
+  if (g_vk.vkCreatePipelineCache(m_device, &create_info, nullptr, &m_pipeline_cache) != VK_SUCCESS) {
+    HEX_CORE_WARN("Failed create vulkan pipeline cache.");
+    m_pipeline_cache = nullptr;
+  } else {
+    HEX_CORE_INFO("Pipeline cache {} ({} bytes).", matches ? "restored" : "created empty",
+                  matches ? m_pipeline_cache_data.size() : 0);
+  }
+
+  m_pipeline_cache_data.clear();
+  m_pipeline_cache_data.shrink_to_fit();
+}
+
+void RenderSystemVk::SavePipelineCache() {
+  if (!m_pipeline_cache) {
+    return;
+  }
+
+  size_t size = 0;
+  std::vector<uint8_t> data{};
+  if (g_vk.vkGetPipelineCacheData(m_device, m_pipeline_cache, &size, nullptr) == VK_SUCCESS && size > 0) {
+    data.resize(size);
+
+    if (g_vk.vkGetPipelineCacheData(m_device, m_pipeline_cache, &size, data.data()) == VK_SUCCESS) {
+      std::ofstream file(kPipelineCacheFile, std::ios::binary | std::ios::trunc);
+      file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(size));
+    }
+  }
+
+  g_vk.vkDestroyPipelineCache(m_device, m_pipeline_cache, nullptr);
+  m_pipeline_cache = nullptr;
+}
+
 void RenderSystemVk::SaveResource(GpuResourceVk* res) {
-  LinkedList<GpuResourceVk>::Insert<&GpuResourceVk::mem_prev, &GpuResourceVk::mem_next>(
-      res, m_res_list.tail, nullptr, &m_res_list.head, &m_res_list.tail);
-  ;
+  auto handle = m_resources.Allocate(res);
+
+  if (!handle.IsValid()) {
+    HEX_CORE_ERROR("Resource registry is full, {} is not tracked.", res->GetLabel());
+  }
+
+  res->SetHandle(handle);
 }
 
 void RenderSystemVk::RemoveResource(GpuResourceVk* res) {
-  LinkedList<GpuResourceVk>::Remove<&GpuResourceVk::mem_prev, &GpuResourceVk::mem_next>(res, &m_res_list.head,
-                                                                                        &m_res_list.tail);
+  if (res->GetHandle().IsValid() && !m_resources.Release(res->GetHandle())) {
+    HEX_CORE_WARN("Remove stale resource handle {} of {}.", res->GetHandle().GetValue(), res->GetLabel());
+  }
+
+  res->SetHandle({});
 }
 
 }  // namespace hexgon
@@ -26,34 +26,131 @@
 #include <vulkan/vulkan.h>
 
 #include <Hexgon/Render/RenderSystem.hpp>
+#include <atomic>
+#include <functional>
+#include <mutex>
 #include <vector>
 
-#include "Core/Util/LinkedList.hpp"
+#include "Core/Util/HandleRegistry.hpp"
+#include "Render/Vulkan/BindlessTableVk.hpp"
+#include "Render/Vulkan/BufferVk.hpp"
+#include "Render/Vulkan/DeletionQueueVk.hpp"
+#include "Render/Vulkan/DescriptorAllocatorVk.hpp"
 #include "Render/Vulkan/GpuResourceVk.hpp"
+#include "Render/Vulkan/ReadbackQueueVk.hpp"
+#include "Render/Vulkan/RenderGraphVk.hpp"
+#include "Render/Vulkan/RenderPassCacheVk.hpp"
+#include "Render/Vulkan/SamplerCacheVk.hpp"
+#include "Render/Vulkan/TextureStreamerVk.hpp"
+#include "Render/Vulkan/TextureUpdateBatchVk.hpp"
 #include "Render/Vulkan/VulkanUtil.hpp"
 
 namespace hexgon {
 
 class RenderSystemVk : public RenderSystem, public GpuResourceDelegateVk {
  public:
+  static constexpr uint32_t kMaxBindlessTextures = 16384;
+
   RenderSystemVk() = default;
   ~RenderSystemVk() override = default;
 
-  static std::unique_ptr<RenderSystem> Init(Window* window, bool debug);
+  // instance and driver loading only, finished by AttachWindow
+  static std::unique_ptr<RenderSystem> Create(bool debug);
 
   virtual std::unique_ptr<SwapChain> CreateSwapChain() override;
 
+  virtual std::shared_ptr<Texture> CreateTexture(TextureDescriptor const& desc) override;
+
+  virtual std::shared_ptr<Texture> LoadTexture(std::string const& path, bool streaming) override;
+
+  virtual bool IsFormatSupported(PixelFormat format, TextureUsageMask usage) override;
+
+  virtual std::shared_ptr<Sampler> CreateSampler(SamplerDescriptor const& desc) override;
+
   virtual void ShutDown() override;
 
+  bool OnAttachWindow(Window* window, const std::string& device) override;
+
+  // device without a window or swap chain, for tests and offline work. `device` is matched like in AttachWindow
+  bool InitHeadless(const std::string& device);
+
   void OnResourceDispose(GpuResourceVk* resource) override;
+
+  void OnReleaseHandle(VkObjectType type, uint64_t handle) override;
+
+  void OnReleaseLater(std::function<void()> release) override;
   // platform functions
   bool InitVulkan(VkInstance instance, VkSurfaceKHR surface, const PhysicalDeviceInfo& device_info);
 
+  VkDevice GetDevice() const { return m_device; }
+
+  VkPhysicalDevice GetPhysicalDevice() const { return m_phy_device; }
+
+  uint32_t GetGraphicQueueIndex() const { return m_graphic_queue_index; }
+
+  // queues are externally synchronized, every submit and present goes through these
+  VkResult SubmitGraphic(VkSubmitInfo const& info, VkFence fence);
+
+  VkResult Present(VkPresentInfoKHR const& info);
+
+  DescriptorSetCacheVk& GetDescriptorSetCache() { return m_descriptor_set_cache; }
+
+  SamplerCacheVk& GetSamplerCache() { return m_sampler_cache; }
+
+  RenderPassCacheVk& GetRenderPassCache() { return m_render_pass_cache; }
+
+  VkPhysicalDeviceFeatures const& GetEnabledFeatures() const { return m_enabled_features; }
+
+  // g_vk.vkCmdDrawIndexedIndirectCount is usable
+  bool IsDrawIndirectCountSupported() const { return m_draw_indirect_count_supported; }
+
+  // seeded from the previous run, pass it to every pipeline creation
+  VkPipelineCache GetPipelineCache() const { return m_pipeline_cache; }
+
+  // nullptr if device not support descriptor indexing
+  BindlessTextureTableVk* GetBindlessTable() const { return m_bindless_table.get(); }
+
+  std::unique_ptr<RenderGraphVk> CreateRenderGraph() {
+    return std::make_unique<RenderGraphVk>(m_device, m_phy_device, this, &m_render_pass_cache);
+  }
+
+  std::unique_ptr<BufferVk> CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, bool host_visible);
+
+  // lock free, returns nullptr if the resource is already destroyed
+  GpuResourceVk* GetResource(ResourceHandle handle) const { return m_resources.Get(handle); }
+
+  uint32_t GetResourceCount() const { return m_resources.GetLiveCount(); }
+
+  // record and submit a one time command buffer, returns after the GPU finished it
+  bool ImmediateSubmit(std::function<void(VkCommandBuffer)> const& func);
+
+  // frame `frame` starts recording on the CPU, objects released from now on are tagged with it. Texture residency
+  // changes are recorded into `upload_cmd`, returns false if nothing was recorded.
+  bool BeginFrame(uint64_t frame, VkCommandBuffer upload_cmd);
+
+  uint64_t GetCurrentFrame() const { return m_current_frame.load(); }
+
+  TextureStreamerVk& GetTextureStreamer() { return m_texture_streamer; }
+
+  TextureUpdateBatchVk& GetTextureUpdateBatch() { return m_texture_update_batch; }
+
+  ReadbackQueueVk& GetReadbackQueue() { return m_readback_queue; }
+
+  // fence of `frame` is signaled, nothing released up to that frame is used by the GPU anymore
+  void OnFrameComplete(uint64_t frame) {
+    m_readback_queue.Collect(frame);
+    m_deletion_queue.Collect(frame);
+  }
+
  private:
   void SaveResource(GpuResourceVk* res);
 
   void RemoveResource(GpuResourceVk* res);
 
+  void CreatePipelineCache();
+
+  void SavePipelineCache();
+
  private:
   bool m_is_debug = {};
   VkInstance m_vk_instance = {};
@@ -65,8 +162,34 @@ class RenderSystemVk : public RenderSystem, public GpuResourceDelegateVk {
   VkDevice m_device = {};
   VkQueue m_graphic_queue = {};
   VkQueue m_present_queue = {};
-
-  LinkedList<GpuResourceVk> m_res_list = {};
+  std::mutex m_queue_mutex = {};
+  bool m_bindless_supported = {};
+  bool m_memory_budget_supported = {};
+  bool m_imageless_supported = {};
+  bool m_dynamic_rendering_supported = {};
+  bool m_draw_indirect_count_supported = {};
+  VkPhysicalDeviceFeatures m_enabled_features = {};
+  std::vector<uint8_t> m_pipeline_cache_data = {};
+  VkPipelineCache m_pipeline_cache = {};
+
+  std::atomic<uint64_t> m_current_frame = {};
+  DeletionQueueVk m_deletion_queue = {};
+
+  std::mutex m_immediate_mutex = {};
+  VkCommandPool m_immediate_pool = {};
+  VkCommandBuffer m_immediate_cmd = {};
+  VkFence m_immediate_fence = {};
+
+  DescriptorSetCacheVk m_descriptor_set_cache = {};
+  SamplerCacheVk m_sampler_cache = {};
+  RenderPassCacheVk m_render_pass_cache = {};
+  std::unique_ptr<BindlessTextureTableVk> m_bindless_table = {};
+  TextureStreamerVk m_texture_streamer = {};
+  TextureUpdateBatchVk m_texture_update_batch = {};
+  ReadbackQueueVk m_readback_queue = {};
+
+  // every live resource created by this render system, safe to add and remove from loader threads
+  HandleRegistry<GpuResourceVk> m_resources = {};
 };
 
 }  // namespace hexgon
@@ -0,0 +1,204 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include "Render/Vulkan/SamplerCacheVk.hpp"
+
+#include <algorithm>
+#include <functional>
+
+#include "Core/Util/HashCombine.hpp"
+#include "LogPrivate.hpp"
+#include "Render/Vulkan/DispatchVk.hpp"
+
+namespace hexgon {
+
+namespace {
+
+VkFilter ToVkFilter(FilterMode mode) { return mode == FilterMode::kNearest ? VK_FILTER_NEAREST : VK_FILTER_LINEAR; }
+
+VkSamplerMipmapMode ToVkMipmapMode(MipmapMode mode) {
+  return mode == MipmapMode::kNearest ? VK_SAMPLER_MIPMAP_MODE_NEAREST : VK_SAMPLER_MIPMAP_MODE_LINEAR;
+}
+
+VkSamplerAddressMode ToVkAddressMode(AddressMode mode) {
+  switch (mode) {
+    case AddressMode::kMirroredRepeat:
+      return VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT;
+    case AddressMode::kClampToEdge:
+      return VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    case AddressMode::kClampToBorder:
+      return VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    default:
+      return VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  }
+}
+
+VkCompareOp ToVkCompareOp(CompareFunction func) {
+  switch (func) {
+    case CompareFunction::kNever:
+      return VK_COMPARE_OP_NEVER;
+    case CompareFunction::kLess:
+      return VK_COMPARE_OP_LESS;
+    case CompareFunction::kEqual:
+      return VK_COMPARE_OP_EQUAL;
+    case CompareFunction::kLessEqual:
+      return VK_COMPARE_OP_LESS_OR_EQUAL;
+    case CompareFunction::kGreater:
+      return VK_COMPARE_OP_GREATER;
+    case CompareFunction::kNotEqual:
+      return VK_COMPARE_OP_NOT_EQUAL;
+    case CompareFunction::kGreaterEqual:
+      return VK_COMPARE_OP_GREATER_OR_EQUAL;
+    default:
+      return VK_COMPARE_OP_ALWAYS;
+  }
+}
+
+VkBorderColor ToVkBorderColor(BorderColor color) {
+  switch (color) {
+    case BorderColor::kOpaqueBlack:
+      return VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
+    case BorderColor::kOpaqueWhite:
+      return VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+    default:
+      return VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+  }
+}
+
+}  // namespace
+
+void SamplerCacheVk::Init(VkDevice device, VkPhysicalDevice phy_device, bool anisotropy_enabled) {
+  m_device = device;
+
+  VkPhysicalDeviceProperties properties{};
+  g_vk.vkGetPhysicalDeviceProperties(phy_device, &properties);
+
+  m_max_anisotropy = anisotropy_enabled ? properties.limits.maxSamplerAnisotropy : 1.f;
+  m_max_samplers = properties.limits.maxSamplerAllocationCount;
+}
+
+std::shared_ptr<SamplerVk> SamplerCacheVk::GetOrCreate(const SamplerDescriptor& desc) {
+  SamplerDescriptor key = Normalize(desc);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto it = m_samplers.find(key);
+  if (it != m_samplers.end()) {
+    return it->second;
+  }
+
+  if (m_samplers.size() >= m_max_samplers) {
+    HEX_CORE_ERROR("Sampler limit of {} reached, can not create more samplers.", m_max_samplers);
+    return nullptr;
+  }
+
+  VkSamplerCreateInfo create_info{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+  create_info.magFilter = ToVkFilter(key.mag_filter);
+  create_info.minFilter = ToVkFilter(key.min_filter);
+  create_info.mipmapMode = ToVkMipmapMode(key.mipmap_mode);
+  create_info.addressModeU = ToVkAddressMode(key.address_u);
+  create_info.addressModeV = ToVkAddressMode(key.address_v);
+  create_info.addressModeW = ToVkAddressMode(key.address_w);
+  create_info.mipLodBias = key.lod_bias;
+  create_info.anisotropyEnable = key.max_anisotropy > 1.f ? VK_TRUE : VK_FALSE;
+  create_info.maxAnisotropy = key.max_anisotropy;
+  create_info.compareEnable = key.compare_enable ? VK_TRUE : VK_FALSE;
+  create_info.compareOp = ToVkCompareOp(key.compare);
+  create_info.minLod = key.min_lod;
+  create_info.maxLod = key.max_lod;
+  create_info.borderColor = ToVkBorderColor(key.border_color);
+
+  VkSampler vk_sampler = VK_NULL_HANDLE;
+  if (g_vk.vkCreateSampler(m_device, &create_info, nullptr, &vk_sampler) != VK_SUCCESS) {
+    HEX_CORE_ERROR("Failed create vulkan sampler.");
+    return nullptr;
+  }
+
+  auto sampler = std::make_shared<SamplerVk>(key, vk_sampler);
+
+  m_samplers.emplace(key, sampler);
+
+  return sampler;
+}
+
+VkSampler SamplerCacheVk::GetSampler(const SamplerDescriptor& desc) {
+  auto sampler = GetOrCreate(desc);
+
+  return sampler ? sampler->GetSampler() : VK_NULL_HANDLE;
+}
+
+size_t SamplerCacheVk::GetSamplerCount() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_samplers.size();
+}
+
+void SamplerCacheVk::Destroy() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  for (auto const& it : m_samplers) {
+    g_vk.vkDestroySampler(m_device, it.second->GetSampler(), nullptr);
+  }
+
+  m_samplers.clear();
+}
+
+SamplerDescriptor SamplerCacheVk::Normalize(const SamplerDescriptor& desc) const {
+  SamplerDescriptor result = desc;
+
+  result.max_anisotropy = std::clamp(desc.max_anisotropy, 1.f, m_max_anisotropy);
+
+  if (!result.compare_enable) {
+    result.compare = SamplerDescriptor{}.compare;
+  }
+
+  bool uses_border = result.address_u == AddressMode::kClampToBorder ||
+                     result.address_v == AddressMode::kClampToBorder ||
+                     result.address_w == AddressMode::kClampToBorder;
+  if (!uses_border) {
+    result.border_color = SamplerDescriptor{}.border_color;
+  }
+
+  return result;
+}
+
+size_t SamplerCacheVk::DescriptorHash::operator()(const SamplerDescriptor& desc) const {
+  size_t seed = 0;
+
+  HashCombine(seed, static_cast<uint32_t>(desc.mag_filter));
+  HashCombine(seed, static_cast<uint32_t>(desc.min_filter));
+  HashCombine(seed, static_cast<uint32_t>(desc.mipmap_mode));
+  HashCombine(seed, static_cast<uint32_t>(desc.address_u));
+  HashCombine(seed, static_cast<uint32_t>(desc.address_v));
+  HashCombine(seed, static_cast<uint32_t>(desc.address_w));
+  HashCombine(seed, desc.max_anisotropy);
+  HashCombine(seed, desc.lod_bias);
+  HashCombine(seed, desc.min_lod);
+  HashCombine(seed, desc.max_lod);
+  HashCombine(seed, desc.compare_enable);
+  HashCombine(seed, static_cast<uint32_t>(desc.compare));
+  HashCombine(seed, static_cast<uint32_t>(desc.border_color));
+
+  return seed;
+}
+
+}  // namespace hexgon
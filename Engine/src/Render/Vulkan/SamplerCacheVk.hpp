@@ -0,0 +1,85 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <Hexgon/Render/Sampler.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace hexgon {
+
+class SamplerVk : public Sampler {
+ public:
+  SamplerVk(SamplerDescriptor desc, VkSampler sampler) : Sampler(desc), m_sampler(sampler) {}
+
+  ~SamplerVk() override = default;
+
+  VkSampler GetSampler() const { return m_sampler; }
+
+ private:
+  VkSampler m_sampler;
+};
+
+// Deduplicates samplers by descriptor. A device can only hold maxSamplerAllocationCount samplers while real scenes
+// use a handful of distinct ones, so every sampler created here lives until Destroy(). That also makes the VkSampler
+// handles safe to bake into descriptor set layouts as immutable samplers.
+class SamplerCacheVk {
+ public:
+  SamplerCacheVk() = default;
+
+  // `anisotropy_enabled` is the samplerAnisotropy feature the device was created with
+  void Init(VkDevice device, VkPhysicalDevice phy_device, bool anisotropy_enabled);
+
+  std::shared_ptr<SamplerVk> GetOrCreate(const SamplerDescriptor& desc);
+
+  // VK_NULL_HANDLE on failure
+  VkSampler GetSampler(const SamplerDescriptor& desc);
+
+  size_t GetSamplerCount();
+
+  void Destroy();
+
+ private:
+  // drop fields the device ignores so they do not split the cache
+  SamplerDescriptor Normalize(const SamplerDescriptor& desc) const;
+
+  struct DescriptorHash {
+    size_t operator()(const SamplerDescriptor& desc) const;
+  };
+
+ private:
+  VkDevice m_device = {};
+  float m_max_anisotropy = 1.f;
+  uint32_t m_max_samplers = {};
+
+  std::mutex m_mutex = {};
+  std::unordered_map<SamplerDescriptor, std::shared_ptr<SamplerVk>, DescriptorHash> m_samplers = {};
+};
+
+}  // namespace hexgon
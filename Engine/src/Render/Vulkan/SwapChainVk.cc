@@ -23,36 +23,55 @@
 
 #include "Render/Vulkan/SwapChainVk.hpp"
 
+#include <Hexgon/Core/JobSystem.hpp>
+#include <algorithm>
+
+#include "LogPrivate.hpp"
+#include "Render/Vulkan/DispatchVk.hpp"
+#include "Render/Vulkan/RenderSystemVk.hpp"
+
 namespace hexgon {
 
 PerFrameData::~PerFrameData() {
+  descriptor_allocator.Destroy();
+
+  for (auto& thread_pool : thread_pools) {
+    if (!thread_pool.buffers.empty()) {
+      g_vk.vkFreeCommandBuffers(device, thread_pool.pool, static_cast<uint32_t>(thread_pool.buffers.size()),
+                                thread_pool.buffers.data());
+    }
+
+    g_vk.vkDestroyCommandPool(device, thread_pool.pool, nullptr);
+  }
+  thread_pools.clear();
+
   // reset pool first
   if (cmd_pool) {
-    vkResetCommandPool(device, cmd_pool, 0);
+    g_vk.vkResetCommandPool(device, cmd_pool, 0);
   }
   // release cmd first
   if (cmd) {
-    vkFreeCommandBuffers(device, cmd_pool, 1, &cmd);
+    g_vk.vkFreeCommandBuffers(device, cmd_pool, 1, &cmd);
     cmd = nullptr;
   }
   // destroy pool
   if (cmd_pool) {
-    vkDestroyCommandPool(device, cmd_pool, nullptr);
+    g_vk.vkDestroyCommandPool(device, cmd_pool, nullptr);
     cmd_pool = nullptr;
   }
   // destroy fence
   if (submit_fence) {
-    vkDestroyFence(device, submit_fence, nullptr);
+    g_vk.vkDestroyFence(device, submit_fence, nullptr);
     submit_fence = nullptr;
   }
 
   // semaphore
   if (acquire_semaphore) {
-    vkDestroySemaphore(device, acquire_semaphore, nullptr);
+    g_vk.vkDestroySemaphore(device, acquire_semaphore, nullptr);
     acquire_semaphore = nullptr;
   }
   if (release_semaphore) {
-    vkDestroySemaphore(device, release_semaphore, nullptr);
+    g_vk.vkDestroySemaphore(device, release_semaphore, nullptr);
     release_semaphore = nullptr;
   }
 }
@@ -64,7 +83,14 @@ void PerFrameData::Init(VkDevice device, uint32_t queue_index) {
     VkFenceCreateInfo info{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
     info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    vkCreateFence(this->device, &info, nullptr, &this->submit_fence);
+    g_vk.vkCreateFence(this->device, &info, nullptr, &this->submit_fence);
+  }
+  // semaphore
+  {
+    VkSemaphoreCreateInfo info{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+
+    g_vk.vkCreateSemaphore(this->device, &info, nullptr, &this->acquire_semaphore);
+    g_vk.vkCreateSemaphore(this->device, &info, nullptr, &this->release_semaphore);
   }
   // command pool
   {
@@ -72,7 +98,7 @@ void PerFrameData::Init(VkDevice device, uint32_t queue_index) {
     info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
     info.queueFamilyIndex = queue_index;
 
-    vkCreateCommandPool(this->device, &info, nullptr, &this->cmd_pool);
+    g_vk.vkCreateCommandPool(this->device, &info, nullptr, &this->cmd_pool);
   }
 
   // command buffer
@@ -82,12 +108,107 @@ void PerFrameData::Init(VkDevice device, uint32_t queue_index) {
     info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
     info.commandBufferCount = 1;
 
-    vkAllocateCommandBuffers(this->device, &info, &this->cmd);
+    g_vk.vkAllocateCommandBuffers(this->device, &info, &this->cmd);
+    g_vk.vkAllocateCommandBuffers(this->device, &info, &this->upload_cmd);
+  }
+
+  // one pool per job system thread, command pools can not be shared between threads
+  {
+    thread_pools.resize(JobSystem::Get()->GetThreadCount());
+
+    VkCommandPoolCreateInfo info{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    info.queueFamilyIndex = queue_index;
+
+    for (auto& thread_pool : thread_pools) {
+      g_vk.vkCreateCommandPool(this->device, &info, nullptr, &thread_pool.pool);
+    }
+  }
+
+  // descriptor sets only live for one frame
+  descriptor_allocator.Init(this->device, 128, DescriptorAllocatorVk::DefaultRatios());
+}
+
+void PerFrameData::Reset() {
+  g_vk.vkResetCommandPool(device, cmd_pool, 0);
+
+  for (auto& thread_pool : thread_pools) {
+    g_vk.vkResetCommandPool(device, thread_pool.pool, 0);
+    thread_pool.used = 0;
+  }
+
+  descriptor_allocator.Reset();
+}
+
+VkCommandBuffer PerFrameData::ObtainSecondary(uint32_t thread_index) {
+  auto& thread_pool = thread_pools[thread_index];
+
+  if (thread_pool.used == thread_pool.buffers.size()) {
+    VkCommandBufferAllocateInfo info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+    info.commandPool = thread_pool.pool;
+    info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    info.commandBufferCount = 1;
+
+    VkCommandBuffer buffer = {};
+    if (g_vk.vkAllocateCommandBuffers(device, &info, &buffer) != VK_SUCCESS) {
+      HEX_CORE_ERROR("Failed allocate secondary command buffer.");
+      return VK_NULL_HANDLE;
+    }
+
+    thread_pool.buffers.emplace_back(buffer);
   }
+
+  return thread_pool.buffers[thread_pool.used++];
 }
 
-SwapChainVk::SwapChainVk(VkDevice device, VkSwapchainKHR swap_chain, VkSurfaceCapabilitiesKHR caps, VkFormat format)
-    : m_device(device),
+void PerFrameData::RecordParallel(const VkCommandBufferInheritanceInfo& inheritance, uint32_t count,
+                                  uint32_t chunk_size, const RecordFunc& func) {
+  if (count == 0) {
+    return;
+  }
+
+  chunk_size = std::max(chunk_size, 1u);
+
+  std::vector<VkCommandBuffer> chunk_buffers((count + chunk_size - 1) / chunk_size);
+
+  VkCommandBufferBeginInfo begin_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+  begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  begin_info.pInheritanceInfo = &inheritance;
+
+  if (inheritance.renderPass || inheritance.pNext) {
+    begin_info.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+  }
+
+  JobSystem::Get()->ParallelFor(count, chunk_size, [&](uint32_t begin, uint32_t end, uint32_t thread_index) {
+    // ParallelFor may merge everything into one call if there are no workers
+    for (uint32_t chunk_begin = begin; chunk_begin < end; chunk_begin += chunk_size) {
+      uint32_t chunk_end = std::min(chunk_begin + chunk_size, end);
+
+      VkCommandBuffer buffer = ObtainSecondary(thread_index);
+      if (!buffer) {
+        continue;
+      }
+
+      g_vk.vkBeginCommandBuffer(buffer, &begin_info);
+      func(buffer, chunk_begin, chunk_end);
+      g_vk.vkEndCommandBuffer(buffer);
+
+      chunk_buffers[chunk_begin / chunk_size] = buffer;
+    }
+  });
+
+  // drop chunks which failed to get a command buffer, order of the rest is kept
+  chunk_buffers.erase(std::remove(chunk_buffers.begin(), chunk_buffers.end(), VkCommandBuffer{}), chunk_buffers.end());
+
+  if (!chunk_buffers.empty()) {
+    g_vk.vkCmdExecuteCommands(cmd, static_cast<uint32_t>(chunk_buffers.size()), chunk_buffers.data());
+  }
+}
+
+SwapChainVk::SwapChainVk(RenderSystemVk* render_system, VkSwapchainKHR swap_chain, VkSurfaceCapabilitiesKHR caps,
+                         VkFormat format)
+    : m_render_system(render_system),
+      m_device(render_system->GetDevice()),
       m_vk_swap_chain(swap_chain),
       m_caps(caps),
       m_format(format),
@@ -103,21 +224,182 @@ uint32_t SwapChainVk::GetWidth() const { return m_caps.currentExtent.width; }
 
 uint32_t SwapChainVk::GetHeight() const { return m_caps.currentExtent.height; }
 
-uint32_t SwapChainVk::GetMaxBufferCount() const { return m_caps.maxImageCount; }
+uint32_t SwapChainVk::GetMaxBufferCount() const { return static_cast<uint32_t>(m_swap_chain_images.size()); }
 
-void SwapChainVk::InitInternal() {
-  // init per frame datas
-  m_frame_data.resize(GetMaxBufferCount());
+bool SwapChainVk::BeginFrame() {
+  auto& frame = m_frame_data[m_frame_index];
 
-  for (auto& data : m_frame_data) {
-    data.Init(m_device, 0);
+  // the frame which used this slot last time must be finished before its resources are reused
+  g_vk.vkWaitForFences(m_device, 1, &frame.submit_fence, VK_TRUE, UINT64_MAX);
+
+  if (frame.frame_number != UINT64_MAX) {
+    m_render_system->OnFrameComplete(frame.frame_number);
   }
 
-  // all image buffers in swapchain
-  m_swap_chain_images.resize(GetMaxBufferCount());
+  VkResult result = g_vk.vkAcquireNextImageKHR(m_device, m_vk_swap_chain, UINT64_MAX, frame.acquire_semaphore,
+                                               VK_NULL_HANDLE, &m_image_index);
+
+  if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+    HEX_CORE_ERROR("Failed acquire swap chain image: {}", static_cast<int32_t>(result));
+    return false;
+  }
+
+  g_vk.vkResetFences(m_device, 1, &frame.submit_fence);
+
+  frame.Reset();
+
+  VkCommandBufferBeginInfo begin_info{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+  begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+  // open until EndFrame, which adds the queued texture writes
+  g_vk.vkBeginCommandBuffer(frame.upload_cmd, &begin_info);
+
+  frame.frame_number = m_frame_number;
+  frame.has_upload = m_render_system->BeginFrame(m_frame_number, frame.upload_cmd);
+
+  g_vk.vkBeginCommandBuffer(frame.cmd, &begin_info);
+
+  VkImageMemoryBarrier barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = GetCurrentImage();
+  barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+  if (m_caps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) {
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+
+    g_vk.vkCmdPipelineBarrier(frame.cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr,
+                              0, nullptr, 1, &barrier);
+
+    auto const& color = GetClearColor();
+    VkClearColorValue clear_value{{color.r, color.g, color.b, color.a}};
+
+    g_vk.vkCmdClearColorImage(frame.cmd, GetCurrentImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clear_value, 1,
+                              &barrier.subresourceRange);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  } else {
+    barrier.srcAccessMask = 0;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  }
+
+  barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  g_vk.vkCmdPipelineBarrier(frame.cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
+                            0, nullptr, 0, nullptr, 1, &barrier);
+
+  return true;
+}
+
+void SwapChainVk::EndFrame() {
+  auto& frame = m_frame_data[m_frame_index];
+
+  VkImageMemoryBarrier barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+  barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  barrier.dstAccessMask = 0;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = GetCurrentImage();
+  barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+  g_vk.vkCmdPipelineBarrier(frame.cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+  // copies for readbacks requested this frame, results arrive when this slot's fence is waited on again
+  m_render_system->GetReadbackQueue().Record(m_render_system, frame.cmd, frame.frame_number);
+
+  g_vk.vkEndCommandBuffer(frame.cmd);
+
+  // texture writes queued during this frame become visible to its draws, they do not wait for the acquire
+  {
+    bool has_upload = m_render_system->GetTextureUpdateBatch().Flush(m_render_system, frame.upload_cmd);
+    has_upload = has_upload || frame.has_upload;
+
+    g_vk.vkEndCommandBuffer(frame.upload_cmd);
+
+    if (has_upload) {
+      VkSubmitInfo upload_info{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+      upload_info.commandBufferCount = 1;
+      upload_info.pCommandBuffers = &frame.upload_cmd;
 
+      if (m_render_system->SubmitGraphic(upload_info, VK_NULL_HANDLE) != VK_SUCCESS) {
+        HEX_CORE_ERROR("Failed submit texture updates.");
+      }
+    }
+  }
+
+  VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+  VkSubmitInfo submit_info{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+  submit_info.waitSemaphoreCount = 1;
+  submit_info.pWaitSemaphores = &frame.acquire_semaphore;
+  submit_info.pWaitDstStageMask = &wait_stage;
+  submit_info.commandBufferCount = 1;
+  submit_info.pCommandBuffers = &frame.cmd;
+  submit_info.signalSemaphoreCount = 1;
+  submit_info.pSignalSemaphores = &frame.release_semaphore;
+
+  if (m_render_system->SubmitGraphic(submit_info, frame.submit_fence) != VK_SUCCESS) {
+    HEX_CORE_ERROR("Failed submit frame command buffer.");
+  }
+
+  VkPresentInfoKHR present_info{VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
+  present_info.waitSemaphoreCount = 1;
+  present_info.pWaitSemaphores = &frame.release_semaphore;
+  present_info.swapchainCount = 1;
+  present_info.pSwapchains = &m_vk_swap_chain;
+  present_info.pImageIndices = &m_image_index;
+
+  m_render_system->Present(present_info);
+
+  m_frame_index = (m_frame_index + 1) % static_cast<uint32_t>(m_frame_data.size());
+  m_frame_number++;
+}
+
+RenderingInfoVk SwapChainVk::GetRenderingInfo(VkAttachmentLoadOp load_op) const {
+  RenderingAttachmentVk color{};
+  color.view = GetCurrentImageView();
+  color.format = m_format;
+  color.load_op = load_op;
+  color.store_op = VK_ATTACHMENT_STORE_OP_STORE;
+  // must match the usage the swapchain was created with
+  color.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  if (m_caps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) {
+    color.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  }
+
+  auto const& clear = GetClearColor();
+  color.clear.color = {{clear.r, clear.g, clear.b, clear.a}};
+
+  RenderingInfoVk info{};
+  info.width = GetWidth();
+  info.height = GetHeight();
+  info.colors.emplace_back(color);
+
+  return info;
+}
+
+void SwapChainVk::InitInternal() {
+  // all image buffers in swapchain
   uint32_t image_count = 0;
-  vkGetSwapchainImagesKHR(m_device, m_vk_swap_chain, &image_count, m_swap_chain_images.data());
+  g_vk.vkGetSwapchainImagesKHR(m_device, m_vk_swap_chain, &image_count, nullptr);
+
+  m_swap_chain_images.resize(image_count);
+  g_vk.vkGetSwapchainImagesKHR(m_device, m_vk_swap_chain, &image_count, m_swap_chain_images.data());
+
+  // init per frame datas
+  m_frame_data.resize(image_count);
+
+  for (auto& data : m_frame_data) {
+    data.Init(m_device, m_render_system->GetGraphicQueueIndex());
+  }
 
   m_swap_chain_image_views.resize(image_count);
 
@@ -130,23 +412,30 @@ void SwapChainVk::InitInternal() {
     info.components = {VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A};
     info.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
 
-    vkCreateImageView(m_device, &info, nullptr, &m_swap_chain_image_views[i]);
+    g_vk.vkCreateImageView(m_device, &info, nullptr, &m_swap_chain_image_views[i]);
   }
 }
 
 void SwapChainVk::DestroyInternal() {
+  // frames still in flight reference the per frame resources
+  for (auto& data : m_frame_data) {
+    g_vk.vkWaitForFences(m_device, 1, &data.submit_fence, VK_TRUE, UINT64_MAX);
+  }
+
   m_frame_data.clear();
 
   // relse image views
   for (auto& image_view : m_swap_chain_image_views) {
-    vkDestroyImageView(m_device, image_view, nullptr);
+    // the recreated swap chain may hand out the same handle values
+    m_render_system->GetRenderPassCache().Evict(image_view);
+    g_vk.vkDestroyImageView(m_device, image_view, nullptr);
   }
 
   m_swap_chain_image_views.clear();
 
   m_swap_chain_images.clear();
 
-  vkDestroySwapchainKHR(m_device, m_vk_swap_chain, nullptr);
+  g_vk.vkDestroySwapchainKHR(m_device, m_vk_swap_chain, nullptr);
 }
 
 }  // namespace hexgon
@@ -26,28 +26,64 @@
 #include <vulkan/vulkan.h>
 
 #include <Hexgon/Render/SwapChain.hpp>
+#include <cstdint>
+#include <functional>
 #include <vector>
 
+#include "Render/Vulkan/DescriptorAllocatorVk.hpp"
+#include "Render/Vulkan/RenderPassCacheVk.hpp"
+
 namespace hexgon {
 
+class RenderSystemVk;
+
+// secondary command buffers owned by one thread during one frame
+struct ThreadCommandPoolVk {
+  VkCommandPool pool = {};
+  std::vector<VkCommandBuffer> buffers = {};
+  uint32_t used = 0;
+};
+
 struct PerFrameData {
+  // cmd, begin, end
+  using RecordFunc = std::function<void(VkCommandBuffer, uint32_t, uint32_t)>;
+
   VkDevice device = {};
   VkFence submit_fence = {};
   VkCommandPool cmd_pool = {};
   VkCommandBuffer cmd = {};
+  // texture residency changes and queued texture writes, submitted right before `cmd`
+  VkCommandBuffer upload_cmd = {};
+  // residency changes were recorded into upload_cmd when the frame began
+  bool has_upload = false;
   VkSemaphore acquire_semaphore = {};
   VkSemaphore release_semaphore = {};
+  DescriptorAllocatorVk descriptor_allocator = {};
+  std::vector<ThreadCommandPoolVk> thread_pools = {};
+  // number of the frame last recorded with this slot
+  uint64_t frame_number = UINT64_MAX;
 
   PerFrameData() = default;
 
   ~PerFrameData();
 
   void Init(VkDevice device, uint32_t queue_index);
+
+  // recycle all transient allocations of this frame, only valid after submit_fence is signaled
+  void Reset();
+
+  VkCommandBuffer ObtainSecondary(uint32_t thread_index);
+
+  // Record [0, count) in chunks of `chunk_size` on the job system, each chunk into its own secondary command buffer.
+  // Secondaries are executed in `cmd` in chunk order, so the result does not depend on thread scheduling.
+  void RecordParallel(VkCommandBufferInheritanceInfo const& inheritance, uint32_t count, uint32_t chunk_size,
+                      RecordFunc const& func);
 };
 
 class SwapChainVk : public SwapChain {
  public:
-  SwapChainVk(VkDevice device, VkSwapchainKHR swap_chain, VkSurfaceCapabilitiesKHR caps, VkFormat format);
+  SwapChainVk(RenderSystemVk* render_system, VkSwapchainKHR swap_chain, VkSurfaceCapabilitiesKHR caps,
+              VkFormat format);
 
   ~SwapChainVk() override;
 
@@ -57,12 +93,32 @@ class SwapChainVk : public SwapChain {
 
   virtual uint32_t GetMaxBufferCount() const override;
 
+  bool BeginFrame() override;
+
+  void EndFrame() override;
+
+  PerFrameData* GetCurrentFrame() { return &m_frame_data[m_frame_index]; }
+
+  VkImage GetCurrentImage() const { return m_swap_chain_images[m_image_index]; }
+
+  VkImageView GetCurrentImageView() const { return m_swap_chain_image_views[m_image_index]; }
+
+  VkFormat GetFormat() const { return m_format; }
+
+  // current back buffer as the only color attachment, BeginFrame already cleared it so the default load op keeps that.
+  // Framebuffers are keyed by format and extent, so a recreated swapchain of the same size reuses them.
+  RenderingInfoVk GetRenderingInfo(VkAttachmentLoadOp load_op = VK_ATTACHMENT_LOAD_OP_LOAD) const;
+
+  // number of frames submitted since creation
+  uint64_t GetFrameNumber() const { return m_frame_number; }
+
  private:
   void InitInternal();
 
   void DestroyInternal();
 
  private:
+  RenderSystemVk* m_render_system = {};
   VkDevice m_device = {};
   VkSwapchainKHR m_vk_swap_chain = {};
   VkSurfaceCapabilitiesKHR m_caps = {};
@@ -71,6 +127,9 @@ class SwapChainVk : public SwapChain {
   std::vector<VkImage> m_swap_chain_images = {};
   std::vector<VkImageView> m_swap_chain_image_views = {};
   std::vector<PerFrameData> m_frame_data = {};
+  uint32_t m_frame_index = 0;
+  uint32_t m_image_index = 0;
+  uint64_t m_frame_number = 0;
 };
 
 }  // namespace hexgon
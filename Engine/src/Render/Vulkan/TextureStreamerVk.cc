@@ -0,0 +1,251 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include "Render/Vulkan/TextureStreamerVk.hpp"
+
+#include <algorithm>
+
+#include "LogPrivate.hpp"
+#include "Render/Vulkan/DispatchVk.hpp"
+#include "Render/Vulkan/TextureVk.hpp"
+
+namespace hexgon {
+
+namespace {
+
+// at most this many textures gain a mip per update, each one costs an upload
+constexpr uint32_t kMaxStreamInPerUpdate = 4;
+// querying the budget is a driver call, no need to do it every frame
+constexpr uint64_t kBudgetUpdateInterval = 30;
+
+struct StreamEntry {
+  TextureVk* texture = nullptr;
+  uint32_t resident = 0;
+  uint32_t target = 0;
+  uint32_t requested = 0;
+  uint64_t last_used = 0;
+};
+
+VkDeviceSize ResidentSize(TextureVk* texture, uint32_t resident) {
+  VkDeviceSize size = 0;
+  for (uint32_t l = resident; l < texture->GetMipLevels(); l++) {
+    size += texture->GetLevelSize(l);
+  }
+
+  return size;
+}
+
+}  // namespace
+
+void TextureStreamerVk::Init(VkPhysicalDevice phy_device, bool memory_budget_supported) {
+  m_phy_device = phy_device;
+  m_memory_budget_supported = memory_budget_supported;
+
+  UpdateBudget();
+
+  HEX_CORE_INFO("Texture streaming budget {} MB, VK_EXT_memory_budget {}.", m_budget >> 20,
+                memory_budget_supported ? "enabled" : "not supported");
+}
+
+void TextureStreamerVk::Register(TextureVk* texture) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  texture->SetStreamer(this);
+  m_textures.emplace_back(texture);
+}
+
+void TextureStreamerVk::Unregister(TextureVk* texture) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto it = std::find(m_textures.begin(), m_textures.end(), texture);
+  if (it != m_textures.end()) {
+    *it = m_textures.back();
+    m_textures.pop_back();
+  }
+
+  texture->SetStreamer(nullptr);
+}
+
+bool TextureStreamerVk::Update(uint64_t frame, VkCommandBuffer cmd) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (frame >= m_next_budget_update) {
+    UpdateBudget();
+    m_next_budget_update = frame + kBudgetUpdateInterval;
+  }
+
+  std::vector<StreamEntry> entries{};
+  entries.reserve(m_textures.size());
+
+  VkDeviceSize total = 0;
+  for (auto texture : m_textures) {
+    StreamEntry entry{};
+    entry.texture = texture;
+    entry.resident = entry.target = texture->GetResidentMip();
+    entry.requested = texture->GetRequestedMip();
+    entry.last_used = texture->GetLastUsedFrame();
+
+    total += ResidentSize(texture, entry.resident);
+    entries.emplace_back(entry);
+  }
+
+  // least recently used first
+  std::sort(entries.begin(), entries.end(),
+            [](StreamEntry const& a, StreamEntry const& b) { return a.last_used < b.last_used; });
+
+  // drop one mip from the least recently used texture which is older than `frame` or holds more than it asked for
+  auto evict_one = [&entries, &total](uint64_t frame, TextureVk* except) {
+    for (auto& entry : entries) {
+      if (entry.texture == except || entry.target + 1 >= entry.texture->GetMipLevels()) {
+        continue;
+      }
+
+      if (entry.last_used >= frame && entry.target >= entry.requested) {
+        continue;
+      }
+
+      total -= entry.texture->GetLevelSize(entry.target);
+      entry.target++;
+      return true;
+    }
+
+    return false;
+  };
+
+  // most recently used textures stream in first
+  uint32_t stream_in = 0;
+  for (auto it = entries.rbegin(); it != entries.rend() && stream_in < kMaxStreamInPerUpdate; ++it) {
+    if (it->requested >= it->target) {
+      continue;
+    }
+
+    VkDeviceSize size = it->texture->GetLevelSize(it->target - 1);
+
+    bool fits = true;
+    while (total + size > m_budget) {
+      if (!evict_one(it->last_used, it->texture)) {
+        fits = false;
+        break;
+      }
+    }
+
+    if (!fits) {
+      break;
+    }
+
+    it->target--;
+    total += size;
+    stream_in++;
+  }
+
+  // the budget may shrink when other applications allocate memory
+  while (total > m_budget && evict_one(frame, nullptr)) {
+  }
+
+  // evict before streaming in so the memory is given back first
+  bool recorded = false;
+  for (auto const& entry : entries) {
+    if (entry.target > entry.resident) {
+      recorded |= entry.texture->MakeResident(entry.target, cmd);
+    }
+  }
+
+  for (auto const& entry : entries) {
+    if (entry.target < entry.resident) {
+      recorded |= entry.texture->MakeResident(entry.target, cmd);
+    }
+  }
+
+  m_resident_size = total;
+
+  return recorded;
+}
+
+void TextureStreamerVk::Clear() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  for (auto texture : m_textures) {
+    texture->SetStreamer(nullptr);
+  }
+
+  m_textures.clear();
+}
+
+void TextureStreamerVk::SetBudgetLimit(VkDeviceSize limit) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_budget_limit = limit;
+  m_next_budget_update = 0;
+}
+
+VkDeviceSize TextureStreamerVk::GetBudget() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_budget;
+}
+
+VkDeviceSize TextureStreamerVk::GetResidentSize() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_resident_size;
+}
+
+void TextureStreamerVk::UpdateBudget() {
+  VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties{
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT};
+  VkPhysicalDeviceMemoryProperties2 properties{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2};
+
+  if (m_memory_budget_supported) {
+    properties.pNext = &budget_properties;
+  }
+
+  g_vk.vkGetPhysicalDeviceMemoryProperties2(m_phy_device, &properties);
+
+  VkDeviceSize budget = 0;
+  for (uint32_t i = 0; i < properties.memoryProperties.memoryHeapCount; i++) {
+    auto const& heap = properties.memoryProperties.memoryHeaps[i];
+
+    if (!(heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) {
+      continue;
+    }
+
+    if (m_memory_budget_supported) {
+      VkDeviceSize usage = budget_properties.heapUsage[i];
+      budget += budget_properties.heapBudget[i] > usage ? budget_properties.heapBudget[i] - usage : 0;
+    } else {
+      // without the extension assume textures may take half of the device memory
+      budget += heap.size / 2;
+    }
+  }
+
+  if (m_memory_budget_supported) {
+    // heap usage contains the streamed mips, keep some headroom for everything else
+    budget = (budget + m_resident_size) / 10 * 9;
+  }
+
+  if (m_budget_limit > 0) {
+    budget = std::min(budget, m_budget_limit);
+  }
+
+  m_budget = budget;
+}
+
+}  // namespace hexgon
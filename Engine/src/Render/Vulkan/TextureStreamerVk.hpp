@@ -0,0 +1,77 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace hexgon {
+
+class TextureVk;
+
+// Decides which mips of streaming textures are resident. Runs once per frame before recording starts: textures
+// asking for more detail gain one mip per update, and when that would exceed the budget mips of the least recently
+// used textures are evicted first.
+class TextureStreamerVk {
+ public:
+  TextureStreamerVk() = default;
+
+  void Init(VkPhysicalDevice phy_device, bool memory_budget_supported);
+
+  void Register(TextureVk* texture);
+
+  void Unregister(TextureVk* texture);
+
+  // residency changes are recorded into `cmd`, returns false if nothing was recorded
+  bool Update(uint64_t frame, VkCommandBuffer cmd);
+
+  // detach all textures, called when the render system shuts down
+  void Clear();
+
+  // upper bound of the budget in bytes, 0 means only the device decides
+  void SetBudgetLimit(VkDeviceSize limit);
+
+  VkDeviceSize GetBudget();
+
+  VkDeviceSize GetResidentSize();
+
+ private:
+  void UpdateBudget();
+
+ private:
+  VkPhysicalDevice m_phy_device = {};
+  bool m_memory_budget_supported = false;
+
+  std::mutex m_mutex = {};
+  std::vector<TextureVk*> m_textures = {};
+  VkDeviceSize m_budget_limit = 0;
+  VkDeviceSize m_budget = 0;
+  VkDeviceSize m_resident_size = 0;
+  uint64_t m_next_budget_update = 0;
+};
+
+}  // namespace hexgon
@@ -0,0 +1,371 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#include "Render/Vulkan/TextureUpdateBatchVk.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "LogPrivate.hpp"
+#include "Render/Vulkan/BufferVk.hpp"
+#include "Render/Vulkan/DispatchVk.hpp"
+#include "Render/Vulkan/RenderSystemVk.hpp"
+#include "Render/Vulkan/TextureVk.hpp"
+#include "Render/Vulkan/VulkanUtil.hpp"
+
+namespace hexgon {
+
+namespace {
+
+template <typename R>
+bool Intersects(R const& a, R const& b) {
+  return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+template <typename R>
+bool Contains(R const& outer, R const& inner) {
+  return inner.x >= outer.x && inner.y >= outer.y && inner.x + inner.width <= outer.x + outer.width &&
+         inner.y + inner.height <= outer.y + outer.height;
+}
+
+// copy a width x height block area between two tightly packed rectangles
+void CopyBlocks(const uint8_t* src, uint32_t src_width, uint32_t src_x, uint32_t src_y, uint8_t* dst,
+                uint32_t dst_width, uint32_t dst_x, uint32_t dst_y, uint32_t width, uint32_t height,
+                uint32_t block_size) {
+  for (uint32_t row = 0; row < height; row++) {
+    std::memcpy(dst + ((static_cast<size_t>(dst_y) + row) * dst_width + dst_x) * block_size,
+                src + ((static_cast<size_t>(src_y) + row) * src_width + src_x) * block_size,
+                static_cast<size_t>(width) * block_size);
+  }
+}
+
+}  // namespace
+
+void TextureUpdateBatchVk::Queue(TextureVk* texture, const void* data, const TextureRange& range) {
+  PixelFormatInfo format_info = GetPixelFormatInfo(texture->GetFormat());
+
+  PendingRect rect{};
+  rect.x = range.x / format_info.block_width;
+  rect.y = range.y / format_info.block_height;
+  rect.width = (range.width + format_info.block_width - 1) / format_info.block_width;
+  rect.height = (range.height + format_info.block_height - 1) / format_info.block_height;
+
+  auto bytes = static_cast<const uint8_t*>(data);
+  rect.data.assign(bytes, bytes + static_cast<size_t>(rect.width) * rect.height * format_info.block_size);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  auto& pending = m_pending[texture];
+  pending.block_size = format_info.block_size;
+
+  auto it = std::find_if(pending.levels.begin(), pending.levels.end(), [&range](PendingLevel const& level) {
+    return level.level == range.mip_level && level.layer == range.array_layer;
+  });
+
+  if (it == pending.levels.end()) {
+    pending.levels.emplace_back(PendingLevel{range.mip_level, range.array_layer, {}});
+    it = pending.levels.end() - 1;
+  }
+
+  Insert(*it, std::move(rect), format_info.block_size);
+
+  m_queued++;
+}
+
+void TextureUpdateBatchVk::Discard(TextureVk* texture) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_pending.erase(texture);
+}
+
+bool TextureUpdateBatchVk::Flush(RenderSystemVk* render_system, VkCommandBuffer cmd) {
+  // textures can not finish their destructor while their writes are recorded
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_last_queued = m_queued;
+  m_last_regions = 0;
+  m_queued = 0;
+
+  if (m_pending.empty()) {
+    return false;
+  }
+
+  VkDeviceSize total = 0;
+  for (auto& [texture, pending] : m_pending) {
+    for (auto& level : pending.levels) {
+      MergeAdjacent(level.rects, pending.block_size);
+
+      for (auto const& rect : level.rects) {
+        total += (rect.data.size() + 15) & ~VkDeviceSize(15);
+      }
+    }
+  }
+
+  auto staging = render_system->CreateBuffer(total, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, true);
+  if (!staging) {
+    HEX_CORE_ERROR("Failed allocate {} bytes staging for texture updates.", total);
+    ClearLocked();
+    return false;
+  }
+
+  struct TextureCopy {
+    VkImage image = {};
+    std::vector<VkBufferImageCopy> regions = {};
+  };
+
+  std::vector<TextureCopy> copies{};
+  std::vector<VkImageMemoryBarrier> pre_barriers{};
+  std::vector<VkImageMemoryBarrier> post_barriers{};
+
+  auto mapped = static_cast<uint8_t*>(staging->GetMappedData());
+  VkDeviceSize offset = 0;
+
+  for (auto& [texture, pending] : m_pending) {
+    PixelFormatInfo format_info = GetPixelFormatInfo(texture->GetFormat());
+    VkImageAspectFlags aspect = VulkanUtil::FormatAspect(TextureVk::ToVkFormat(texture->GetFormat()));
+
+    std::lock_guard<std::mutex> texture_lock(texture->m_mutex);
+
+    // image level 0 of a streaming texture is its resident mip, evicted levels are refreshed when they come back
+    uint32_t resident = texture->GetResidentMip();
+
+    TextureCopy copy{};
+
+    for (auto const& level : pending.levels) {
+      if (level.level < resident) {
+        continue;
+      }
+
+      VkExtent3D extent = TextureVk::GetMipExtent(texture->GetDescriptor(), level.level);
+
+      for (auto const& rect : level.rects) {
+        std::memcpy(mapped + offset, rect.data.data(), rect.data.size());
+
+        uint32_t x = rect.x * format_info.block_width;
+        uint32_t y = rect.y * format_info.block_height;
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = offset;
+        region.imageSubresource = {aspect, level.level - resident, level.layer, 1};
+        region.imageOffset = {static_cast<int32_t>(x), static_cast<int32_t>(y), 0};
+        // the last block row or column may stick out of the level
+        region.imageExtent = {std::min(rect.width * format_info.block_width, extent.width - x),
+                              std::min(rect.height * format_info.block_height, extent.height - y), 1};
+
+        copy.regions.emplace_back(region);
+
+        offset += (rect.data.size() + 15) & ~size_t(15);
+      }
+    }
+
+    if (copy.regions.empty()) {
+      continue;
+    }
+
+    copy.image = texture->mInfo.image;
+
+    VkImageMemoryBarrier barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = copy.image;
+    barrier.subresourceRange = {aspect, 0, texture->GetMipLevels() - resident, 0, texture->GetArrayLayers()};
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = texture->mInfo.layout;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    pre_barriers.emplace_back(barrier);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = texture->GetReadyLayout();
+    post_barriers.emplace_back(barrier);
+
+    texture->mInfo.layout = texture->GetReadyLayout();
+
+    m_last_regions += static_cast<uint32_t>(copy.regions.size());
+    copies.emplace_back(std::move(copy));
+  }
+
+  if (copies.empty()) {
+    m_pending.clear();
+    return false;
+  }
+
+  g_vk.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                            nullptr, static_cast<uint32_t>(pre_barriers.size()), pre_barriers.data());
+
+  for (auto const& copy : copies) {
+    g_vk.vkCmdCopyBufferToImage(cmd, staging->GetBuffer(), copy.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                static_cast<uint32_t>(copy.regions.size()), copy.regions.data());
+  }
+
+  g_vk.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0,
+                            nullptr, static_cast<uint32_t>(post_barriers.size()), post_barriers.data());
+
+  m_pending.clear();
+
+  // staging goes to the deletion queue with the current frame and lives until the copies are done
+  return true;
+}
+
+void TextureUpdateBatchVk::Clear() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  ClearLocked();
+}
+
+void TextureUpdateBatchVk::ClearLocked() {
+  m_pending.clear();
+  m_queued = 0;
+}
+
+void TextureUpdateBatchVk::Insert(PendingLevel& level, PendingRect rect, uint32_t block_size) {
+  auto& rects = level.rects;
+
+  std::vector<PendingRect> work{};
+  work.emplace_back(std::move(rect));
+
+  while (!work.empty()) {
+    PendingRect current = std::move(work.back());
+    work.pop_back();
+
+    bool handled = false;
+
+    for (size_t i = 0; i < rects.size() && !handled;) {
+      PendingRect& old = rects[i];
+
+      if (!Intersects(current, old)) {
+        i++;
+        continue;
+      }
+
+      // fully overwritten
+      if (Contains(current, old)) {
+        if (i + 1 != rects.size()) {
+          rects[i] = std::move(rects.back());
+        }
+        rects.pop_back();
+        continue;
+      }
+
+      // the older rectangle takes the newest data where they overlap
+      uint32_t x0 = std::max(current.x, old.x);
+      uint32_t y0 = std::max(current.y, old.y);
+      uint32_t x1 = std::min(current.x + current.width, old.x + old.width);
+      uint32_t y1 = std::min(current.y + current.height, old.y + old.height);
+
+      CopyBlocks(current.data.data(), current.width, x0 - current.x, y0 - current.y, old.data.data(), old.width,
+                 x0 - old.x, y0 - old.y, x1 - x0, y1 - y0, block_size);
+
+      if (!Contains(old, current)) {
+        // what is left of the new rectangle is at most four bands around the overlap
+        auto band = [&current, &work, block_size](uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+          PendingRect part{x, y, width, height, {}};
+          part.data.resize(static_cast<size_t>(width) * height * block_size);
+
+          CopyBlocks(current.data.data(), current.width, x - current.x, y - current.y, part.data.data(), width, 0, 0,
+                     width, height, block_size);
+
+          work.emplace_back(std::move(part));
+        };
+
+        uint32_t right = current.x + current.width;
+        uint32_t bottom = current.y + current.height;
+
+        if (current.y < y0) {
+          band(current.x, current.y, current.width, y0 - current.y);
+        }
+
+        if (bottom > y1) {
+          band(current.x, y1, current.width, bottom - y1);
+        }
+
+        if (current.x < x0) {
+          band(current.x, y0, x0 - current.x, y1 - y0);
+        }
+
+        if (right > x1) {
+          band(x1, y0, right - x1, y1 - y0);
+        }
+      }
+
+      handled = true;
+    }
+
+    if (!handled) {
+      rects.emplace_back(std::move(current));
+    }
+  }
+}
+
+void TextureUpdateBatchVk::MergeAdjacent(std::vector<PendingRect>& rects, uint32_t block_size) {
+  bool merged = true;
+
+  while (merged) {
+    merged = false;
+
+    for (size_t i = 0; i < rects.size(); i++) {
+      for (size_t j = i + 1; j < rects.size(); j++) {
+        PendingRect& a = rects[i];
+        PendingRect& b = rects[j];
+
+        PendingRect result{};
+
+        if (a.y == b.y && a.height == b.height && (a.x + a.width == b.x || b.x + b.width == a.x)) {
+          PendingRect& left = a.x < b.x ? a : b;
+          PendingRect& right = a.x < b.x ? b : a;
+
+          result = PendingRect{left.x, left.y, left.width + right.width, left.height, {}};
+          result.data.resize(static_cast<size_t>(result.width) * result.height * block_size);
+
+          CopyBlocks(left.data.data(), left.width, 0, 0, result.data.data(), result.width, 0, 0, left.width,
+                     left.height, block_size);
+          CopyBlocks(right.data.data(), right.width, 0, 0, result.data.data(), result.width, left.width, 0,
+                     right.width, right.height, block_size);
+        } else if (a.x == b.x && a.width == b.width && (a.y + a.height == b.y || b.y + b.height == a.y)) {
+          PendingRect& top = a.y < b.y ? a : b;
+          PendingRect& bottom = a.y < b.y ? b : a;
+
+          // rows are tightly packed, stacking is a plain append
+          result = PendingRect{top.x, top.y, top.width, top.height + bottom.height, std::move(top.data)};
+          result.data.insert(result.data.end(), bottom.data.begin(), bottom.data.end());
+        } else {
+          continue;
+        }
+
+        rects[i] = std::move(result);
+        if (j + 1 != rects.size()) {
+          rects[j] = std::move(rects.back());
+        }
+        rects.pop_back();
+
+        merged = true;
+        j = i;
+      }
+    }
+  }
+}
+
+}  // namespace hexgon
@@ -0,0 +1,97 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace hexgon {
+
+class RenderSystemVk;
+class TextureVk;
+struct TextureRange;
+
+// Collects small texture writes during a frame. On flush every texture gets one copy command with one region per
+// pending rectangle, all sourced from a single staging buffer. Rectangles are kept disjoint: a newer write patches
+// older data where they overlap, and rectangles sharing an edge are merged before the copy is recorded.
+class TextureUpdateBatchVk {
+ public:
+  TextureUpdateBatchVk() = default;
+
+  // `range` is already validated against the texture, depth must be 1
+  void Queue(TextureVk* texture, const void* data, TextureRange const& range);
+
+  // drop pending writes of a texture which is being destroyed
+  void Discard(TextureVk* texture);
+
+  // record all pending writes into `cmd`, returns false if nothing was recorded
+  bool Flush(RenderSystemVk* render_system, VkCommandBuffer cmd);
+
+  void Clear();
+
+  // number of writes queued and number of copy regions recorded by the last flush
+  uint32_t GetLastQueuedCount() const { return m_last_queued; }
+
+  uint32_t GetLastRegionCount() const { return m_last_regions; }
+
+ private:
+  // position and size are in blocks of the texture format
+  struct PendingRect {
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> data = {};
+  };
+
+  struct PendingLevel {
+    uint32_t level = 0;
+    uint32_t layer = 0;
+    std::vector<PendingRect> rects = {};
+  };
+
+  struct PendingTexture {
+    uint32_t block_size = 0;
+    std::vector<PendingLevel> levels = {};
+  };
+
+  void ClearLocked();
+
+  static void Insert(PendingLevel& level, PendingRect rect, uint32_t block_size);
+
+  static void MergeAdjacent(std::vector<PendingRect>& rects, uint32_t block_size);
+
+ private:
+  std::mutex m_mutex = {};
+  std::unordered_map<TextureVk*, PendingTexture> m_pending = {};
+  uint32_t m_queued = 0;
+  uint32_t m_last_queued = 0;
+  uint32_t m_last_regions = 0;
+};
+
+}  // namespace hexgon
@@ -23,10 +23,875 @@
 
 #include "Render/Vulkan/TextureVk.hpp"
 
+#include <algorithm>
+#include <cstring>
+
+#include "LogPrivate.hpp"
+#include "Render/Vulkan/BufferVk.hpp"
+#include "Render/Vulkan/DispatchVk.hpp"
+#include "Render/Vulkan/RenderSystemVk.hpp"
+#include "Render/Vulkan/TextureStreamerVk.hpp"
+#include "Render/Vulkan/VulkanUtil.hpp"
+
 namespace hexgon {
 
-TextureVk::TextureVk(const TextureDescriptor& desc, const Info& info) : Texture(desc), mInfo(info) {}
+namespace {
+
+VkImageUsageFlags ToVkUsage(TextureUsageMask usage, PixelFormat format) {
+  VkImageUsageFlags flags = 0;
+
+  if (usage & TextureUsage::kShaderRead) {
+    flags |= VK_IMAGE_USAGE_SAMPLED_BIT;
+  }
+
+  if (usage & TextureUsage::kShaderWrite) {
+    flags |= VK_IMAGE_USAGE_STORAGE_BIT;
+  }
+
+  if (usage & TextureUsage::kRenderTarget) {
+    flags |= GetPixelFormatInfo(format).is_depth ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT
+                                                 : VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  }
+
+  if (usage & TextureUsage::kCopySrc) {
+    flags |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+  }
+
+  if (usage & TextureUsage::kCopyDst) {
+    flags |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  }
+
+  return flags;
+}
+
+VkSampleCountFlagBits ToVkSampleCount(uint32_t count) {
+  switch (count) {
+    case 1:
+      return VK_SAMPLE_COUNT_1_BIT;
+    case 2:
+      return VK_SAMPLE_COUNT_2_BIT;
+    case 4:
+      return VK_SAMPLE_COUNT_4_BIT;
+    case 8:
+      return VK_SAMPLE_COUNT_8_BIT;
+    case 16:
+      return VK_SAMPLE_COUNT_16_BIT;
+    case 32:
+      return VK_SAMPLE_COUNT_32_BIT;
+    case 64:
+      return VK_SAMPLE_COUNT_64_BIT;
+    default:
+      return static_cast<VkSampleCountFlagBits>(0);
+  }
+}
+
+void TransitionImage(VkCommandBuffer cmd, VkImage image, VkImageSubresourceRange const& range,
+                     VkImageLayout old_layout, VkImageLayout new_layout, VkAccessFlags src_access,
+                     VkAccessFlags dst_access, VkPipelineStageFlags src_stage, VkPipelineStageFlags dst_stage) {
+  VkImageMemoryBarrier barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+  barrier.srcAccessMask = src_access;
+  barrier.dstAccessMask = dst_access;
+  barrier.oldLayout = old_layout;
+  barrier.newLayout = new_layout;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange = range;
+
+  g_vk.vkCmdPipelineBarrier(cmd, src_stage, dst_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+// 2x2 box filter, the last row or column is repeated for odd sizes
+void DownsampleBox(const uint8_t* src, uint32_t src_width, uint32_t src_height, uint8_t* dst, uint32_t dst_width,
+                   uint32_t dst_height, uint32_t bpp) {
+  for (uint32_t y = 0; y < dst_height; y++) {
+    const uint8_t* row0 = src + static_cast<size_t>(std::min(y * 2, src_height - 1)) * src_width * bpp;
+    const uint8_t* row1 = src + static_cast<size_t>(std::min(y * 2 + 1, src_height - 1)) * src_width * bpp;
+
+    for (uint32_t x = 0; x < dst_width; x++) {
+      uint32_t x0 = std::min(x * 2, src_width - 1) * bpp;
+      uint32_t x1 = std::min(x * 2 + 1, src_width - 1) * bpp;
+
+      for (uint32_t c = 0; c < bpp; c++) {
+        uint32_t sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+        dst[(static_cast<size_t>(y) * dst_width + x) * bpp + c] = static_cast<uint8_t>((sum + 2) >> 2);
+      }
+    }
+  }
+}
+
+}  // namespace
+
+TextureVk::TextureVk(RenderSystemVk* render_system, const TextureDescriptor& desc, const Info& info)
+    : Texture(desc), GpuResourceVk(), m_render_system(render_system), mInfo(info) {}
+
+TextureVk::~TextureVk() {
+  if (m_streamer) {
+    m_streamer->Unregister(this);
+  }
+
+  // always taken, a flush in progress may be recording this texture and Discard waits for it
+  m_render_system->GetTextureUpdateBatch().Discard(this);
+
+  if (m_pending_readbacks) {
+    m_render_system->GetReadbackQueue().Discard(this);
+  }
+
+  // frames in flight may still sample the slot, it is reused once they are done
+  auto bindless_table = m_render_system->GetBindlessTable();
+  if (bindless_table && m_bindless_index != BindlessTextureTableVk::kInvalidIndex) {
+    uint32_t index = m_bindless_index;
+    m_render_system->OnReleaseLater([bindless_table, index]() { bindless_table->Unregister(index); });
+  }
+
+  // a new view may get the same handle value
+  m_render_system->GetDescriptorSetCache().Evict(mInfo.view);
+  m_render_system->GetRenderPassCache().Evict(mInfo.view);
+
+  ReleaseHandles();
+}
+
+std::shared_ptr<TextureVk> TextureVk::Create(RenderSystemVk* render_system, const TextureDescriptor& desc) {
+  TextureDescriptor full_desc = desc;
+
+  if (full_desc.mip_levels == 0) {
+    full_desc.mip_levels = CalculateMipLevels(desc.width, desc.height);
+  }
+
+  if (desc.sample_count > 1 && (full_desc.mip_levels > 1 || desc.type != TextureType::k2D)) {
+    HEX_CORE_ERROR("Multisample texture {} must be 2D without mipmaps.", desc.label);
+    return nullptr;
+  }
+
+  if (desc.streaming &&
+      (desc.type == TextureType::k3D || desc.sample_count > 1 || GetPixelFormatInfo(desc.format).block_size == 0)) {
+    HEX_CORE_ERROR("Texture {} can not be streamed.", desc.label);
+    return nullptr;
+  }
+
+  // streaming textures start with the least detailed mip and grow on request
+  uint32_t base_mip = desc.streaming ? full_desc.mip_levels - 1 : 0;
+
+  Info info{};
+  if (!CreateImage(render_system, full_desc, base_mip, info)) {
+    return nullptr;
+  }
+
+  auto texture = std::make_shared<TextureVk>(render_system, full_desc, info);
+  texture->SetLabel(desc.label);
+  texture->SetDelegate(render_system);
+  texture->m_resident_mip = base_mip;
+  texture->m_request = base_mip;
+
+  if (desc.streaming) {
+    texture->m_mip_data.resize(full_desc.mip_levels);
+    render_system->GetTextureStreamer().Register(texture.get());
+  }
+
+  // render targets are never uploaded to, they go to their ready layout right away
+  if (desc.usage & TextureUsage::kRenderTarget) {
+    VkImageSubresourceRange range{VulkanUtil::FormatAspect(ToVkFormat(desc.format)), 0, full_desc.mip_levels, 0,
+                                  full_desc.array_layers};
+    VkImageLayout ready_layout = texture->GetReadyLayout();
+
+    render_system->ImmediateSubmit([&](VkCommandBuffer cmd) {
+      TransitionImage(cmd, info.image, range, VK_IMAGE_LAYOUT_UNDEFINED, ready_layout, 0, 0,
+                      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    });
+
+    texture->mInfo.layout = ready_layout;
+  }
+
+  return texture;
+}
+
+bool TextureVk::CreateImage(RenderSystemVk* render_system, const TextureDescriptor& desc, uint32_t base_mip,
+                            Info& info) {
+  VkDevice device = render_system->GetDevice();
+  VkFormat format = ToVkFormat(desc.format);
+  VkSampleCountFlagBits samples = ToVkSampleCount(desc.sample_count);
+
+  if (format == VK_FORMAT_UNDEFINED || desc.width == 0 || desc.height == 0 || samples == 0 ||
+      desc.array_layers == 0) {
+    HEX_CORE_ERROR("Invalid texture descriptor for {}.", desc.label);
+    return false;
+  }
+
+  VkImageCreateInfo image_info{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+  image_info.format = format;
+  image_info.extent = GetMipExtent(desc, base_mip);
+  image_info.mipLevels = desc.mip_levels - base_mip;
+  image_info.arrayLayers = desc.array_layers;
+  image_info.samples = samples;
+  image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+  image_info.usage = ToVkUsage(desc.usage, desc.format);
+  image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+  // mips are generated with blits and streaming copies levels between images
+  if (desc.mip_levels > 1 || desc.streaming) {
+    image_info.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  }
+
+  bool is_array = desc.array_layers > 1;
+  VkImageViewType view_type = VK_IMAGE_VIEW_TYPE_2D;
+  switch (desc.type) {
+    case TextureType::k1D:
+      image_info.imageType = VK_IMAGE_TYPE_1D;
+      view_type = is_array ? VK_IMAGE_VIEW_TYPE_1D_ARRAY : VK_IMAGE_VIEW_TYPE_1D;
+      break;
+    case TextureType::k2D:
+      image_info.imageType = VK_IMAGE_TYPE_2D;
+      view_type = is_array ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+      break;
+    case TextureType::k3D:
+      image_info.imageType = VK_IMAGE_TYPE_3D;
+      view_type = VK_IMAGE_VIEW_TYPE_3D;
+      break;
+  }
+
+  if (desc.type == TextureType::k3D && is_array) {
+    HEX_CORE_ERROR("3D texture {} can not have array layers.", desc.label);
+    return false;
+  }
+
+  VkImageFormatProperties format_properties{};
+  if (g_vk.vkGetPhysicalDeviceImageFormatProperties(render_system->GetPhysicalDevice(), format, image_info.imageType,
+                                                    image_info.tiling, image_info.usage, 0,
+                                                    &format_properties) != VK_SUCCESS ||
+      image_info.mipLevels > format_properties.maxMipLevels ||
+      image_info.arrayLayers > format_properties.maxArrayLayers || !(format_properties.sampleCounts & samples)) {
+    HEX_CORE_ERROR("Texture {} with {} mips {} layers {} samples is not supported.", desc.label, desc.mip_levels,
+                   desc.array_layers, desc.sample_count);
+    return false;
+  }
+
+  info.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+  if (g_vk.vkCreateImage(device, &image_info, nullptr, &info.image) != VK_SUCCESS) {
+    HEX_CORE_ERROR("Failed create image for texture {}.", desc.label);
+    return false;
+  }
+
+  VkMemoryRequirements requirements{};
+  g_vk.vkGetImageMemoryRequirements(device, info.image, &requirements);
+
+  VkMemoryAllocateInfo alloc_info{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+  alloc_info.allocationSize = requirements.size;
+  alloc_info.memoryTypeIndex = VulkanUtil::FindMemoryType(render_system->GetPhysicalDevice(),
+                                                          requirements.memoryTypeBits,
+                                                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+  if (alloc_info.memoryTypeIndex == UINT32_MAX ||
+      g_vk.vkAllocateMemory(device, &alloc_info, nullptr, &info.memory) != VK_SUCCESS) {
+    HEX_CORE_ERROR("Failed allocate {} bytes memory for texture {}.", requirements.size, desc.label);
+    g_vk.vkDestroyImage(device, info.image, nullptr);
+    info.image = nullptr;
+    return false;
+  }
+
+  g_vk.vkBindImageMemory(device, info.image, info.memory, 0);
+
+  VkImageViewCreateInfo view_info{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+  view_info.image = info.image;
+  view_info.viewType = view_type;
+  view_info.format = format;
+  view_info.subresourceRange = {VulkanUtil::FormatAspect(format), 0, image_info.mipLevels, 0, image_info.arrayLayers};
+
+  if (g_vk.vkCreateImageView(device, &view_info, nullptr, &info.view) != VK_SUCCESS) {
+    HEX_CORE_ERROR("Failed create image view for texture {}.", desc.label);
+    g_vk.vkFreeMemory(device, info.memory, nullptr);
+    g_vk.vkDestroyImage(device, info.image, nullptr);
+    info.memory = nullptr;
+    info.image = nullptr;
+    return false;
+  }
+
+  return true;
+}
+
+VkFormat TextureVk::ToVkFormat(PixelFormat format) {
+  switch (format) {
+    case PixelFormat::kA8UNorm:
+      return VK_FORMAT_R8_UNORM;
+    case PixelFormat::kR8G8B8A8Unorm:
+      return VK_FORMAT_R8G8B8A8_UNORM;
+    case PixelFormat::kB8G8R8A8Unorm:
+      return VK_FORMAT_B8G8R8A8_UNORM;
+    case PixelFormat::kBC1RGBAUnorm:
+      return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    case PixelFormat::kBC2RGBAUnorm:
+      return VK_FORMAT_BC2_UNORM_BLOCK;
+    case PixelFormat::kBC3RGBAUnorm:
+      return VK_FORMAT_BC3_UNORM_BLOCK;
+    case PixelFormat::kBC4RUnorm:
+      return VK_FORMAT_BC4_UNORM_BLOCK;
+    case PixelFormat::kBC5RGUnorm:
+      return VK_FORMAT_BC5_UNORM_BLOCK;
+    case PixelFormat::kBC6HRGBUFloat:
+      return VK_FORMAT_BC6H_UFLOAT_BLOCK;
+    case PixelFormat::kBC7RGBAUnorm:
+      return VK_FORMAT_BC7_UNORM_BLOCK;
+    case PixelFormat::kETC2R8G8B8Unorm:
+      return VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK;
+    case PixelFormat::kETC2R8G8B8A8Unorm:
+      return VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK;
+    case PixelFormat::kASTC4x4Unorm:
+      return VK_FORMAT_ASTC_4x4_UNORM_BLOCK;
+    case PixelFormat::kASTC6x6Unorm:
+      return VK_FORMAT_ASTC_6x6_UNORM_BLOCK;
+    case PixelFormat::kASTC8x8Unorm:
+      return VK_FORMAT_ASTC_8x8_UNORM_BLOCK;
+    case PixelFormat::kD16Unorm:
+      return VK_FORMAT_D16_UNORM;
+    case PixelFormat::kD32Float:
+      return VK_FORMAT_D32_SFLOAT;
+    case PixelFormat::kD24UnormS8Uint:
+      return VK_FORMAT_D24_UNORM_S8_UINT;
+    default:
+      return VK_FORMAT_UNDEFINED;
+  }
+}
+
+PixelFormat TextureVk::FromVkFormat(VkFormat format) {
+  uint32_t first = static_cast<uint32_t>(PixelFormat::kA8UNorm);
+  uint32_t last = static_cast<uint32_t>(PixelFormat::kD24UnormS8Uint);
+
+  for (uint32_t i = first; i <= last; i++) {
+    if (ToVkFormat(static_cast<PixelFormat>(i)) == format) {
+      return static_cast<PixelFormat>(i);
+    }
+  }
+
+  return PixelFormat::kUnknown;
+}
+
+VkExtent3D TextureVk::GetMipExtent(const TextureDescriptor& desc, uint32_t level) {
+  VkExtent3D extent{};
+  extent.width = std::max(1u, desc.width >> level);
+  extent.height = desc.type == TextureType::k1D ? 1 : std::max(1u, desc.height >> level);
+  extent.depth = desc.type == TextureType::k3D ? std::max(1u, desc.depth >> level) : 1;
+
+  return extent;
+}
+
+void TextureVk::ReleaseHandles() {
+  ReleaseLater(VK_OBJECT_TYPE_IMAGE_VIEW, mInfo.view);
+  ReleaseLater(VK_OBJECT_TYPE_IMAGE, mInfo.image);
+  ReleaseLater(VK_OBJECT_TYPE_DEVICE_MEMORY, mInfo.memory);
+}
+
+VkDeviceSize TextureVk::GetLevelSize(uint32_t level) const {
+  VkExtent3D extent = GetMipExtent(GetDescriptor(), level);
+
+  return static_cast<VkDeviceSize>(GetPixelFormatInfo(GetFormat()).GetImageSize(extent.width, extent.height)) *
+         extent.depth * GetArrayLayers();
+}
+
+bool TextureVk::MakeResident(uint32_t level, VkCommandBuffer cmd) {
+  if (!IsStreaming()) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  uint32_t level_count = GetMipLevels();
+  uint32_t old_mip = m_resident_mip;
+  level = std::min(level, level_count - 1);
+
+  if (level == old_mip) {
+    return true;
+  }
+
+  Info info{};
+  if (!CreateImage(m_render_system, GetDescriptor(), level, info)) {
+    return false;
+  }
+
+  VkImageAspectFlags aspect = VulkanUtil::FormatAspect(ToVkFormat(GetFormat()));
+  uint32_t layers = GetArrayLayers();
+
+  // levels resident in both images are copied on the GPU
+  std::vector<VkImageCopy> copies{};
+  if (mInfo.layout != VK_IMAGE_LAYOUT_UNDEFINED) {
+    for (uint32_t l = std::max(level, old_mip); l < level_count; l++) {
+      VkImageCopy copy{};
+      copy.srcSubresource = {aspect, l - old_mip, 0, layers};
+      copy.dstSubresource = {aspect, l - level, 0, layers};
+      copy.extent = GetMipExtent(GetDescriptor(), l);
+
+      copies.emplace_back(copy);
+    }
+  }
+
+  // newly resident levels come from the cpu copy
+  std::vector<VkBufferImageCopy> uploads{};
+  std::unique_ptr<BufferVk> staging{};
+  if (level < old_mip) {
+    VkDeviceSize total = 0;
+    for (uint32_t l = level; l < old_mip; l++) {
+      total += (GetLevelSize(l) + 15) & ~VkDeviceSize(15);
+    }
+
+    staging = m_render_system->CreateBuffer(total, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, true);
+
+    VkDeviceSize offset = 0;
+    for (uint32_t l = level; staging && l < old_mip; l++) {
+      auto data = GetLevelData(l);
+      if (!data) {
+        continue;
+      }
+
+      std::memcpy(static_cast<uint8_t*>(staging->GetMappedData()) + offset, data->data(), data->size());
+
+      VkBufferImageCopy region{};
+      region.bufferOffset = offset;
+      region.imageSubresource = {aspect, l - level, 0, layers};
+      region.imageExtent = GetMipExtent(GetDescriptor(), l);
+
+      uploads.emplace_back(region);
+
+      offset += (data->size() + 15) & ~size_t(15);
+    }
+  }
+
+  VkImageLayout ready_layout = GetReadyLayout();
+  VkImageSubresourceRange new_range{aspect, 0, level_count - level, 0, layers};
+  VkImageSubresourceRange old_range{aspect, 0, level_count - old_mip, 0, layers};
+
+  TransitionImage(cmd, info.image, new_range, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0,
+                  VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+  // the old image is only used by frames submitted before `cmd`, it is not transitioned back
+  if (!copies.empty()) {
+    TransitionImage(cmd, mInfo.image, old_range, mInfo.layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    g_vk.vkCmdCopyImage(cmd, mInfo.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, info.image,
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copies.size()), copies.data());
+  }
+
+  if (!uploads.empty()) {
+    g_vk.vkCmdCopyBufferToImage(cmd, staging->GetBuffer(), info.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                static_cast<uint32_t>(uploads.size()), uploads.data());
+  }
+
+  TransitionImage(cmd, info.image, new_range, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, ready_layout,
+                  VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                  VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+  info.layout = ready_layout;
+
+  std::swap(mInfo, info);
+  m_resident_mip = level;
+
+  // frames in flight keep sampling the old image through the old slot, this frame and later ones get a new slot
+  auto bindless_table = m_render_system->GetBindlessTable();
+  if (bindless_table && m_bindless_index != BindlessTextureTableVk::kInvalidIndex) {
+    uint32_t old_index = m_bindless_index;
+    m_bindless_index = bindless_table->Register(mInfo.view, ready_layout);
+    m_render_system->OnReleaseLater([bindless_table, old_index]() { bindless_table->Unregister(old_index); });
+  }
+
+  m_render_system->GetDescriptorSetCache().Evict(info.view);
+  m_render_system->GetRenderPassCache().Evict(info.view);
+
+  // staging and the old image go to the deletion queue with the current frame, they live until `cmd` is done
+  ReleaseLater(VK_OBJECT_TYPE_IMAGE_VIEW, info.view);
+  ReleaseLater(VK_OBJECT_TYPE_IMAGE, info.image);
+  ReleaseLater(VK_OBJECT_TYPE_DEVICE_MEMORY, info.memory);
+
+  return true;
+}
+
+bool TextureVk::CheckRange(const TextureRange& range) const {
+  VkExtent3D extent = GetMipExtent(GetDescriptor(), range.mip_level);
+
+  if (range.x + range.width > extent.width || range.y + range.height > extent.height) {
+    HEX_CORE_ERROR("Range out of texture {} bounds.", GetLabel());
+    return false;
+  }
+
+  // compressed formats are copied in whole blocks, only the blocks on the right and bottom edge may be partial
+  PixelFormatInfo format_info = GetPixelFormatInfo(GetFormat());
+  if (range.x % format_info.block_width != 0 || range.y % format_info.block_height != 0 ||
+      (range.width % format_info.block_width != 0 && range.x + range.width != extent.width) ||
+      (range.height % format_info.block_height != 0 && range.y + range.height != extent.height)) {
+    HEX_CORE_ERROR("Range of texture {} is not aligned to {}x{} blocks.", GetLabel(), format_info.block_width,
+                   format_info.block_height);
+    return false;
+  }
+
+  return true;
+}
+
+bool TextureVk::CheckUploadRange(size_t len, const TextureRange& range) const {
+  if (!mInfo.image) {
+    return false;
+  }
+
+  if (!(GetUsage() & TextureUsage::kCopyDst)) {
+    HEX_CORE_ERROR("Texture {} is not created with TextureUsage::kCopyDst.", GetLabel());
+    return false;
+  }
+
+  if (!CheckRange(range)) {
+    return false;
+  }
+
+  VkExtent3D extent = GetMipExtent(GetDescriptor(), range.mip_level);
+  PixelFormatInfo format_info = GetPixelFormatInfo(GetFormat());
+  size_t data_size = format_info.GetImageSize(range.width, range.height) * extent.depth;
+
+  if (data_size == 0 || len < data_size) {
+    HEX_CORE_ERROR("Upload data size {} is too small for texture {}, need {}.", len, GetLabel(), data_size);
+    return false;
+  }
+
+  return true;
+}
+
+void TextureVk::OnUploadData(void* data, size_t len, const TextureRange& range) {
+  if (!CheckUploadRange(len, range)) {
+    return;
+  }
+
+  VkExtent3D extent = GetMipExtent(GetDescriptor(), range.mip_level);
+  PixelFormatInfo format_info = GetPixelFormatInfo(GetFormat());
+
+  size_t row_size = format_info.GetImageSize(range.width, 1);
+  uint32_t row_count = (range.height + format_info.block_height - 1) / format_info.block_height;
+  size_t data_size = row_size * row_count * extent.depth;
+
+  if (IsStreaming()) {
+    std::vector<uint32_t> levels{range.mip_level};
+    std::vector<std::vector<uint8_t>> level_data{};
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    // keep a cpu copy so evicted levels can be streamed in again
+    auto& mip = m_mip_data[range.mip_level];
+    size_t level_row_size = format_info.GetImageSize(extent.width, 1);
+    size_t layer_size = format_info.GetImageSize(extent.width, extent.height);
+    size_t x_offset = format_info.GetImageSize(range.x, 1);
+    uint32_t first_row = range.y / format_info.block_height;
+
+    if (!mip.uploaded) {
+      mip.bytes.assign(layer_size * GetArrayLayers(), 0);
+      mip.uploaded = true;
+    }
+
+    for (uint32_t row = 0; row < row_count; row++) {
+      std::memcpy(mip.bytes.data() + layer_size * range.array_layer + (first_row + row) * level_row_size + x_offset,
+                  static_cast<uint8_t*>(data) + row * row_size, row_size);
+    }
+
+    // less detailed levels derived from this one are stale now
+    for (uint32_t l = range.mip_level + 1; l < GetMipLevels() && !m_mip_data[l].uploaded; l++) {
+      m_mip_data[l].bytes.clear();
+      levels.emplace_back(l);
+    }
+
+    uint32_t resident = m_resident_mip;
+    levels.erase(std::remove_if(levels.begin(), levels.end(), [resident](uint32_t l) { return l < resident; }),
+                 levels.end());
+
+    for (auto l : levels) {
+      auto bytes = GetLevelData(l);
+      level_data.emplace_back(bytes ? *bytes : std::vector<uint8_t>{});
+    }
+
+    // the update batch locks textures while flushing, so queue without holding our lock
+    lock.unlock();
+
+    QueueLevels(levels, level_data);
+    return;
+  }
+
+  auto staging = m_render_system->CreateBuffer(data_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, true);
+  if (!staging) {
+    return;
+  }
+
+  std::memcpy(staging->GetMappedData(), data, data_size);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  VkImageLayout ready_layout = GetReadyLayout();
+  VkImageAspectFlags aspect = VulkanUtil::FormatAspect(ToVkFormat(GetFormat()));
+  VkImageSubresourceRange full_range{aspect, 0, GetMipLevels(), 0, GetArrayLayers()};
+
+  m_render_system->ImmediateSubmit([&](VkCommandBuffer cmd) {
+    TransitionImage(cmd, mInfo.image, full_range, mInfo.layout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0,
+                    VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource = {aspect, range.mip_level, range.array_layer, 1};
+    region.imageOffset = {static_cast<int32_t>(range.x), static_cast<int32_t>(range.y), 0};
+    region.imageExtent = {range.width, range.height, extent.depth};
+
+    g_vk.vkCmdCopyBufferToImage(cmd, staging->GetBuffer(), mInfo.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1,
+                                &region);
+
+    TransitionImage(cmd, mInfo.image, full_range, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, ready_layout,
+                    VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+  });
+
+  mInfo.layout = ready_layout;
+}
+
+void TextureVk::OnQueueUpdate(const void* data, size_t len, const TextureRange& range) {
+  if (!CheckUploadRange(len, range)) {
+    return;
+  }
+
+  // streaming textures update their cpu copy before queueing whole levels, 3D writes span many slices
+  if (IsStreaming() || GetTextureType() == TextureType::k3D) {
+    OnUploadData(const_cast<void*>(data), len, range);
+    return;
+  }
+
+  m_render_system->GetTextureUpdateBatch().Queue(this, data, range);
+}
+
+bool TextureVk::OnReadback(const TextureRange& range, ReadbackCallback callback) {
+  if (!mInfo.image || range.width == 0 || range.height == 0 || !CheckRange(range)) {
+    return false;
+  }
+
+  m_render_system->GetReadbackQueue().Queue(this, range, std::move(callback));
+
+  return true;
+}
+
+void TextureVk::OnGenerateMipmaps() {
+  // levels of streaming textures are derived from the cpu copy when they become resident
+  if (IsStreaming() || !mInfo.image) {
+    return;
+  }
+
+  VkFormat format = ToVkFormat(GetFormat());
+
+  VkFormatProperties format_properties{};
+  g_vk.vkGetPhysicalDeviceFormatProperties(m_render_system->GetPhysicalDevice(), format, &format_properties);
+
+  VkFormatFeatureFlags features = format_properties.optimalTilingFeatures;
+  if (!(features & VK_FORMAT_FEATURE_BLIT_SRC_BIT) || !(features & VK_FORMAT_FEATURE_BLIT_DST_BIT)) {
+    HEX_CORE_ERROR("Format of texture {} does not support blit, can not generate mipmaps.", GetLabel());
+    return;
+  }
+
+  VkFilter filter =
+      (features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  VkImageLayout ready_layout = GetReadyLayout();
+  VkImageAspectFlags aspect = VulkanUtil::FormatAspect(format);
+  uint32_t level_count = GetMipLevels();
+  uint32_t layers = GetArrayLayers();
+
+  m_render_system->ImmediateSubmit([&](VkCommandBuffer cmd) {
+    TransitionImage(cmd, mInfo.image, {aspect, 0, level_count, 0, layers}, mInfo.layout,
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    for (uint32_t l = 1; l < level_count; l++) {
+      VkImageSubresourceRange src_range{aspect, l - 1, 1, 0, layers};
+
+      TransitionImage(cmd, mInfo.image, src_range, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                      VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+      VkExtent3D src_extent = GetMipExtent(GetDescriptor(), l - 1);
+      VkExtent3D dst_extent = GetMipExtent(GetDescriptor(), l);
+
+      VkImageBlit blit{};
+      blit.srcSubresource = {aspect, l - 1, 0, layers};
+      blit.srcOffsets[1] = {static_cast<int32_t>(src_extent.width), static_cast<int32_t>(src_extent.height),
+                            static_cast<int32_t>(src_extent.depth)};
+      blit.dstSubresource = {aspect, l, 0, layers};
+      blit.dstOffsets[1] = {static_cast<int32_t>(dst_extent.width), static_cast<int32_t>(dst_extent.height),
+                            static_cast<int32_t>(dst_extent.depth)};
+
+      g_vk.vkCmdBlitImage(cmd, mInfo.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, mInfo.image,
+                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, filter);
+
+      TransitionImage(cmd, mInfo.image, src_range, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, ready_layout,
+                      VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                      VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+    }
+
+    TransitionImage(cmd, mInfo.image, {aspect, level_count - 1, 1, 0, layers}, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    ready_layout, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+  });
+
+  mInfo.layout = ready_layout;
+}
+
+void TextureVk::OnRequestMipLevel(uint32_t level) {
+  uint64_t frame = m_render_system->GetCurrentFrame();
+  uint64_t value = (frame << 8) | level;
+  uint64_t current = m_request.load(std::memory_order_relaxed);
+
+  // keep the most detailed request of the newest frame, draws may be recorded on several threads
+  while ((current >> 8) < frame || ((current >> 8) == frame && (current & 0xff) > level)) {
+    if (m_request.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+      break;
+    }
+  }
+}
+
+uint32_t TextureVk::GetBindlessIndex() {
+  auto bindless_table = m_render_system->GetBindlessTable();
+  if (!bindless_table || !(GetUsage() & TextureUsage::kShaderRead)) {
+    return BindlessTextureTableVk::kInvalidIndex;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (m_bindless_index == BindlessTextureTableVk::kInvalidIndex && mInfo.view) {
+    m_bindless_index = bindless_table->Register(mInfo.view, GetReadyLayout());
+  }
+
+  return m_bindless_index;
+}
+
+VkImageLayout TextureVk::GetReadyLayout() const {
+  if (GetUsage() & TextureUsage::kShaderRead) {
+    return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  }
+
+  if (GetUsage() & TextureUsage::kRenderTarget) {
+    return GetPixelFormatInfo(GetFormat()).is_depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+                                                    : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  }
+
+  return VK_IMAGE_LAYOUT_GENERAL;
+}
+
+const std::vector<uint8_t>* TextureVk::GetLevelData(uint32_t level) {
+  auto& mip = m_mip_data[level];
+
+  if (!mip.bytes.empty()) {
+    return &mip.bytes;
+  }
+
+  // compressed levels can not be derived, they all have to be uploaded
+  PixelFormatInfo format_info = GetPixelFormatInfo(GetFormat());
+  if (level == 0 || format_info.IsCompressed()) {
+    return nullptr;
+  }
+
+  auto finer = GetLevelData(level - 1);
+  if (!finer) {
+    return nullptr;
+  }
+
+  uint32_t bpp = format_info.block_size;
+  VkExtent3D src_extent = GetMipExtent(GetDescriptor(), level - 1);
+  VkExtent3D dst_extent = GetMipExtent(GetDescriptor(), level);
+  size_t src_layer_size = static_cast<size_t>(src_extent.width) * src_extent.height * bpp;
+  size_t dst_layer_size = static_cast<size_t>(dst_extent.width) * dst_extent.height * bpp;
+
+  mip.bytes.resize(dst_layer_size * GetArrayLayers());
+
+  for (uint32_t layer = 0; layer < GetArrayLayers(); layer++) {
+    DownsampleBox(finer->data() + src_layer_size * layer, src_extent.width, src_extent.height,
+                  mip.bytes.data() + dst_layer_size * layer, dst_extent.width, dst_extent.height, bpp);
+  }
+
+  return &mip.bytes;
+}
+
+bool TextureVk::UploadLevels(const std::vector<LevelSource>& sources) {
+  if (!mInfo.image || IsStreaming()) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  return UploadLevelsLocked(sources);
+}
+
+void TextureVk::QueueLevels(const std::vector<uint32_t>& levels, const std::vector<std::vector<uint8_t>>& data) {
+  // written in the frame's upload commands, after any residency change recorded for that frame
+  auto& batch = m_render_system->GetTextureUpdateBatch();
+
+  for (size_t i = 0; i < levels.size(); i++) {
+    if (data[i].empty()) {
+      continue;
+    }
+
+    VkExtent3D extent = GetMipExtent(GetDescriptor(), levels[i]);
+    size_t layer_size = data[i].size() / GetArrayLayers();
+
+    for (uint32_t layer = 0; layer < GetArrayLayers(); layer++) {
+      TextureRange range{0, 0, extent.width, extent.height, levels[i], layer};
+      batch.Queue(this, data[i].data() + layer_size * layer, range);
+    }
+  }
+}
+
+bool TextureVk::UploadLevelsLocked(const std::vector<LevelSource>& sources) {
+  if (sources.empty()) {
+    return true;
+  }
+
+  uint32_t resident = m_resident_mip;
+  VkImageAspectFlags aspect = VulkanUtil::FormatAspect(ToVkFormat(GetFormat()));
+
+  VkDeviceSize total = 0;
+  for (auto const& source : sources) {
+    if (source.level < resident || source.level >= GetMipLevels() || source.size != GetLevelSize(source.level)) {
+      HEX_CORE_ERROR("Level {} with {} bytes does not match texture {}.", source.level, source.size, GetLabel());
+      return false;
+    }
+
+    total += (source.size + 15) & ~VkDeviceSize(15);
+  }
+
+  auto staging = m_render_system->CreateBuffer(total, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, true);
+  if (!staging) {
+    return false;
+  }
+
+  std::vector<VkBufferImageCopy> regions{};
+  VkDeviceSize offset = 0;
+  for (auto const& source : sources) {
+    std::memcpy(static_cast<uint8_t*>(staging->GetMappedData()) + offset, source.data, source.size);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = offset;
+    region.imageSubresource = {aspect, source.level - resident, 0, GetArrayLayers()};
+    region.imageExtent = GetMipExtent(GetDescriptor(), source.level);
+
+    regions.emplace_back(region);
+
+    offset += (source.size + 15) & ~size_t(15);
+  }
+
+  VkImageLayout ready_layout = GetReadyLayout();
+  VkImageSubresourceRange full_range{aspect, 0, GetMipLevels() - resident, 0, GetArrayLayers()};
+
+  bool result = m_render_system->ImmediateSubmit([&](VkCommandBuffer cmd) {
+    TransitionImage(cmd, mInfo.image, full_range, mInfo.layout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0,
+                    VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    g_vk.vkCmdCopyBufferToImage(cmd, staging->GetBuffer(), mInfo.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                static_cast<uint32_t>(regions.size()), regions.data());
+
+    TransitionImage(cmd, mInfo.image, full_range, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, ready_layout,
+                    VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+  });
+
+  mInfo.layout = ready_layout;
 
-TextureVk::~TextureVk() {}
+  return result;
+}
 
-}  // namespace hexgon
\ No newline at end of file
+}  // namespace hexgon
@@ -26,22 +26,129 @@
 #include <vulkan/vulkan.h>
 
 #include <Hexgon/Render/Texture.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Render/Vulkan/BindlessTableVk.hpp"
+#include "Render/Vulkan/GpuResourceVk.hpp"
 
 namespace hexgon {
 
-class TextureVk : public Texture {
+class RenderSystemVk;
+class TextureStreamerVk;
+
+class TextureVk : public Texture, public GpuResourceVk {
+  friend class ReadbackQueueVk;
+  friend class TextureUpdateBatchVk;
+
  public:
+  // a whole mip level with all array layers, tightly packed
+  struct LevelSource {
+    uint32_t level = 0;
+    const void* data = nullptr;
+    size_t size = 0;
+  };
+
   struct Info {
     VkImage image = {};
     VkImageView view = {};
     VkImageLayout layout = {};
+    VkDeviceMemory memory = {};
   };
 
-  TextureVk(const TextureDescriptor& desc, const Info& info);
-  ~TextureVk();
+  TextureVk(RenderSystemVk* render_system, const TextureDescriptor& desc, const Info& info);
+  ~TextureVk() override;
+
+  static std::shared_ptr<TextureVk> Create(RenderSystemVk* render_system, const TextureDescriptor& desc);
+
+  static VkFormat ToVkFormat(PixelFormat format);
+
+  // kUnknown if the format has no PixelFormat counterpart
+  static PixelFormat FromVkFormat(VkFormat format);
+
+  static VkExtent3D GetMipExtent(const TextureDescriptor& desc, uint32_t level);
+
+  // image and view of a streaming texture are replaced when its resident mips change, do not cache them across frames
+  const Info& GetInfo() const { return mInfo; }
+
+  void ReleaseHandles() override;
+
+  // bytes of one mip level including all array layers
+  VkDeviceSize GetLevelSize(uint32_t level) const;
+
+  // most detailed mip stored in the image, image level 0 is this mip
+  uint32_t GetResidentMip() const { return m_resident_mip.load(std::memory_order_acquire); }
+
+  uint32_t GetRequestedMip() const { return static_cast<uint32_t>(m_request.load(std::memory_order_relaxed) & 0xff); }
+
+  uint64_t GetLastUsedFrame() const { return m_request.load(std::memory_order_relaxed) >> 8; }
+
+  // rebuild the image so that mips [level, n) are resident, only for streaming textures. The copies are recorded into
+  // `cmd`, which has to be submitted before any command recorded after this call samples the texture.
+  bool MakeResident(uint32_t level, VkCommandBuffer cmd);
+
+  void SetStreamer(TextureStreamerVk* streamer) { m_streamer = streamer; }
+
+  // copy complete levels into one staging buffer and upload them with a single submit, not for streaming textures
+  bool UploadLevels(std::vector<LevelSource> const& sources);
+
+  // layout every subresource is left in after an upload
+  VkImageLayout GetReadyLayout() const;
+
+  // slot of the view in the bindless table, registered on first use. Replacing the image moves the texture to a new
+  // slot, read it again for every frame recorded. BindlessTextureTableVk::kInvalidIndex if there is no bindless table.
+  uint32_t GetBindlessIndex();
+
+ protected:
+  void OnUploadData(void* data, size_t len, const TextureRange& range) override;
+
+  void OnQueueUpdate(const void* data, size_t len, const TextureRange& range) override;
+
+  bool OnReadback(const TextureRange& range, ReadbackCallback callback) override;
+
+  void OnGenerateMipmaps() override;
+
+  void OnRequestMipLevel(uint32_t level) override;
 
  private:
+  static bool CreateImage(RenderSystemVk* render_system, const TextureDescriptor& desc, uint32_t base_mip,
+                          Info& info);
+
+  // bounds and block alignment of a region of one mip level
+  bool CheckRange(const TextureRange& range) const;
+
+  bool CheckUploadRange(size_t len, const TextureRange& range) const;
+
+  // data of a streaming texture level, derived from the next detailed level if it was never uploaded
+  const std::vector<uint8_t>* GetLevelData(uint32_t level);
+
+  // queue whole levels of a streaming texture from their cpu copy, `levels` are mip numbers of the full chain
+  void QueueLevels(std::vector<uint32_t> const& levels, std::vector<std::vector<uint8_t>> const& data);
+
+  bool UploadLevelsLocked(std::vector<LevelSource> const& sources);
+
+ private:
+  struct MipData {
+    std::vector<uint8_t> bytes = {};
+    // false if bytes are derived from a more detailed level
+    bool uploaded = false;
+  };
+
+  RenderSystemVk* m_render_system;
+  TextureStreamerVk* m_streamer = nullptr;
   Info mInfo;
+
+  // guards image replacement and the cpu copy of streaming textures
+  std::mutex m_mutex = {};
+  std::atomic<uint32_t> m_resident_mip = {0};
+  // last used frame << 8 | most detailed mip requested in that frame
+  std::atomic<uint64_t> m_request = {0};
+  std::vector<MipData> m_mip_data = {};
+  uint32_t m_bindless_index = BindlessTextureTableVk::kInvalidIndex;
+  // readbacks queued but not yet recorded
+  std::atomic<uint32_t> m_pending_readbacks = {0};
 };
 
-}  // namespace hexgon
\ No newline at end of file
+}  // namespace hexgon
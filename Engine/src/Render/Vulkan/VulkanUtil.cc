@@ -25,11 +25,201 @@
 
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
 #include "LogPrivate.hpp"
+#include "Render/Vulkan/DispatchVk.hpp"
 
 namespace hexgon {
 
-PFN_vkCreateDebugReportCallbackEXT g_vkCreateDebugReportCallbackEXT = nullptr;
+namespace {
+
+// extensions the device has to support
+const char* const kRequiredExtensions[] = {
+    VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+};
+
+// extensions the engine makes use of when present, each one adds to the device score
+const char* const kOptionalExtensions[] = {
+    VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME,
+    VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,
+    VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
+    VK_KHR_IMAGELESS_FRAMEBUFFER_EXTENSION_NAME,
+};
+
+struct DeviceCandidate {
+  std::string name = {};
+  VkPhysicalDeviceProperties properties = {};
+  VkPhysicalDeviceFeatures features = {};
+  VkDeviceSize local_memory = 0;
+  uint32_t graphic_queue_index = 0;
+  uint32_t present_queue_index = 0;
+  uint32_t optional_extensions = 0;
+  bool usable = false;
+  std::string reason = {};
+  uint64_t score = 0;
+};
+
+bool ContainsNoCase(const std::string& text, const std::string& part) {
+  auto it = std::search(text.begin(), text.end(), part.begin(), part.end(),
+                        [](unsigned char a, unsigned char b) { return std::tolower(a) == std::tolower(b); });
+  return it != text.end();
+}
+
+uint32_t DeviceTypeRank(VkPhysicalDeviceType type) {
+  switch (type) {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+      return 4;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+      return 3;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+      return 2;
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+const char* DeviceTypeName(VkPhysicalDeviceType type) {
+  switch (type) {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+      return "discrete";
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+      return "integrated";
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+      return "virtual";
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:
+      return "cpu";
+    default:
+      return "other";
+  }
+}
+
+DeviceCandidate RateDevice(VkPhysicalDevice device, VkSurfaceKHR surface) {
+  DeviceCandidate candidate{};
+
+  g_vk.vkGetPhysicalDeviceProperties(device, &candidate.properties);
+  g_vk.vkGetPhysicalDeviceFeatures(device, &candidate.features);
+  candidate.name = candidate.properties.deviceName;
+
+  VkPhysicalDeviceMemoryProperties memory{};
+  g_vk.vkGetPhysicalDeviceMemoryProperties(device, &memory);
+
+  for (uint32_t i = 0; i < memory.memoryHeapCount; i++) {
+    if (memory.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+      candidate.local_memory += memory.memoryHeaps[i].size;
+    }
+  }
+
+  // a family doing both graphics and present avoids ownership transfers of the back buffers
+  uint32_t queue_count = 0;
+  g_vk.vkGetPhysicalDeviceQueueFamilyProperties(device, &queue_count, nullptr);
+
+  std::vector<VkQueueFamilyProperties> families(queue_count);
+  g_vk.vkGetPhysicalDeviceQueueFamilyProperties(device, &queue_count, families.data());
+
+  int32_t graphic = -1;
+  int32_t present = -1;
+
+  for (uint32_t i = 0; i < queue_count; i++) {
+    bool has_graphic = families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT;
+
+    // headless devices never present, any graphics family will do
+    VkBool32 present_support = surface ? VK_FALSE : has_graphic;
+    if (surface) {
+      g_vk.vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &present_support);
+    }
+
+    if (has_graphic && present_support) {
+      graphic = static_cast<int32_t>(i);
+      present = static_cast<int32_t>(i);
+      break;
+    }
+
+    if (has_graphic && graphic < 0) {
+      graphic = static_cast<int32_t>(i);
+    }
+
+    if (present_support && present < 0) {
+      present = static_cast<int32_t>(i);
+    }
+  }
+
+  uint32_t extension_count = 0;
+  g_vk.vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_count, nullptr);
+
+  std::vector<VkExtensionProperties> extensions(extension_count);
+  g_vk.vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_count, extensions.data());
+
+  auto has_extension = [&extensions](const char* name) {
+    return std::any_of(extensions.begin(), extensions.end(), [name](const VkExtensionProperties& prop) {
+      return std::strcmp(prop.extensionName, name) == 0;
+    });
+  };
+
+  for (auto name : kOptionalExtensions) {
+    candidate.optional_extensions += has_extension(name) ? 1 : 0;
+  }
+
+  if (graphic < 0 || present < 0) {
+    candidate.reason = "no graphics or present queue";
+    return candidate;
+  }
+
+  for (auto name : kRequiredExtensions) {
+    if (surface && !has_extension(name)) {
+      candidate.reason = std::string("missing ") + name;
+      return candidate;
+    }
+  }
+
+  if (candidate.properties.apiVersion < VK_API_VERSION_1_1) {
+    candidate.reason = "vulkan 1.1 is required";
+    return candidate;
+  }
+
+  candidate.graphic_queue_index = static_cast<uint32_t>(graphic);
+  candidate.present_queue_index = static_cast<uint32_t>(present);
+  candidate.usable = true;
+
+  // device type dominates, then VRAM in MiB, then optional extensions
+  uint64_t memory_mb = std::min<uint64_t>(candidate.local_memory >> 20, (1ull << 24) - 1);
+  candidate.score = (static_cast<uint64_t>(DeviceTypeRank(candidate.properties.deviceType)) << 32) |
+                    (memory_mb << 8) | candidate.optional_extensions;
+
+  return candidate;
+}
+
+void LogDevice(uint32_t index, const DeviceCandidate& candidate) {
+  auto const& props = candidate.properties;
+  auto const& features = candidate.features;
+
+  HEX_CORE_INFO("Vulkan device {}: {} ({}), api {}.{}.{}, driver {:#x}, {} MiB device local", index, candidate.name,
+                DeviceTypeName(props.deviceType), VK_API_VERSION_MAJOR(props.apiVersion),
+                VK_API_VERSION_MINOR(props.apiVersion), VK_API_VERSION_PATCH(props.apiVersion), props.driverVersion,
+                candidate.local_memory >> 20);
+  HEX_CORE_INFO("  max image 2D {}, max anisotropy {}, max samplers {}, max msaa {:#x}",
+                props.limits.maxImageDimension2D, features.samplerAnisotropy ? props.limits.maxSamplerAnisotropy : 0.f,
+                props.limits.maxSamplerAllocationCount, props.limits.framebufferColorSampleCounts);
+  HEX_CORE_INFO("  anisotropy {}, sample shading {}, BC {}, ETC2 {}, ASTC {}, optional extensions {}/{}",
+                features.samplerAnisotropy != VK_FALSE, features.sampleRateShading != VK_FALSE,
+                features.textureCompressionBC != VK_FALSE, features.textureCompressionETC2 != VK_FALSE,
+                features.textureCompressionASTC_LDR != VK_FALSE, candidate.optional_extensions,
+                std::size(kOptionalExtensions));
+
+  if (candidate.usable) {
+    HEX_CORE_INFO("  score {:#x}", candidate.score);
+  } else {
+    HEX_CORE_INFO("  not usable: {}", candidate.reason);
+  }
+}
+
+}  // namespace
 
 std::tuple<VkInstance, VkDebugReportCallbackEXT> VulkanUtil::CreateInstance(bool debug) {
   VkApplicationInfo app_info{};
@@ -82,13 +272,17 @@ std::tuple<VkInstance, VkDebugReportCallbackEXT> VulkanUtil::CreateInstance(bool
     return {nullptr, nullptr};
   }
 
-  if (debug) {
-    if (g_vkCreateDebugReportCallbackEXT == nullptr) {
-      g_vkCreateDebugReportCallbackEXT =
-          (PFN_vkCreateDebugReportCallbackEXT)vkGetInstanceProcAddr(result, "vkCreateDebugReportCallbackEXT");
-    }
+  if (!g_vk.LoadInstance(result)) {
+    HEX_CORE_ERROR("Failed load Vulkan instance functions");
+    vkDestroyInstance(result, nullptr);
+    g_vk.Reset();
+    return {nullptr, nullptr};
+  }
 
-    ret = g_vkCreateDebugReportCallbackEXT(result, &debug_info, nullptr, &debug_result);
+  if (debug) {
+    ret = g_vk.vkCreateDebugReportCallbackEXT
+              ? g_vk.vkCreateDebugReportCallbackEXT(result, &debug_info, nullptr, &debug_result)
+              : VK_ERROR_EXTENSION_NOT_PRESENT;
 
     if (ret != VK_SUCCESS) {
       HEX_CORE_ERROR("Debug is enabled, but validation debug callback register failed.");
@@ -99,12 +293,13 @@ std::tuple<VkInstance, VkDebugReportCallbackEXT> VulkanUtil::CreateInstance(bool
   return {result, debug_result};
 }
 
-PhysicalDeviceInfo VulkanUtil::QueryDevice(VkInstance vk_instance, VkSurfaceKHR vk_surface) {
+PhysicalDeviceInfo VulkanUtil::QueryDevice(VkInstance vk_instance, VkSurfaceKHR vk_surface,
+                                           const std::string& preferred) {
   uint32_t device_count = 0;
-  vkEnumeratePhysicalDevices(vk_instance, &device_count, nullptr);
+  g_vk.vkEnumeratePhysicalDevices(vk_instance, &device_count, nullptr);
 
   std::vector<VkPhysicalDevice> devices(device_count);
-  vkEnumeratePhysicalDevices(vk_instance, &device_count, devices.data());
+  g_vk.vkEnumeratePhysicalDevices(vk_instance, &device_count, devices.data());
 
   PhysicalDeviceInfo result{};
 
@@ -112,54 +307,61 @@ PhysicalDeviceInfo VulkanUtil::QueryDevice(VkInstance vk_instance, VkSurfaceKHR
     HEX_CORE_ERROR("No available vulkan gpu in system.");
     return result;
   }
-  int32_t graphic_queue_family = -1;
-  int32_t present_queue_family = -1;
 
-  for (size_t i = 0; i < devices.size(); i++) {
-    uint32_t queue_count = 0;
-    vkGetPhysicalDeviceQueueFamilyProperties(devices[i], &queue_count, nullptr);
+  std::vector<DeviceCandidate> candidates{};
 
-    std::vector<VkQueueFamilyProperties> properties(queue_count);
-
-    vkGetPhysicalDeviceQueueFamilyProperties(devices[i], &queue_count, properties.data());
+  for (uint32_t i = 0; i < devices.size(); i++) {
+    candidates.emplace_back(RateDevice(devices[i], vk_surface));
+    LogDevice(i, candidates.back());
+  }
 
-    for (size_t j = 0; j < properties.size(); j++) {
-      if (properties[j].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-        graphic_queue_family = j;
-      }
+  int32_t chosen = -1;
 
-      VkBool32 present_support = false;
-      vkGetPhysicalDeviceSurfaceSupportKHR(devices[i], j, vk_surface, &present_support);
+  if (!preferred.empty()) {
+    bool is_index = std::all_of(preferred.begin(), preferred.end(), [](unsigned char c) { return std::isdigit(c); });
+    size_t index = is_index ? std::strtoul(preferred.c_str(), nullptr, 10) : 0;
 
-      if (present_support) {
-        present_queue_family = j;
-      }
+    for (size_t i = 0; i < candidates.size(); i++) {
+      bool match = is_index ? index == i : ContainsNoCase(candidates[i].name, preferred);
 
-      if (graphic_queue_family >= 0 && present_queue_family >= 0) {
+      if (match && candidates[i].usable) {
+        chosen = static_cast<int32_t>(i);
         break;
       }
     }
 
-    if (graphic_queue_family >= 0 && present_queue_family >= 0) {
-      result.device = devices[i];
-      result.graphic_queue_index = graphic_queue_family;
-      result.present_queue_index = present_queue_family;
-      break;
-    } else {
-      graphic_queue_family = -1;
-      present_queue_family = -1;
+    if (chosen < 0) {
+      HEX_CORE_WARN("Requested vulkan device '{}' is not available, falling back to the best scored one.", preferred);
+    }
+  }
+
+  if (chosen < 0) {
+    for (size_t i = 0; i < candidates.size(); i++) {
+      if (candidates[i].usable && (chosen < 0 || candidates[i].score > candidates[chosen].score)) {
+        chosen = static_cast<int32_t>(i);
+      }
     }
   }
 
+  if (chosen < 0) {
+    return result;
+  }
+
+  HEX_CORE_INFO("Using vulkan device {}: {}", chosen, candidates[chosen].name);
+
+  result.device = devices[chosen];
+  result.graphic_queue_index = candidates[chosen].graphic_queue_index;
+  result.present_queue_index = candidates[chosen].present_queue_index;
+
   return result;
 }
 
 VkFormat VulkanUtil::PickSurfaceFormat(VkPhysicalDevice device, VkSurfaceKHR surface) {
   uint32_t surface_format_count;
-  vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &surface_format_count, nullptr);
+  g_vk.vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &surface_format_count, nullptr);
 
   std::vector<VkSurfaceFormatKHR> all_formats(surface_format_count);
-  vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &surface_format_count, all_formats.data());
+  g_vk.vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &surface_format_count, all_formats.data());
 
   if (all_formats.size() == 1 && all_formats[0].format == VK_FORMAT_UNDEFINED) {
     return VK_FORMAT_R8G8B8A8_UNORM;
@@ -175,6 +377,36 @@ VkFormat VulkanUtil::PickSurfaceFormat(VkPhysicalDevice device, VkSurfaceKHR sur
   return all_formats[0].format;
 }
 
+uint32_t VulkanUtil::FindMemoryType(VkPhysicalDevice device, uint32_t type_bits, VkMemoryPropertyFlags properties) {
+  VkPhysicalDeviceMemoryProperties memory_properties{};
+  g_vk.vkGetPhysicalDeviceMemoryProperties(device, &memory_properties);
+
+  for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++) {
+    if ((type_bits & (1u << i)) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties) {
+      return i;
+    }
+  }
+
+  return UINT32_MAX;
+}
+
+VkImageAspectFlags VulkanUtil::FormatAspect(VkFormat format) {
+  switch (format) {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+      return VK_IMAGE_ASPECT_DEPTH_BIT;
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+      return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    case VK_FORMAT_S8_UINT:
+      return VK_IMAGE_ASPECT_STENCIL_BIT;
+    default:
+      return VK_IMAGE_ASPECT_COLOR_BIT;
+  }
+}
+
 VKAPI_ATTR VkBool32 VKAPI_CALL VulkanUtil::ValidationCallback(VkDebugReportFlagsEXT flags,
                                                               VkDebugReportObjectTypeEXT type, uint64_t object,
                                                               size_t location, int32_t message_code,
@@ -25,6 +25,7 @@
 
 #include <vulkan/vulkan.h>
 
+#include <string>
 #include <tuple>
 #include <vector>
 
@@ -43,10 +44,18 @@ class VulkanUtil {
 
   static std::tuple<VkInstance, VkDebugReportCallbackEXT> CreateInstance(bool debug);
 
-  static PhysicalDeviceInfo QueryDevice(VkInstance vk_instance, VkSurfaceKHR vk_surface);
+  // Score every device (discrete > integrated > virtual > cpu, then VRAM, then optional extensions), log what each can
+  // do and pick the best usable one. `preferred` is a device index or part of a device name and wins if it is usable.
+  static PhysicalDeviceInfo QueryDevice(VkInstance vk_instance, VkSurfaceKHR vk_surface,
+                                        const std::string& preferred = {});
 
   static VkFormat PickSurfaceFormat(VkPhysicalDevice device, VkSurfaceKHR surface);
 
+  // returns UINT32_MAX if no memory type matches
+  static uint32_t FindMemoryType(VkPhysicalDevice device, uint32_t type_bits, VkMemoryPropertyFlags properties);
+
+  static VkImageAspectFlags FormatAspect(VkFormat format);
+
   static VKAPI_ATTR VkBool32 VKAPI_CALL ValidationCallback(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT type,
                                                            uint64_t object, size_t location, int32_t message_code,
                                                            const char* layer_prefix, const char* message,
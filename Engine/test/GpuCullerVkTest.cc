@@ -0,0 +1,169 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+// Headless smoke test of the culling compute shader. Needs a Vulkan driver, the CPU one of Mesa works:
+//   VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ctest -R GpuCullerVk
+// HEXGON_DEVICE picks the device like for AttachWindow, the test is skipped when no device can be created.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Render/Vulkan/DispatchVk.hpp"
+#include "Render/Vulkan/GpuCullerVk.hpp"
+#include "Render/Vulkan/RenderSystemVk.hpp"
+
+using namespace hexgon;
+
+namespace {
+
+constexpr int kSkip = 77;
+constexpr uint32_t kGroupObjectCount = 10;
+
+void AddBox(GpuCullerVk& culler, uint32_t index, glm::vec3 const& center) {
+  Aabb aabb{center - glm::vec3(0.5f), center + glm::vec3(0.5f)};
+  BoundingSphere sphere{center, 0.87f};
+
+  culler.SetObject(index, aabb, sphere, 36, 0, 0);
+  culler.SetTransform(index, glm::mat4(1.f));
+}
+
+int Run(RenderSystemVk* rs) {
+  // only a missing feature skips, a broken shader or pipeline has to fail the test
+  if (!rs->GetEnabledFeatures().drawIndirectFirstInstance) {
+    std::puts("GpuCullerVk: no drawIndirectFirstInstance, skipped");
+    return kSkip;
+  }
+
+  GpuCullerVk culler{};
+  if (!culler.Init(rs, 1)) {
+    std::puts("GpuCullerVk: init failed");
+    culler.Destroy();
+    return EXIT_FAILURE;
+  }
+
+  // camera at the origin looking down -z, one group of boxes in front of it, one behind and one far to the side
+  culler.SetObjectCount(kGroupObjectCount * 3);
+  for (uint32_t i = 0; i < kGroupObjectCount; i++) {
+    float x = static_cast<float>(i) - kGroupObjectCount * 0.5f;
+
+    AddBox(culler, i, glm::vec3(x, 0.f, -20.f));
+    AddBox(culler, kGroupObjectCount + i, glm::vec3(x, 0.f, 20.f));
+    AddBox(culler, kGroupObjectCount * 2 + i, glm::vec3(1000.f + x, 0.f, -20.f));
+  }
+
+  glm::mat4 view = glm::lookAt(glm::vec3(0.f), glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, 1.f, 0.f));
+  glm::mat4 projection = glm::perspective(glm::radians(60.f), 1.f, 0.1f, 100.f);
+
+  VkDeviceSize draw_size = sizeof(VkDrawIndexedIndirectCommand) * kGroupObjectCount * 3;
+  auto readback = rs->CreateBuffer(sizeof(uint32_t) + draw_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, true);
+  if (!readback) {
+    std::puts("GpuCullerVk: readback buffer failed");
+    culler.Destroy();
+    return EXIT_FAILURE;
+  }
+
+  bool submitted = rs->ImmediateSubmit([&](VkCommandBuffer cmd) {
+    culler.Cull(cmd, 0, projection * view);
+
+    VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    g_vk.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1,
+                              &barrier, 0, nullptr, 0, nullptr);
+
+    VkBufferCopy count_region{0, 0, sizeof(uint32_t)};
+    g_vk.vkCmdCopyBuffer(cmd, culler.GetCountBuffer(), readback->GetBuffer(), 1, &count_region);
+
+    VkBufferCopy draw_region{0, sizeof(uint32_t), draw_size};
+    g_vk.vkCmdCopyBuffer(cmd, culler.GetDrawBuffer(), readback->GetBuffer(), 1, &draw_region);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    g_vk.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0,
+                              nullptr, 0, nullptr);
+  });
+
+  if (!submitted) {
+    std::puts("GpuCullerVk: submit failed");
+    culler.Destroy();
+    return EXIT_FAILURE;
+  }
+
+  auto data = static_cast<uint8_t const*>(readback->GetMappedData());
+
+  uint32_t count = 0;
+  std::memcpy(&count, data, sizeof(uint32_t));
+
+  int result = EXIT_SUCCESS;
+
+  if (count != kGroupObjectCount) {
+    std::printf("GpuCullerVk: expected %u visible objects, got %u\n", kGroupObjectCount, count);
+    result = EXIT_FAILURE;
+  }
+
+  for (uint32_t i = 0; i < count && i < kGroupObjectCount * 3; i++) {
+    VkDrawIndexedIndirectCommand draw{};
+    std::memcpy(&draw, data + sizeof(uint32_t) + sizeof(draw) * i, sizeof(draw));
+
+    if (draw.firstInstance >= kGroupObjectCount || draw.instanceCount != 1 || draw.indexCount != 36) {
+      std::printf("GpuCullerVk: unexpected draw of object %u\n", draw.firstInstance);
+      result = EXIT_FAILURE;
+    }
+  }
+
+  readback.reset();
+  culler.Destroy();
+
+  return result;
+}
+
+}  // namespace
+
+int main() {
+  auto render_system = RenderSystemVk::Create(false);
+  if (!render_system) {
+    std::puts("GpuCullerVk: no Vulkan instance, skipped");
+    return kSkip;
+  }
+
+  auto rs = static_cast<RenderSystemVk*>(render_system.get());
+
+  char const* device = std::getenv("HEXGON_DEVICE");
+  if (!rs->InitHeadless(device ? device : "")) {
+    std::puts("GpuCullerVk: no Vulkan device, skipped");
+    rs->ShutDown();
+    return kSkip;
+  }
+
+  int result = Run(rs);
+
+  rs->ShutDown();
+
+  if (result == EXIT_SUCCESS) {
+    std::puts("GpuCullerVk: ok");
+  }
+
+  return result;
+}
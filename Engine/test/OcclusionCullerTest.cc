@@ -0,0 +1,79 @@
+/*
+ *   Copyright (c) 2023 RuiwenTang
+ *   All rights reserved.
+
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+
+ *   The above copyright notice and this permission notice shall be included in all
+ *   copies or substantial portions of the Software.
+
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *   SOFTWARE.
+ */
+
+// CPU occlusion culling against a single wall in front of the camera.
+
+#include <Hexgon/Core/Bounds.hpp>
+#include <Hexgon/Render/OcclusionCuller.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Core/Geometry/Box.hpp"
+
+using namespace hexgon;
+
+namespace {
+
+Aabb MakeBox(glm::vec3 const& center, float half_extent) {
+  return Aabb{center - glm::vec3(half_extent), center + glm::vec3(half_extent)};
+}
+
+bool Expect(OcclusionCuller const& culler, char const* name, Aabb const& aabb, bool visible) {
+  if (culler.IsVisible(aabb) == visible) {
+    return true;
+  }
+
+  std::printf("OcclusionCuller: %s should be %s\n", name, visible ? "visible" : "culled");
+  return false;
+}
+
+}  // namespace
+
+int main() {
+  // 8 x 4 wall, 5 units in front of the camera looking down -z
+  Box wall(8.f, 4.f, 0.5f, 1, 1, 1);
+  wall.Build();
+
+  glm::mat4 projection = glm::perspective(glm::radians(60.f), 2.f, 0.1f, 100.f);
+
+  OcclusionCuller culler(256, 128);
+  culler.Begin(projection);
+  culler.AddOccluder(&wall, glm::translate(glm::mat4(1.f), glm::vec3(0.f, 0.f, -5.f)));
+  culler.Rasterize();
+
+  bool ok = true;
+
+  ok &= Expect(culler, "box behind the wall", MakeBox(glm::vec3(0.f, 0.f, -20.f), 1.f), false);
+  ok &= Expect(culler, "box beside the wall", MakeBox(glm::vec3(20.f, 0.f, -20.f), 1.f), true);
+  ok &= Expect(culler, "box in front of the wall", MakeBox(glm::vec3(0.f, 0.f, -3.f), 0.5f), true);
+  ok &= Expect(culler, "box crossing the near plane", MakeBox(glm::vec3(0.f, 0.f, 0.f), 1.f), true);
+
+  if (!ok) {
+    return EXIT_FAILURE;
+  }
+
+  std::puts("OcclusionCuller: ok");
+
+  return EXIT_SUCCESS;
+}